@@ -229,6 +229,34 @@ $$($(1)_BIN): $$($(1)_CC_DEPS) \
                $$($(1)_S_OBJS) | $$(OUT)/$(1) $$($(1)_DIRS)
 	$(V)$(3) -o $$@ $(11) $$(filter %.o, $$^) $(12) $(10)
 
+# Log Format Table #############################################################
+
+# With deferred log formatting, the log macros place the format strings in the
+# .chre_log_formats section (CHRE_LOG_FORMAT_SECTION in log_format_common.h).
+# The host decodes logs with these strings, so extract them next to the shared
+# object and optionally install them.
+ifeq ($(CHRE_DEFERRED_LOG_FORMATTING_ENABLED),true)
+ifeq ($(IS_NANOAPP_BUILD),)
+ifneq ($(IS_ARCHIVE_ONLY_BUILD),true)
+$(1)_LOG_FORMATS = $(OUT)/$(1)/libchre_log_formats.bin
+
+.PHONY: $(1)_log_formats
+$(1)_log_formats: $$($(1)_LOG_FORMATS)
+
+$(1): $(1)_log_formats
+
+$$($(1)_LOG_FORMATS): $$($(1)_SO)
+	@echo " [LOG FORMATS] $$@"
+	$(V)$(CHRE_LOG_FORMATS_OBJCOPY) -O binary \
+		--only-section=.chre_log_formats $$< $$@
+ifneq ($(CHRE_LOG_FORMATS_INSTALL_DIR),)
+	$(V)mkdir -p $(CHRE_LOG_FORMATS_INSTALL_DIR)
+	$(V)cp $$@ $(CHRE_LOG_FORMATS_INSTALL_DIR)/
+endif
+endif
+endif
+endif
+
 # Output Directories ###########################################################
 
 $$($$$(1)_DIRS):
@@ -40,6 +40,14 @@ extern "C" {
  */
 uint32_t chppCrc32(uint32_t crc, const uint8_t *buf, size_t len);
 
+/**
+ * Portable implementation of chppCrc32() using a 64-byte lookup table, which
+ * is used by chppCrc32() unless the build selects a platform-specific backend
+ * by defining CHPP_CRC32_FAST, in which case the platform must provide
+ * chppPlatformCrc32() through chpp/platform/platform_crc.h.
+ */
+uint32_t chppCrc32Nibble(uint32_t crc, const uint8_t *buf, size_t len);
+
 #ifdef __cplusplus
 }
 #endif
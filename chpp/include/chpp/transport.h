@@ -129,6 +129,26 @@ extern "C" {
  */
 #define CHPP_TX_DATAGRAM_QUEUE_LEN ((uint8_t)16)
 
+/**
+ * Maximum number of outstanding (i.e. sent but not yet ACKed) payload-bearing
+ * packets, which is the upper bound of the negotiated window size. The
+ * per-sequence Tx state is indexed by sequence number modulo this value, so it
+ * must be a power of 2.
+ */
+#define CHPP_TRANSPORT_MAX_WINDOW_SIZE ((uint8_t)16)
+
+/**
+ * Window size advertised by this endpoint in its reset and reset-ack packets.
+ * The window size that is used on the link is the smaller of the sizes
+ * advertised by the two endpoints, so a window of more than one packet is only
+ * used when both endpoints support it. A window size of 1 results in
+ * stop-and-wait operation. Must be between 1 and
+ * CHPP_TRANSPORT_MAX_WINDOW_SIZE.
+ */
+#ifndef CHPP_TRANSPORT_WINDOW_SIZE
+#define CHPP_TRANSPORT_WINDOW_SIZE 1
+#endif
+
 /**
  * Maximum payload of packets at the link layer.
  * TODO: Negotiate or advertise MTU. In the mean time, set default as to achieve
@@ -307,7 +327,7 @@ struct ChppTransportConfiguration {
   //! Receive MTU size.
   uint16_t rxMtu;
 
-  //! Max outstanding packet window size (1 for current implementation).
+  //! Max outstanding packet window size (CHPP_TRANSPORT_WINDOW_SIZE).
   uint16_t windowSize;
 
   //! Transport layer timeout in milliseconds (i.e. to receive ACK).
@@ -339,6 +359,23 @@ struct ChppRxStatus {
   //! Location counter in bytes within the current Rx datagram.
   size_t locInDatagram;
 
+  //! Allocated size in bytes of the current Rx datagram's payload buffer,
+  //! which may be larger than its length while a fragmented datagram is being
+  //! reassembled.
+  size_t datagramCapacity;
+
+  //! The number of times an Rx datagram's payload buffer was grown to make
+  //! room for another fragment.
+  size_t numDatagramReallocs;
+
+  //! The total length in bytes of the Rx datagram data that had been
+  //! reassembled when its buffer was grown, i.e. an upper bound of the data
+  //! copied by chppRealloc().
+  size_t numDatagramBytesCopied;
+
+  //! The largest Rx datagram payload buffer allocated, in bytes.
+  size_t peakDatagramCapacity;
+
   //! The total number of data received in chppRxDataCb.
   size_t numTotalDataBytes;
 
@@ -347,6 +384,23 @@ struct ChppRxStatus {
 
   //! The timestamp when the transport received a good RX packet.
   uint32_t lastGoodPacketTimeMs;
+
+  //! Whether an out-of-order NACK has already been sent for a packet received
+  //! ahead of expectedSeq, so that the rest of the window following a lost
+  //! packet does not result in a flood of NACKs.
+  bool orderNackSent;
+};
+
+/**
+ * Tx state of an outstanding (i.e. sent but not yet ACKed) payload-bearing
+ * packet.
+ */
+struct ChppTxWindowEntry {
+  //! Payload length of the packet in bytes.
+  uint16_t length;
+
+  //! Whether the packet concludes its datagram.
+  bool finishesDatagram;
 };
 
 struct ChppTxStatus {
@@ -371,19 +425,38 @@ struct ChppTxStatus {
   //! Time when the last packet was sent to the link layer.
   uint64_t lastTxTimeNs;
 
-  //! How many bytes of the front-of-queue datagram has been sent out
+  //! How many bytes of the datagram being sent have been sent out
   size_t sentLocInDatagram;
 
-  //! Note: For a future ACK window >1, sentLocInDatagram doesn't always apply
-  //! to the front-of-queue datagram. Instead, we need to track the queue
-  //! position the datagram being sent as well (relative to the front-of-queue).
-  //! e.g. uint8_t datagramBeingSent
+  //! Queue position of the datagram being sent (i.e. that sentLocInDatagram
+  //! applies to), relative to the front-of-queue.
+  uint8_t datagramBeingSent;
 
   //! How many bytes of the front-of-queue datagram has been acked
   size_t ackedLocInDatagram;
 
   //! Whether the link layer is still processing pendingTxPacket
   bool linkBusy;
+
+  //! Negotiated maximum number of outstanding payload-bearing packets.
+  uint8_t windowSize;
+
+  //! Number of payload-bearing packets that have been sent but not ACKed,
+  //! starting at sequence number rxStatus.receivedAckSeq.
+  uint8_t packetsInFlight;
+
+  //! Number of these packets that have been (re)sent since the last
+  //! retransmission started, i.e. the next payload-bearing packet has sequence
+  //! number rxStatus.receivedAckSeq + packetsSent.
+  uint8_t packetsSent;
+
+  //! Whether the outstanding packets need to be resent starting from
+  //! ackedLocInDatagram, i.e. after a NACK or an ACK timeout.
+  bool retransmitPending;
+
+  //! Tx state of the outstanding packets, indexed by sequence number modulo
+  //! CHPP_TRANSPORT_MAX_WINDOW_SIZE.
+  struct ChppTxWindowEntry window[CHPP_TRANSPORT_MAX_WINDOW_SIZE];
 };
 
 struct PendingTxPacket {
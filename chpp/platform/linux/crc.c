@@ -0,0 +1,262 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "chpp/platform/platform_crc.h"
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CHPP_CRC32_HW_X86
+#elif defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#define CHPP_CRC32_HW_ARM
+#endif
+
+//! Reflected IEEE CRC-32 polynomial.
+#define CHPP_CRC32_POLY 0xEDB88320u
+
+//! Slice-by-8 lookup tables. Table 0 is the classic byte-wise table, and table
+//! k gives the CRC contribution of a byte followed by k zero bytes.
+static uint32_t gCrc32Tables[8][256];
+
+//! Whether chppCrc32Hw() is supported, set along with the tables.
+static bool gCrc32HwSupported;
+
+static pthread_once_t gCrc32InitOnce = PTHREAD_ONCE_INIT;
+
+static void crc32Init(void) {
+  for (uint32_t i = 0; i < 256; i++) {
+    uint32_t crc = i;
+    for (int bit = 0; bit < 8; bit++) {
+      crc = (crc >> 1) ^ ((crc & 1) ? CHPP_CRC32_POLY : 0);
+    }
+    gCrc32Tables[0][i] = crc;
+  }
+  for (uint32_t i = 0; i < 256; i++) {
+    for (size_t k = 1; k < 8; k++) {
+      uint32_t prev = gCrc32Tables[k - 1][i];
+      gCrc32Tables[k][i] = (prev >> 8) ^ gCrc32Tables[0][prev & 0xff];
+    }
+  }
+
+#if defined(CHPP_CRC32_HW_X86)
+  __builtin_cpu_init();
+  gCrc32HwSupported =
+      __builtin_cpu_supports("pclmul") && __builtin_cpu_supports("sse4.1");
+#elif defined(CHPP_CRC32_HW_ARM)
+  // The CRC32 instructions are part of the target ISA this was built for.
+  gCrc32HwSupported = true;
+#else
+  gCrc32HwSupported = false;
+#endif
+}
+
+static void crc32EnsureInit(void) {
+  pthread_once(&gCrc32InitOnce, crc32Init);
+}
+
+/**
+ * Advances the (non-inverted) CRC register over the buffer using slice-by-8.
+ */
+static uint32_t crc32SliceBy8Update(uint32_t reg, const uint8_t *buf,
+                                    size_t len) {
+  while (len >= 8) {
+    // Assembled byte-wise to be independent of endianness and alignment;
+    // compilers reduce this to a single load on little endian targets.
+    uint32_t lo = (uint32_t)buf[0] | ((uint32_t)buf[1] << 8) |
+                  ((uint32_t)buf[2] << 16) | ((uint32_t)buf[3] << 24);
+    uint32_t hi = (uint32_t)buf[4] | ((uint32_t)buf[5] << 8) |
+                  ((uint32_t)buf[6] << 16) | ((uint32_t)buf[7] << 24);
+    lo ^= reg;
+    reg = gCrc32Tables[7][lo & 0xff] ^ gCrc32Tables[6][(lo >> 8) & 0xff] ^
+          gCrc32Tables[5][(lo >> 16) & 0xff] ^ gCrc32Tables[4][lo >> 24] ^
+          gCrc32Tables[3][hi & 0xff] ^ gCrc32Tables[2][(hi >> 8) & 0xff] ^
+          gCrc32Tables[1][(hi >> 16) & 0xff] ^ gCrc32Tables[0][hi >> 24];
+    buf += 8;
+    len -= 8;
+  }
+
+  while (len-- > 0) {
+    reg = (reg >> 8) ^ gCrc32Tables[0][(reg ^ *buf++) & 0xff];
+  }
+
+  return reg;
+}
+
+#if defined(CHPP_CRC32_HW_X86)
+
+//! The minimum length processed by crc32ClmulUpdate().
+#define CHPP_CRC32_CLMUL_MIN_LEN 64
+
+//! Loads 16 bytes from a possibly unaligned buffer.
+__attribute__((target("sse4.1,pclmul"))) static inline __m128i crc32LoadBlock(
+    const uint8_t *buf) {
+  return _mm_loadu_si128((const __m128i *)(const void *)buf);
+}
+
+/**
+ * Advances the (non-inverted) CRC register over the buffer by folding 512 bits
+ * at a time with carry-less multiplication, then reducing with Barrett
+ * reduction, per Intel's "Fast CRC Computation for Generic Polynomials Using
+ * PCLMULQDQ Instruction". The constants are for the bit-reflected IEEE
+ * polynomial.
+ *
+ * @param len Must be at least CHPP_CRC32_CLMUL_MIN_LEN and a multiple of 16.
+ */
+__attribute__((target("sse4.1,pclmul"))) static uint32_t crc32ClmulUpdate(
+    uint32_t reg, const uint8_t *buf, size_t len) {
+  const __m128i k1k2 = _mm_set_epi64x(0x01c6e41596, 0x0154442bd4);
+  const __m128i k3k4 = _mm_set_epi64x(0x00ccaa009e, 0x01751997d0);
+  const __m128i k5k0 = _mm_set_epi64x(0, 0x0163cd6124);
+  const __m128i poly = _mm_set_epi64x(0x01f7011641, 0x01db710641);
+  const __m128i mask32 = _mm_setr_epi32(~0, 0, ~0, 0);
+  __m128i x1, x2, x3, x4, x5, x6, x7, x8;
+
+  x1 = crc32LoadBlock(buf + 0x00);
+  x2 = crc32LoadBlock(buf + 0x10);
+  x3 = crc32LoadBlock(buf + 0x20);
+  x4 = crc32LoadBlock(buf + 0x30);
+  x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128((int)reg));
+  buf += 64;
+  len -= 64;
+
+  // Fold four 128-bit lanes in parallel.
+  while (len >= 64) {
+    x5 = _mm_clmulepi64_si128(x1, k1k2, 0x00);
+    x6 = _mm_clmulepi64_si128(x2, k1k2, 0x00);
+    x7 = _mm_clmulepi64_si128(x3, k1k2, 0x00);
+    x8 = _mm_clmulepi64_si128(x4, k1k2, 0x00);
+
+    x1 = _mm_clmulepi64_si128(x1, k1k2, 0x11);
+    x2 = _mm_clmulepi64_si128(x2, k1k2, 0x11);
+    x3 = _mm_clmulepi64_si128(x3, k1k2, 0x11);
+    x4 = _mm_clmulepi64_si128(x4, k1k2, 0x11);
+
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), crc32LoadBlock(buf + 0x00));
+    x2 = _mm_xor_si128(_mm_xor_si128(x2, x6), crc32LoadBlock(buf + 0x10));
+    x3 = _mm_xor_si128(_mm_xor_si128(x3, x7), crc32LoadBlock(buf + 0x20));
+    x4 = _mm_xor_si128(_mm_xor_si128(x4, x8), crc32LoadBlock(buf + 0x30));
+    buf += 64;
+    len -= 64;
+  }
+
+  // Fold the four lanes into one.
+  x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+  x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+  x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+
+  x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+  x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+  x1 = _mm_xor_si128(_mm_xor_si128(x1, x3), x5);
+
+  x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+  x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+  x1 = _mm_xor_si128(_mm_xor_si128(x1, x4), x5);
+
+  // Fold any remaining 128-bit blocks.
+  while (len >= 16) {
+    x2 = crc32LoadBlock(buf);
+    x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+    buf += 16;
+    len -= 16;
+  }
+
+  // Fold 128 bits to 64 bits.
+  x2 = _mm_clmulepi64_si128(x1, k3k4, 0x10);
+  x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), x2);
+
+  x2 = _mm_srli_si128(x1, 4);
+  x1 = _mm_and_si128(x1, mask32);
+  x1 = _mm_clmulepi64_si128(x1, k5k0, 0x00);
+  x1 = _mm_xor_si128(x1, x2);
+
+  // Barrett reduction to 32 bits.
+  x2 = _mm_and_si128(x1, mask32);
+  x2 = _mm_clmulepi64_si128(x2, poly, 0x10);
+  x2 = _mm_and_si128(x2, mask32);
+  x2 = _mm_clmulepi64_si128(x2, poly, 0x00);
+  x1 = _mm_xor_si128(x1, x2);
+
+  return (uint32_t)_mm_extract_epi32(x1, 1);
+}
+
+#elif defined(CHPP_CRC32_HW_ARM)
+
+/**
+ * Advances the (non-inverted) CRC register over the buffer using the ARMv8
+ * CRC32 instructions, which implement the IEEE polynomial.
+ */
+static uint32_t crc32ArmUpdate(uint32_t reg, const uint8_t *buf, size_t len) {
+  while (len >= 8) {
+    uint64_t value = 0;
+    for (int i = 7; i >= 0; i--) {
+      value = (value << 8) | buf[i];
+    }
+    reg = __crc32d(reg, value);
+    buf += 8;
+    len -= 8;
+  }
+
+  while (len-- > 0) {
+    reg = __crc32b(reg, *buf++);
+  }
+
+  return reg;
+}
+
+#endif
+
+uint32_t chppCrc32SliceBy8(uint32_t crc, const uint8_t *buf, size_t len) {
+  crc32EnsureInit();
+  return ~crc32SliceBy8Update(~crc, buf, len);
+}
+
+bool chppCrc32HwSupported(void) {
+  crc32EnsureInit();
+  return gCrc32HwSupported;
+}
+
+uint32_t chppCrc32Hw(uint32_t crc, const uint8_t *buf, size_t len) {
+  crc32EnsureInit();
+  uint32_t reg = ~crc;
+
+#if defined(CHPP_CRC32_HW_X86)
+  if (len >= CHPP_CRC32_CLMUL_MIN_LEN) {
+    size_t blockLen = len & ~(size_t)15;
+    reg = crc32ClmulUpdate(reg, buf, blockLen);
+    buf += blockLen;
+    len -= blockLen;
+  }
+  reg = crc32SliceBy8Update(reg, buf, len);
+#elif defined(CHPP_CRC32_HW_ARM)
+  reg = crc32ArmUpdate(reg, buf, len);
+#else
+  reg = crc32SliceBy8Update(reg, buf, len);
+#endif
+
+  return ~reg;
+}
+
+uint32_t chppPlatformCrc32(uint32_t crc, const uint8_t *buf, size_t len) {
+  return chppCrc32HwSupported() ? chppCrc32Hw(crc, buf, len)
+                                : chppCrc32SliceBy8(crc, buf, len);
+}
@@ -0,0 +1,63 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CHPP_PLATFORM_CRC_H_
+#define CHPP_PLATFORM_CRC_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Fast CRC-32 backends for the Linux platform, where memory for lookup tables
+ * is not constrained. chppCrc32() uses chppPlatformCrc32() when built with
+ * CHPP_CRC32_FAST defined. All functions follow the semantics of chppCrc32().
+ */
+
+/**
+ * Calculates IEEE CRC-32 using the hardware backend if the CPU supports it,
+ * and chppCrc32SliceBy8() otherwise.
+ */
+uint32_t chppPlatformCrc32(uint32_t crc, const uint8_t *buf, size_t len);
+
+/**
+ * Calculates IEEE CRC-32 processing 8 bytes per iteration, using 8 lookup
+ * tables totalling 8 KB.
+ */
+uint32_t chppCrc32SliceBy8(uint32_t crc, const uint8_t *buf, size_t len);
+
+/**
+ * @return true if chppCrc32Hw() is supported by the CPU, i.e. PCLMULQDQ and
+ * SSE4.1 on x86, or the CRC32 instructions on ARMv8.
+ */
+bool chppCrc32HwSupported(void);
+
+/**
+ * Calculates IEEE CRC-32 using carry-less multiplication (x86) or the CRC32
+ * instructions (ARMv8). Must only be called if chppCrc32HwSupported() returns
+ * true.
+ */
+uint32_t chppCrc32Hw(uint32_t crc, const uint8_t *buf, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // CHPP_PLATFORM_CRC_H_
@@ -20,6 +20,7 @@
 #include <pthread.h>
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 
 #include "chpp/mutex.h"
 #include "chpp/notifier.h"
@@ -33,9 +34,22 @@ extern "C" {
 
 #define CHPP_PLATFORM_TRANSPORT_TIMEOUT_MS 1000
 
+//! Max number of packets that can be in transit on a simulated link with
+//! latency (see ChppPlatformLinkParameters.latencyNs).
+#define CHPP_PLATFORM_LINK_DELAY_QUEUE_LEN 32
+
 // Forward declaration
 struct ChppTransportState;
 
+//! A packet in transit on a simulated link with latency.
+struct ChppPlatformLinkDelayedPacket {
+  //! Time at which the packet is delivered to the remote endpoint.
+  uint64_t deliveryTimeNs;
+
+  uint8_t buf[CHPP_PLATFORM_LINK_TX_MTU_BYTES];
+  size_t bufLen;
+};
+
 struct ChppPlatformLinkParameters {
   //! Indicates that the link to the remote endpoint has been established.
   //! This simulates the establishment of the physical link, so
@@ -67,6 +81,26 @@ struct ChppPlatformLinkParameters {
   //! A flag to indicate if the link is active. Setting this value to false
   //! will cause the CHPP link layer to fail to send/receive messages.
   bool isLinkActive;
+
+  //! Simulated one-way latency of the link. If this or dropPercent is
+  //! non-zero, sent packets are delivered to the remote endpoint after this
+  //! delay, while the link is immediately available to send the next packet
+  //! (i.e. packets are pipelined as on a real link).
+  uint64_t latencyNs;
+
+  //! Percentage of sent packets that are silently dropped by the simulated
+  //! link.
+  uint8_t dropPercent;
+
+  //! Pseudo-random state used to select the dropped packets. A fixed seed
+  //! makes the dropped packets reproducible.
+  uint32_t dropRandomState;
+
+  //! Packets in transit when simulating latency, in order of delivery.
+  struct ChppPlatformLinkDelayedPacket
+      delayedPackets[CHPP_PLATFORM_LINK_DELAY_QUEUE_LEN];
+  size_t delayedFront;
+  size_t delayedCount;
 };
 
 #ifdef __cplusplus
@@ -23,12 +23,94 @@
 
 #include "chpp/log.h"
 #include "chpp/macros.h"
+#include "chpp/time.h"
 #include "chpp/transport.h"
 
 // The set of signals to use for the linkSendThread.
 #define SIGNAL_EXIT UINT32_C(1 << 0)
 #define SIGNAL_DATA UINT32_C(1 << 1)
 
+/**
+ * @return True if the link simulates latency and/or packet loss, in which case
+ * sent packets go through the delayed packet queue.
+ */
+static bool isSimulatedLink(const struct ChppPlatformLinkParameters *params) {
+  return (params->latencyNs > 0 || params->dropPercent > 0);
+}
+
+/**
+ * @return True if the packet that is being sent should be dropped by the
+ * simulated link.
+ */
+static bool shouldDropPacket(struct ChppPlatformLinkParameters *params) {
+  // xorshift32
+  uint32_t x = (params->dropRandomState != 0) ? params->dropRandomState : 1;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  params->dropRandomState = x;
+
+  return (x % 100 < params->dropPercent);
+}
+
+/**
+ * Queues the packet that is being sent for delivery once the simulated latency
+ * has elapsed. Must be called with params->mutex held.
+ */
+static void delayPacket(struct ChppPlatformLinkParameters *params) {
+  if (shouldDropPacket(params)) {
+    CHPP_LOGD("Simulated link dropped %" PRIuSIZE " bytes",
+              params->bufLen);
+
+  } else if (params->delayedCount >= CHPP_PLATFORM_LINK_DELAY_QUEUE_LEN) {
+    CHPP_LOGE("Simulated link queue full, dropped %" PRIuSIZE " bytes",
+              params->bufLen);
+
+  } else {
+    size_t end = (params->delayedFront + params->delayedCount) %
+                 CHPP_PLATFORM_LINK_DELAY_QUEUE_LEN;
+    struct ChppPlatformLinkDelayedPacket *packet =
+        &params->delayedPackets[end];
+    packet->deliveryTimeNs = chppGetCurrentTimeNs() + params->latencyNs;
+    memcpy(packet->buf, params->buf, params->bufLen);
+    packet->bufLen = params->bufLen;
+    params->delayedCount++;
+  }
+}
+
+/**
+ * Delivers the delayed packets that are due to the remote endpoint.
+ *
+ * @return The time until the next delayed packet is due, or
+ * CHPP_TRANSPORT_TIMEOUT_INFINITE if there is none.
+ */
+static uint64_t deliverDelayedPackets(
+    struct ChppPlatformLinkParameters *params) {
+  uint64_t timeoutNs = CHPP_TRANSPORT_TIMEOUT_INFINITE;
+
+  chppMutexLock(&params->mutex);
+  while (params->delayedCount > 0) {
+    struct ChppPlatformLinkDelayedPacket *packet =
+        &params->delayedPackets[params->delayedFront];
+    uint64_t now = chppGetCurrentTimeNs();
+    if (packet->deliveryTimeNs > now) {
+      timeoutNs = packet->deliveryTimeNs - now;
+      break;
+    }
+
+    if (params->remoteTransportContext != NULL && params->linkEstablished) {
+      chppRxDataCb(params->remoteTransportContext, packet->buf,
+                   packet->bufLen);
+    }
+    params->delayedFront =
+        (params->delayedFront + 1) % CHPP_PLATFORM_LINK_DELAY_QUEUE_LEN;
+    params->delayedCount--;
+  }
+  chppMutexUnlock(&params->mutex);
+
+  return timeoutNs;
+}
+
 /**
  * This thread is used to "send" TX data to the remote endpoint. The remote
  * endpoint is defined by the ChppTransportState pointer, so a loopback link
@@ -37,8 +119,9 @@
 static void *linkSendThread(void *arg) {
   struct ChppPlatformLinkParameters *params =
       (struct ChppPlatformLinkParameters *)arg;
+  uint64_t timeoutNs = CHPP_TRANSPORT_TIMEOUT_INFINITE;
   while (true) {
-    uint32_t signal = chppNotifierTimedWait(&params->notifier, CHPP_TIME_MAX);
+    uint32_t signal = chppNotifierTimedWait(&params->notifier, timeoutNs);
 
     if (signal & SIGNAL_EXIT) {
       break;
@@ -56,6 +139,10 @@ static void *linkSendThread(void *arg) {
         CHPP_LOGE("No (fake) link");
         error = CHPP_LINK_ERROR_NO_LINK;
 
+      } else if (isSimulatedLink(params)) {
+        delayPacket(params);
+        error = CHPP_LINK_ERROR_NONE_SENT;
+
       } else if (!chppRxDataCb(params->remoteTransportContext, params->buf,
                                params->bufLen)) {
         CHPP_LOGW("chppRxDataCb return state!=preamble (packet incomplete)");
@@ -70,6 +157,8 @@ static void *linkSendThread(void *arg) {
 
       chppMutexUnlock(&params->mutex);
     }
+
+    timeoutNs = deliverDelayedPackets(params);
   }
 
   return NULL;
@@ -77,6 +166,8 @@ static void *linkSendThread(void *arg) {
 
 void chppPlatformLinkInit(struct ChppPlatformLinkParameters *params) {
   params->bufLen = 0;
+  params->delayedFront = 0;
+  params->delayedCount = 0;
   chppMutexInit(&params->mutex);
   chppNotifierInit(&params->notifier);
   pthread_create(&params->linkSendThread, NULL /* attr */, linkSendThread,
@@ -80,10 +80,14 @@ uint32_t chppPlatformNotifierTimedWait(struct ChppNotifier *notifier,
     timeout = absTime;
     timeout.tv_sec += timeoutS;
     timeout.tv_nsec += timeoutNs;
+    if (timeout.tv_nsec >= (long)CHPP_NSEC_PER_SEC) {
+      timeout.tv_sec++;
+      timeout.tv_nsec -= (long)CHPP_NSEC_PER_SEC;
+    }
 
     while ((notifier->signal == 0) &&
            (CHPP_TIMESPEC_TO_NS(absTime) < CHPP_TIMESPEC_TO_NS(timeout))) {
-      pthread_cond_timedwait(&notifier->cond, &notifier->mutex.lock, &absTime);
+      pthread_cond_timedwait(&notifier->cond, &notifier->mutex.lock, &timeout);
       clock_gettime(CLOCK_REALTIME, &absTime);
     }
     uint32_t signal = notifier->signal;
@@ -19,7 +19,19 @@
 #include <stddef.h>
 #include <stdint.h>
 
+#ifdef CHPP_CRC32_FAST
+#include "chpp/platform/platform_crc.h"
+#endif
+
 uint32_t chppCrc32(uint32_t crc, const uint8_t *buf, size_t len) {
+#ifdef CHPP_CRC32_FAST
+  return chppPlatformCrc32(crc, buf, len);
+#else
+  return chppCrc32Nibble(crc, buf, len);
+#endif
+}
+
+uint32_t chppCrc32Nibble(uint32_t crc, const uint8_t *buf, size_t len) {
   // This lookup table (LUT) consumes 16 * 4 = 64 bytes. Other implementations
   // exist with a larger LUT, with a LUT calculated on the fly, or without using
   // a LUT altogether.
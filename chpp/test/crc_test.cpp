@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "chpp/crc.h"
+#include "chpp/platform/platform_crc.h"
+
+namespace {
+
+typedef uint32_t(Crc32Function)(uint32_t crc, const uint8_t *buf, size_t len);
+
+constexpr size_t kMaxTestLen = 1100;
+constexpr size_t kMaxOffset = 16;
+
+//! Fills the buffer with a deterministic pseudo-random pattern.
+void fillTestPattern(uint8_t *buf, size_t len) {
+  uint32_t state = 0x12345678;
+  for (size_t i = 0; i < len; i++) {
+    state = state * 1103515245 + 12345;
+    buf[i] = static_cast<uint8_t>(state >> 16);
+  }
+}
+
+/**
+ * Verifies that the given backend is bit-exact with chppCrc32Nibble() across
+ * all lengths up to kMaxTestLen, unaligned offsets, and non-zero initial
+ * values.
+ */
+void verifyMatchesReference(Crc32Function *crc32) {
+  static uint8_t buf[kMaxTestLen + kMaxOffset];
+  fillTestPattern(buf, sizeof(buf));
+
+  for (size_t offset = 0; offset < kMaxOffset; offset++) {
+    for (size_t len = 0; len <= kMaxTestLen; len++) {
+      const uint8_t *data = &buf[offset];
+      ASSERT_EQ(crc32(0, data, len), chppCrc32Nibble(0, data, len))
+          << "offset " << offset << " len " << len;
+      ASSERT_EQ(crc32(0xdeadbeef, data, len),
+                chppCrc32Nibble(0xdeadbeef, data, len))
+          << "offset " << offset << " len " << len;
+    }
+  }
+}
+
+}  // namespace
+
+TEST(Crc32Test, KnownVector) {
+  static const char kTestStr[] = "123456789";
+  const uint8_t *test = reinterpret_cast<const uint8_t *>(kTestStr);
+  EXPECT_EQ(chppCrc32Nibble(0, test, 9), 0xCBF43926);
+  EXPECT_EQ(chppCrc32SliceBy8(0, test, 9), 0xCBF43926);
+  EXPECT_EQ(chppPlatformCrc32(0, test, 9), 0xCBF43926);
+  if (chppCrc32HwSupported()) {
+    EXPECT_EQ(chppCrc32Hw(0, test, 9), 0xCBF43926);
+  }
+}
+
+TEST(Crc32Test, SliceBy8MatchesReference) {
+  verifyMatchesReference(chppCrc32SliceBy8);
+}
+
+TEST(Crc32Test, HwMatchesReference) {
+  if (!chppCrc32HwSupported()) {
+    GTEST_SKIP() << "No hardware CRC-32 support";
+  }
+  verifyMatchesReference(chppCrc32Hw);
+}
+
+TEST(Crc32Test, DefaultMatchesReference) {
+  verifyMatchesReference(chppCrc32);
+}
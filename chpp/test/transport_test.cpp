@@ -22,9 +22,12 @@
 #include <stddef.h>
 #include <stdint.h>
 #include <string.h>
+#include <chrono>
 #include <thread>
 
+#include "app_test_base.h"
 #include "chpp/app.h"
+#include "chpp/clients/loopback.h"
 #include "chpp/common/discovery.h"
 #include "chpp/common/gnss.h"
 #include "chpp/common/gnss_types.h"
@@ -1150,6 +1153,162 @@ TEST_F(TransportTests, WorkMonitorInvoked) {
   EXPECT_EQ(mTransportContext.workMonitor.numPostProcessCalls, 2);
 }
 
+/**
+ * Sends a reset packet advertising the given window size and returns the
+ * window size the transport layer has negotiated in response.
+ */
+uint8_t negotiateWindowSize(ChppTransportState *transportContext, uint8_t *buf,
+                            uint16_t windowSize) {
+  size_t loc = 0;
+  addPreambleToBuf(buf, &loc);
+  ChppTransportHeader *transHeader = addTransportHeaderToBuf(buf, &loc);
+  transHeader->packetCode = CHPP_ATTR_AND_ERROR_TO_PACKET_CODE(
+      CHPP_TRANSPORT_ATTR_RESET, CHPP_TRANSPORT_ERROR_NONE);
+  transHeader->ackSeq = 0;
+  transHeader->length = sizeof(ChppTransportConfiguration);
+
+  ChppTransportConfiguration config = {};
+  config.version.major = 1;
+  config.rxMtu = CHPP_PLATFORM_LINK_RX_MTU_BYTES;
+  config.windowSize = windowSize;
+  config.timeoutInMs = CHPP_PLATFORM_TRANSPORT_TIMEOUT_MS;
+  memcpy(&buf[loc], &config, sizeof(config));
+  loc += sizeof(config);
+
+  addTransportFooterToBuf(buf, &loc);
+  EXPECT_TRUE(chppRxDataCb(transportContext, buf, loc));
+
+  return transportContext->txStatus.windowSize;
+}
+
+/**
+ * The window size is the smaller of the local and remote window sizes, so a
+ * remote endpoint that only supports a window of 1 gets stop-and-wait.
+ */
+TEST_F(TransportTests, ResetNegotiatesWindowSize) {
+  EXPECT_EQ(negotiateWindowSize(&mTransportContext, mBuf, 1), 1);
+  EXPECT_EQ(negotiateWindowSize(&mTransportContext, mBuf, 0), 1);
+  EXPECT_EQ(negotiateWindowSize(&mTransportContext, mBuf, 2),
+            MIN(2, CHPP_TRANSPORT_WINDOW_SIZE));
+  EXPECT_EQ(negotiateWindowSize(&mTransportContext, mBuf, UINT16_MAX),
+            CHPP_TRANSPORT_WINDOW_SIZE);
+}
+
+/**
+ * Reassembling a fragmented datagram should grow the RX buffer a logarithmic
+ * number of times, copying less data than the datagram length.
+ */
+TEST_F(TransportTests, FragmentedDatagramReassembly) {
+  constexpr size_t kFragmentLen = 1000;
+  constexpr size_t kFragmentCount = 16;
+
+  for (size_t i = 0; i < kFragmentCount; i++) {
+    size_t loc = 0;
+    addPreambleToBuf(mBuf, &loc);
+    ChppTransportHeader *transHeader = addTransportHeaderToBuf(mBuf, &loc);
+    transHeader->flags = CHPP_TRANSPORT_FLAG_UNFINISHED_DATAGRAM;
+    transHeader->seq = static_cast<uint8_t>(i);
+    transHeader->length = kFragmentLen;
+    memset(&mBuf[loc], static_cast<int>(i), kFragmentLen);
+    loc += kFragmentLen;
+    addTransportFooterToBuf(mBuf, &loc);
+
+    EXPECT_TRUE(chppRxDataCb(&mTransportContext, mBuf, loc));
+    ASSERT_EQ(mTransportContext.rxDatagram.length, (i + 1) * kFragmentLen);
+  }
+
+  for (size_t i = 0; i < kFragmentCount; i++) {
+    EXPECT_EQ(mTransportContext.rxDatagram.payload[i * kFragmentLen], i);
+    EXPECT_EQ(mTransportContext.rxDatagram.payload[(i + 1) * kFragmentLen - 1],
+              i);
+  }
+
+  const ChppRxStatus &rxStatus = mTransportContext.rxStatus;
+  EXPECT_EQ(rxStatus.numDatagramReallocs, 4);
+  EXPECT_LT(rxStatus.numDatagramBytesCopied, kFragmentCount * kFragmentLen);
+  EXPECT_EQ(rxStatus.peakDatagramCapacity, kFragmentCount * kFragmentLen);
+  EXPECT_EQ(rxStatus.datagramCapacity, kFragmentCount * kFragmentLen);
+
+  // Partially received datagrams are only freed by a transport reset
+  CHPP_FREE_AND_NULLIFY(mTransportContext.rxDatagram.payload);
+  mTransportContext.rxDatagram.length = 0;
+}
+
 INSTANTIATE_TEST_SUITE_P(TransportTestRange, TransportTests,
                          testing::ValuesIn(kChunkSizes));
 }  // namespace
+
+namespace chpp {
+namespace {
+
+/*
+ * Test suite for the CHPP Transport Layer window, with a client and a service
+ * endpoint connected through a simulated lossy, high-latency link.
+ */
+class TransportWindowTests : public AppTestBase {
+ protected:
+  void setLinkConditions(ChppTransportState *transportContext,
+                         uint64_t latencyNs, uint8_t dropPercent) {
+    ChppPlatformLinkParameters *params = &transportContext->linkParams;
+    chppMutexLock(&params->mutex);
+    params->latencyNs = latencyNs;
+    params->dropPercent = dropPercent;
+    params->dropRandomState = 0x1234;
+    chppMutexUnlock(&params->mutex);
+  }
+
+  void setWindowSize(ChppTransportState *transportContext,
+                     uint8_t windowSize) {
+    chppMutexLock(&transportContext->mutex);
+    transportContext->txStatus.windowSize = windowSize;
+    chppMutexUnlock(&transportContext->mutex);
+  }
+};
+
+TEST_F(TransportWindowTests, WindowNegotiatedOnReset) {
+  EXPECT_EQ(mClientTransportContext.txStatus.windowSize,
+            CHPP_TRANSPORT_WINDOW_SIZE);
+  EXPECT_EQ(mServiceTransportContext.txStatus.windowSize,
+            CHPP_TRANSPORT_WINDOW_SIZE);
+}
+
+TEST_F(TransportWindowTests, ThroughputOverLossyLink) {
+  constexpr uint64_t kLatencyNs = 5 * CHPP_NSEC_PER_MSEC;
+  constexpr uint8_t kDropPercent = 2;
+  constexpr size_t kTestLen = 6 * CHPP_TRANSPORT_TX_MTU_BYTES;
+  constexpr int kIterations = 10;
+  constexpr uint8_t kWindowSizes[] = {1, 2, 4, 8};
+
+  uint8_t buf[kTestLen];
+  for (size_t i = 0; i < kTestLen; i++) {
+    buf[i] = (uint8_t)((i % 251) + 64);
+  }
+
+  setLinkConditions(&mClientTransportContext, kLatencyNs, kDropPercent);
+  setLinkConditions(&mServiceTransportContext, kLatencyNs, kDropPercent);
+
+  double throughput[ARRAY_SIZE(kWindowSizes)];
+  for (size_t w = 0; w < ARRAY_SIZE(kWindowSizes); w++) {
+    setWindowSize(&mClientTransportContext, kWindowSizes[w]);
+    setWindowSize(&mServiceTransportContext, kWindowSizes[w]);
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < kIterations; i++) {
+      struct ChppLoopbackTestResult result =
+          chppRunLoopbackTest(&mClientAppContext, buf, kTestLen);
+      EXPECT_EQ(result.error, CHPP_APP_ERROR_NONE);
+    }
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+
+    // The loopback service echoes the data back, so it crosses the link twice
+    throughput[w] = 2.0 * kTestLen * kIterations / elapsed.count();
+    CHPP_LOGI("Window size %" PRIu8 ": %.1f kB/s", kWindowSizes[w],
+              throughput[w] / 1000);
+  }
+
+  EXPECT_GT(throughput[ARRAY_SIZE(kWindowSizes) - 1], 2 * throughput[0]);
+}
+
+}  // namespace
+}  // namespace chpp
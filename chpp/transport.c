@@ -43,6 +43,8 @@ static size_t chppConsumePreamble(struct ChppTransportState *context,
                                   const uint8_t *buf, size_t len);
 static size_t chppConsumeHeader(struct ChppTransportState *context,
                                 const uint8_t *buf, size_t len);
+static bool chppReserveRxDatagram(struct ChppTransportState *context,
+                                  size_t length);
 static size_t chppConsumePayload(struct ChppTransportState *context,
                                  const uint8_t *buf, size_t len);
 static size_t chppConsumeFooter(struct ChppTransportState *context,
@@ -65,6 +67,9 @@ static bool chppRxChecksumIsOk(const struct ChppTransportState *context);
 static enum ChppTransportErrorCode chppRxHeaderCheck(
     const struct ChppTransportState *context);
 static void chppRegisterRxAck(struct ChppTransportState *context);
+static uint8_t chppGetRxConfigWindowSize(
+    const struct ChppTransportState *context);
+static bool chppTxWindowHasRoom(const struct ChppTransportState *context);
 
 static void chppEnqueueTxPacket(struct ChppTransportState *context,
                                 uint8_t packetCode);
@@ -202,25 +207,12 @@ static size_t chppConsumeHeader(struct ChppTransportState *context,
 
     } else {
       // Payload bearing packet
-      uint8_t *tempPayload;
-
-      if (context->rxDatagram.length == 0) {
-        // Packet is a new datagram
-        tempPayload = chppMalloc(context->rxHeader.length);
-      } else {
-        // Packet is a continuation of a fragmented datagram
-        tempPayload =
-            chppRealloc(context->rxDatagram.payload,
-                        context->rxDatagram.length + context->rxHeader.length,
-                        context->rxDatagram.length);
-      }
-
-      if (tempPayload == NULL) {
+      if (!chppReserveRxDatagram(context, context->rxDatagram.length +
+                                              context->rxHeader.length)) {
         CHPP_LOG_OOM();
         chppEnqueueTxPacket(context, CHPP_TRANSPORT_ERROR_OOM);
         chppSetRxState(context, CHPP_STATE_PREAMBLE);
       } else {
-        context->rxDatagram.payload = tempPayload;
         context->rxDatagram.length += context->rxHeader.length;
         chppSetRxState(context, CHPP_STATE_PAYLOAD);
       }
@@ -230,6 +222,60 @@ static size_t chppConsumeHeader(struct ChppTransportState *context,
   return bytesToCopy;
 }
 
+/**
+ * Makes sure the Rx datagram payload buffer can hold at least the given number
+ * of bytes, allocating or growing it as necessary.
+ *
+ * The total length of a fragmented datagram is not known until its last packet
+ * is received. Rather than growing the buffer by a single packet for each
+ * fragment, which copies the datagram reassembled so far every time (i.e.
+ * quadratic in the datagram length on platforms without an in-place realloc),
+ * the capacity is at least doubled, so that the number of reallocations is
+ * logarithmic and the total data copied is less than the datagram length.
+ *
+ * @param context Maintains status for each transport layer instance.
+ * @param length Required length of the Rx datagram payload in bytes.
+ *
+ * @return False if the buffer could not be allocated, in which case the
+ * current Rx datagram (if any) is left untouched.
+ */
+static bool chppReserveRxDatagram(struct ChppTransportState *context,
+                                  size_t length) {
+  struct ChppRxStatus *rxStatus = &context->rxStatus;
+  bool success = true;
+
+  if (length > rxStatus->datagramCapacity) {
+    uint8_t *tempPayload;
+    size_t capacity;
+
+    if (context->rxDatagram.length == 0) {
+      // Packet is a new datagram. Most datagrams fit in a single packet.
+      capacity = length;
+      tempPayload = chppMalloc(capacity);
+    } else {
+      // Packet is a continuation of a fragmented datagram
+      capacity = MAX(length, 2 * rxStatus->datagramCapacity);
+      tempPayload = chppRealloc(context->rxDatagram.payload, capacity,
+                                rxStatus->datagramCapacity);
+      if (tempPayload != NULL) {
+        rxStatus->numDatagramReallocs++;
+        rxStatus->numDatagramBytesCopied += context->rxDatagram.length;
+      }
+    }
+
+    if (tempPayload == NULL) {
+      success = false;
+    } else {
+      context->rxDatagram.payload = tempPayload;
+      rxStatus->datagramCapacity = capacity;
+      rxStatus->peakDatagramCapacity =
+          MAX(rxStatus->peakDatagramCapacity, capacity);
+    }
+  }
+
+  return success;
+}
+
 /**
  * Called by chppRxDataCb to copy the payload, the length of which is determined
  * by the header, from the incoming data stream.
@@ -401,19 +447,10 @@ static void chppAbortRxPacket(struct ChppTransportState *context) {
     if (context->rxDatagram.length == 0) {
       // Discarding this packet == discarding entire datagram
       CHPP_FREE_AND_NULLIFY(context->rxDatagram.payload);
-
-    } else {
-      // Discarding this packet == discarding part of datagram
-      uint8_t *tempPayload =
-          chppRealloc(context->rxDatagram.payload, context->rxDatagram.length,
-                      context->rxDatagram.length + undoLen);
-
-      if (tempPayload == NULL) {
-        CHPP_LOG_OOM();
-      } else {
-        context->rxDatagram.payload = tempPayload;
-      }
+      context->rxStatus.datagramCapacity = 0;
     }
+    // Otherwise, discarding this packet == discarding part of datagram. The
+    // buffer is kept as is, as the packet is expected to be retransmitted.
   }
 
   chppSetRxState(context, CHPP_STATE_PREAMBLE);
@@ -543,7 +580,8 @@ static void chppProcessResetAck(struct ChppTransportState *context) {
   context->rxStatus.expectedSeq = context->rxHeader.seq + 1;
   chppRegisterRxAck(context);
 
-  // TODO: Configure transport layer based on (optional?) received config
+  context->txStatus.windowSize = chppGetRxConfigWindowSize(context);
+  CHPP_LOGI("TX window size=%" PRIu8, context->txStatus.windowSize);
 
   chppDatagramProcessDoneCb(context, context->rxDatagram.payload);
   chppClearRxDatagram(context);
@@ -577,23 +615,45 @@ static void chppProcessRxPacket(struct ChppTransportState *context) {
   context->rxStatus.receivedPacketCode = context->rxHeader.packetCode;
   chppRegisterRxAck(context);
 
+  if (CHPP_TRANSPORT_GET_ERROR(context->rxHeader.packetCode) !=
+          CHPP_TRANSPORT_ERROR_NONE &&
+      context->txStatus.packetsInFlight > 0) {
+    // NACK. Resend the outstanding packets starting at the last ACKed one.
+    context->txStatus.retransmitPending = true;
+  }
+
   enum ChppTransportErrorCode errorCode = CHPP_TRANSPORT_ERROR_NONE;
   if (context->rxHeader.length > 0 &&
       context->rxHeader.seq != context->rxStatus.expectedSeq) {
     // Out of order payload
     errorCode = CHPP_TRANSPORT_ERROR_ORDER;
+
+    // A packet ahead of the expected one means that a packet within the
+    // remote's window was lost. The remaining packets of that window will also
+    // be out of order, so only NACK the first one. Duplicates (i.e. packets
+    // behind the expected one) are always NACKed, as our ACK may have been
+    // lost.
+    uint8_t seqAhead =
+        (uint8_t)(context->rxHeader.seq - context->rxStatus.expectedSeq);
+    if (seqAhead < CHPP_TRANSPORT_MAX_WINDOW_SIZE) {
+      if (context->rxStatus.orderNackSent) {
+        errorCode = CHPP_TRANSPORT_ERROR_NONE;
+        CHPP_LOGD("Skipping NACK for out of order seq=%" PRIu8,
+                  context->rxHeader.seq);
+      }
+      context->rxStatus.orderNackSent = true;
+    }
   }
 
   if (context->txDatagramQueue.pending > 0 ||
       errorCode == CHPP_TRANSPORT_ERROR_ORDER) {
     // There are packets to send out (could be new or retx)
-    // Note: For a future ACK window > 1, makes more sense to cap the NACKs
-    // to one instead of flooding with out of order NACK errors.
     chppEnqueueTxPacket(context, CHPP_ATTR_AND_ERROR_TO_PACKET_CODE(
                                      CHPP_TRANSPORT_ATTR_NONE, errorCode));
   }
 
-  if (errorCode == CHPP_TRANSPORT_ERROR_ORDER) {
+  if (context->rxHeader.length > 0 &&
+      context->rxHeader.seq != context->rxStatus.expectedSeq) {
     CHPP_LOGE("Out of order RX discarded seq=%" PRIu8 " expect=%" PRIu8
               " len=%" PRIu16,
               context->rxHeader.seq, context->rxStatus.expectedSeq,
@@ -617,6 +677,7 @@ static void chppProcessRxPayload(struct ChppTransportState *context) {
                                     // that context->rxStatus.expectedSeq ==
                                     // context->rxHeader.seq, protecting against
                                     // duplicate and out-of-order packets.
+  context->rxStatus.orderNackSent = false;
 
   if (context->rxHeader.flags & CHPP_TRANSPORT_FLAG_UNFINISHED_DATAGRAM) {
     // Packet is part of a larger datagram
@@ -638,10 +699,15 @@ static void chppProcessRxPayload(struct ChppTransportState *context) {
 
     CHPP_LOGD("App layer processed datagram with len=%" PRIuSIZE
               ", ending packet seq=%" PRIu8 ", len=%" PRIu16
-              ". Sending ACK=%" PRIu8 " (previously sent=%" PRIu8 ")",
+              ". Sending ACK=%" PRIu8 " (previously sent=%" PRIu8
+              "). RX reallocs=%" PRIuSIZE " copied=%" PRIuSIZE
+              " peak=%" PRIuSIZE,
               context->rxDatagram.length, context->rxHeader.seq,
               context->rxHeader.length, context->rxStatus.expectedSeq,
-              context->txStatus.sentAckSeq);
+              context->txStatus.sentAckSeq,
+              context->rxStatus.numDatagramReallocs,
+              context->rxStatus.numDatagramBytesCopied,
+              context->rxStatus.peakDatagramCapacity);
     chppClearRxDatagram(context);
   }
 
@@ -660,6 +726,7 @@ static void chppProcessRxPayload(struct ChppTransportState *context) {
  */
 static void chppClearRxDatagram(struct ChppTransportState *context) {
   context->rxStatus.locInDatagram = 0;
+  context->rxStatus.datagramCapacity = 0;
   context->rxDatagram.length = 0;
   context->rxDatagram.payload = NULL;
 }
@@ -718,58 +785,132 @@ static enum ChppTransportErrorCode chppRxHeaderCheck(
 }
 
 /**
- * Registers a received ACK. If an outgoing datagram is fully ACKed, it is
+ * Registers a received ACK. As ACKs are cumulative, a single ACK may cover
+ * several outstanding packets. Any outgoing datagram that is fully ACKed is
  * popped from the TX queue.
  *
  * @param context Maintains status for each transport layer instance.
  */
 static void chppRegisterRxAck(struct ChppTransportState *context) {
   uint8_t rxAckSeq = context->rxHeader.ackSeq;
+  uint8_t ackedPackets = (uint8_t)(rxAckSeq - context->rxStatus.receivedAckSeq);
+
+  if (ackedPackets == 0) {
+    // Nothing was ACKed
+  } else if (ackedPackets > context->txStatus.packetsInFlight) {
+    CHPP_LOGE("Out of order ACK: last=%" PRIu8 " rx=%" PRIu8
+              " in flight=%" PRIu8,
+              context->rxStatus.receivedAckSeq, rxAckSeq,
+              context->txStatus.packetsInFlight);
+  } else {
+    CHPP_LOGD(
+        "ACK received (last registered=%" PRIu8 ", received=%" PRIu8
+        "). Prior queue depth=%" PRIu8 ", front datagram=%" PRIu8
+        " at loc=%" PRIuSIZE " of len=%" PRIuSIZE,
+        context->rxStatus.receivedAckSeq, rxAckSeq,
+        context->txDatagramQueue.pending, context->txDatagramQueue.front,
+        context->txStatus.ackedLocInDatagram,
+        context->txDatagramQueue.datagram[context->txDatagramQueue.front]
+            .length);
 
-  if (context->rxStatus.receivedAckSeq != rxAckSeq) {
-    // A previously sent packet was actually ACKed
-    // Note: For a future ACK window >1, we should loop by # of ACKed packets
-    if ((uint8_t)(context->rxStatus.receivedAckSeq + 1) != rxAckSeq) {
-      CHPP_LOGE("Out of order ACK: last=%" PRIu8 " rx=%" PRIu8,
-                context->rxStatus.receivedAckSeq, rxAckSeq);
-    } else {
-      CHPP_LOGD(
-          "ACK received (last registered=%" PRIu8 ", received=%" PRIu8
-          "). Prior queue depth=%" PRIu8 ", front datagram=%" PRIu8
-          " at loc=%" PRIuSIZE " of len=%" PRIuSIZE,
-          context->rxStatus.receivedAckSeq, rxAckSeq,
-          context->txDatagramQueue.pending, context->txDatagramQueue.front,
-          context->txStatus.ackedLocInDatagram,
-          context->txDatagramQueue.datagram[context->txDatagramQueue.front]
-              .length);
-
-      context->rxStatus.receivedAckSeq = rxAckSeq;
-      if (context->txStatus.txAttempts > 1) {
-        CHPP_LOGW("Seq %" PRIu8 " ACK'd after %" PRIuSIZE " reTX",
-                  context->rxHeader.seq, context->txStatus.txAttempts - 1);
-      }
-      context->txStatus.txAttempts = 0;
+    if (context->txStatus.txAttempts > 1) {
+      CHPP_LOGW("Seq %" PRIu8 " ACK'd after %" PRIuSIZE " reTX",
+                context->rxStatus.receivedAckSeq,
+                context->txStatus.txAttempts - 1);
+    }
+    context->txStatus.txAttempts = 0;
+
+    // During a retransmission, an ACK for an earlier transmission may cover
+    // packets that have not been resent yet.
+    bool ackedUnsent = (ackedPackets > context->txStatus.packetsSent);
+
+    for (uint8_t i = 0; i < ackedPackets; i++) {
+      const struct ChppTxWindowEntry *entry =
+          &context->txStatus.window[context->rxStatus.receivedAckSeq %
+                                    CHPP_TRANSPORT_MAX_WINDOW_SIZE];
+      context->rxStatus.receivedAckSeq++;
+      context->txStatus.packetsInFlight--;
 
       // Process and if necessary pop from Tx datagram queue
-      context->txStatus.ackedLocInDatagram += CHPP_TRANSPORT_TX_MTU_BYTES;
-      if (context->txStatus.ackedLocInDatagram >=
-          context->txDatagramQueue.datagram[context->txDatagramQueue.front]
-              .length) {
-        // We are done with datagram
+      if (!entry->finishesDatagram) {
+        context->txStatus.ackedLocInDatagram += entry->length;
 
+      } else {
+        // We are done with datagram
         context->txStatus.ackedLocInDatagram = 0;
-        context->txStatus.sentLocInDatagram = 0;
-
-        // Note: For a future ACK window >1, we need to update the queue
-        // position of the datagram being sent as well (relative to the
-        // front-of-queue). e.g. context->txStatus.datagramBeingSent--;
+        if (!ackedUnsent && context->txStatus.datagramBeingSent > 0) {
+          context->txStatus.datagramBeingSent--;
+        }
 
         if (chppDequeueTxDatagram(context) == 0) {
           context->txStatus.hasPacketsToSend = false;
         }
       }
     }
-  }  // else {nothing was ACKed}
+
+    if (ackedUnsent) {
+      // Continue sending from the ACKed location
+      context->txStatus.packetsSent = 0;
+      context->txStatus.datagramBeingSent = 0;
+      context->txStatus.sentLocInDatagram =
+          context->txStatus.ackedLocInDatagram;
+    } else {
+      context->txStatus.packetsSent =
+          (uint8_t)(context->txStatus.packetsSent - ackedPackets);
+    }
+  }
+}
+
+/**
+ * Reads the window size advertised by the remote endpoint in the configuration
+ * payload of a received reset or reset-ack packet, and determines the window
+ * size to use when sending to it.
+ *
+ * @param context Maintains status for each transport layer instance.
+ *
+ * @return The smaller of the local and remote window sizes. 1 (i.e.
+ * stop-and-wait) if the packet does not contain a configuration payload.
+ */
+static uint8_t chppGetRxConfigWindowSize(
+    const struct ChppTransportState *context) {
+  uint8_t windowSize = 1;
+
+  if (context->rxHeader.length >= sizeof(struct ChppTransportConfiguration) &&
+      context->rxDatagram.length >= context->rxHeader.length) {
+    struct ChppTransportConfiguration config;
+    memcpy(&config,
+           &context->rxDatagram.payload[context->rxDatagram.length -
+                                        context->rxHeader.length],
+           sizeof(config));
+
+    if (config.windowSize > 1) {
+      windowSize = (uint8_t)MIN(config.windowSize, CHPP_TRANSPORT_WINDOW_SIZE);
+    }
+  }
+
+  return windowSize;
+}
+
+/**
+ * Packets with a packet attribute (i.e. reset and reset-ack) are always sent
+ * on their own, as the attribute applies to every packet sent until the next
+ * ACK is received.
+ *
+ * @param context Maintains status for each transport layer instance.
+ *
+ * @return True if a new payload-bearing packet can be sent without exceeding
+ * the window, i.e. without waiting for an ACK.
+ */
+static bool chppTxWindowHasRoom(const struct ChppTransportState *context) {
+  uint8_t windowSize =
+      (CHPP_TRANSPORT_GET_ATTR(context->txStatus.packetCodeToSend) ==
+       CHPP_TRANSPORT_ATTR_NONE)
+          ? context->txStatus.windowSize
+          : 1;
+
+  return (context->txStatus.packetsSent < windowSize &&
+          context->txStatus.datagramBeingSent <
+              context->txDatagramQueue.pending);
 }
 
 /**
@@ -841,7 +982,8 @@ static struct ChppTransportHeader *chppAddHeader(
 }
 
 /**
- * Adds the packet payload to pendingTxPacket.
+ * Adds the packet payload to pendingTxPacket, continuing from the sent location
+ * within the datagram being sent, and records it as an outstanding packet.
  *
  * @param context Maintains status for each transport layer instance.
  */
@@ -849,10 +991,14 @@ static void chppAddPayload(struct ChppTransportState *context) {
   struct ChppTransportHeader *txHeader =
       (struct ChppTransportHeader *)&context->pendingTxPacket
           .payload[CHPP_PREAMBLE_LEN_BYTES];
+  struct ChppDatagram *datagram =
+      &context->txDatagramQueue
+           .datagram[(context->txDatagramQueue.front +
+                      context->txStatus.datagramBeingSent) %
+                     CHPP_TX_DATAGRAM_QUEUE_LEN];
 
   size_t remainingBytes =
-      context->txDatagramQueue.datagram[context->txDatagramQueue.front].length -
-      context->txStatus.ackedLocInDatagram;
+      datagram->length - context->txStatus.sentLocInDatagram;
 
   CHPP_LOGD("Adding payload to seq=%" PRIu8 ", remainingBytes=%" PRIuSIZE
             " of pending datagrams=%" PRIu8,
@@ -871,13 +1017,26 @@ static void chppAddPayload(struct ChppTransportState *context) {
   // Copy payload
   chppAppendToPendingTxPacket(
       &context->pendingTxPacket,
-      context->txDatagramQueue.datagram[context->txDatagramQueue.front]
-              .payload +
-          context->txStatus.ackedLocInDatagram,
+      datagram->payload + context->txStatus.sentLocInDatagram,
       txHeader->length);
 
-  context->txStatus.sentLocInDatagram =
-      context->txStatus.ackedLocInDatagram + txHeader->length;
+  struct ChppTxWindowEntry *entry =
+      &context->txStatus
+           .window[txHeader->seq % CHPP_TRANSPORT_MAX_WINDOW_SIZE];
+  entry->length = txHeader->length;
+  entry->finishesDatagram =
+      (txHeader->flags == CHPP_TRANSPORT_FLAG_FINISHED_DATAGRAM);
+
+  if (entry->finishesDatagram) {
+    context->txStatus.datagramBeingSent++;
+    context->txStatus.sentLocInDatagram = 0;
+  } else {
+    context->txStatus.sentLocInDatagram += txHeader->length;
+  }
+
+  context->txStatus.packetsSent++;
+  context->txStatus.packetsInFlight = (uint8_t)MAX(
+      context->txStatus.packetsInFlight, context->txStatus.packetsSent);
 }
 
 /**
@@ -949,11 +1108,15 @@ static void chppClearTxDatagramQueue(struct ChppTransportState *context) {
  * chppEnqueueTxPacket().
  *
  * A payload may or may not be included be according the following:
- * No payload: If Tx datagram queue is empty OR we are waiting on a pending ACK.
- * New payload: If there is one or more pending Tx datagrams and we are not
- * waiting on a pending ACK.
- * Repeat payload: If we haven't received an ACK yet for our previous payload,
- * i.e. we have registered an explicit or implicit NACK.
+ * No payload: If Tx datagram queue is empty OR the window is full, i.e. we are
+ * waiting on pending ACKs. With a window of more than one packet, nothing is
+ * sent in the latter case unless there is an ACK or error to report.
+ * New payload: If there is one or more pending Tx datagrams and the window is
+ * not full.
+ * Repeat payload: If we have registered an explicit or implicit NACK (i.e. an
+ * ACK timeout), in which case the outstanding packets are resent starting
+ * from the last ACKed location. With a window of one packet, any received
+ * packet that does not ACK the outstanding packet is an implicit NACK.
  *
  * @param context Maintains status for each transport layer instance.
  */
@@ -962,10 +1125,29 @@ static void chppTransportDoWork(struct ChppTransportState *context) {
   struct ChppTransportHeader *txHeader;
   struct ChppAppHeader *timeoutResponse = NULL;
 
-  // Note: For a future ACK window >1, there needs to be a loop outside the lock
   chppMutexLock(&context->mutex);
 
-  if (context->txStatus.hasPacketsToSend && !context->txStatus.linkBusy) {
+  if (context->txStatus.retransmitPending ||
+      (context->txStatus.windowSize == 1 &&
+       context->txStatus.packetsSent > 0)) {
+    // Go back to the last ACKed location
+    context->txStatus.retransmitPending = false;
+    context->txStatus.packetsSent = 0;
+    context->txStatus.datagramBeingSent = 0;
+    context->txStatus.sentLocInDatagram = context->txStatus.ackedLocInDatagram;
+  }
+
+  bool addPayload = chppTxWindowHasRoom(context);
+  if (context->txStatus.hasPacketsToSend && !addPayload &&
+      context->txDatagramQueue.pending > 0 &&
+      context->txStatus.packetCodeToSend == CHPP_TRANSPORT_ERROR_NONE &&
+      context->txStatus.sentAckSeq == context->rxStatus.expectedSeq) {
+    // The window is full and there is nothing to report to the remote
+    CHPP_LOGD("DoWork window full: in flight=%" PRIu8,
+              context->txStatus.packetsInFlight);
+
+  } else if (context->txStatus.hasPacketsToSend &&
+             !context->txStatus.linkBusy) {
     // There are pending outgoing packets and the link isn't busy
     havePacketForLinkLayer = true;
     context->txStatus.linkBusy = true;
@@ -981,18 +1163,16 @@ static void chppTransportDoWork(struct ChppTransportState *context) {
     txHeader = chppAddHeader(context);
 
     // If applicable, add payload
-    if ((context->txDatagramQueue.pending > 0)) {
-      // Note: For a future ACK window >1, we need to rewrite this payload
-      // adding code to base the next packet on the sent location within the
-      // last sent datagram, except for the case of a NACK (explicit or
-      // timeout). For a NACK, we would need to base the next packet off the
-      // last ACKed location.
-
-      txHeader->seq = context->rxStatus.receivedAckSeq;
+    if (addPayload) {
+      txHeader->seq = (uint8_t)(context->rxStatus.receivedAckSeq +
+                                context->txStatus.packetsSent);
       context->txStatus.sentSeq = txHeader->seq;
 
-      if (context->txStatus.txAttempts > CHPP_TRANSPORT_MAX_RETX &&
-          context->resetState != CHPP_RESET_STATE_RESETTING) {
+      if (context->txStatus.packetsSent > 0) {
+        chppAddPayload(context);
+
+      } else if (context->txStatus.txAttempts > CHPP_TRANSPORT_MAX_RETX &&
+                 context->resetState != CHPP_RESET_STATE_RESETTING) {
         CHPP_LOGE("Resetting after %d reTX", CHPP_TRANSPORT_MAX_RETX);
         havePacketForLinkLayer = false;
 
@@ -1006,7 +1186,7 @@ static void chppTransportDoWork(struct ChppTransportState *context) {
         context->txStatus.txAttempts++;
       }
 
-    } else {
+    } else if (context->txDatagramQueue.pending == 0) {
       // No payload
       context->txStatus.hasPacketsToSend = false;
     }
@@ -1142,6 +1322,9 @@ static bool chppEnqueueTxDatagram(struct ChppTransportState *context,
       if (context->txDatagramQueue.pending == 1) {
         // Queue was empty prior. Need to kickstart transmission.
         chppEnqueueTxPacket(context, packetCode);
+      } else if (chppTxWindowHasRoom(context)) {
+        // All prior datagrams have been sent and the window allows for more
+        chppEnqueueTxPacket(context, context->txStatus.packetCodeToSend);
       }
 
       success = true;
@@ -1186,6 +1369,7 @@ static void chppResetTransportContext(struct ChppTransportState *context) {
 
   context->txStatus.sentSeq =
       UINT8_MAX;  // So that the seq # of the first TX packet is 0
+  context->txStatus.windowSize = 1;  // Until negotiated through a reset
   context->resetState = CHPP_RESET_STATE_RESETTING;
 }
 
@@ -1207,10 +1391,15 @@ static void chppResetTransportContext(struct ChppTransportState *context) {
 static void chppReset(struct ChppTransportState *transportContext,
                       enum ChppTransportPacketAttributes resetType,
                       enum ChppTransportErrorCode error) {
-  // TODO: Configure transport layer based on (optional?) received config before
+  chppMutexLock(&transportContext->mutex);
+
+  // Configure transport layer based on the received reset (if any) before the
   // datagram is wiped
+  uint8_t windowSize = 1;
+  if (resetType == CHPP_TRANSPORT_ATTR_RESET_ACK) {
+    windowSize = chppGetRxConfigWindowSize(transportContext);
+  }
 
-  chppMutexLock(&transportContext->mutex);
   struct ChppAppState *appContext = transportContext->appContext;
   transportContext->resetState = CHPP_RESET_STATE_RESETTING;
 
@@ -1241,6 +1430,7 @@ static void chppReset(struct ChppTransportState *transportContext,
   transportContext->rxStatus.receivedPacketCode =
       transportContext->rxHeader.packetCode;
   transportContext->rxStatus.expectedSeq = transportContext->rxHeader.seq + 1;
+  transportContext->txStatus.windowSize = windowSize;
 
   // Send reset or reset-ACK
   chppMutexUnlock(&transportContext->mutex);
@@ -1576,6 +1766,10 @@ bool chppWorkThreadHandleSignal(struct ChppTransportState *context,
           CHPP_TRANSPORT_TX_TIMEOUT_NS) {
         CHPP_LOGE("ACK timeout. Tx t=%" PRIu64,
                   context->txStatus.lastTxTimeNs / CHPP_NSEC_PER_MSEC);
+        chppMutexLock(&context->mutex);
+        context->txStatus.retransmitPending =
+            (context->txStatus.packetsInFlight > 0);
+        chppMutexUnlock(&context->mutex);
         chppTransportDoWork(context);
       }
 
@@ -1628,6 +1822,11 @@ void chppLinkSendDoneCb(struct ChppPlatformLinkParameters *params,
   // No need to free anything as pendingTxPacket.payload is static. Likewise, we
   // keep pendingTxPacket.length to assist testing.
 
+  if (context->txStatus.retransmitPending || chppTxWindowHasRoom(context)) {
+    // Keep sending without waiting for an ACK
+    chppEnqueueTxPacket(context, context->txStatus.packetCodeToSend);
+  }
+
   chppMutexUnlock(&context->mutex);
 }
 
@@ -1737,8 +1936,11 @@ void chppTransportSendReset(struct ChppTransportState *context,
     config->rxMtu = CHPP_PLATFORM_LINK_RX_MTU_BYTES;
 
     // Max Rx window size
-    // Note: current implementation does not support a window size >1
-    config->windowSize = 1;
+    CHPP_STATIC_ASSERT(CHPP_TRANSPORT_WINDOW_SIZE >= 1 &&
+                           CHPP_TRANSPORT_WINDOW_SIZE <=
+                               CHPP_TRANSPORT_MAX_WINDOW_SIZE,
+                       "Invalid CHPP_TRANSPORT_WINDOW_SIZE");
+    config->windowSize = CHPP_TRANSPORT_WINDOW_SIZE;
 
     // Advertised transport layer (ACK) timeout
     config->timeoutInMs = CHPP_PLATFORM_TRANSPORT_TIMEOUT_MS;
@@ -38,6 +38,11 @@ extern "C" {
  */
 #define CHRE_AUDIO_DATA_EVENT_VERSION  UINT8_C(1)
 
+/**
+ * The current compatibility version of the chreAudioFeatureEvent structure.
+ */
+#define CHRE_AUDIO_FEATURE_EVENT_VERSION  UINT8_C(1)
+
 /**
  * Produce an event ID in the block of IDs reserved for audio
  * @param offset Index into audio event ID block; valid range [0,15]
@@ -59,6 +64,16 @@ extern "C" {
  */
 #define CHRE_EVENT_AUDIO_DATA  CHRE_AUDIO_EVENT_ID(1)
 
+/**
+ * nanoappHandleEvent argument: struct chreAudioFeatureEvent
+ *
+ * Provides the spectral features of a buffer of audio data to a nanoapp which
+ * enabled them with chreAudioConfigureFeatures().
+ *
+ * @since v1.6
+ */
+#define CHRE_EVENT_AUDIO_FEATURES  CHRE_AUDIO_EVENT_ID(2)
+
 /**
  * The maximum size of the name of an audio source including the
  * null-terminator.
@@ -269,6 +284,126 @@ struct chreAudioDataEvent {
   };
 };
 
+/**
+ * The kinds of spectral features that the CHRE implementation can compute from
+ * audio data on behalf of nanoapps.
+ *
+ * @since v1.6
+ */
+enum chreAudioFeatureType {
+  /**
+   * The power spectrum of the audio, with one value per frequency bin from 0Hz
+   * to the Nyquist frequency, i.e. (fftSize / 2 + 1) values. The power of bin k
+   * is |X[k]|^2, where X is the discrete Fourier transform of a Hann-windowed
+   * frame of samples normalized to [-1, 1), divided by fftSize.
+   */
+  CHRE_AUDIO_FEATURE_TYPE_POWER_SPECTRUM = 0,
+
+  /**
+   * The natural logarithm of the energy of the power spectrum in numMelBands
+   * triangular filters evenly spaced on the mel scale from 0Hz to the Nyquist
+   * frequency, i.e. numMelBands values.
+   */
+  CHRE_AUDIO_FEATURE_TYPE_LOG_MEL = 1,
+};
+
+/**
+ * The minimum and maximum values of chreAudioFeatureConfig.fftSize.
+ */
+#define CHRE_AUDIO_FEATURE_MIN_FFT_SIZE  UINT16_C(64)
+#define CHRE_AUDIO_FEATURE_MAX_FFT_SIZE  UINT16_C(1024)
+
+/**
+ * The maximum value of chreAudioFeatureConfig.numMelBands.
+ */
+#define CHRE_AUDIO_FEATURE_MAX_MEL_BANDS  UINT8_C(64)
+
+/**
+ * The configuration of the spectral features computed for a nanoapp.
+ *
+ * @since v1.6
+ */
+struct chreAudioFeatureConfig {
+  /**
+   * The number of samples per frame transformed, which must be a power of two
+   * in the range [CHRE_AUDIO_FEATURE_MIN_FFT_SIZE,
+   * CHRE_AUDIO_FEATURE_MAX_FFT_SIZE].
+   */
+  uint16_t fftSize;
+
+  /**
+   * The kind of features to compute, from enum chreAudioFeatureType.
+   */
+  uint8_t featureType;
+
+  /**
+   * The number of mel bands, in the range [1,
+   * CHRE_AUDIO_FEATURE_MAX_MEL_BANDS], if featureType is
+   * CHRE_AUDIO_FEATURE_TYPE_LOG_MEL. Must be set to 0 otherwise.
+   */
+  uint8_t numMelBands;
+};
+
+/**
+ * The nanoappHandleEvent argument for CHRE_EVENT_AUDIO_FEATURES.
+ *
+ * A buffer of audio data is split in consecutive frames of fftSize samples,
+ * the last one being padded with zeros if needed, and the features of the
+ * frames are averaged. The features of a buffer are delivered right after the
+ * CHRE_EVENT_AUDIO_DATA event carrying it.
+ *
+ * @since v1.6
+ */
+struct chreAudioFeatureEvent {
+  /**
+   * Indicates the version of the structure, for compatibility purposes. Clients
+   * do not normally need to worry about this field; the CHRE implementation
+   * guarantees that the client only receives the structure version it expects.
+   */
+  uint8_t version;
+
+  /**
+   * The kind of features provided, from enum chreAudioFeatureType.
+   */
+  uint8_t featureType;
+
+  /**
+   * The number of samples per frame transformed.
+   */
+  uint16_t fftSize;
+
+  /**
+   * The handle for which the audio data originated from.
+   */
+  uint32_t handle;
+
+  /**
+   * The timestamp of the first sample of the buffer of audio data, from the
+   * same time base as chreGetTime() (in nanoseconds).
+   */
+  uint64_t timestamp;
+
+  /**
+   * The sample rate of the audio data in hertz.
+   */
+  uint32_t sampleRate;
+
+  /**
+   * The number of frames averaged into the features.
+   */
+  uint16_t frameCount;
+
+  /**
+   * The number of features provided.
+   */
+  uint16_t featureCount;
+
+  /**
+   * The features, as described by enum chreAudioFeatureType.
+   */
+  const float *features;
+};
+
 /**
  * Retrieves information about an audio source supported by the current CHRE
  * implementation. The source returned by the runtime must not change for the
@@ -412,6 +547,32 @@ bool chreAudioConfigureSource(uint32_t handle, bool enable,
  */
 bool chreAudioGetStatus(uint32_t handle, struct chreAudioSourceStatus *status);
 
+/**
+ * Configures the spectral features computed from the audio data delivered to
+ * a nanoapp by a given audio source, which are provided through
+ * CHRE_EVENT_AUDIO_FEATURES events. The nanoapp must have enabled the audio
+ * source with chreAudioConfigureSource(), and disabling the source also
+ * disables the features.
+ *
+ * The features are computed once per buffer of audio data for all the
+ * nanoapps requesting the same configuration, which is cheaper than each of
+ * them transforming the audio data.
+ *
+ * @param handle The handle for the audio source, which must be enabled by the
+ *     nanoapp.
+ * @param enable true to enable features, false to disable them.
+ * @param config The configuration of the features, ignored when disabling
+ *     them. Replaces the current configuration if features are enabled.
+ * @return true if the configuration was successful, false if invalid
+ *     parameters were provided (handle not enabled by the nanoapp, invalid
+ *     configuration) or if the features could not be enabled.
+ *
+ * @since v1.6
+ * @note Requires audio permission
+ */
+bool chreAudioConfigureFeatures(uint32_t handle, bool enable,
+                                const struct chreAudioFeatureConfig *config);
+
 #else  /* defined(CHRE_NANOAPP_USES_AUDIO) || !defined(CHRE_IS_NANOAPP_BUILD) */
 #define CHRE_AUDIO_PERM_ERROR_STRING \
     "CHRE_NANOAPP_USES_AUDIO must be defined when building this nanoapp in " \
@@ -420,6 +581,8 @@ bool chreAudioGetStatus(uint32_t handle, struct chreAudioSourceStatus *status);
     CHRE_BUILD_ERROR(CHRE_AUDIO_PERM_ERROR_STRING "chreAudioConfigureSource")
 #define chreAudioGetStatus(...) \
     CHRE_BUILD_ERROR(CHRE_AUDIO_PERM_ERROR_STRING "chreAudioGetStatus")
+#define chreAudioConfigureFeatures(...) \
+    CHRE_BUILD_ERROR(CHRE_AUDIO_PERM_ERROR_STRING "chreAudioConfigureFeatures")
 #endif  /* defined(CHRE_NANOAPP_USES_AUDIO) || !defined(CHRE_IS_NANOAPP_BUILD) */
 
 #ifdef __cplusplus
@@ -0,0 +1,216 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "chre/core/audio_feature_extractor.h"
+
+#include <cmath>
+#include <cstring>
+
+#include "chre/core/audio_util.h"
+#include "chre/platform/assert.h"
+#include "chre/platform/log.h"
+#include "chre/platform/memory.h"
+
+namespace chre {
+
+namespace {
+
+constexpr float kPi = 3.14159265358979f;
+
+//! The scale applied to the power of the fixed-point spectrum so that it is
+//! expressed for samples normalized to [-1, 1).
+constexpr float kPowerScale = 1.0f / (32768.0f * 32768.0f);
+
+//! Added to the mel band energies before taking their logarithm, so that
+//! silence maps to a finite value.
+constexpr float kLogMelFloor = 1e-10f;
+
+float hertzToMel(float frequency) {
+  return 2595.0f * log10f(1.0f + frequency / 700.0f);
+}
+
+float melToHertz(float mel) {
+  return 700.0f * (powf(10.0f, mel / 2595.0f) - 1.0f);
+}
+
+}  // anonymous namespace
+
+AudioFeatureExtractor::~AudioFeatureExtractor() {
+  memoryFree(mFftConfig);
+}
+
+bool AudioFeatureExtractor::isValidConfig(
+    const struct chreAudioFeatureConfig &config) {
+  bool isPowerOfTwo = (config.fftSize & (config.fftSize - 1)) == 0;
+  bool valid = isPowerOfTwo &&
+               config.fftSize >= CHRE_AUDIO_FEATURE_MIN_FFT_SIZE &&
+               config.fftSize <= CHRE_AUDIO_FEATURE_MAX_FFT_SIZE;
+
+  if (config.featureType == CHRE_AUDIO_FEATURE_TYPE_POWER_SPECTRUM) {
+    valid &= (config.numMelBands == 0);
+  } else if (config.featureType == CHRE_AUDIO_FEATURE_TYPE_LOG_MEL) {
+    valid &= (config.numMelBands > 0 &&
+              config.numMelBands <= CHRE_AUDIO_FEATURE_MAX_MEL_BANDS);
+  } else {
+    valid = false;
+  }
+
+  return valid;
+}
+
+bool AudioFeatureExtractor::init(const struct chreAudioFeatureConfig &config,
+                                 uint32_t sampleRate) {
+  CHRE_ASSERT(isValidConfig(config));
+  CHRE_ASSERT(mFftConfig == nullptr);
+  mConfig = config;
+
+  size_t fftSize = config.fftSize;
+  size_t numBins = fftSize / 2 + 1;
+  size_t fftConfigSize = 0;
+  kiss_fftr_alloc(static_cast<int>(fftSize), 0 /* inverse_fft */,
+                  nullptr /* mem */, &fftConfigSize);
+  void *fftConfigMemory = memoryAlloc(fftConfigSize);
+
+  bool success = false;
+  if (fftConfigMemory == nullptr || !mWindow.resize(fftSize) ||
+      !mFrame.resize(fftSize) || !mSpectrum.resize(numBins) ||
+      !mPower.resize(numBins) ||
+      (config.featureType == CHRE_AUDIO_FEATURE_TYPE_LOG_MEL &&
+       !mMelEdges.resize(config.numMelBands + 2))) {
+    memoryFree(fftConfigMemory);
+    LOG_OOM();
+  } else {
+    mFftConfig =
+        kiss_fftr_alloc(static_cast<int>(fftSize), 0 /* inverse_fft */,
+                        fftConfigMemory, &fftConfigSize);
+
+    for (size_t i = 0; i < fftSize; i++) {
+      float weight = 0.5f - 0.5f * cosf(2.0f * kPi * i / fftSize);
+      mWindow[i] = static_cast<int16_t>(fminf(weight * 32768.0f, 32767.0f));
+    }
+
+    if (config.featureType == CHRE_AUDIO_FEATURE_TYPE_LOG_MEL) {
+      float maxMel = hertzToMel(sampleRate / 2.0f);
+      float hertzPerBin = static_cast<float>(sampleRate) / fftSize;
+      for (size_t i = 0; i < mMelEdges.size(); i++) {
+        float mel = maxMel * i / (mMelEdges.size() - 1);
+        mMelEdges[i] = melToHertz(mel) / hertzPerBin;
+      }
+    }
+
+    success = true;
+  }
+
+  return success;
+}
+
+bool AudioFeatureExtractor::hasConfig(
+    const struct chreAudioFeatureConfig &config) const {
+  return (mConfig.fftSize == config.fftSize &&
+          mConfig.featureType == config.featureType &&
+          mConfig.numMelBands == config.numMelBands);
+}
+
+uint16_t AudioFeatureExtractor::getFeatureCount() const {
+  return (mConfig.featureType == CHRE_AUDIO_FEATURE_TYPE_LOG_MEL)
+             ? mConfig.numMelBands
+             : static_cast<uint16_t>(mConfig.fftSize / 2 + 1);
+}
+
+uint16_t AudioFeatureExtractor::extract(const struct chreAudioDataEvent &event,
+                                        float *features) {
+  CHRE_ASSERT(mFftConfig != nullptr);
+  for (float &power : mPower) {
+    power = 0.0f;
+  }
+
+  uint32_t frameCount = 0;
+  uint32_t offset = 0;
+  do {
+    loadFrame(event, offset);
+    kiss_fftr(mFftConfig, mFrame.data(), mSpectrum.data());
+    for (size_t i = 0; i < mPower.size(); i++) {
+      float real = mSpectrum[i].r;
+      float imaginary = mSpectrum[i].i;
+      mPower[i] += real * real + imaginary * imaginary;
+    }
+
+    frameCount++;
+    offset += mConfig.fftSize;
+  } while (offset < event.sampleCount);
+
+  float scale = kPowerScale / frameCount;
+  for (float &power : mPower) {
+    power *= scale;
+  }
+
+  if (mConfig.featureType == CHRE_AUDIO_FEATURE_TYPE_LOG_MEL) {
+    computeLogMelEnergies(features);
+  } else {
+    memcpy(features, mPower.data(), mPower.size() * sizeof(float));
+  }
+
+  return static_cast<uint16_t>(frameCount);
+}
+
+void AudioFeatureExtractor::loadFrame(const struct chreAudioDataEvent &event,
+                                      uint32_t offset) {
+  uint32_t numSamples = 0;
+  if (offset < event.sampleCount) {
+    numSamples = event.sampleCount - offset;
+    if (numSamples > mConfig.fftSize) {
+      numSamples = mConfig.fftSize;
+    }
+  }
+
+  if (event.format == CHRE_AUDIO_DATA_FORMAT_16_BIT_SIGNED_PCM) {
+    const int16_t *samples = &event.samplesS16[offset];
+    for (uint32_t i = 0; i < numSamples; i++) {
+      mFrame[i] = static_cast<kiss_fft_scalar>(
+          (static_cast<int32_t>(samples[i]) * mWindow[i]) >> 15);
+    }
+  } else {
+    const uint8_t *samples = &event.samplesULaw8[offset];
+    for (uint32_t i = 0; i < numSamples; i++) {
+      int32_t sample = AudioUtil::decodeULaw8(samples[i]);
+      mFrame[i] = static_cast<kiss_fft_scalar>((sample * mWindow[i]) >> 15);
+    }
+  }
+
+  for (uint32_t i = numSamples; i < mConfig.fftSize; i++) {
+    mFrame[i] = 0;
+  }
+}
+
+void AudioFeatureExtractor::computeLogMelEnergies(float *features) const {
+  for (size_t band = 0; band < mConfig.numMelBands; band++) {
+    float lower = mMelEdges[band];
+    float center = mMelEdges[band + 1];
+    float upper = mMelEdges[band + 2];
+
+    float energy = 0.0f;
+    size_t firstBin = static_cast<size_t>(ceilf(lower));
+    for (size_t bin = firstBin; bin < mPower.size() && bin <= upper; bin++) {
+      float weight = (bin <= center) ? (bin - lower) / (center - lower)
+                                     : (upper - bin) / (upper - center);
+      energy += weight * mPower[bin];
+    }
+
+    features[band] = logf(energy + kLogMelFloor);
+  }
+}
+
+}  // namespace chre
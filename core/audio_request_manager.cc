@@ -19,6 +19,7 @@
 #include "chre/core/audio_util.h"
 #include "chre/core/event_loop_manager.h"
 #include "chre/platform/fatal_error.h"
+#include "chre/platform/memory.h"
 #include "chre/platform/system_time.h"
 #include "chre/util/nested_data_ptr.h"
 #include "chre/util/system/debug_dump.h"
@@ -66,6 +67,36 @@ bool AudioRequestManager::configureSource(const Nanoapp *nanoapp,
                            Nanoseconds(deliveryInterval));
 }
 
+bool AudioRequestManager::configureFeatures(
+    const Nanoapp *nanoapp, uint32_t handle, bool enable,
+    const struct chreAudioFeatureConfig *config) {
+  uint16_t instanceId = nanoapp->getInstanceId();
+
+  bool success = false;
+  if (handle >= mAudioRequestLists.size()) {
+    LOGE("Provided audio handle out of range");
+  } else if (!enable) {
+    success = removeAudioFeatureRequest(handle, instanceId);
+    if (!success) {
+      LOGW("Nanoapp disabling nonexistent audio features");
+    }
+  } else if (config == nullptr ||
+             !AudioFeatureExtractor::isValidConfig(*config)) {
+    LOGE("Invalid audio feature configuration");
+  } else if (findAudioRequestByInstanceId(handle, instanceId,
+                                          nullptr /* index */,
+                                          nullptr /* instanceIdIndex */) ==
+             nullptr) {
+    LOGE("Audio features require the handle %" PRIu32 " to be enabled",
+         handle);
+  } else {
+    removeAudioFeatureRequest(handle, instanceId);
+    success = createAudioFeatureRequest(handle, instanceId, *config);
+  }
+
+  return success;
+}
+
 void AudioRequestManager::handleAudioDataEvent(
     const struct chreAudioDataEvent *audioDataEvent) {
   uint32_t handle = audioDataEvent->handle;
@@ -76,19 +107,15 @@ void AudioRequestManager::handleAudioDataEvent(
         SystemTime::getMonotonicTime();
   }
 
-  auto callback = [](uint16_t /*type*/, void *data, void * /*extraData*/) {
-    auto *event = static_cast<struct chreAudioDataEvent *>(data);
-    EventLoopManagerSingleton::get()
-        ->getAudioRequestManager()
-        .handleAudioDataEventSync(event);
-  };
-
-  // Cast off the event const so that it can be provided to the callback as
+  // Cast off the event const so that it can be provided to the hook as
   // non-const. The event is provided to nanoapps as const and the runtime
   // itself will not modify this memory so this is safe.
-  EventLoopManagerSingleton::get()->deferCallback(
-      SystemCallbackType::AudioHandleDataEvent,
-      const_cast<struct chreAudioDataEvent *>(audioDataEvent), callback);
+  EventLoopManagerSingleton::get()
+      ->getEventLoop()
+      .postEventWithPreDispatchHookOrDie(
+          CHRE_EVENT_AUDIO_DATA,
+          const_cast<struct chreAudioDataEvent *>(audioDataEvent),
+          audioDataEventPreDispatchHook, freeAudioDataEventCallback);
 }
 
 void AudioRequestManager::handleAudioAvailability(uint32_t handle,
@@ -135,6 +162,17 @@ void AudioRequestManager::logStateToBuffer(DebugDumpWrapper &debugDump) const {
                             .getMilliseconds());
       }
     }
+
+    for (const auto &featureRequest : mAudioRequestLists[i].featureRequests) {
+      const chreAudioFeatureConfig &config =
+          featureRequest.extractor->getConfig();
+      for (const auto &instanceId : featureRequest.instanceIds) {
+        debugDump.print("  nanoappId=%" PRIu16 ", featureType=%" PRIu8
+                        ", fftSize=%" PRIu16 ", melBands=%" PRIu8 "\n",
+                        instanceId, config.featureType, config.fftSize,
+                        config.numMelBands);
+      }
+    }
   }
 }
 
@@ -200,9 +238,10 @@ bool AudioRequestManager::doConfigureSource(uint16_t instanceId,
       requestList.requests.erase(requestIndex);
     }
 
-    // If the client is disabling, there is nothing to do, otherwise a
-    // request must be created successfully.
+    // If the client is disabling, its features are disabled as well,
+    // otherwise a request must be created successfully.
     if (!enable) {
+      removeAudioFeatureRequest(handle, instanceId);
       success = true;
     } else {
       success =
@@ -272,6 +311,67 @@ bool AudioRequestManager::createAudioRequest(uint32_t handle,
   return success;
 }
 
+bool AudioRequestManager::createAudioFeatureRequest(
+    uint32_t handle, uint16_t instanceId,
+    const struct chreAudioFeatureConfig &config) {
+  auto &featureRequests = mAudioRequestLists[handle].featureRequests;
+  AudioFeatureRequest *matchingFeatureRequest = nullptr;
+  for (auto &featureRequest : featureRequests) {
+    if (featureRequest.extractor->hasConfig(config)) {
+      matchingFeatureRequest = &featureRequest;
+      break;
+    }
+  }
+
+  bool success = false;
+  chreAudioSource audioSource;
+  if (matchingFeatureRequest != nullptr) {
+    if (!matchingFeatureRequest->instanceIds.push_back(instanceId)) {
+      LOG_OOM();
+    } else {
+      success = true;
+    }
+  } else if (!mPlatformAudio.getAudioSource(handle, &audioSource)) {
+    LOGE("Failed to query for audio source");
+  } else if (!featureRequests.emplace_back()) {
+    LOG_OOM();
+  } else {
+    AudioFeatureRequest &featureRequest = featureRequests.back();
+    featureRequest.extractor = MakeUnique<AudioFeatureExtractor>();
+    if (featureRequest.extractor.isNull() ||
+        !featureRequest.extractor->init(config, audioSource.sampleRate) ||
+        !featureRequest.instanceIds.push_back(instanceId)) {
+      featureRequests.pop_back();
+      LOG_OOM();
+    } else {
+      success = true;
+    }
+  }
+
+  return success;
+}
+
+bool AudioRequestManager::removeAudioFeatureRequest(uint32_t handle,
+                                                    uint16_t instanceId) {
+  bool removed = false;
+  auto &featureRequests = mAudioRequestLists[handle].featureRequests;
+  for (size_t i = 0; i < featureRequests.size(); i++) {
+    auto &instanceIds = featureRequests[i].instanceIds;
+    size_t instanceIdIndex = instanceIds.find(instanceId);
+    if (instanceIdIndex != instanceIds.size()) {
+      if (instanceIds.size() > 1) {
+        instanceIds.erase(instanceIdIndex);
+      } else {
+        featureRequests.erase(i);
+      }
+      removed = true;
+      break;
+    }
+  }
+
+  return removed;
+}
+
 uint32_t AudioRequestManager::disableAllAudioRequests(const Nanoapp *nanoapp) {
   uint32_t numRequestDisabled = 0;
 
@@ -351,25 +451,35 @@ AudioRequestManager::AudioRequest *AudioRequestManager::findNextAudioRequest(
   return nextRequest;
 }
 
-void AudioRequestManager::handleAudioDataEventSync(
+uint16_t AudioRequestManager::handleAudioDataEventSync(
     struct chreAudioDataEvent *event) {
+  uint16_t targetInstanceId = kSystemInstanceId;
   uint32_t handle = event->handle;
   if (handle < mAudioRequestLists.size()) {
     auto &reqList = mAudioRequestLists[handle];
     AudioRequest *nextAudioRequest = reqList.nextAudioRequest;
     if (nextAudioRequest != nullptr) {
-      postAudioDataEventFatal(event, nextAudioRequest->instanceIds);
+      targetInstanceId =
+          postAudioDataEventFatal(event, nextAudioRequest->instanceIds);
+      postAudioFeatureEvents(event, nextAudioRequest->instanceIds);
       nextAudioRequest->nextEventTimestamp =
           SystemTime::getMonotonicTime() + nextAudioRequest->deliveryInterval;
     } else {
       LOGW("Received audio data event with no pending audio request");
-      mPlatformAudio.releaseAudioDataEvent(event);
     }
 
     scheduleNextAudioDataEvent(handle);
   } else {
     LOGE("Audio data event handle out of range: %" PRIu32, handle);
   }
+
+  if (targetInstanceId == kSystemInstanceId) {
+    // The dropped event still holds a reference, which is released by its free
+    // callback
+    mAudioDataEventRefCounts.emplace_back(event, 1 /* refCount */);
+  }
+
+  return targetInstanceId;
 }
 
 void AudioRequestManager::handleAudioAvailabilitySync(uint32_t handle,
@@ -440,21 +550,73 @@ void AudioRequestManager::postAudioSamplingChangeEvent(uint16_t instanceId,
       instanceId);
 }
 
-void AudioRequestManager::postAudioDataEventFatal(
+uint16_t AudioRequestManager::postAudioDataEventFatal(
     struct chreAudioDataEvent *event,
     const DynamicVector<uint16_t> &instanceIds) {
+  uint16_t targetInstanceId = kSystemInstanceId;
   if (instanceIds.empty()) {
     LOGW("Received audio data event for no clients");
-    mPlatformAudio.releaseAudioDataEvent(event);
   } else {
-    for (const auto &instanceId : instanceIds) {
+    targetInstanceId = instanceIds[0];
+    for (size_t i = 1; i < instanceIds.size(); i++) {
       EventLoopManagerSingleton::get()->getEventLoop().postEventOrDie(
-          CHRE_EVENT_AUDIO_DATA, event, freeAudioDataEventCallback, instanceId);
+          CHRE_EVENT_AUDIO_DATA, event, freeAudioDataEventCallback,
+          instanceIds[i]);
     }
 
     mAudioDataEventRefCounts.emplace_back(
         event, static_cast<uint32_t>(instanceIds.size()));
   }
+
+  return targetInstanceId;
+}
+
+void AudioRequestManager::postAudioFeatureEvents(
+    const struct chreAudioDataEvent *event,
+    const DynamicVector<uint16_t> &instanceIds) {
+  for (auto &featureRequest :
+       mAudioRequestLists[event->handle].featureRequests) {
+    uint32_t refCount = 0;
+    for (uint16_t instanceId : featureRequest.instanceIds) {
+      if (instanceIds.find(instanceId) != instanceIds.size()) {
+        refCount++;
+      }
+    }
+    if (refCount == 0) {
+      continue;
+    }
+
+    AudioFeatureExtractor &extractor = *featureRequest.extractor;
+    uint16_t featureCount = extractor.getFeatureCount();
+    auto *sharedEvent = static_cast<SharedAudioFeatureEvent *>(memoryAlloc(
+        sizeof(SharedAudioFeatureEvent) + featureCount * sizeof(float)));
+    if (sharedEvent == nullptr) {
+      LOG_OOM();
+      continue;
+    }
+
+    // The features are computed once for all the nanoapps of the request.
+    auto *features = reinterpret_cast<float *>(sharedEvent + 1);
+    struct chreAudioFeatureEvent &featureEvent = sharedEvent->event;
+    featureEvent.version = CHRE_AUDIO_FEATURE_EVENT_VERSION;
+    featureEvent.featureType = extractor.getConfig().featureType;
+    featureEvent.fftSize = extractor.getConfig().fftSize;
+    featureEvent.handle = event->handle;
+    featureEvent.timestamp = event->timestamp;
+    featureEvent.sampleRate = event->sampleRate;
+    featureEvent.frameCount = extractor.extract(*event, features);
+    featureEvent.featureCount = featureCount;
+    featureEvent.features = features;
+    sharedEvent->refCount = refCount;
+
+    for (uint16_t instanceId : featureRequest.instanceIds) {
+      if (instanceIds.find(instanceId) != instanceIds.size()) {
+        EventLoopManagerSingleton::get()->getEventLoop().postEventOrDie(
+            CHRE_EVENT_AUDIO_FEATURES, sharedEvent,
+            freeAudioFeatureEventCallback, instanceId);
+      }
+    }
+  }
 }
 
 void AudioRequestManager::handleFreeAudioDataEvent(
@@ -487,6 +649,24 @@ void AudioRequestManager::freeAudioDataEventCallback(uint16_t eventType,
       .handleFreeAudioDataEvent(event);
 }
 
+void AudioRequestManager::freeAudioFeatureEventCallback(uint16_t eventType,
+                                                        void *eventData) {
+  UNUSED_VAR(eventType);
+  auto *sharedEvent = static_cast<SharedAudioFeatureEvent *>(eventData);
+  sharedEvent->refCount--;
+  if (sharedEvent->refCount == 0) {
+    memoryFree(sharedEvent);
+  }
+}
+
+uint16_t AudioRequestManager::audioDataEventPreDispatchHook(
+    uint16_t /* eventType */, void *eventData) {
+  auto *event = static_cast<struct chreAudioDataEvent *>(eventData);
+  return EventLoopManagerSingleton::get()
+      ->getAudioRequestManager()
+      .handleAudioDataEventSync(event);
+}
+
 void AudioRequestManager::onSettingChanged(Setting setting, bool enabled) {
   if (setting == Setting::MICROPHONE) {
     for (size_t i = 0; i < mAudioRequestLists.size(); ++i) {
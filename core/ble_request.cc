@@ -171,6 +171,55 @@ bool BleRequest::isEnabled() const {
   return mEnabled;
 }
 
+bool BleRequest::hasFilter() const {
+  return (mRssiThreshold != CHRE_BLE_RSSI_THRESHOLD_NONE || !mFilters.empty());
+}
+
+bool BleRequest::matches(const chreBleAdvertisingReport &report) const {
+  bool matched = (report.rssi == CHRE_BLE_RSSI_NONE ||
+                  report.rssi >= mRssiThreshold);
+  if (matched && !mFilters.empty()) {
+    matched = matchesGenericFilters(report.data, report.dataLength);
+  }
+  return matched;
+}
+
+bool BleRequest::matchesGenericFilters(const uint8_t *data,
+                                       uint16_t dataLength) const {
+  bool matched = false;
+  // The advertising data is a sequence of AD structures, each made of a length
+  // byte followed by the AD type and the AD payload it covers. A zero length
+  // marks the end of the significant part of the data.
+  size_t offset = 0;
+  while (!matched && data != nullptr && offset + 1 < dataLength) {
+    size_t adLength = data[offset];
+    if (adLength == 0 || offset + 1 + adLength > dataLength) {
+      break;
+    }
+    uint8_t adType = data[offset + 1];
+    const uint8_t *payload = &data[offset + 2];
+    size_t payloadLength = adLength - 1;
+
+    for (const chreBleGenericFilter &filter : mFilters) {
+      if (filter.type == adType && filter.len <= payloadLength) {
+        matched = true;
+        for (size_t i = 0; i < filter.len; i++) {
+          if ((payload[i] & filter.dataMask[i]) !=
+              (filter.data[i] & filter.dataMask[i])) {
+            matched = false;
+            break;
+          }
+        }
+        if (matched) {
+          break;
+        }
+      }
+    }
+    offset += 1 + adLength;
+  }
+  return matched;
+}
+
 void BleRequest::logStateToBuffer(DebugDumpWrapper &debugDump,
                                   bool isPlatformRequest) const {
   if (!isPlatformRequest) {
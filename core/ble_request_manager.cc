@@ -201,7 +201,21 @@ bool BleRequestManager::controlPlatform() {
 
 void BleRequestManager::handleFreeAdvertisingEvent(
     struct chreBleAdvertisementEvent *event) {
-  mPlatformBle.releaseAdvertisingEvent(event);
+  size_t index =
+      mAdvertisingEventRefCounts.find(AdvertisingEventRefCount(event));
+  if (index == mAdvertisingEventRefCounts.size()) {
+    // The event was broadcast as is.
+    mPlatformBle.releaseAdvertisingEvent(event);
+  } else {
+    AdvertisingEventRefCount &eventRefCount =
+        mAdvertisingEventRefCounts[index];
+    CHRE_ASSERT(eventRefCount.refCount > 0);
+    eventRefCount.refCount--;
+    if (eventRefCount.refCount == 0) {
+      mAdvertisingEventRefCounts.erase(index);
+      mPlatformBle.releaseAdvertisingEvent(event);
+    }
+  }
 }
 
 void BleRequestManager::freeAdvertisingEventCallback(uint16_t /* eventType */,
@@ -212,10 +226,125 @@ void BleRequestManager::freeAdvertisingEventCallback(uint16_t /* eventType */,
       .handleFreeAdvertisingEvent(event);
 }
 
+void BleRequestManager::freeFilteredAdvertisingEventCallback(
+    uint16_t /* eventType */, void *eventData) {
+  auto filteredEvent = static_cast<FilteredAdvertisementEvent *>(eventData);
+  chreBleAdvertisementEvent *originalEvent = filteredEvent->originalEvent;
+  memoryFree(filteredEvent);
+  EventLoopManagerSingleton::get()
+      ->getBleRequestManager()
+      .handleFreeAdvertisingEvent(originalEvent);
+}
+
+uint16_t BleRequestManager::advertisingEventPreDispatchHook(
+    uint16_t /* eventType */, void *eventData) {
+  auto event = static_cast<chreBleAdvertisementEvent *>(eventData);
+  return EventLoopManagerSingleton::get()
+      ->getBleRequestManager()
+      .handleAdvertisementEventSync(event);
+}
+
 void BleRequestManager::handleAdvertisementEvent(
     struct chreBleAdvertisementEvent *event) {
-  EventLoopManagerSingleton::get()->getEventLoop().postEventOrDie(
-      CHRE_EVENT_BLE_ADVERTISEMENT, event, freeAdvertisingEventCallback);
+  EventLoopManagerSingleton::get()
+      ->getEventLoop()
+      .postEventWithPreDispatchHookOrDie(CHRE_EVENT_BLE_ADVERTISEMENT, event,
+                                         advertisingEventPreDispatchHook,
+                                         freeAdvertisingEventCallback);
+}
+
+uint16_t BleRequestManager::handleAdvertisementEventSync(
+    chreBleAdvertisementEvent *event) {
+  bool hasFilter = false;
+  for (const BleRequest &req : mRequests.getRequests()) {
+    if (req.hasFilter()) {
+      hasFilter = true;
+      break;
+    }
+  }
+
+  // Events delivered individually are posted at the tail of the event queue.
+  // While some of them are outstanding, the next events must take the same
+  // path so that every nanoapp receives the reports in order.
+  uint16_t targetInstanceId = kBroadcastInstanceId;
+  if (!hasFilter && mAdvertisingEventRefCounts.empty()) {
+    // Every nanoapp receives all the reports, as with a broadcast.
+  } else if (!mAdvertisingEventRefCounts.emplace_back(event,
+                                                      1 /* refCount */)) {
+    LOG_OOM();
+  } else {
+    // The original event is dropped, and the reference it holds is released
+    // through its free callback.
+    targetInstanceId = kSystemInstanceId;
+    uint32_t &refCount = mAdvertisingEventRefCounts.back().refCount;
+    EventLoop &eventLoop = EventLoopManagerSingleton::get()->getEventLoop();
+    if (!hasFilter) {
+      eventLoop.postEventOrDie(CHRE_EVENT_BLE_ADVERTISEMENT, event,
+                               freeAdvertisingEventCallback);
+      refCount++;
+    } else {
+      for (const BleRequest &req : mRequests.getRequests()) {
+        uint16_t instanceId = req.getInstanceId();
+        const Nanoapp *nanoapp = eventLoop.findNanoappByInstanceId(instanceId);
+        if (nanoapp == nullptr || !nanoapp->isRegisteredForBroadcastEvent(
+                                      CHRE_EVENT_BLE_ADVERTISEMENT)) {
+          continue;
+        }
+
+        uint16_t numMatchingReports = 0;
+        for (uint16_t i = 0; i < event->numReports; i++) {
+          if (req.matches(event->reports[i])) {
+            numMatchingReports++;
+          }
+        }
+
+        bool deliverOriginalEvent = (numMatchingReports == event->numReports);
+        if (!deliverOriginalEvent && numMatchingReports > 0) {
+          if (postFilteredAdvertisementEvent(event, req, numMatchingReports)) {
+            refCount++;
+          } else {
+            LOG_OOM();
+            deliverOriginalEvent = true;
+          }
+        }
+
+        if (deliverOriginalEvent) {
+          eventLoop.postEventOrDie(CHRE_EVENT_BLE_ADVERTISEMENT, event,
+                                   freeAdvertisingEventCallback, instanceId);
+          refCount++;
+        }
+      }
+    }
+  }
+  return targetInstanceId;
+}
+
+bool BleRequestManager::postFilteredAdvertisementEvent(
+    chreBleAdvertisementEvent *event, const BleRequest &request,
+    uint16_t numMatchingReports) {
+  auto filteredEvent = static_cast<FilteredAdvertisementEvent *>(
+      memoryAlloc(sizeof(FilteredAdvertisementEvent) +
+                  numMatchingReports * sizeof(chreBleAdvertisingReport)));
+  if (filteredEvent != nullptr) {
+    auto reports =
+        reinterpret_cast<chreBleAdvertisingReport *>(filteredEvent + 1);
+    uint16_t numReports = 0;
+    for (uint16_t i = 0; i < event->numReports; i++) {
+      if (request.matches(event->reports[i])) {
+        reports[numReports++] = event->reports[i];
+      }
+    }
+    CHRE_ASSERT(numReports == numMatchingReports);
+
+    filteredEvent->event.reserved = 0;
+    filteredEvent->event.numReports = numReports;
+    filteredEvent->event.reports = reports;
+    filteredEvent->originalEvent = event;
+    EventLoopManagerSingleton::get()->getEventLoop().postEventOrDie(
+        CHRE_EVENT_BLE_ADVERTISEMENT, filteredEvent,
+        freeFilteredAdvertisingEventCallback, request.getInstanceId());
+  }
+  return (filteredEvent != nullptr);
 }
 
 void BleRequestManager::handlePlatformChange(bool enable, uint8_t errorCode) {
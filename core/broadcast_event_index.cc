@@ -0,0 +1,167 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "chre/core/broadcast_event_index.h"
+
+#include "chre/core/nanoapp.h"
+
+namespace chre {
+
+bool BroadcastEventIndex::setSubscription(Nanoapp *nanoapp, uint16_t eventType,
+                                          uint16_t groupIdMask) {
+  bool success = true;
+  uint16_t instanceId = nanoapp->getInstanceId();
+  size_t entryIndex = lowerBound(eventType);
+  bool entryFound = (entryIndex < mEntries.size() &&
+                     mEntries[entryIndex].eventType == eventType);
+
+  if (!entryFound) {
+    if (groupIdMask != 0) {
+      if (!mEntries.insert(entryIndex, Entry(eventType))) {
+        success = false;
+      } else if (!mEntries[entryIndex].subscribers.push_back(
+                     Subscriber(nanoapp, instanceId, groupIdMask))) {
+        mEntries.erase(entryIndex);
+        success = false;
+      } else {
+        mEntries[entryIndex].groupIdMask = groupIdMask;
+      }
+    }
+  } else {
+    Entry &entry = mEntries[entryIndex];
+    size_t subIndex = subscriberLowerBound(entry, instanceId);
+    bool subFound = (subIndex < entry.subscribers.size() &&
+                     entry.subscribers[subIndex].nanoapp == nanoapp);
+
+    if (subFound && groupIdMask != 0) {
+      entry.subscribers[subIndex].groupIdMask = groupIdMask;
+    } else if (subFound) {
+      entry.subscribers.erase(subIndex);
+    } else if (groupIdMask != 0) {
+      success = entry.subscribers.insert(
+          subIndex, Subscriber(nanoapp, instanceId, groupIdMask));
+    }
+
+    // May remove the entry, so the reference to it is invalid after this
+    updateEntryAt(entryIndex);
+  }
+
+  return success;
+}
+
+void BroadcastEventIndex::removeNanoapp(const Nanoapp *nanoapp) {
+  uint16_t instanceId = nanoapp->getInstanceId();
+  size_t i = 0;
+  while (i < mEntries.size()) {
+    Entry &entry = mEntries[i];
+    size_t subIndex = subscriberLowerBound(entry, instanceId);
+    if (subIndex < entry.subscribers.size() &&
+        entry.subscribers[subIndex].nanoapp == nanoapp) {
+      entry.subscribers.erase(subIndex);
+    }
+
+    // Only advance if the entry was not removed
+    size_t sizeBefore = mEntries.size();
+    updateEntryAt(i);
+    if (mEntries.size() == sizeBefore) {
+      i++;
+    }
+  }
+}
+
+Nanoapp *BroadcastEventIndex::findNextSubscriber(
+    uint16_t eventType, uint16_t targetGroupMask,
+    uint16_t afterInstanceId) const {
+  Nanoapp *next = nullptr;
+  const Entry *entry = findEntry(eventType);
+
+  if (entry != nullptr && (entry->groupIdMask & targetGroupMask) != 0) {
+    size_t i = subscriberLowerBound(*entry, afterInstanceId);
+    for (; i < entry->subscribers.size(); i++) {
+      const Subscriber &sub = entry->subscribers[i];
+      if (sub.instanceId > afterInstanceId &&
+          (sub.groupIdMask & targetGroupMask) != 0) {
+        next = sub.nanoapp;
+        break;
+      }
+    }
+  }
+
+  return next;
+}
+
+bool BroadcastEventIndex::hasSubscribers(uint16_t eventType,
+                                         uint16_t targetGroupMask) const {
+  const Entry *entry = findEntry(eventType);
+  return (entry != nullptr && (entry->groupIdMask & targetGroupMask) != 0);
+}
+
+size_t BroadcastEventIndex::getSubscriberCount(uint16_t eventType) const {
+  const Entry *entry = findEntry(eventType);
+  return (entry == nullptr) ? 0 : entry->subscribers.size();
+}
+
+size_t BroadcastEventIndex::lowerBound(uint16_t eventType) const {
+  size_t low = 0;
+  size_t high = mEntries.size();
+  while (low < high) {
+    size_t mid = low + (high - low) / 2;
+    if (mEntries[mid].eventType < eventType) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+  return low;
+}
+
+const BroadcastEventIndex::Entry *BroadcastEventIndex::findEntry(
+    uint16_t eventType) const {
+  size_t index = lowerBound(eventType);
+  return (index < mEntries.size() && mEntries[index].eventType == eventType)
+             ? &mEntries[index]
+             : nullptr;
+}
+
+size_t BroadcastEventIndex::subscriberLowerBound(const Entry &entry,
+                                                 uint16_t instanceId) {
+  size_t low = 0;
+  size_t high = entry.subscribers.size();
+  while (low < high) {
+    size_t mid = low + (high - low) / 2;
+    if (entry.subscribers[mid].instanceId < instanceId) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+  return low;
+}
+
+void BroadcastEventIndex::updateEntryAt(size_t index) {
+  Entry &entry = mEntries[index];
+  if (entry.subscribers.empty()) {
+    mEntries.erase(index);
+  } else {
+    uint16_t groupIdMask = 0;
+    for (const Subscriber &sub : entry.subscribers) {
+      groupIdMask |= sub.groupIdMask;
+    }
+    entry.groupIdMask = groupIdMask;
+  }
+}
+
+}  // namespace chre
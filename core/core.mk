@@ -9,6 +9,7 @@ COMMON_CFLAGS += -I$(CHRE_PREFIX)/core/include
 
 # Common Source Files ##########################################################
 
+COMMON_SRCS += $(CHRE_PREFIX)/core/broadcast_event_index.cc
 COMMON_SRCS += $(CHRE_PREFIX)/core/debug_dump_manager.cc
 COMMON_SRCS += $(CHRE_PREFIX)/core/event.cc
 COMMON_SRCS += $(CHRE_PREFIX)/core/event_loop.cc
@@ -25,6 +26,7 @@ COMMON_SRCS += $(CHRE_PREFIX)/core/timer_pool.cc
 
 # Optional audio support.
 ifeq ($(CHRE_AUDIO_SUPPORT_ENABLED), true)
+COMMON_SRCS += $(CHRE_PREFIX)/core/audio_feature_extractor.cc
 COMMON_SRCS += $(CHRE_PREFIX)/core/audio_request_manager.cc
 endif
 
@@ -43,6 +45,7 @@ endif
 # Optional sensors support.
 ifeq ($(CHRE_SENSORS_SUPPORT_ENABLED), true)
 COMMON_SRCS += $(CHRE_PREFIX)/core/sensor.cc
+COMMON_SRCS += $(CHRE_PREFIX)/core/sensor_data_batcher.cc
 COMMON_SRCS += $(CHRE_PREFIX)/core/sensor_request.cc
 COMMON_SRCS += $(CHRE_PREFIX)/core/sensor_request_manager.cc
 COMMON_SRCS += $(CHRE_PREFIX)/core/sensor_request_multiplexer.cc
@@ -53,6 +56,7 @@ endif
 # Optional Wi-Fi support.
 ifeq ($(CHRE_WIFI_SUPPORT_ENABLED), true)
 COMMON_SRCS += $(CHRE_PREFIX)/core/wifi_request_manager.cc
+COMMON_SRCS += $(CHRE_PREFIX)/core/wifi_scan_cache.cc
 COMMON_SRCS += $(CHRE_PREFIX)/core/wifi_scan_request.cc
 endif
 
@@ -78,9 +82,13 @@ endif
 
 # GoogleTest Source Files ######################################################
 
+GOOGLETEST_SRCS += $(CHRE_PREFIX)/core/tests/audio_feature_extractor_test.cc
 GOOGLETEST_SRCS += $(CHRE_PREFIX)/core/tests/audio_util_test.cc
 GOOGLETEST_SRCS += $(CHRE_PREFIX)/core/tests/ble_request_test.cc
+GOOGLETEST_SRCS += $(CHRE_PREFIX)/core/tests/broadcast_event_index_test.cc
 GOOGLETEST_SRCS += $(CHRE_PREFIX)/core/tests/memory_manager_test.cc
 GOOGLETEST_SRCS += $(CHRE_PREFIX)/core/tests/request_multiplexer_test.cc
+GOOGLETEST_SRCS += $(CHRE_PREFIX)/core/tests/sensor_data_batcher_test.cc
 GOOGLETEST_SRCS += $(CHRE_PREFIX)/core/tests/sensor_request_test.cc
+GOOGLETEST_SRCS += $(CHRE_PREFIX)/core/tests/wifi_scan_cache_test.cc
 GOOGLETEST_SRCS += $(CHRE_PREFIX)/core/tests/wifi_scan_request_test.cc
@@ -110,21 +110,37 @@ void EventLoop::run() {
     // Events are delivered in a single stage: they arrive in the inbound event
     // queue mEvents (potentially posted from another thread), then within
     // this context these events are distributed to all interested Nanoapps,
-    // with their free callback invoked after distribution.
-    mEventPoolUsage.addValue(static_cast<uint32_t>(mEvents.size()));
-
-    // mEvents.pop() will be a blocking call if mEvents.empty()
-    Event *event = mEvents.pop();
-    // Need size() + 1 since the to-be-processed event has already been removed.
-    mPowerControlManager.preEventLoopProcess(mEvents.size() + 1);
-    distributeEvent(event);
+    // with their free callback invoked after distribution. Events are removed
+    // from mEvents in batches to reduce lock traffic.
+
+    // mEvents.popBatch() will be a blocking call if mEvents.empty()
+    size_t remaining;
+    mEventBatchSize =
+        mEvents.popBatch(mEventBatch, kMaxEventBatchSize, &remaining);
+    mEventBatchIndex = 0;
+    size_t numPendingEvents = mEventBatchSize + remaining;
+    mPowerControlManager.preEventLoopProcess(numPendingEvents);
+
+    // Nested calls to flushInboundEventQueue() may consume the rest of the
+    // batch, so mEventBatchIndex is re-checked on each iteration
+    while (mRunning && mEventBatchIndex < mEventBatchSize) {
+      // Record the usage as if events were popped individually, i.e. including
+      // the event about to be processed
+      mEventPoolUsage.addValue(
+          static_cast<uint32_t>(numPendingEvents - mEventBatchIndex));
+      distributeEvent(mEventBatch[mEventBatchIndex++]);
+    }
 
-    mPowerControlManager.postEventLoopProcess(mEvents.size());
+    mPowerControlManager.postEventLoopProcess(mEvents.size() +
+                                              getPendingBatchEventCount());
   }
 
   // Purge the main queue of events pending distribution. All nanoapps should be
   // prevented from sending events or messages at this point via
   // currentNanoappIsStopping() returning true.
+  while (mEventBatchIndex < mEventBatchSize) {
+    freeEvent(mEventBatch[mEventBatchIndex++]);
+  }
   while (!mEvents.empty()) {
     freeEvent(mEvents.pop());
   }
@@ -170,6 +186,7 @@ bool EventLoop::startNanoapp(UniquePtr<Nanoapp> &nanoapp) {
       // After this point, nanoapp is null as we've transferred ownership into
       // mNanoapps.back() - use newNanoapp to reference it
     }
+    newNanoapp->setBroadcastEventIndex(&mBroadcastEventIndex);
 
     mCurrentApp = newNanoapp;
     success = newNanoapp->start();
@@ -180,6 +197,8 @@ bool EventLoop::startNanoapp(UniquePtr<Nanoapp> &nanoapp) {
       // destroy the Nanoapp instance.
       LOGE("Nanoapp %" PRIu16 " failed to start", newNanoapp->getInstanceId());
 
+      newNanoapp->setBroadcastEventIndex(nullptr);
+
       // Note that this lock protects against concurrent read and modification
       // of mNanoapps, but we are assured that no new nanoapps were added since
       // we pushed the new nanoapp
@@ -253,6 +272,21 @@ void EventLoop::postEventOrDie(uint16_t eventType, void *eventData,
   }
 }
 
+void EventLoop::postEventWithPreDispatchHookOrDie(
+    uint16_t eventType, void *eventData,
+    PreDispatchHookFunction *preDispatchHook,
+    chreEventCompleteFunction *freeCallback) {
+  if (mRunning) {
+    Event *event = mEventPool.allocate(eventType, eventData, freeCallback,
+                                       preDispatchHook);
+    if (event == nullptr || !mEvents.push(event)) {
+      FATAL_ERROR("Failed to post critical system event 0x%" PRIx16, eventType);
+    }
+  } else if (freeCallback != nullptr) {
+    freeCallback(eventType, eventData);
+  }
+}
+
 bool EventLoop::postSystemEvent(uint16_t eventType, void *eventData,
                                 SystemEventCallbackFunction *callback,
                                 void *extraData) {
@@ -351,6 +385,8 @@ void EventLoop::logStateToBuffer(DebugDumpWrapper &debugDump) const {
                   "mins ago, bucketDuration=%" PRIu64 "mins\n",
                   timeSinceMins, durationMins);
 
+  mTimerPool.logStateToBuffer(debugDump);
+
   debugDump.print("\nNanoapps:\n");
   for (const UniquePtr<Nanoapp> &app : mNanoapps) {
     app->logStateToBuffer(debugDump);
@@ -374,19 +410,45 @@ bool EventLoop::allocateAndPostEvent(uint16_t eventType, void *eventData,
   return success;
 }
 
-void EventLoop::deliverNextEvent(const UniquePtr<Nanoapp> &app, Event *event) {
+void EventLoop::deliverNextEvent(Nanoapp *app, Event *event) {
   // TODO: cleaner way to set/clear this? RAII-style?
-  mCurrentApp = app.get();
+  mCurrentApp = app;
   app->processEvent(event);
   mCurrentApp = nullptr;
 }
 
 void EventLoop::distributeEvent(Event *event) {
+  uint16_t targetInstanceId = event->targetInstanceId;
+  if (event->preDispatchHook != nullptr) {
+    targetInstanceId = event->preDispatchHook(event->eventType,
+                                              event->eventData);
+  }
+
   bool eventDelivered = false;
-  for (const UniquePtr<Nanoapp> &app : mNanoapps) {
-    if ((event->targetInstanceId == chre::kBroadcastInstanceId &&
-         app->isRegisteredForBroadcastEvent(event)) ||
-        event->targetInstanceId == app->getInstanceId()) {
+  if (targetInstanceId == kBroadcastInstanceId) {
+    if (event->eventType == CHRE_EVENT_HOST_ENDPOINT_NOTIFICATION) {
+      // Registration for this event is tracked by host endpoint ID rather than
+      // by event type, so it is not part of mBroadcastEventIndex
+      for (const UniquePtr<Nanoapp> &app : mNanoapps) {
+        if (app->isRegisteredForBroadcastEvent(event)) {
+          deliverNextEvent(app.get(), event);
+        }
+      }
+    } else {
+      // The subscriber lookup restarts after each delivery, as the nanoapp may
+      // have modified its registrations while handling the event
+      uint16_t lastInstanceId = kSystemInstanceId;
+      Nanoapp *app;
+      while ((app = mBroadcastEventIndex.findNextSubscriber(
+                  event->eventType, event->targetAppGroupMask,
+                  lastInstanceId)) != nullptr) {
+        lastInstanceId = app->getInstanceId();
+        deliverNextEvent(app, event);
+      }
+    }
+  } else if (targetInstanceId != kSystemInstanceId) {
+    Nanoapp *app = lookupAppByInstanceId(targetInstanceId);
+    if (app != nullptr) {
       eventDelivered = true;
       deliverNextEvent(app, event);
     }
@@ -396,16 +458,19 @@ void EventLoop::distributeEvent(Event *event) {
   // unloaded), though it could just be a harmless transient issue (e.g. race
   // condition with nanoapp unload, where we post an event to a nanoapp just
   // after queues are flushed while it's unloading)
-  if (!eventDelivered && event->targetInstanceId != kBroadcastInstanceId &&
-      event->targetInstanceId != kSystemInstanceId) {
+  if (!eventDelivered && targetInstanceId != kBroadcastInstanceId &&
+      targetInstanceId != kSystemInstanceId) {
     LOGW("Dropping event 0x%" PRIx16 " from instanceId %" PRIu16 "->%" PRIu16,
-         event->eventType, event->senderInstanceId, event->targetInstanceId);
+         event->eventType, event->senderInstanceId, targetInstanceId);
   }
   CHRE_ASSERT(event->isUnreferenced());
   freeEvent(event);
 }
 
 void EventLoop::flushInboundEventQueue() {
+  while (mEventBatchIndex < mEventBatchSize) {
+    distributeEvent(mEventBatch[mEventBatchIndex++]);
+  }
   while (!mEvents.empty()) {
     distributeEvent(mEvents.pop());
   }
@@ -523,6 +588,7 @@ void EventLoop::unloadNanoappAtIndex(size_t index) {
   mCurrentApp = nullptr;
 
   // Destroy the Nanoapp instance
+  nanoapp->setBroadcastEventIndex(nullptr);
   mNanoapps.erase(index);
 }
 
@@ -27,51 +27,6 @@
 
 namespace chre {
 
-namespace {
-
-bool getCallbackType(uint16_t eventType, SystemCallbackType *callbackType) {
-  bool success = true;
-  switch (eventType) {
-    case CHRE_EVENT_GNSS_LOCATION: {
-      *callbackType = SystemCallbackType::GnssLocationReportEvent;
-      break;
-    }
-    case CHRE_EVENT_GNSS_DATA: {
-      *callbackType = SystemCallbackType::GnssMeasurementReportEvent;
-      break;
-    }
-    default: {
-      LOGE("Unknown event type %" PRIu16, eventType);
-      success = false;
-    }
-  }
-
-  return success;
-}
-
-bool getReportEventType(SystemCallbackType callbackType, uint16_t *eventType) {
-  bool success = true;
-  switch (callbackType) {
-    case SystemCallbackType::GnssLocationReportEvent: {
-      *eventType = CHRE_EVENT_GNSS_LOCATION;
-      break;
-    }
-    case SystemCallbackType::GnssMeasurementReportEvent: {
-      *eventType = CHRE_EVENT_GNSS_DATA;
-      break;
-    }
-    default: {
-      LOGE("Unknown callback type %" PRIu16,
-           static_cast<uint16_t>(callbackType));
-      success = false;
-    }
-  }
-
-  return success;
-}
-
-}  // anonymous namespace
-
 GnssManager::GnssManager()
     : mLocationSession(CHRE_EVENT_GNSS_LOCATION),
       mMeasurementSession(CHRE_EVENT_GNSS_DATA) {}
@@ -233,7 +188,7 @@ uint32_t GnssManager::disableAllSubscriptions(Nanoapp *nanoapp) {
 }
 
 GnssSession::GnssSession(uint16_t reportEventType)
-    : kReportEventType(reportEventType) {
+    : kReportEventType(reportEventType), mNumDeferredCallbacks(0) {
   switch (kReportEventType) {
     case CHRE_EVENT_GNSS_LOCATION:
       mStartRequestType = CHRE_GNSS_REQUEST_TYPE_LOCATION_SESSION_START;
@@ -279,11 +234,13 @@ void GnssSession::handleStatusChange(bool enabled, uint8_t errorCode) {
     auto *session = static_cast<GnssSession *>(data);
     CallbackState cbState = NestedDataPtr<CallbackState>(extraData);
     session->handleStatusChangeSync(cbState.enabled, cbState.errorCode);
+    session->mNumDeferredCallbacks.fetch_decrement();
   };
 
   CallbackState cbState = {};
   cbState.enabled = enabled;
   cbState.errorCode = errorCode;
+  mNumDeferredCallbacks.fetch_increment();
   EventLoopManagerSingleton::get()->deferCallback(
       SystemCallbackType::GnssSessionStatusChange, /*data=*/this, callback,
       NestedDataPtr<CallbackState>(cbState));
@@ -294,28 +251,36 @@ void GnssSession::handleReportEvent(void *event) {
     LOGW("Unexpected %s event", mName);
   }
 
-  auto callback = [](uint16_t type, void *data, void * /*extraData*/) {
-    uint16_t reportEventType = 0;
-    if (!getReportEventType(static_cast<SystemCallbackType>(type),
-                            &reportEventType) ||
-        !EventLoopManagerSingleton::get()
-             ->getSettingManager()
-             .getSettingEnabled(Setting::LOCATION)) {
-      freeReportEventCallback(reportEventType, data);
-    } else {
-      EventLoopManagerSingleton::get()->getEventLoop().postEventOrDie(
-          reportEventType, data, freeReportEventCallback);
-    }
-  };
-
-  SystemCallbackType type;
-  if (!getCallbackType(kReportEventType, &type)) {
-    freeReportEventCallback(kReportEventType, event);
+  // The async result of a status change is posted from the CHRE thread. If
+  // one is still deferred, the report must be deferred behind it so that
+  // nanoapps receive the async result of the session request first.
+  if (mNumDeferredCallbacks.load() == 0) {
+    postReportEvent(event);
   } else {
-    EventLoopManagerSingleton::get()->deferCallback(type, event, callback);
+    auto callback = [](uint16_t /*type*/, void *data, void *extraData) {
+      auto *session = static_cast<GnssSession *>(extraData);
+      session->postReportEvent(data);
+      session->mNumDeferredCallbacks.fetch_decrement();
+    };
+
+    SystemCallbackType type =
+        (kReportEventType == CHRE_EVENT_GNSS_LOCATION)
+            ? SystemCallbackType::GnssLocationReportEvent
+            : SystemCallbackType::GnssMeasurementReportEvent;
+    mNumDeferredCallbacks.fetch_increment();
+    EventLoopManagerSingleton::get()->deferCallback(type, event, callback,
+                                                    /*extraData=*/this);
   }
 }
 
+void GnssSession::postReportEvent(void *event) {
+  EventLoopManagerSingleton::get()
+      ->getEventLoop()
+      .postEventWithPreDispatchHookOrDie(kReportEventType, event,
+                                         reportEventPreDispatchHook,
+                                         freeReportEventCallback);
+}
+
 void GnssSession::onSettingChanged(Setting setting, bool /*enabled*/) {
   if (setting == Setting::LOCATION) {
     if (asyncResponsePending()) {
@@ -679,6 +644,16 @@ void GnssSession::freeReportEventCallback(uint16_t eventType, void *eventData) {
   }
 }
 
+uint16_t GnssSession::reportEventPreDispatchHook(uint16_t /* eventType */,
+                                                 void * /* eventData */) {
+  // Reports are dropped if the location setting was disabled after they were
+  // posted
+  bool enabled =
+      EventLoopManagerSingleton::get()->getSettingManager().getSettingEnabled(
+          Setting::LOCATION);
+  return enabled ? kBroadcastInstanceId : kSystemInstanceId;
+}
+
 bool GnssSession::controlPlatform(bool enable, Milliseconds minInterval,
                                   Milliseconds /* minTimeToNext */) {
   bool success = false;
@@ -15,6 +15,7 @@
  */
 
 #include <cinttypes>
+#include <new>
 #include <type_traits>
 
 #include "chre/core/event_loop_manager.h"
@@ -81,12 +82,32 @@ bool HostCommsManager::sendMessageToHostFromNanoapp(
   return success;
 }
 
+SharedPtr<HostReceiveBuffer> HostReceiveBuffer::create(size_t size) {
+  HostReceiveBuffer *buffer = nullptr;
+  void *memory = memoryAlloc(sizeof(HostReceiveBuffer) + size);
+  if (memory == nullptr) {
+    LOG_OOM();
+  } else {
+    buffer = new (memory) HostReceiveBuffer(size);
+  }
+
+  // The buffer starts with the reference held by the returned SharedPtr.
+  return SharedPtr<HostReceiveBuffer>(buffer);
+}
+
 MessageFromHost *HostCommsManager::craftNanoappMessageFromHost(
     uint64_t appId, uint16_t hostEndpoint, uint32_t messageType,
-    const void *messageData, uint32_t messageSize) {
+    const SharedPtr<HostReceiveBuffer> &receiveBuffer, const void *messageData,
+    uint32_t messageSize) {
   MessageFromHost *msgFromHost = mMessagePool.allocate();
   if (msgFromHost == nullptr) {
     LOG_OOM();
+  } else if (!receiveBuffer.isNull()) {
+    // The message data is const for the nanoapp, the buffer only needs to be
+    // mutable for Buffer::wrap.
+    msgFromHost->message.wrap(
+        static_cast<uint8_t *>(const_cast<void *>(messageData)), messageSize);
+    msgFromHost->receiveBuffer = receiveBuffer;
   } else if (!msgFromHost->message.copy_array(
                  static_cast<const uint8_t *>(messageData), messageSize)) {
     LOGE("Couldn't allocate %" PRIu32
@@ -95,7 +116,9 @@ MessageFromHost *HostCommsManager::craftNanoappMessageFromHost(
          messageSize, hostEndpoint, messageType);
     mMessagePool.deallocate(msgFromHost);
     msgFromHost = nullptr;
-  } else {
+  }
+
+  if (msgFromHost != nullptr) {
     msgFromHost->appId = appId;
     msgFromHost->fromHostData.messageType = messageType;
     msgFromHost->fromHostData.messageSize = messageSize;
@@ -131,6 +154,20 @@ void HostCommsManager::sendMessageToNanoappFromHost(uint64_t appId,
                                                     uint16_t hostEndpoint,
                                                     const void *messageData,
                                                     size_t messageSize) {
+  sendMessageToNanoappFromHost(appId, messageType, hostEndpoint,
+                               SharedPtr<HostReceiveBuffer>(), messageData,
+                               messageSize);
+}
+
+void HostCommsManager::sendMessageToNanoappFromHost(
+    uint64_t appId, uint32_t messageType, uint16_t hostEndpoint,
+    const SharedPtr<HostReceiveBuffer> &receiveBuffer, const void *messageData,
+    size_t messageSize) {
+  CHRE_ASSERT_LOG(
+      receiveBuffer.isNull() || messageSize == 0 ||
+          receiveBuffer->contains(messageData, messageSize),
+      "Message from host does not lie within its receive buffer");
+
   if (hostEndpoint == kHostEndpointBroadcast) {
     LOGE("Received invalid message from host from broadcast endpoint");
   } else if (messageSize > ((UINT32_MAX))) {
@@ -140,7 +177,7 @@ void HostCommsManager::sendMessageToNanoappFromHost(uint64_t appId,
     LOGE("Rejecting message of size %zu (too big)", messageSize);
   } else {
     MessageFromHost *craftedMessage = craftNanoappMessageFromHost(
-        appId, hostEndpoint, messageType, messageData,
+        appId, hostEndpoint, messageType, receiveBuffer, messageData,
         static_cast<uint32_t>(messageSize));
     if (craftedMessage == nullptr) {
       LOGE("Out of memory - rejecting message to app ID 0x%016" PRIx64
@@ -230,6 +267,12 @@ void HostCommsManager::freeMessageFromHostCallback(uint16_t /*type*/,
 
   auto *eventData = static_cast<chreMessageFromHostData *>(data);
   auto *msgFromHost = reinterpret_cast<MessageFromHost *>(eventData);
+
+  // Drops the reference to the receive buffer of the message, if any, which
+  // releases the buffer once the link layer and all the other messages in it
+  // are done with it.
+  msgFromHost->receiveBuffer.reset();
+
   auto &hostCommsMgr = EventLoopManagerSingleton::get()->getHostCommsManager();
   hostCommsMgr.mMessagePool.deallocate(msgFromHost);
 }
@@ -0,0 +1,125 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CHRE_CORE_AUDIO_FEATURE_EXTRACTOR_H_
+#define CHRE_CORE_AUDIO_FEATURE_EXTRACTOR_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include "chre/util/dynamic_vector.h"
+#include "chre/util/non_copyable.h"
+#include "chre_api/chre/audio.h"
+#include "kiss_fftr.h"
+
+namespace chre {
+
+/**
+ * Computes the spectral features of buffers of audio data for one
+ * configuration, as described by struct chreAudioFeatureEvent. The real FFT of
+ * each frame is computed with kiss_fftr.
+ */
+class AudioFeatureExtractor : public NonCopyable {
+ public:
+  ~AudioFeatureExtractor();
+
+  /**
+   * Checks whether a feature configuration is valid.
+   *
+   * @param config The configuration to check.
+   * @return true if the configuration is valid.
+   */
+  static bool isValidConfig(const struct chreAudioFeatureConfig &config);
+
+  /**
+   * Allocates the state needed to compute the features. Must be called once,
+   * before any other method.
+   *
+   * @param config A valid feature configuration.
+   * @param sampleRate The sample rate of the audio data, in hertz.
+   * @return true if successful, false if memory could not be allocated.
+   */
+  bool init(const struct chreAudioFeatureConfig &config, uint32_t sampleRate);
+
+  /**
+   * @return true if the features of this extractor match a configuration.
+   */
+  bool hasConfig(const struct chreAudioFeatureConfig &config) const;
+
+  /**
+   * @return the configuration of the features.
+   */
+  const struct chreAudioFeatureConfig &getConfig() const {
+    return mConfig;
+  }
+
+  /**
+   * @return the number of features computed per buffer of audio data.
+   */
+  uint16_t getFeatureCount() const;
+
+  /**
+   * Computes the features of a buffer of audio data.
+   *
+   * @param event The audio data event holding the buffer, whose sample rate
+   *     must be the one provided to init().
+   * @param features The array of getFeatureCount() values to populate.
+   * @return the number of frames averaged into the features.
+   */
+  uint16_t extract(const struct chreAudioDataEvent &event, float *features);
+
+ private:
+  /**
+   * Loads one frame of samples, zero-padded if the buffer ends before the
+   * frame does, and applies the window to it.
+   *
+   * @param event The audio data event holding the buffer.
+   * @param offset The index of the first sample of the frame.
+   */
+  void loadFrame(const struct chreAudioDataEvent &event, uint32_t offset);
+
+  /**
+   * Computes the log-mel energies of the power spectrum held in mPower.
+   *
+   * @param features The array of mel bands to populate.
+   */
+  void computeLogMelEnergies(float *features) const;
+
+  struct chreAudioFeatureConfig mConfig = {};
+
+  //! The configuration of the real FFT, allocated with memoryAlloc().
+  kiss_fftr_cfg mFftConfig = nullptr;
+
+  //! The Hann window, in Q15.
+  DynamicVector<int16_t> mWindow;
+
+  //! The windowed frame being transformed.
+  DynamicVector<kiss_fft_scalar> mFrame;
+
+  //! The spectrum of the frame being transformed.
+  DynamicVector<kiss_fft_cpx> mSpectrum;
+
+  //! The power spectrum accumulated over the frames of a buffer.
+  DynamicVector<float> mPower;
+
+  //! The edges of the mel filters in fractional frequency bins, two more than
+  //! the number of bands since consecutive filters overlap by half.
+  DynamicVector<float> mMelEdges;
+};
+
+}  // namespace chre
+
+#endif  // CHRE_CORE_AUDIO_FEATURE_EXTRACTOR_H_
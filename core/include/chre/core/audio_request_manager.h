@@ -19,11 +19,13 @@
 
 #include <cstdint>
 
+#include "chre/core/audio_feature_extractor.h"
 #include "chre/core/nanoapp.h"
 #include "chre/core/settings.h"
 #include "chre/platform/platform_audio.h"
 #include "chre/util/dynamic_vector.h"
 #include "chre/util/non_copyable.h"
+#include "chre/util/unique_ptr.h"
 #include "chre_api/chre/audio.h"
 
 namespace chre {
@@ -73,6 +75,24 @@ class AudioRequestManager : public NonCopyable {
   bool configureSource(const Nanoapp *nanoapp, uint32_t handle, bool enable,
                        uint64_t bufferDuration, uint64_t deliveryInterval);
 
+  /**
+   * Updates the spectral features requested by a nanoapp for a given audio
+   * source, which must be enabled by the nanoapp. Features are computed once
+   * per buffer of audio data for all the nanoapps requesting the same
+   * configuration.
+   *
+   * @param nanoapp A non-null pointer to the nanoapp requesting this change.
+   * @param handle The audio source handle for which this request is directed
+   *        toward.
+   * @param enable true if enabling features, false if disabling them.
+   * @param config The configuration of the features when enabling them.
+   * @return true if the request was successful, false otherwise.
+   *
+   * @see chreAudioConfigureFeatures()
+   */
+  bool configureFeatures(const Nanoapp *nanoapp, uint32_t handle, bool enable,
+                         const struct chreAudioFeatureConfig *config);
+
   /**
    * Disables all the active requests for a nanoapp.
    *
@@ -151,6 +171,31 @@ class AudioRequestManager : public NonCopyable {
     Nanoseconds nextEventTimestamp;
   };
 
+  /**
+   * The nanoapps requesting spectral features of one configuration for an
+   * audio source.
+   */
+  struct AudioFeatureRequest {
+    //! The nanoapp instance IDs that own this request.
+    DynamicVector<uint16_t> instanceIds;
+
+    //! Computes the features of this configuration.
+    UniquePtr<AudioFeatureExtractor> extractor;
+  };
+
+  /**
+   * A CHRE_EVENT_AUDIO_FEATURES event shared by the nanoapps it is posted to.
+   * The features follow this struct in the same allocation.
+   */
+  struct SharedAudioFeatureEvent {
+    //! The event provided to nanoapps, which must be the first member as the
+    //! free callback is given its address.
+    struct chreAudioFeatureEvent event;
+
+    //! The number of outstanding published events.
+    uint32_t refCount;
+  };
+
   /**
    * A list of audio requests for a given source. Note that each nanoapp may
    * have at most one open request for a given source. When the source is
@@ -168,6 +213,10 @@ class AudioRequestManager : public NonCopyable {
 
     //! The list of requests for this source that are currently open.
     DynamicVector<AudioRequest> requests;
+
+    //! The feature requests for this source, each nanoapp being part of at
+    //! most one of them.
+    DynamicVector<AudioFeatureRequest> featureRequests;
   };
 
   /**
@@ -273,6 +322,28 @@ class AudioRequestManager : public NonCopyable {
   bool createAudioRequest(uint32_t handle, uint16_t instanceId,
                           uint32_t numSamples, Nanoseconds deliveryInterval);
 
+  /**
+   * Adds a nanoapp to the feature request of a given configuration, creating
+   * it if needed.
+   *
+   * @param handle The handle to create a request for.
+   * @param instanceId The instance ID that will own this request.
+   * @param config A valid feature configuration.
+   * @return true if successful, false otherwise.
+   */
+  bool createAudioFeatureRequest(uint32_t handle, uint16_t instanceId,
+                                 const struct chreAudioFeatureConfig &config);
+
+  /**
+   * Removes a nanoapp from its feature request for a given handle, if any.
+   * The feature request is removed once it has no nanoapp left.
+   *
+   * @param handle The handle to remove the request for.
+   * @param instanceId The instance ID of the nanoapp.
+   * @return true if the nanoapp had requested features.
+   */
+  bool removeAudioFeatureRequest(uint32_t handle, uint16_t instanceId);
+
   /**
    * Finds an audio request for a given audio handle and nanoapp instance ID. If
    * no existing request is available, nullptr is returned.
@@ -319,11 +390,13 @@ class AudioRequestManager : public NonCopyable {
 
   /**
    * Handles an audio data event from the platform synchronously. This is
-   * invoked on the CHRE thread through a scheduled callback.
+   * invoked on the CHRE thread right before the event is dispatched.
    *
    * @param event The event to provide to nanoapps containg audio data.
+   * @return The instance ID of the nanoapp to deliver the dispatched event to,
+   *         or kSystemInstanceId if it must be dropped.
    */
-  void handleAudioDataEventSync(struct chreAudioDataEvent *event);
+  uint16_t handleAudioDataEventSync(struct chreAudioDataEvent *event);
 
   /**
    * Handles audio availability from the platform synchronously. This is
@@ -362,16 +435,31 @@ class AudioRequestManager : public NonCopyable {
                                     bool available, bool suspended);
 
   /**
-   * Posts the provided audio data event to a nanoapp with the given instance ID
-   * and fails fatally if the event is not posted. Fatal error is an acceptable
-   * error handling mechanism here because there is no way to satisfy the
-   * requirements of the API without posting an event.
+   * Directs the provided audio data event to the nanoapps with the given
+   * instance IDs. The event being dispatched is delivered to the first one, and
+   * an event is posted to each of the others, failing fatally if it is not
+   * posted. Fatal error is an acceptable error handling mechanism here because
+   * there is no way to satisfy the requirements of the API without posting an
+   * event.
    *
    * @param audioDataEvent The audio data event to send to a nanoapp.
    * @param instanceIds The list of nanoapp instance IDs to direct the event to.
+   * @return The instance ID to deliver the dispatched event to, or
+   *         kSystemInstanceId if instanceIds is empty.
    */
-  void postAudioDataEventFatal(struct chreAudioDataEvent *event,
-                               const DynamicVector<uint16_t> &instanceIds);
+  uint16_t postAudioDataEventFatal(struct chreAudioDataEvent *event,
+                                   const DynamicVector<uint16_t> &instanceIds);
+
+  /**
+   * Computes the features of an audio data event for each configuration
+   * requested by nanoapps receiving the event, and posts them to these
+   * nanoapps. Feature events that could not be allocated are skipped.
+   *
+   * @param event The audio data event being delivered.
+   * @param instanceIds The instance IDs of the nanoapps receiving the event.
+   */
+  void postAudioFeatureEvents(const struct chreAudioDataEvent *event,
+                              const DynamicVector<uint16_t> &instanceIds);
 
   /**
    * Invoked by the freeAudioDataEventCallback to decrement the reference count
@@ -388,6 +476,24 @@ class AudioRequestManager : public NonCopyable {
    * @param eventData a pointer to the scan event to release.
    */
   static void freeAudioDataEventCallback(uint16_t eventType, void *eventData);
+
+  /**
+   * Releases a feature event once all the nanoapps it was posted to consumed
+   * it.
+   *
+   * @param eventType the type of event being freed.
+   * @param eventData a pointer to the SharedAudioFeatureEvent to release.
+   */
+  static void freeAudioFeatureEventCallback(uint16_t eventType,
+                                            void *eventData);
+
+  /**
+   * Pre-dispatch hook of the audio data events.
+   *
+   * @see PreDispatchHookFunction
+   */
+  static uint16_t audioDataEventPreDispatchHook(uint16_t eventType,
+                                                void *eventData);
 };
 
 }  // namespace chre
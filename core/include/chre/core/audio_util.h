@@ -65,6 +65,22 @@ class AudioUtil {
     return static_cast<uint32_t>((sampleRate * duration.toRawNanoseconds()) /
                                  kOneSecondInNanoseconds);
   }
+
+  /**
+   * Decodes an 8-bit u-law sample, as specified by ITU-T G.711, into a 16-bit
+   * linear PCM sample.
+   *
+   * @param sample The u-law encoded sample.
+   * @return The linear sample, in the range [-32124, 32124].
+   */
+  static constexpr int16_t decodeULaw8(uint8_t sample) {
+    constexpr int32_t kBias = 0x84;
+    uint8_t inverted = static_cast<uint8_t>(~sample);
+    int32_t exponent = (inverted >> 4) & 0x07;
+    int32_t mantissa = inverted & 0x0f;
+    int32_t magnitude = (((mantissa << 3) + kBias) << exponent) - kBias;
+    return static_cast<int16_t>((inverted & 0x80) ? -magnitude : magnitude);
+  }
 };
 
 }  // namespace chre
@@ -113,6 +113,28 @@ class BleRequest : public NonCopyable {
    */
   bool isEnabled() const;
 
+  /**
+   * @return true if this request sets an RSSI threshold or generic filters,
+   *    i.e. if some advertising reports may not match it.
+   */
+  bool hasFilter() const;
+
+  /**
+   * Checks whether an advertising report satisfies this request. A report
+   * matches if its RSSI is not below the RSSI threshold (reports without RSSI
+   * always pass that check), and if any of the generic filters matches one of
+   * the AD structures of the report. Requests without generic filters match
+   * any AD structure.
+   *
+   * A generic filter matches an AD structure of the same type if the first len
+   * bytes of its payload, which follows the AD type byte as transmitted over
+   * the air, are equal to the filter data once both are masked by dataMask.
+   *
+   * @param report The advertising report to check.
+   * @return true if the report matches this request.
+   */
+  bool matches(const chreBleAdvertisingReport &report) const;
+
   /**
    * Prints state in a string buffer. Must only be called from the context of
    * the main CHRE thread.
@@ -126,6 +148,12 @@ class BleRequest : public NonCopyable {
                         bool isPlatformRequest = false) const;
 
  private:
+  /**
+   * @return true if any of the generic filters matches an AD structure of the
+   *    advertising data.
+   */
+  bool matchesGenericFilters(const uint8_t *data, uint16_t dataLength) const;
+
   // Maximum requested batching delay in ms.
   uint32_t mReportDelayMs;
 
@@ -89,7 +89,7 @@ class BleRequestManager : public NonCopyable {
 
   /**
    * Frees an advertising event that was previously provided to the BLE
-   * manager.
+   * manager, once it is no longer referenced by any event posted to nanoapps.
    *
    * @param event the event to release.
    */
@@ -103,6 +103,25 @@ class BleRequestManager : public NonCopyable {
    */
   static void freeAdvertisingEventCallback(uint16_t eventType, void *eventData);
 
+  /**
+   * Releases an advertising event holding the subset of the reports of a
+   * platform event that matches the request of a nanoapp.
+   *
+   * @param eventType the type of event being freed.
+   * @param eventData a pointer to the FilteredAdvertisementEvent to release.
+   */
+  static void freeFilteredAdvertisingEventCallback(uint16_t eventType,
+                                                   void *eventData);
+
+  /**
+   * Pre-dispatch hook of the advertising events, which delivers them to the
+   * nanoapps whose requests match them.
+   *
+   * @see PreDispatchHookFunction
+   */
+  static uint16_t advertisingEventPreDispatchHook(uint16_t eventType,
+                                                  void *eventData);
+
   /**
    * Handles a CHRE BLE advertisement event.
    *
@@ -196,6 +215,44 @@ class BleRequestManager : public NonCopyable {
   static constexpr size_t kNumBleRequestLogs = 10;
   ArrayQueue<BleRequestLog, kNumBleRequestLogs> mBleRequestLogs;
 
+  // An advertising event holding the subset of the reports of an event
+  // provided by the platform that matches the request of a nanoapp. The
+  // reports are stored right after this structure, and share their data with
+  // the reports of the original event. The advertising event is the first
+  // member so that nanoapps can read this structure as a
+  // chreBleAdvertisementEvent.
+  struct FilteredAdvertisementEvent {
+    chreBleAdvertisementEvent event;
+    chreBleAdvertisementEvent *originalEvent;
+  };
+
+  // Keeps track of the number of events referencing an advertising event
+  // provided by the platform, when it is not broadcast as is.
+  struct AdvertisingEventRefCount {
+    explicit AdvertisingEventRefCount(
+        chreBleAdvertisementEvent *advertisingEvent)
+        : event(advertisingEvent) {}
+
+    AdvertisingEventRefCount(chreBleAdvertisementEvent *advertisingEvent,
+                             uint32_t initialRefCount)
+        : event(advertisingEvent), refCount(initialRefCount) {}
+
+    bool operator==(const AdvertisingEventRefCount &other) const {
+      return (event == other.event);
+    }
+
+    // The event provided by the platform.
+    chreBleAdvertisementEvent *event;
+
+    // The number of outstanding events referencing the platform event.
+    uint32_t refCount;
+  };
+
+  // Advertising events which have been delivered to nanoapps individually,
+  // and must only be released to the platform once all of their references
+  // have been freed. Events broadcast as is are not tracked here.
+  DynamicVector<AdvertisingEventRefCount> mAdvertisingEventRefCounts;
+
   /**
    * Configures BLE platform based on the current maximal BleRequest.
    */
@@ -280,6 +337,37 @@ class BleRequestManager : public NonCopyable {
    */
   void handlePlatformChangeSync(bool enable, uint8_t errorCode);
 
+  /**
+   * Delivers an advertising event to the nanoapps registered for BLE events.
+   * When none of their requests filters advertising reports, the event is
+   * broadcast as is. Otherwise, each nanoapp only receives the reports
+   * matching its request: the original event if all of them match, an event
+   * holding the matching subset otherwise, and no event if none of them does.
+   * These events are posted for every nanoapp and the original one is
+   * dropped, which also applies to the next events while some of them are
+   * outstanding, so that each nanoapp receives the reports in order.
+   * Invoked from the pre-dispatch hook of the event, in the context of the
+   * CHRE thread.
+   *
+   * @param event The advertising event provided by the platform.
+   * @return the instance ID the original event must be delivered to.
+   * @see PreDispatchHookFunction
+   */
+  uint16_t handleAdvertisementEventSync(chreBleAdvertisementEvent *event);
+
+  /**
+   * Posts the reports of an advertising event that match a request to the
+   * nanoapp that made it, in an event allocated for this purpose.
+   *
+   * @param event The advertising event provided by the platform.
+   * @param request The request of the nanoapp to deliver the reports to.
+   * @param numMatchingReports The number of reports matching the request.
+   * @return true if the event was posted, false if it couldn't be allocated.
+   */
+  static bool postFilteredAdvertisementEvent(chreBleAdvertisementEvent *event,
+                                             const BleRequest &request,
+                                             uint16_t numMatchingReports);
+
   /**
    * Dispatches pending BLE requests from nanoapps.
    */
@@ -0,0 +1,161 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CHRE_CORE_BROADCAST_EVENT_INDEX_H_
+#define CHRE_CORE_BROADCAST_EVENT_INDEX_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include "chre/util/dynamic_vector.h"
+#include "chre/util/non_copyable.h"
+
+namespace chre {
+
+class Nanoapp;
+
+/**
+ * Maps broadcast event types to the nanoapps that are registered to receive
+ * them, so that distributing a broadcast event only needs to visit the actual
+ * subscribers rather than every nanoapp managed by the EventLoop.
+ *
+ * Event types are kept sorted so lookups are a binary search, and the
+ * subscribers of each event type are kept sorted by instance ID. As instance
+ * IDs are assigned in increasing order, this matches the order of nanoapps in
+ * the EventLoop, so delivery order is unchanged compared to a linear scan.
+ *
+ * This class is not thread-safe, and must only be used from the context of
+ * the thread that runs the associated EventLoop.
+ */
+class BroadcastEventIndex : public NonCopyable {
+ public:
+  /**
+   * Sets the group ID mask that the given nanoapp is registered for with the
+   * given event type, replacing any previous registration. A mask of 0 removes
+   * the nanoapp from the event type's subscribers.
+   *
+   * @param nanoapp The nanoapp whose registration has changed. Its instance ID
+   *     must be assigned and must not change while it is in the index.
+   * @param eventType The broadcast event type
+   * @param groupIdMask The full mask of group IDs the nanoapp is now registered
+   *     for, or 0 if it is no longer registered for this event type
+   * @return false if memory allocation failed
+   */
+  bool setSubscription(Nanoapp *nanoapp, uint16_t eventType,
+                       uint16_t groupIdMask);
+
+  /**
+   * Removes all subscriptions associated with the given nanoapp.
+   *
+   * @param nanoapp The nanoapp to remove from the index
+   */
+  void removeNanoapp(const Nanoapp *nanoapp);
+
+  /**
+   * Finds the next nanoapp that should receive a broadcast event, in order of
+   * increasing instance ID. As the lookup is restarted from the given instance
+   * ID on each call, it is safe for subscriptions to be modified between
+   * calls, e.g. by a nanoapp unregistering from within handleEvent.
+   *
+   * @param eventType The broadcast event type
+   * @param targetGroupMask The group mask the event is targeted at
+   * @param afterInstanceId Only nanoapps with an instance ID strictly greater
+   *     than this value are considered. Pass kSystemInstanceId to start from
+   *     the first subscriber.
+   * @return The next subscribed nanoapp, or nullptr if there are no more
+   */
+  Nanoapp *findNextSubscriber(uint16_t eventType, uint16_t targetGroupMask,
+                              uint16_t afterInstanceId) const;
+
+  /**
+   * @param eventType The broadcast event type
+   * @param targetGroupMask The group mask the event is targeted at
+   * @return true if at least one nanoapp would receive the event
+   */
+  bool hasSubscribers(uint16_t eventType, uint16_t targetGroupMask) const;
+
+  /**
+   * @param eventType The broadcast event type
+   * @return The number of nanoapps registered for the event type, regardless
+   *     of group ID mask
+   */
+  size_t getSubscriberCount(uint16_t eventType) const;
+
+  /**
+   * @return The number of distinct event types with at least one subscriber
+   */
+  size_t getEventTypeCount() const {
+    return mEntries.size();
+  }
+
+ private:
+  //! A single nanoapp registered for an event type.
+  struct Subscriber {
+    Subscriber(Nanoapp *nanoapp_, uint16_t instanceId_, uint16_t groupIdMask_)
+        : nanoapp(nanoapp_),
+          instanceId(instanceId_),
+          groupIdMask(groupIdMask_) {}
+
+    Nanoapp *nanoapp;
+    uint16_t instanceId;
+    uint16_t groupIdMask;
+  };
+
+  //! The subscribers for a single event type.
+  struct Entry {
+    explicit Entry(uint16_t eventType_) : eventType(eventType_) {}
+
+    uint16_t eventType;
+
+    //! The union of all subscribers' group ID masks, used to quickly reject
+    //! events targeted at groups that no nanoapp is registered for.
+    uint16_t groupIdMask = 0;
+
+    //! Sorted by instance ID.
+    DynamicVector<Subscriber> subscribers;
+  };
+
+  //! Sorted by event type.
+  DynamicVector<Entry> mEntries;
+
+  /**
+   * @return The index of the first entry whose event type is greater than or
+   *     equal to the given one, which is mEntries.size() if there is none
+   */
+  size_t lowerBound(uint16_t eventType) const;
+
+  /**
+   * @return A pointer to the entry for the given event type, or nullptr if no
+   *     nanoapp is registered for it
+   */
+  const Entry *findEntry(uint16_t eventType) const;
+
+  /**
+   * @return The index of the first subscriber in the entry whose instance ID
+   *     is greater than or equal to the given one
+   */
+  static size_t subscriberLowerBound(const Entry &entry, uint16_t instanceId);
+
+  /**
+   * Recomputes the aggregate group ID mask of the entry at the given index,
+   * removing the entry if it has no subscribers left.
+   */
+  void updateEntryAt(size_t index);
+};
+
+}  // namespace chre
+
+#endif  // CHRE_CORE_BROADCAST_EVENT_INDEX_H_
@@ -78,6 +78,22 @@ class Event : public NonCopyable {
     CHRE_ASSERT(systemEventCallback_ != nullptr);
   }
 
+  // Events sent by the system to nanoapps, whose recipient is picked by a hook
+  // invoked right before distribution
+  Event(uint16_t eventType_, void *eventData_,
+        chreEventCompleteFunction *freeCallback_,
+        PreDispatchHookFunction *preDispatchHook_)
+      : eventType(eventType_),
+        receivedTimeMillis(getTimeMillis()),
+        eventData(eventData_),
+        freeCallback(freeCallback_),
+        senderInstanceId(kSystemInstanceId),
+        targetInstanceId(kBroadcastInstanceId),
+        targetAppGroupMask(kDefaultTargetGroupMask),
+        preDispatchHook(preDispatchHook_) {
+    CHRE_ASSERT(preDispatchHook_ != nullptr);
+  }
+
   void incrementRefCount() {
     mRefCount++;
     CHRE_ASSERT(mRefCount != 0);
@@ -143,6 +159,10 @@ class Event : public NonCopyable {
   // all registered listeners.
   const uint16_t targetAppGroupMask;
 
+  //! If not null, invoked by the event loop prior to distributing the event,
+  //! overriding targetInstanceId with its return value
+  PreDispatchHookFunction *const preDispatchHook = nullptr;
+
  private:
   uint16_t mRefCount = 0;
 
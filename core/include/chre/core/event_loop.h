@@ -17,6 +17,7 @@
 #ifndef CHRE_CORE_EVENT_LOOP_H_
 #define CHRE_CORE_EVENT_LOOP_H_
 
+#include "chre/core/broadcast_event_index.h"
 #include "chre/core/event.h"
 #include "chre/core/nanoapp.h"
 #include "chre/core/timer_pool.h"
@@ -29,6 +30,8 @@
 #include "chre/util/fixed_size_blocking_queue.h"
 #include "chre/util/non_copyable.h"
 #include "chre/util/synchronized_memory_pool.h"
+#include "chre/util/system/atomic_memory_pool.h"
+#include "chre/util/system/atomic_mpsc_queue.h"
 #include "chre/util/system/debug_dump.h"
 #include "chre/util/system/stats_container.h"
 #include "chre/util/unique_ptr.h"
@@ -43,6 +46,13 @@
 #define CHRE_MAX_UNSCHEDULED_EVENT_COUNT 96
 #endif
 
+//! The maximum number of events the event loop takes from the inbound queue in
+//! a single lock acquisition, and processes between one pair of power control
+//! callbacks. Setting this to 1 processes events individually.
+#ifndef CHRE_MAX_EVENT_BATCH_SIZE
+#define CHRE_MAX_EVENT_BATCH_SIZE CHRE_MAX_UNSCHEDULED_EVENT_COUNT
+#endif
+
 namespace chre {
 
 /**
@@ -176,6 +186,34 @@ class EventLoop : public NonCopyable {
                       uint16_t targetInstanceId = kBroadcastInstanceId,
                       uint16_t targetGroupMask = kDefaultTargetGroupMask);
 
+  /**
+   * Variant of postEventOrDie() whose recipient is picked by a hook, invoked
+   * from within the context of the event loop right before the event is
+   * distributed. This allows data events coming from the PALs to be delivered
+   * in a single pass through the event queue, where the system previously had
+   * to defer a callback to update its state and then post the actual event,
+   * consuming two event pool slots per event.
+   *
+   * The hook is not invoked if the event is dropped because CHRE is shutting
+   * down, but freeCallback always is.
+   *
+   * Safe to call from any thread.
+   *
+   * @param eventType Event type identifier, which implies the type of eventData
+   * @param eventData The data being posted
+   * @param preDispatchHook Function returning the instance ID to deliver the
+   *        event to, or kSystemInstanceId to drop it
+   * @param freeCallback Function to invoke to when the event has been processed
+   *        by all recipients or dropped; this must be safe to call
+   *        immediately, to handle the case where CHRE is shutting down
+   *
+   * @see PreDispatchHookFunction
+   */
+  void postEventWithPreDispatchHookOrDie(
+      uint16_t eventType, void *eventData,
+      PreDispatchHookFunction *preDispatchHook,
+      chreEventCompleteFunction *freeCallback);
+
   /**
    * Posts an event to a nanoapp that is currently running (or all nanoapps if
    * the target instance ID is kBroadcastInstanceId). If the event fails to
@@ -323,6 +361,15 @@ class EventLoop : public NonCopyable {
     return mNumDroppedLowPriEvents;
   }
 
+  /**
+   * @return The number of events waiting to be distributed, including those
+   *     of the current batch. Must only be called from the thread context of
+   *     this EventLoop.
+   */
+  size_t getNumPendingEvents() {
+    return mEvents.size() + getPendingBatchEventCount();
+  }
+
  private:
   //! The maximum number of events that can be active in the system.
   static constexpr size_t kMaxEventCount = CHRE_MAX_EVENT_COUNT;
@@ -336,6 +383,12 @@ class EventLoop : public NonCopyable {
   static constexpr size_t kMaxUnscheduledEventCount =
       CHRE_MAX_UNSCHEDULED_EVENT_COUNT;
 
+  //! The maximum number of events removed from mEvents at once.
+  static constexpr size_t kMaxEventBatchSize = CHRE_MAX_EVENT_BATCH_SIZE;
+  static_assert(kMaxEventBatchSize > 0 &&
+                    kMaxEventBatchSize <= kMaxUnscheduledEventCount,
+                "Invalid event batch size");
+
   //! The time interval of nanoapp wakeup buckets, adjust in conjuction with
   //! Nanoapp::kMaxSizeWakeupBuckets.
   static constexpr Nanoseconds kIntervalWakeupBucket =
@@ -344,8 +397,14 @@ class EventLoop : public NonCopyable {
   //! The last time wakeup buckets were pushed onto the nanoapps.
   Nanoseconds mTimeLastWakeupBucketCycled;
 
-  //! The memory pool to allocate incoming events from.
+  //! The memory pool to allocate incoming events from. The lock-free pool
+  //! avoids contention between PAL threads and the event loop thread, which
+  //! all allocate and free events.
+#ifdef CHRE_LOCK_FREE_MEMORY_POOL_ENABLED
+  AtomicMemoryPool<Event, kMaxEventCount> mEventPool;
+#else
   SynchronizedMemoryPool<Event, kMaxEventCount> mEventPool;
+#endif  // CHRE_LOCK_FREE_MEMORY_POOL_ENABLED
 
   //! The timer used schedule timed events for tasks running in this event loop.
   TimerPool mTimerPool;
@@ -361,9 +420,30 @@ class EventLoop : public NonCopyable {
   //! the thread context of this EventLoop.
   mutable Mutex mNanoappsLock;
 
+  //! Maps broadcast event types to the nanoapps in mNanoapps that are
+  //! registered for them. Must only be accessed from the thread context of this
+  //! EventLoop.
+  BroadcastEventIndex mBroadcastEventIndex;
+
   //! The blocking queue of incoming events from the system that have not been
-  //! distributed out to apps yet.
+  //! distributed out to apps yet. The lock-free queue avoids contention
+  //! between threads posting events and the event loop thread.
+#ifdef CHRE_LOCK_FREE_EVENT_QUEUE_ENABLED
+  AtomicMpscQueue<Event *, kMaxUnscheduledEventCount> mEvents;
+#else
   FixedSizeBlockingQueue<Event *, kMaxUnscheduledEventCount> mEvents;
+#endif  // CHRE_LOCK_FREE_EVENT_QUEUE_ENABLED
+
+  //! Events that were removed from mEvents as a batch. The events at
+  //! [mEventBatchIndex, mEventBatchSize) are still pending distribution, and
+  //! are logically at the front of the inbound queue.
+  Event *mEventBatch[kMaxEventBatchSize];
+
+  //! The number of events in mEventBatch.
+  size_t mEventBatchSize = 0;
+
+  //! The index of the next event in mEventBatch to distribute.
+  size_t mEventBatchIndex = 0;
 
   //! Indicates whether the event loop is running.
   AtomicBool mRunning;
@@ -407,7 +487,7 @@ class EventLoop : public NonCopyable {
   /**
    * Delivers the next event pending to the Nanoapp.
    */
-  void deliverNextEvent(const UniquePtr<Nanoapp> &app, Event *event);
+  void deliverNextEvent(Nanoapp *app, Event *event);
 
   /**
    * Given an event pulled from the main incoming event queue (mEvents), deliver
@@ -419,14 +499,23 @@ class EventLoop : public NonCopyable {
   void distributeEvent(Event *event);
 
   /**
-   * Distribute all events pending in the inbound event queue. Note that this
-   * function only guarantees that any events in the inbound queue at the time
-   * it is called will be distributed to Nanoapp event queues - new events may
-   * still be posted during or after this function call from other threads as
-   * long as postEvent() will accept them.
+   * Distribute all events pending in the inbound event queue, including those
+   * remaining in the current batch. Note that this function only guarantees
+   * that any events in the inbound queue at the time it is called will be
+   * distributed to Nanoapp event queues - new events may still be posted
+   * during or after this function call from other threads as long as
+   * postEvent() will accept them.
    */
   void flushInboundEventQueue();
 
+  /**
+   * @return The number of events remaining in the current batch that have not
+   *     been distributed yet.
+   */
+  size_t getPendingBatchEventCount() const {
+    return mEventBatchSize - mEventBatchIndex;
+  }
+
   /**
    * Call after when an Event has been delivered to all intended recipients.
    * Invokes the event's free callback (if given) and releases resources.
@@ -68,6 +68,7 @@ enum class SystemCallbackType : uint16_t {
   BleAdvertisementEvent,
   BleScanResponse,
   BleRequestResyncEvent,
+  SensorBatchTimeout,
 };
 
 //! Deferred/delayed callbacks use the event subsystem but are invariably sent
@@ -77,6 +78,14 @@ enum class SystemCallbackType : uint16_t {
 using SystemEventCallbackFunction = void(uint16_t type, void *data,
                                          void *extraData);
 
+//! Invoked from within the context of the event loop right before an event
+//! posted via EventLoop::postEventWithPreDispatchHookOrDie() is distributed,
+//! so that the system can update its state and pick the recipient of the event
+//! in the same pass. Returns the instance ID to deliver the event to (which
+//! may be kBroadcastInstanceId), or kSystemInstanceId to drop the event.
+//! @see Event
+using PreDispatchHookFunction = uint16_t(uint16_t eventType, void *eventData);
+
 /**
  * Generic event free callback that can be used by any event where the event
  * data is allocated via memoryAlloc, and no special processing is needed in the
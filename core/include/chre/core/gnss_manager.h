@@ -22,6 +22,7 @@
 #include "chre/core/api_manager_common.h"
 #include "chre/core/nanoapp.h"
 #include "chre/core/settings.h"
+#include "chre/platform/atomic.h"
 #include "chre/platform/platform_gnss.h"
 #include "chre/util/non_copyable.h"
 #include "chre/util/system/debug_dump.h"
@@ -224,6 +225,11 @@ class GnssSession {
   //! True if a state resync callback is pending to be processed.
   bool mResyncPending = false;
 
+  //! The number of status changes and report events deferred to the CHRE
+  //! thread that haven't been handled yet. Report events are deferred while it
+  //! is non-zero to keep them behind the async results.
+  AtomicUint32 mNumDeferredCallbacks;
+
   // Allows GnssManager to access constructor.
   friend class GnssManager;
 
@@ -360,6 +366,23 @@ class GnssSession {
    */
   static void freeReportEventCallback(uint16_t eventType, void *eventData);
 
+  /**
+   * Posts a GNSS report event to the nanoapps registered for it. Failure to
+   * post this event is a FATAL_ERROR.
+   *
+   * @param event the GNSS report event.
+   */
+  void postReportEvent(void *event);
+
+  /**
+   * Pre-dispatch hook of the GNSS report events, which are broadcast to all
+   * nanoapps registered for them.
+   *
+   * @see PreDispatchHookFunction
+   */
+  static uint16_t reportEventPreDispatchHook(uint16_t eventType,
+                                             void *eventData);
+
   /**
    * Configures PlatformGnss based on session settings.
    *
@@ -25,6 +25,9 @@
 #include "chre/util/buffer.h"
 #include "chre/util/non_copyable.h"
 #include "chre/util/synchronized_memory_pool.h"
+#include "chre/util/system/atomic_memory_pool.h"
+#include "chre/util/system/ref_base.h"
+#include "chre/util/system/shared_ptr.h"
 #include "chre_api/chre/event.h"
 
 namespace chre {
@@ -37,6 +40,53 @@ constexpr uint16_t kHostEndpointUnspecified = CHRE_HOST_ENDPOINT_UNSPECIFIED;
 //! registered clients of the Context Hub HAL, which is the default behavior.
 constexpr uint16_t kHostEndpointBroadcast = CHRE_HOST_ENDPOINT_BROADCAST;
 
+/**
+ * A reference-counted buffer that the host link layer receives messages from
+ * the host into. Messages delivered to nanoapps can reference their payload
+ * within this buffer instead of copying it, and the buffer is released when
+ * the link layer and the last of these messages drop their references.
+ */
+class HostReceiveBuffer : public RefBase<HostReceiveBuffer> {
+ public:
+  /**
+   * Allocates a receive buffer, with the buffer object and its data in a
+   * single allocation.
+   *
+   * @param size The size of the buffer in bytes.
+   * @return The buffer, null if the allocation failed.
+   */
+  static SharedPtr<HostReceiveBuffer> create(size_t size);
+
+  /**
+   * @return A pointer to the data of the buffer.
+   */
+  uint8_t *data() {
+    return reinterpret_cast<uint8_t *>(this + 1);
+  }
+
+  /**
+   * @return The size of the buffer in bytes.
+   */
+  size_t size() const {
+    return mSize;
+  }
+
+  /**
+   * @return true if the given range lies within the buffer.
+   */
+  bool contains(const void *data, size_t size) {
+    const uint8_t *begin = static_cast<const uint8_t *>(data);
+    return begin >= this->data() && size <= mSize &&
+           begin - this->data() <= static_cast<ptrdiff_t>(mSize - size);
+  }
+
+ private:
+  explicit HostReceiveBuffer(size_t size) : mSize(size) {}
+
+  //! The size of the data following this object, in bytes.
+  size_t mSize;
+};
+
 /**
  * Data associated with a message either to or from the host.
  */
@@ -82,6 +132,10 @@ struct HostMessage : public NonCopyable {
 
   //! Application-defined message data
   Buffer<uint8_t> message;
+
+  //! For messages from the host, the receive buffer that message wraps a part
+  //! of, if it was delivered without copying. Null otherwise.
+  SharedPtr<HostReceiveBuffer> receiveBuffer;
 };
 
 typedef HostMessage MessageFromHost;
@@ -147,6 +201,25 @@ class HostCommsManager : public HostLink {
                                     const void *messageData,
                                     size_t messageSize);
 
+  /**
+   * Posts a message to the queue for later delivery to the addressed nanoapp,
+   * without copying its payload: the message references the payload within
+   * the receive buffer of the host link layer, and holds a reference to that
+   * buffer until the nanoapp is done with the message.
+   *
+   * This function is safe to call from any thread.
+   *
+   * @param receiveBuffer The buffer the message was received into
+   * @param messageData Payload of the message, which must lie within
+   *        receiveBuffer; can be null if messageSize is 0
+   *
+   * @see sendMessageToNanoappFromHost for the other parameters
+   */
+  void sendMessageToNanoappFromHost(
+      uint64_t appId, uint32_t messageType, uint16_t hostEndpoint,
+      const SharedPtr<HostReceiveBuffer> &receiveBuffer,
+      const void *messageData, size_t messageSize);
+
   /**
    * This function is used by sendMessageToNanoappFromHost() for sending
    * deferred messages. Messages are deferred when the destination nanoapp is
@@ -191,7 +264,11 @@ class HostCommsManager : public HostLink {
   //! messages themselves). Must be synchronized as the same HostCommsManager
   //! handles communications for all EventLoops, and also to support freeing
   //! messages directly in onMessageToHostComplete.
+#ifdef CHRE_LOCK_FREE_MEMORY_POOL_ENABLED
+  AtomicMemoryPool<HostMessage, kMaxOutstandingMessages> mMessagePool;
+#else
   SynchronizedMemoryPool<HostMessage, kMaxOutstandingMessages> mMessagePool;
+#endif  // CHRE_LOCK_FREE_MEMORY_POOL_ENABLED
 
   /**
    * Allocates and populates the event structure used to notify a nanoapp of an
@@ -202,13 +279,16 @@ class HostCommsManager : public HostLink {
    *
    * All parameters must be sanitized before invoking this function.
    *
+   * @param receiveBuffer If not null, the buffer containing messageData,
+   *        which the crafted message references instead of a copy of
+   *        messageData
+   *
    * @see sendMessageToNanoappFromHost
    */
-  MessageFromHost *craftNanoappMessageFromHost(uint64_t appId,
-                                               uint16_t hostEndpoint,
-                                               uint32_t messageType,
-                                               const void *messageData,
-                                               uint32_t messageSize);
+  MessageFromHost *craftNanoappMessageFromHost(
+      uint64_t appId, uint16_t hostEndpoint, uint32_t messageType,
+      const SharedPtr<HostReceiveBuffer> &receiveBuffer,
+      const void *messageData, uint32_t messageSize);
 
   /**
    * Posts a crafted event, craftedMessage, to a nanoapp for processing, and
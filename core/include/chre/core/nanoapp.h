@@ -19,6 +19,7 @@
 
 #include <cinttypes>
 
+#include "chre/core/broadcast_event_index.h"
 #include "chre/core/event.h"
 #include "chre/core/event_ref_queue.h"
 #include "chre/platform/heap_block_header.h"
@@ -93,6 +94,18 @@ class Nanoapp : public PlatformNanoapp {
    */
   bool isRegisteredForBroadcastEvent(const Event *event) const;
 
+  /**
+   * @param eventType The type of the broadcast event.
+   * @param targetGroupIdMask The target group mask of the broadcast event.
+   * @return true if the nanoapp is registered to receive broadcast events of
+   *     the given type and group mask. Must not be used for
+   *     CHRE_EVENT_HOST_ENDPOINT_NOTIFICATION, whose registration depends on
+   *     the event data.
+   */
+  bool isRegisteredForBroadcastEvent(
+      uint16_t eventType,
+      uint16_t targetGroupIdMask = kDefaultTargetGroupMask) const;
+
   /**
    * Updates the Nanoapp's registration so that it will receive broadcast events
    * with the given event type.
@@ -117,6 +130,17 @@ class Nanoapp : public PlatformNanoapp {
   void unregisterForBroadcastEvent(
       uint16_t eventType, uint16_t groupIdMask = kDefaultTargetGroupMask);
 
+  /**
+   * Sets the index that is kept up to date with this nanoapp's broadcast event
+   * registrations, adding any existing registrations to it. Passing nullptr
+   * detaches the nanoapp from its current index, removing its registrations
+   * from it.
+   *
+   * @param index The index used by the EventLoop to distribute broadcast
+   *     events, or nullptr
+   */
+  void setBroadcastEventIndex(BroadcastEventIndex *index);
+
   /**
    * Configures whether nanoapp info events will be sent to the nanoapp.
    * Nanoapps are not sent nanoapp start/stop events by default.
@@ -281,11 +305,14 @@ class Nanoapp : public PlatformNanoapp {
   };
 
   //! The set of broadcast events that this app is registered for.
-  // TODO: Implement a set container and replace DynamicVector here. There may
-  // also be a better way of handling this (perhaps we map event type to apps
-  // who care about them).
+  // TODO: Implement a set container and replace DynamicVector here.
   DynamicVector<EventRegistration> mRegisteredEvents;
 
+  //! The index mapping event types to registered nanoapps, which is updated
+  //! along with mRegisteredEvents. Set by the EventLoop while this nanoapp is
+  //! managed by it.
+  BroadcastEventIndex *mBroadcastEventIndex = nullptr;
+
   //! The registered host endpoints to receive notifications for.
   DynamicVector<uint16_t> mRegisteredHostEndpoints;
 
@@ -296,6 +323,15 @@ class Nanoapp : public PlatformNanoapp {
   //!     not.
   size_t registrationIndex(uint16_t eventType) const;
 
+  /**
+   * Propagates a change in this nanoapp's registration for the given event
+   * type to mBroadcastEventIndex, if set.
+   *
+   * @param eventType The event type whose registration changed
+   * @param groupIdMask The new group ID mask, 0 if no longer registered
+   */
+  void updateBroadcastEventIndex(uint16_t eventType, uint16_t groupIdMask);
+
   /**
    * A special function to deliver GNSS measurement events to nanoapps and
    * handles version compatibility.
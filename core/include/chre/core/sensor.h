@@ -17,6 +17,7 @@
 #ifndef CHRE_CORE_SENSOR_H_
 #define CHRE_CORE_SENSOR_H_
 
+#include "chre/core/sensor_data_batcher.h"
 #include "chre/core/sensor_request_multiplexer.h"
 #include "chre/core/sensor_type_helpers.h"
 #include "chre/core/timer_pool.h"
@@ -224,6 +225,26 @@ class Sensor : public PlatformSensor {
     return SensorTypeHelpers::getSensorTypeName(getSensorType());
   }
 
+  /**
+   * @return true if this sensor's data events can be merged by the framework
+   *     before being posted, see SensorDataBatcher.
+   */
+  bool supportsFrameworkBatching() const {
+    return isContinuous() && SensorTypeHelpers::isThreeAxis(getSensorType());
+  }
+
+  /**
+   * @return The batcher that merges this sensor's data events. Must only be
+   *     accessed while holding SensorRequestManager's batching lock.
+   */
+  SensorDataBatcher &getBatcher() {
+    return mBatcher;
+  }
+
+  const SensorDataBatcher &getBatcher() const {
+    return mBatcher;
+  }
+
  private:
   size_t getLastEventSize() {
     return SensorTypeHelpers::getLastEventSize(getSensorType());
@@ -254,6 +275,9 @@ class Sensor : public PlatformSensor {
 
   //! True if a flush request is pending for this sensor.
   AtomicBool mFlushRequestPending;
+
+  //! Merges consecutive data events when the merged request latency allows.
+  SensorDataBatcher mBatcher;
 };
 
 }  // namespace chre
@@ -0,0 +1,194 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CHRE_CORE_SENSOR_DATA_BATCHER_H_
+#define CHRE_CORE_SENSOR_DATA_BATCHER_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include "chre/core/timer_pool.h"
+#include "chre/util/non_copyable.h"
+#include "chre/util/system/debug_dump.h"
+#include "chre/util/time.h"
+#include "chre_api/chre/sensor.h"
+
+namespace chre {
+
+/**
+ * Merges consecutive chreSensorThreeAxisData events delivered by the PAL into
+ * larger, framework-owned events, so that a high-rate sensor shared by several
+ * nanoapps costs one event allocation and dispatch per batch instead of one
+ * per PAL delivery.
+ *
+ * A batch is held no longer than the sensor's merged request latency, which is
+ * the smallest latency requested by any nanoapp. The delivery cadence of the
+ * PAL is tracked so that a batch is released as soon as waiting for the next
+ * delivery would exceed that latency.
+ *
+ * This class is not thread-safe; SensorRequestManager serializes access.
+ */
+class SensorDataBatcher : public NonCopyable {
+ public:
+  //! The maximum number of readings in one batched event.
+  static constexpr uint16_t kMaxReadings = 64;
+
+  //! Number of buckets in the batch size histogram. Bucket i counts batches
+  //! made of (2^(i-1), 2^i] PAL events, with the last bucket open ended.
+  static constexpr size_t kNumHistogramBuckets = 7;
+
+  SensorDataBatcher() = default;
+  SensorDataBatcher(SensorDataBatcher &&other);
+  SensorDataBatcher &operator=(SensorDataBatcher &&other);
+  ~SensorDataBatcher();
+
+  /**
+   * @param latency The maximum time a reading may be held back. Zero disables
+   *     batching. The caller must post any pending batch first if the latency
+   *     decreases.
+   */
+  void setLatency(Nanoseconds latency) {
+    mLatency = latency;
+  }
+
+  Nanoseconds getLatency() const {
+    return mLatency;
+  }
+
+  bool isEnabled() const {
+    return mLatency.toRawNanoseconds() > 0;
+  }
+
+  bool hasPendingBatch() const {
+    return mBatch != nullptr;
+  }
+
+  /**
+   * Updates the estimate of the PAL delivery period. Must be called for every
+   * PAL data event of the sensor, batched or not.
+   *
+   * @param event A PAL data event.
+   */
+  void trackDelivery(const chreSensorThreeAxisData &event);
+
+  /**
+   * @param event A PAL data event.
+   * @return true if the event can be merged into the pending batch (or start
+   *     a new one) without breaking the event format: the reading count and
+   *     timestamp deltas must fit, readings must be in order, and the accuracy
+   *     must match. A new batch is only started if it could also hold the
+   *     next delivery within the latency.
+   */
+  bool canAppend(const chreSensorThreeAxisData &event) const;
+
+  /**
+   * Copies the readings of a PAL event into the pending batch, allocating it
+   * if needed, and rewrites the first reading's timestampDelta relative to
+   * the previous reading. canAppend() must have returned true.
+   *
+   * @return false if a new batch could not be allocated.
+   */
+  bool append(const chreSensorThreeAxisData &event);
+
+  /**
+   * @return true if the pending batch should be posted now, because it can't
+   *     hold another PAL delivery or because waiting for one would exceed the
+   *     latency.
+   */
+  bool isReadyToPost() const;
+
+  /**
+   * @return The monotonic time by which the pending batch must be posted.
+   */
+  Nanoseconds getPostDeadline() const;
+
+  /**
+   * Hands the pending batch over to the caller and records its size in the
+   * histogram. The returned event must be released with memoryFree().
+   *
+   * @return The pending batch, or nullptr if there is none.
+   */
+  chreSensorThreeAxisData *releaseBatch();
+
+  TimerHandle getTimerHandle() const {
+    return mTimerHandle;
+  }
+
+  void setTimerHandle(TimerHandle handle) {
+    mTimerHandle = handle;
+  }
+
+  /**
+   * Starts a new generation of the batch timer. A timer callback carrying an
+   * older generation fired after its timer was cancelled, and must not touch
+   * the timer that replaced it.
+   *
+   * @return The generation to pass to the callback of the new timer.
+   */
+  uint16_t startTimerGeneration() {
+    return ++mTimerGeneration;
+  }
+
+  uint16_t getTimerGeneration() const {
+    return mTimerGeneration;
+  }
+
+  /**
+   * Prints the latency and batch size histogram.
+   *
+   * @param debugDump The debug dump wrapper to print into.
+   * @param sensorName The name of the sensor this batcher belongs to.
+   */
+  void logStateToBuffer(DebugDumpWrapper &debugDump,
+                        const char *sensorName) const;
+
+ private:
+  //! The batch being accumulated, or nullptr.
+  chreSensorThreeAxisData *mBatch = nullptr;
+
+  //! Absolute timestamps of the first and last readings in mBatch.
+  uint64_t mFirstReadingTime = 0;
+  uint64_t mLastReadingTime = 0;
+
+  //! Timestamp of the last reading of the previous PAL event, batched or
+  //! not, used to estimate the PAL delivery period.
+  uint64_t mPrevDeliveryTime = 0;
+
+  //! Most recently observed time between two PAL deliveries.
+  uint64_t mDeliveryPeriodNs = 0;
+
+  //! Reading count of the most recently appended PAL event.
+  uint16_t mLastDeliveryReadingCount = 0;
+
+  //! Number of PAL events merged into mBatch.
+  uint16_t mPalEventCount = 0;
+
+  Nanoseconds mLatency;
+
+  //! The timer that posts mBatch at its deadline if no further PAL event
+  //! does so first.
+  TimerHandle mTimerHandle = CHRE_TIMER_INVALID;
+
+  //! Incremented every time the timer is armed, see startTimerGeneration().
+  uint16_t mTimerGeneration = 0;
+
+  uint32_t mHistogram[kNumHistogramBuckets] = {};
+  uint64_t mBatchedReadingCount = 0;
+};
+
+}  // namespace chre
+
+#endif  // CHRE_CORE_SENSOR_DATA_BATCHER_H_
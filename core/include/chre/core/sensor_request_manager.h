@@ -21,6 +21,7 @@
 #include "chre/core/sensor_request.h"
 #include "chre/core/sensor_request_multiplexer.h"
 #include "chre/platform/fatal_error.h"
+#include "chre/platform/mutex.h"
 #include "chre/platform/platform_sensor_manager.h"
 #include "chre/platform/system_time.h"
 #include "chre/platform/system_timer.h"
@@ -345,6 +346,58 @@ class SensorRequestManager : public NonCopyable {
 
   PlatformSensorManager mPlatformSensorManager;
 
+  //! Serializes access to the SensorDataBatcher of every sensor, which is
+  //! used from PAL threads as well as the event loop.
+  mutable Mutex mBatchMutex;
+
+  /**
+   * Merges a PAL data event into the sensor's pending batch, and posts the
+   * batch if it can't wait for another delivery. Must be called with
+   * mBatchMutex held.
+   *
+   * The batch is shared by all subscribers, so it is posted at the merged
+   * latency, i.e. the smallest one requested by any nanoapp, rather than at
+   * each nanoapp's own latency.
+   *
+   * @param sensorHandle The handle of the sensor that produced the event.
+   * @param sensor The sensor that produced the event.
+   * @param event The PAL data event, released to the platform if batched.
+   * @return true if the event was batched, false if it must be posted as is.
+   */
+  bool batchSensorDataEventLocked(uint32_t sensorHandle, Sensor &sensor,
+                                  void *event);
+
+  /**
+   * Posts the sensor's pending batch, if any, and cancels its timer. Must be
+   * called with mBatchMutex held.
+   *
+   * @param sensor The sensor whose batch to post.
+   */
+  void postPendingBatchLocked(Sensor &sensor);
+
+  //! The data of a batch timer callback.
+  struct BatchTimerData {
+    uint16_t sensorHandle;
+    //! The SensorDataBatcher timer generation the timer was armed with.
+    uint16_t generation;
+  };
+
+  /**
+   * Invoked when a batch's latency deadline expires before enough further PAL
+   * events arrived to fill it. Ignored if the timer was since replaced.
+   *
+   * @param timerData The sensor and timer generation of the timer.
+   */
+  void onBatchTimeout(BatchTimerData timerData);
+
+  /**
+   * Updates the batching latency from the sensor's maximal request, posting
+   * any pending batch first if the latency shrinks.
+   *
+   * @param sensor The sensor whose request changed.
+   */
+  void updateBatchingLatency(Sensor &sensor);
+
   /**
    * Makes a specified flush request, and sets the timeout timer appropriately.
    * If there already is a pending flush request for the sensor specified in
@@ -62,6 +62,12 @@ class SensorTypeHelpers : public PlatformSensorTypeHelpers {
     return sensorType >= CHRE_SENSOR_TYPE_VENDOR_START;
   }
 
+  /**
+   * @param sensorType The type of sensor to check
+   * @return true if this sensor reports chreSensorThreeAxisData events.
+   */
+  static bool isThreeAxis(uint8_t sensorType);
+
   /**
    * @param sensorType The type of sensor to get the reporting mode for.
    * @return the reporting mode for this sensor.
@@ -24,8 +24,17 @@
 #include "chre/core/nanoapp.h"
 #include "chre/platform/mutex.h"
 #include "chre/platform/system_timer.h"
+#include "chre/util/dynamic_vector.h"
 #include "chre/util/non_copyable.h"
-#include "chre/util/priority_queue.h"
+#include "chre/util/system/debug_dump.h"
+#include "chre/util/time.h"
+
+// This default value can be overridden in the variant-specific makefile.
+//! The maximum amount of time, in milliseconds, that a timer may expire late
+//! so that it can share a wakeup with other timers. 0 disables coalescing.
+#ifndef CHRE_TIMER_SLACK_MS
+#define CHRE_TIMER_SLACK_MS 0
+#endif
 
 namespace chre {
 
@@ -42,6 +51,20 @@ typedef uint32_t TimerHandle;
 
 /**
  * Tracks requests from CHRE apps for timed events.
+ *
+ * Requests are stored in slots which are ordered by expiration time through an
+ * indexed binary heap, where each slot records its position in the heap. The
+ * slot index is encoded in the low bits of the timer handle, along with a
+ * per-slot generation count in the upper bits, so looking up a request by
+ * handle is constant time, and cancelling a timer is logarithmic in the number
+ * of active timers.
+ *
+ * To reduce the number of wakeups, the system timer is programmed for the
+ * earliest expiration time plus a configurable slack, and every timer that has
+ * expired by then is handled in the same wakeup. As timers with similar
+ * periods tend to converge on the same wakeup, and a new timer only reprograms
+ * the system timer if it can't be served by the pending wakeup, this also
+ * reduces how often the system timer is set.
  */
 class TimerPool : public NonCopyable {
  public:
@@ -119,15 +142,27 @@ class TimerPool : public NonCopyable {
     return cancelTimer(kSystemInstanceId, timerHandle);
   }
 
+  /**
+   * Prints state in a string buffer. Must only be called from the context of
+   * the main CHRE thread.
+   *
+   * @param debugDump The debug dump wrapper where a string can be printed
+   *     into one of the buffers.
+   */
+  void logStateToBuffer(DebugDumpWrapper &debugDump) const;
+
  private:
-  // Allows TestTimer to access hasNanoappTimers.
+  // Allows TestTimer to access hasNanoappTimers, the slack and statistics.
   friend class TestTimer;
 
   /**
    * Tracks metadata associated with a request for a timed event.
    */
   struct TimerRequest {
-    TimerHandle timerHandle;
+    //! The handle of the request. Retained after the request is released so
+    //! the next request using the same slot gets a different handle.
+    TimerHandle timerHandle = CHRE_TIMER_INVALID;
+
     Nanoseconds expirationTime;
     Nanoseconds duration;
 
@@ -148,27 +183,67 @@ class TimerPool : public NonCopyable {
     //! The instance ID from which this request was made
     uint16_t instanceId;
 
-    /**
-     * Provides a greater than comparison of TimerRequests.
-     *
-     * @param request The other request to compare against.
-     * @return Returns true if this request is greater than the provided
-     *         request.
-     */
-    bool operator>(const TimerRequest &request) const;
+    //! The position of this request in mTimerHeap, or kInvalidIndex if the
+    //! slot is not in use.
+    uint8_t heapIndex = kInvalidIndex;
+
+    //! If the slot is not in use, the next slot in the free list, or
+    //! kInvalidIndex if this is the last one.
+    uint8_t nextFreeSlot = kInvalidIndex;
   };
 
-  //! The queue of outstanding timer requests.
-  PriorityQueue<TimerRequest, std::greater<TimerRequest>> mTimerRequests;
+  //! Max number of timers that can be requested.
+  static constexpr size_t kMaxTimerRequests = 64;
+
+  //! The number of low bits of a timer handle that hold the slot index.
+  static constexpr uint32_t kTimerHandleSlotBits = 6;
+
+  //! Marks an unused heap position or slot index.
+  static constexpr uint8_t kInvalidIndex = UINT8_MAX;
+
+  static_assert(kMaxTimerRequests <= (1u << kTimerHandleSlotBits),
+                "Timer handles can't hold the slot index");
+  static_assert(kMaxTimerRequests < kInvalidIndex,
+                "Max number of timers is too big for the slot index type");
+
+  //! Storage for timer requests, indexed by the slot encoded in their handle.
+  //! Grows on demand up to kMaxTimerRequests, and is never shrunk so slots
+  //! retain their generation count.
+  DynamicVector<TimerRequest> mTimerSlots;
+
+  //! Binary min-heap of the slots of active timer requests, ordered by
+  //! expiration time.
+  DynamicVector<uint8_t> mTimerHeap;
+
+  //! The first slot of the list of unused slots, or kInvalidIndex if empty.
+  uint8_t mFreeSlotHead = kInvalidIndex;
 
   //! The underlying system timer used to schedule delayed callbacks.
   SystemTimer mSystemTimer;
 
-  //! The next timer handle for generateTimerHandleLocked() to return.
-  TimerHandle mLastTimerHandle = CHRE_TIMER_INVALID;
+  //! The maximum amount of time a timer may expire late to be coalesced.
+  Nanoseconds mTimerSlack = Nanoseconds(Milliseconds(CHRE_TIMER_SLACK_MS));
 
-  //! Max number of timers that can be requested.
-  static constexpr size_t kMaxTimerRequests = 64;
+  //! The time at which mSystemTimer is set to fire, or UINT64_MAX if it is not
+  //! set.
+  Nanoseconds mNextWakeupTime = Nanoseconds(UINT64_MAX);
+
+  //! The number of times expired timers were handled together.
+  uint32_t mNumWakeups = 0;
+
+  //! The number of timer expirations handled.
+  uint32_t mNumTimersExpired = 0;
+
+  //! The number of timers handled by the wakeup of a timer expiring earlier,
+  //! within the slack.
+  uint32_t mNumTimersCoalesced = 0;
+
+  //! The number of times mSystemTimer was set.
+  uint32_t mNumSystemTimerSets = 0;
+
+  //! The number of times a new timer was served by the pending wakeup rather
+  //! than setting mSystemTimer.
+  uint32_t mNumSystemTimerSetsSkipped = 0;
 
   //! The number of timers that must be available for all nanoapps
   //! (per CHRE API).
@@ -181,12 +256,8 @@ class TimerPool : public NonCopyable {
   static_assert(kMaxNanoappTimers >= kNumReservedNanoappTimers,
                 "Max number of nanoapp timers is too small");
 
-  //! Whether or not the timer handle generation logic needs to perform a
-  //! search for a vacant timer handle.
-  bool mGenerateTimerHandleMustCheckUniqueness = false;
-
   //! The mutex to lock when using this class.
-  Mutex mMutex;
+  mutable Mutex mMutex;
 
   //! The number of active nanoapp timers.
   size_t mNumNanoappTimers = 0;
@@ -223,31 +294,39 @@ class TimerPool : public NonCopyable {
    * prior to calling this function.
    *
    * @param timerHandle The timer handle referring to a given request.
-   * @param index A pointer to the index of the handle. If the handle is found
-   *        this will be populated with the index of the request from the list
-   *        of requests. This is optional and will only be populated if not
-   *        nullptr.
+   * @param slot A pointer to the slot of the handle. If the handle is found
+   *        this will be populated with the slot of the request. This is
+   *        optional and will only be populated if not nullptr.
    * @return A pointer to a TimerRequest or nullptr if no match is found.
    */
   TimerRequest *getTimerRequestByTimerHandleLocked(TimerHandle timerHandle,
-                                                   size_t *index = nullptr);
+                                                   uint8_t *slot = nullptr);
 
   /**
-   * Obtains a unique timer handle to return to an app requesting a timer.
-   * mMutex must be acquired prior to calling this function.
+   * Obtains a timer handle for a slot that is being allocated, which is unique
+   * among active requests as it encodes the slot index, and differs from the
+   * slot's previous handles until its generation count wraps around.
    *
-   * @return The guaranteed unique timer handle.
+   * @param slot The slot being allocated.
+   * @return The new timer handle for the slot.
    */
-  TimerHandle generateTimerHandleLocked();
+  TimerHandle generateTimerHandleLocked(uint8_t slot) const;
 
   /**
-   * Obtains a unique timer handle by searching through the list of timer
-   * requests. This is a fallback for once the timer handles have been
-   * exhausted. mMutex must be acquired prior to calling this function.
+   * Takes a slot from the free list, or adds a new one if none are free. mMutex
+   * must be acquired prior to calling this function.
    *
-   * @return A guaranteed unique timer handle.
+   * @return The allocated slot, or kInvalidIndex if allocation failed.
    */
-  TimerHandle generateUniqueTimerHandleLocked();
+  uint8_t allocateTimerSlotLocked();
+
+  /**
+   * Returns a slot to the free list. mMutex must be acquired prior to calling
+   * this function.
+   *
+   * @param slot The slot to release, which must not be in mTimerHeap.
+   */
+  void releaseTimerSlotLocked(uint8_t slot);
 
   /**
    * Helper function to determine whether a new timer of the specified type
@@ -259,29 +338,73 @@ class TimerPool : public NonCopyable {
   bool isNewTimerAllowedLocked(bool isNanoappTimer) const;
 
   /**
-   * Inserts a TimerRequest into the list of active timer requests. The order of
-   * mTimerRequests is always maintained such that the timer request with the
-   * closest expiration time is at the front of the list. mMutex must be
-   * acquired prior to calling this function.
+   * Inserts a TimerRequest into the set of active timer requests, assigning it
+   * a slot and a timer handle. The heap is always maintained such that the
+   * timer request with the closest expiration time is at its top. mMutex must
+   * be acquired prior to calling this function.
    *
-   * @param timerRequest The timer request being inserted into the list.
+   * @param timerRequest The timer request being inserted.
+   * @param slot Populated with the slot of the new request on success.
    * @return true if insertion of timer succeeds.
    */
-  bool insertTimerRequestLocked(const TimerRequest &timerRequest);
+  bool insertTimerRequestLocked(const TimerRequest &timerRequest,
+                                uint8_t *slot);
 
   /**
-   * Pops the TimerRequest at the front of the list. mMutex must be acquired
-   * prior to calling this function.
+   * Pops the TimerRequest with the closest expiration time. mMutex must be
+   * acquired prior to calling this function.
    */
   void popTimerRequestLocked();
 
   /**
-   * Removes the TimerRequest at the specified index of the list. mMutex must be
-   * acquired prior to calling this function.
+   * Removes the TimerRequest in the given slot, and reschedules the system
+   * timer if it was the next to expire. mMutex must be acquired prior to
+   * calling this function.
+   *
+   * @param slot The slot of the TimerRequest to remove.
+   */
+  void removeTimerRequestLocked(uint8_t slot);
+
+  /**
+   * Removes the TimerRequest in the given slot from the heap and releases the
+   * slot, without updating the system timer. mMutex must be acquired prior to
+   * calling this function.
+   *
+   * @param slot The slot of the TimerRequest to release.
+   */
+  void releaseTimerRequestLocked(uint8_t slot);
+
+  /**
+   * @return true if the request at heap position a expires before the one at
+   *         heap position b.
+   */
+  bool heapLessLocked(size_t a, size_t b) const;
+
+  /**
+   * Swaps two heap positions, updating the heap index of their slots.
+   */
+  void heapSwapLocked(size_t a, size_t b);
+
+  /**
+   * Moves the entry at the given heap position towards the top of the heap
+   * until the heap property is restored.
+   */
+  void heapSiftUpLocked(size_t index);
+
+  /**
+   * Moves the entry at the given heap position towards the bottom of the heap
+   * until the heap property is restored.
+   */
+  void heapSiftDownLocked(size_t index);
+
+  /**
+   * Sets the underlying system timer to fire after the given delay. mMutex
+   * must be acquired prior to calling this function.
    *
-   * @param index The index of the TimerRequest to remove.
+   * @param currentTime The current monotonic time.
+   * @param delay The delay after which the system timer should fire.
    */
-  void removeTimerRequestLocked(size_t index);
+  void setSystemTimerLocked(Nanoseconds currentTime, Nanoseconds delay);
 
   /**
    * Sets the underlying system timer to the next timer in the timer list if
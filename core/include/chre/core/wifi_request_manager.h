@@ -20,6 +20,8 @@
 #include "chre/core/api_manager_common.h"
 #include "chre/core/nanoapp.h"
 #include "chre/core/settings.h"
+#include "chre/core/wifi_scan_cache.h"
+#include "chre/platform/atomic.h"
 #include "chre/platform/platform_wifi.h"
 #include "chre/util/buffer.h"
 #include "chre/util/non_copyable.h"
@@ -106,10 +108,14 @@ class WifiRequestManager : public NonCopyable {
   /**
    * Performs an active wifi scan.
    *
-   * This is currently a 1:1 mapping into the PAL. If more than one nanoapp
-   * requests an active wifi scan, this will be an assertion failure for
-   * debug builds and a no-op in production (ie: subsequent requests are
-   * ignored).
+   * If CHRE_WIFI_SCAN_CACHE_ENABLED is defined and the most recent scan
+   * delivered by the platform satisfies the request, including its
+   * maxScanAgeMs, the request is answered from the scan cache without
+   * involving the PAL. Otherwise, if a scan requested by another
+   * nanoapp is in flight and its results satisfy this request, the request is
+   * coalesced with it. Otherwise, the request is forwarded to the PAL, which
+   * only handles one scan request at a time: if a scan that can't satisfy the
+   * request is in flight, the request is rejected.
    *
    * @param nanoapp The nanoapp that has requested an active wifi scan.
    * @param params Non-null pointer to the scan parameters structure
@@ -378,20 +384,42 @@ class WifiRequestManager : public NonCopyable {
   //! format that is used is <subscriptionId, nanoappInstanceId>.
   DynamicVector<NanoappNanSubscriptions> mNanoappSubscriptions;
 
-  // TODO: Support multiple requests for active wifi scans.
-  //! The instance ID of the nanoapp that has a pending active scan request. At
-  //! this time, only one nanoapp can have a pending request for an active WiFi
-  //! scan.
-  Optional<uint16_t> mScanRequestingNanoappInstanceId;
+  //! The nanoapps waiting for the active scan in flight, in the order of
+  //! their requests. The first one issued the scan to the PAL, and the others
+  //! were coalesced with it. Empty if no active scan is in flight.
+  DynamicVector<PendingRequestBase> mPendingScanRequests;
 
-  //! The cookie passed in by a nanoapp making an active request for wifi scans.
-  //! Note that this will only be valid if the mScanRequestingNanoappInstanceId
-  //! is set.
-  const void *mScanRequestingNanoappCookie;
+  //! The parameters of the active scan in flight that determine which
+  //! requests it can satisfy. Only valid if mPendingScanRequests is not empty.
+  uint8_t mPendingScanType = CHRE_WIFI_SCAN_TYPE_NO_PREFERENCE;
+  uint32_t mPendingScanMaxAgeMs = 0;
+  bool mPendingScanIsFullScan = false;
 
   //! This is set to true if the results of an active scan request are pending.
   bool mScanRequestResultsArePending = false;
 
+  //! This is set to true once the first scan event has been distributed while
+  //! the results of an active scan request are pending, after which requests
+  //! can't be coalesced with the scan anymore.
+  bool mScanRequestResultsStarted = false;
+
+#ifdef CHRE_WIFI_SCAN_CACHE_ENABLED
+  //! The results of the most recent scan, used to answer requests that accept
+  //! them without scanning again.
+  WifiScanCache mScanCache;
+
+  //! The number of scan requests answered from the scan cache.
+  uint32_t mNumScanRequestsServedFromCache = 0;
+#endif  // CHRE_WIFI_SCAN_CACHE_ENABLED
+
+  //! The number of scan requests coalesced with a scan in flight.
+  uint32_t mNumScanRequestsCoalesced = 0;
+
+  //! The number of scan responses, scan monitor state changes and scan events
+  //! deferred to the CHRE thread that haven't been handled yet. Scan events
+  //! are deferred while it is non-zero to keep them behind the async results.
+  AtomicUint32 mNumDeferredScanCallbacks;
+
   //! Accumulates the number of scan event results to determine when the last
   //! in a scan event stream has been received.
   uint8_t mScanEventResultCountAccumulator = 0;
@@ -552,13 +580,58 @@ class WifiRequestManager : public NonCopyable {
 
   /**
    * Posts a broadcast event containing the results of a wifi scan. Failure to
-   * post this event is a FATAL_ERROR. This is unrecoverable as the nanoapp will
-   * be stuck waiting for wifi scan results but there may be a gap.
+   * post this event is a FATAL_ERROR.
    *
    * @param event the wifi scan event.
    */
   void postScanEventFatal(chreWifiScanEvent *event);
 
+  /**
+   * Updates the state of the manager when a wifi scan event is about to be
+   * broadcast to nanoapps, including the scan cache if enabled.
+   *
+   * @param event the wifi scan event.
+   */
+  void handleScanEventSync(const chreWifiScanEvent *event);
+
+#ifdef CHRE_WIFI_SCAN_CACHE_ENABLED
+  /**
+   * Answers a scan request with the results of the scan cache, by posting the
+   * async result and a scan event to the nanoapp.
+   *
+   * @param nanoappInstanceId The instance ID of the requesting nanoapp.
+   * @param params The parameters of the scan request.
+   * @param cookie The cookie supplied with the request.
+   * @return true if the events were posted.
+   */
+  bool postCachedScanResults(uint16_t nanoappInstanceId,
+                             const chreWifiScanParams &params,
+                             const void *cookie);
+#endif  // CHRE_WIFI_SCAN_CACHE_ENABLED
+
+  /**
+   * Checks whether a scan request can be coalesced with the active scan in
+   * flight, i.e. whether that scan satisfies the request and its results have
+   * not started to be delivered.
+   *
+   * @param nanoappInstanceId The instance ID of the requesting nanoapp.
+   * @param params The parameters of the scan request.
+   * @return true if the request can be coalesced with the scan in flight.
+   */
+  bool canCoalesceScanRequest(uint16_t nanoappInstanceId,
+                              const chreWifiScanParams &params) const;
+
+  /**
+   * Adds a nanoapp to the list of nanoapps waiting for the active scan in
+   * flight. If the PAL already accepted the scan, the async result is posted
+   * to the nanoapp right away, and it is subscribed to the scan results.
+   *
+   * @param nanoappInstanceId The instance ID of the requesting nanoapp.
+   * @param cookie The cookie supplied with the request.
+   * @return true if the nanoapp was added.
+   */
+  bool addPendingScanRequest(uint16_t nanoappInstanceId, const void *cookie);
+
   /**
    * Posts an event to a nanoapp indicating the async result of a NAN operation.
    *
@@ -730,6 +803,15 @@ class WifiRequestManager : public NonCopyable {
    * @param eventData a pointer to the scan event to release.
    */
   static void freeWifiScanEventCallback(uint16_t eventType, void *eventData);
+
+  /**
+   * Pre-dispatch hook of the wifi scan events, which are broadcast to all
+   * nanoapps registered for them.
+   *
+   * @see PreDispatchHookFunction
+   */
+  static uint16_t scanEventPreDispatchHook(uint16_t eventType,
+                                           void *eventData);
   static void freeWifiRangingEventCallback(uint16_t eventType, void *eventData);
   static void freeNanDiscoveryEventCallback(uint16_t eventType,
                                             void *eventData);
@@ -0,0 +1,158 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CHRE_CORE_WIFI_SCAN_CACHE_H_
+#define CHRE_CORE_WIFI_SCAN_CACHE_H_
+
+#include <cstdint>
+
+#include "chre/util/dynamic_vector.h"
+#include "chre/util/non_copyable.h"
+#include "chre/util/time.h"
+#include "chre_api/chre/wifi.h"
+
+namespace chre {
+
+/**
+ * Keeps the results of the most recent complete WiFi scan delivered by the
+ * platform, whether it was requested by a nanoapp or reported through scan
+ * monitoring, so that on-demand scan requests whose maxScanAgeMs allows it
+ * can be answered without scanning again.
+ *
+ * The results are copied out of the scan events as they are distributed, and
+ * a scan only replaces the cached one once all of its results were received.
+ */
+class WifiScanCache : public NonCopyable {
+ public:
+  /**
+   * Adds the results of a scan event to the scan being received. Scan events
+   * must be added in the order they are distributed to nanoapps.
+   *
+   * @param event A scan event provided by the platform.
+   */
+  void addScanEvent(const chreWifiScanEvent &event);
+
+  /**
+   * Discards the cached scan and the scan being received, e.g. because the
+   * WiFi setting was disabled.
+   */
+  void clear();
+
+  /**
+   * Checks whether the cached scan can be delivered in response to an
+   * on-demand scan request. This requires that the scan completed at most
+   * maxScanAgeMs before now, that it is of a type satisfying the requested
+   * one, that it covered all the requested frequencies, and that the request
+   * is not limited to a set of SSIDs, which may be hidden networks.
+   *
+   * @param params The parameters of the scan request.
+   * @param now The current monotonic time.
+   * @return true if the cached scan satisfies the request.
+   */
+  bool canServe(const chreWifiScanParams &params, Nanoseconds now) const;
+
+  /**
+   * Allocates a scan event holding the cached results applicable to a
+   * request, i.e. the results on the requested frequencies if the request is
+   * limited to some frequencies. Must only be called if canServe() returned
+   * true for the request. The event is a single allocation, which must be
+   * released with memoryFree().
+   *
+   * @param params The parameters of the scan request.
+   * @return the scan event, or nullptr if it could not be allocated.
+   */
+  chreWifiScanEvent *createScanEvent(const chreWifiScanParams &params) const;
+
+  /**
+   * @return true if a complete scan is cached.
+   */
+  bool hasScan() const {
+    return mHasScan;
+  }
+
+  /**
+   * @return the completion time of the cached scan, in the same time base as
+   *     the referenceTime of scan events. Only valid if hasScan() is true.
+   */
+  uint64_t getScanTimeNs() const {
+    return mScan.referenceTime;
+  }
+
+  /**
+   * @return the number of results of the cached scan.
+   */
+  size_t getNumResults() const {
+    return mScan.results.size();
+  }
+
+  /**
+   * Checks whether the results of a scan of a given type are acceptable to a
+   * request for another scan type. Passive scans and scans without
+   * preference accept any scan, active scans accept active scans, and active
+   * scans including passive scans of DFS channels only accept scans of the
+   * same type.
+   *
+   * @param scanType The type of the performed scan, from enum
+   *     chreWifiScanType.
+   * @param requestedScanType The requested scan type, from enum
+   *     chreWifiScanType.
+   * @return true if the scan satisfies the requested scan type.
+   */
+  static bool scanTypeSatisfies(uint8_t scanType, uint8_t requestedScanType);
+
+ private:
+  //! The results and attributes of a scan.
+  struct Scan {
+    DynamicVector<chreWifiScanResult> results;
+
+    //! The scanned frequencies, empty if all the frequencies applicable to
+    //! the scan type were scanned.
+    DynamicVector<uint32_t> scannedFrequencies;
+
+    uint64_t referenceTime = 0;
+    uint8_t scanType = CHRE_WIFI_SCAN_TYPE_NO_PREFERENCE;
+    uint8_t radioChainPref = CHRE_WIFI_RADIO_CHAIN_PREF_DEFAULT;
+  };
+
+  /**
+   * @return true if the cached scan covered a frequency.
+   */
+  bool scannedFrequency(uint32_t frequency) const;
+
+  /**
+   * @return true if a result was on one of the requested frequencies, or if
+   *     the request is not limited to some frequencies.
+   */
+  static bool resultMatchesFrequencies(const chreWifiScanResult &result,
+                                       const chreWifiScanParams &params);
+
+  //! The most recent complete scan.
+  Scan mScan;
+  bool mHasScan = false;
+
+  //! The scan whose events are being received.
+  Scan mPendingScan;
+  bool mHasPendingScan = false;
+
+  //! The total number of results and the index of the next event of the scan
+  //! being received.
+  uint8_t mPendingResultTotal = 0;
+  uint8_t mNextEventIndex = 0;
+};
+
+}  // namespace chre
+
+#endif  // CHRE_CORE_WIFI_SCAN_CACHE_H_
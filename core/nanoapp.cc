@@ -51,12 +51,19 @@ bool Nanoapp::isRegisteredForBroadcastEvent(const Event *event) const {
         static_cast<const chreHostEndpointNotification *>(event->eventData);
     registered = isRegisteredForHostEndpointNotifications(data->hostEndpointId);
   } else {
-    size_t foundIndex = registrationIndex(eventType);
-    if (foundIndex < mRegisteredEvents.size()) {
-      const EventRegistration &reg = mRegisteredEvents[foundIndex];
-      if (targetGroupIdMask & reg.groupIdMask) {
-        registered = true;
-      }
+    registered = isRegisteredForBroadcastEvent(eventType, targetGroupIdMask);
+  }
+  return registered;
+}
+
+bool Nanoapp::isRegisteredForBroadcastEvent(uint16_t eventType,
+                                            uint16_t targetGroupIdMask) const {
+  bool registered = false;
+  size_t foundIndex = registrationIndex(eventType);
+  if (foundIndex < mRegisteredEvents.size()) {
+    const EventRegistration &reg = mRegisteredEvents[foundIndex];
+    if (targetGroupIdMask & reg.groupIdMask) {
+      registered = true;
     }
   }
   return registered;
@@ -70,7 +77,12 @@ void Nanoapp::registerForBroadcastEvent(uint16_t eventType,
   } else if (!mRegisteredEvents.push_back(
                  EventRegistration(eventType, groupIdMask))) {
     FATAL_ERROR_OOM();
+  } else {
+    foundIndex = mRegisteredEvents.size() - 1;
   }
+
+  updateBroadcastEventIndex(eventType,
+                            mRegisteredEvents[foundIndex].groupIdMask);
 }
 
 void Nanoapp::unregisterForBroadcastEvent(uint16_t eventType,
@@ -79,9 +91,23 @@ void Nanoapp::unregisterForBroadcastEvent(uint16_t eventType,
   if (foundIndex < mRegisteredEvents.size()) {
     EventRegistration &reg = mRegisteredEvents[foundIndex];
     reg.groupIdMask &= ~groupIdMask;
-    if (reg.groupIdMask == 0) {
+    uint16_t newGroupIdMask = reg.groupIdMask;
+    if (newGroupIdMask == 0) {
       mRegisteredEvents.erase(foundIndex);
     }
+
+    updateBroadcastEventIndex(eventType, newGroupIdMask);
+  }
+}
+
+void Nanoapp::setBroadcastEventIndex(BroadcastEventIndex *index) {
+  if (mBroadcastEventIndex != nullptr) {
+    mBroadcastEventIndex->removeNanoapp(this);
+  }
+
+  mBroadcastEventIndex = index;
+  for (const EventRegistration &reg : mRegisteredEvents) {
+    updateBroadcastEventIndex(reg.eventType, reg.groupIdMask);
   }
 }
 
@@ -185,6 +211,14 @@ size_t Nanoapp::registrationIndex(uint16_t eventType) const {
   return foundIndex;
 }
 
+void Nanoapp::updateBroadcastEventIndex(uint16_t eventType,
+                                        uint16_t groupIdMask) {
+  if (mBroadcastEventIndex != nullptr &&
+      !mBroadcastEventIndex->setSubscription(this, eventType, groupIdMask)) {
+    FATAL_ERROR_OOM();
+  }
+}
+
 void Nanoapp::handleGnssMeasurementDataEvent(const Event *event) {
 #ifdef CHRE_GNSS_MEASUREMENT_BACK_COMPAT_ENABLED
   const struct chreGnssDataEvent *data =
@@ -44,6 +44,8 @@ Sensor &Sensor::operator=(Sensor &&other) {
   mLastEventValid = other.mLastEventValid;
   other.mLastEventValid = false;
 
+  mBatcher = std::move(other.mBatcher);
+
   return *this;
 }
 
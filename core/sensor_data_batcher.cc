@@ -0,0 +1,201 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "chre/core/sensor_data_batcher.h"
+
+#include <cinttypes>
+#include <cstring>
+#include <utility>
+
+#include "chre/platform/assert.h"
+#include "chre/platform/memory.h"
+
+namespace chre {
+namespace {
+
+constexpr size_t kBatchSize =
+    sizeof(chreSensorThreeAxisData) +
+    (SensorDataBatcher::kMaxReadings - 1) *
+        sizeof(chreSensorThreeAxisData::chreSensorThreeAxisSampleData);
+
+uint64_t getFirstReadingTime(const chreSensorThreeAxisData &event) {
+  return event.header.baseTimestamp + event.readings[0].timestampDelta;
+}
+
+uint64_t getLastReadingTime(const chreSensorThreeAxisData &event) {
+  uint64_t timestamp = event.header.baseTimestamp;
+  for (uint16_t i = 0; i < event.header.readingCount; i++) {
+    timestamp += event.readings[i].timestampDelta;
+  }
+  return timestamp;
+}
+
+size_t getHistogramBucket(uint16_t palEventCount) {
+  size_t bucket = 0;
+  uint32_t upperBound = 1;
+  while (palEventCount > upperBound &&
+         bucket < SensorDataBatcher::kNumHistogramBuckets - 1) {
+    upperBound <<= 1;
+    bucket++;
+  }
+  return bucket;
+}
+
+}  // anonymous namespace
+
+SensorDataBatcher::SensorDataBatcher(SensorDataBatcher &&other) {
+  *this = std::move(other);
+}
+
+SensorDataBatcher &SensorDataBatcher::operator=(SensorDataBatcher &&other) {
+  if (mBatch != nullptr) {
+    memoryFree(mBatch);
+  }
+  mBatch = other.mBatch;
+  other.mBatch = nullptr;
+
+  mFirstReadingTime = other.mFirstReadingTime;
+  mLastReadingTime = other.mLastReadingTime;
+  mPrevDeliveryTime = other.mPrevDeliveryTime;
+  mDeliveryPeriodNs = other.mDeliveryPeriodNs;
+  mLastDeliveryReadingCount = other.mLastDeliveryReadingCount;
+  mPalEventCount = other.mPalEventCount;
+  mLatency = other.mLatency;
+  mTimerHandle = other.mTimerHandle;
+  other.mTimerHandle = CHRE_TIMER_INVALID;
+  mTimerGeneration = other.mTimerGeneration;
+  memcpy(mHistogram, other.mHistogram, sizeof(mHistogram));
+  mBatchedReadingCount = other.mBatchedReadingCount;
+  return *this;
+}
+
+SensorDataBatcher::~SensorDataBatcher() {
+  if (mBatch != nullptr) {
+    memoryFree(mBatch);
+  }
+}
+
+void SensorDataBatcher::trackDelivery(const chreSensorThreeAxisData &event) {
+  if (event.header.readingCount > 0) {
+    uint64_t lastReadingTime = getLastReadingTime(event);
+    if (mPrevDeliveryTime != 0 && lastReadingTime > mPrevDeliveryTime) {
+      mDeliveryPeriodNs = lastReadingTime - mPrevDeliveryTime;
+    }
+    mPrevDeliveryTime = lastReadingTime;
+  }
+}
+
+bool SensorDataBatcher::canAppend(const chreSensorThreeAxisData &event) const {
+  uint16_t readingCount = event.header.readingCount;
+  if (!isEnabled() || readingCount == 0 || readingCount > kMaxReadings) {
+    return false;
+  } else if (mBatch == nullptr) {
+    // Only start a batch if it could hold at least one more delivery,
+    // otherwise copying the event gains nothing.
+    uint64_t span = getLastReadingTime(event) - getFirstReadingTime(event);
+    return (span + mDeliveryPeriodNs < mLatency.toRawNanoseconds());
+  }
+
+  uint64_t firstReadingTime = getFirstReadingTime(event);
+  return (mBatch->header.readingCount + readingCount <= kMaxReadings &&
+          mBatch->header.accuracy == event.header.accuracy &&
+          firstReadingTime >= mLastReadingTime &&
+          firstReadingTime - mLastReadingTime <= UINT32_MAX);
+}
+
+bool SensorDataBatcher::append(const chreSensorThreeAxisData &event) {
+  CHRE_ASSERT(canAppend(event));
+
+  uint16_t readingCount = event.header.readingCount;
+  uint64_t lastReadingTime = getLastReadingTime(event);
+
+  if (mBatch == nullptr) {
+    mBatch = static_cast<chreSensorThreeAxisData *>(memoryAlloc(kBatchSize));
+    if (mBatch == nullptr) {
+      return false;
+    }
+
+    mBatch->header = event.header;
+    mBatch->header.readingCount = 0;
+    mFirstReadingTime = getFirstReadingTime(event);
+    mPalEventCount = 0;
+    memcpy(mBatch->readings, event.readings,
+           readingCount * sizeof(event.readings[0]));
+  } else {
+    auto *dest = &mBatch->readings[mBatch->header.readingCount];
+    memcpy(dest, event.readings, readingCount * sizeof(event.readings[0]));
+
+    // The first reading of the PAL event is relative to its own base
+    // timestamp; in the batch it must be relative to the preceding reading.
+    dest->timestampDelta =
+        static_cast<uint32_t>(getFirstReadingTime(event) - mLastReadingTime);
+  }
+
+  mBatch->header.readingCount += readingCount;
+  mLastReadingTime = lastReadingTime;
+  mLastDeliveryReadingCount = readingCount;
+  mPalEventCount++;
+  return true;
+}
+
+bool SensorDataBatcher::isReadyToPost() const {
+  if (mBatch == nullptr) {
+    return false;
+  }
+
+  uint64_t nextSpan =
+      (mLastReadingTime - mFirstReadingTime) + mDeliveryPeriodNs;
+  return (mBatch->header.readingCount + mLastDeliveryReadingCount >
+              kMaxReadings ||
+          nextSpan >= mLatency.toRawNanoseconds());
+}
+
+Nanoseconds SensorDataBatcher::getPostDeadline() const {
+  return Nanoseconds(mFirstReadingTime) + mLatency;
+}
+
+chreSensorThreeAxisData *SensorDataBatcher::releaseBatch() {
+  chreSensorThreeAxisData *batch = mBatch;
+  if (batch != nullptr) {
+    mHistogram[getHistogramBucket(mPalEventCount)]++;
+    mBatchedReadingCount += batch->header.readingCount;
+    mBatch = nullptr;
+    mPalEventCount = 0;
+  }
+  return batch;
+}
+
+void SensorDataBatcher::logStateToBuffer(DebugDumpWrapper &debugDump,
+                                         const char *sensorName) const {
+  uint64_t batchCount = 0;
+  for (uint32_t count : mHistogram) {
+    batchCount += count;
+  }
+  if (batchCount == 0 && !isEnabled()) {
+    return;
+  }
+
+  debugDump.print("  %s: lat=%" PRIu64 " batches=%" PRIu64
+                  " readings=%" PRIu64 " hist=",
+                  sensorName, mLatency.toRawNanoseconds(), batchCount,
+                  mBatchedReadingCount);
+  for (size_t i = 0; i < kNumHistogramBuckets; i++) {
+    debugDump.print("%s%" PRIu32, (i == 0) ? "" : ",", mHistogram[i]);
+  }
+  debugDump.print("\n");
+}
+
+}  // namespace chre
@@ -17,6 +17,7 @@
 #include "chre/core/sensor_request_manager.h"
 
 #include "chre/core/event_loop_manager.h"
+#include "chre/util/lock_guard.h"
 #include "chre/util/macros.h"
 #include "chre/util/nested_data_ptr.h"
 #include "chre/util/system/debug_dump.h"
@@ -460,6 +461,12 @@ void SensorRequestManager::handleFlushCompleteEvent(uint32_t sensorHandle,
     // has been received.
     mSensors[sensorHandle].cancelPendingFlushRequestTimer();
 
+    // Batched readings must reach nanoapps before the flush complete event.
+    {
+      LockGuard<Mutex> lock(mBatchMutex);
+      postPendingBatchLocked(mSensors[sensorHandle]);
+    }
+
     auto callback = [](uint16_t /*type*/, void *data, void *extraData) {
       uint8_t cbErrorCode = NestedDataPtr<uint8_t>(data);
       uint32_t cbSensorHandle = NestedDataPtr<uint32_t>(extraData);
@@ -491,7 +498,18 @@ void SensorRequestManager::handleSensorDataEvent(uint32_t sensorHandle,
 
     // Only allow dropping continuous sensor events since losing one-shot or
     // on-change events could result in nanoapps stuck in a bad state.
-    if (sensor.isContinuous()) {
+    if (sensor.supportsFrameworkBatching()) {
+      LockGuard<Mutex> lock(mBatchMutex);
+      if (!batchSensorDataEventLocked(sensorHandle, sensor, event)) {
+        // Posted under the lock so that it can't overtake a batch holding
+        // earlier readings.
+        EventLoopManagerSingleton::get()
+            ->getEventLoop()
+            .postLowPriorityEventOrFree(
+                eventType, event, sensorDataEventFree, kSystemInstanceId,
+                kBroadcastInstanceId, sensor.getTargetGroupMask());
+      }
+    } else if (sensor.isContinuous()) {
       EventLoopManagerSingleton::get()
           ->getEventLoop()
           .postLowPriorityEventOrFree(eventType, event, sensorDataEventFree,
@@ -574,6 +592,19 @@ void SensorRequestManager::logStateToBuffer(DebugDumpWrapper &debugDump) const {
           request.getLatency().toRawNanoseconds(), request.getInstanceId());
     }
   }
+  debugDump.print(
+      "\n Sensor batching (PAL events per batch: 1,2,<=4,<=8,<=16,<=32,"
+      ">32):\n");
+  {
+    LockGuard<Mutex> lock(mBatchMutex);
+    for (const Sensor &sensor : mSensors) {
+      if (sensor.supportsFrameworkBatching()) {
+        sensor.getBatcher().logStateToBuffer(debugDump,
+                                             sensor.getSensorTypeName());
+      }
+    }
+  }
+
   debugDump.print("\n Last %zu Sensor Requests:\n", mSensorRequestLogs.size());
   static_assert(kMaxSensorRequestLogs <= INT8_MAX,
                 "kMaxSensorRequestLogs must be <= INT8_MAX");
@@ -916,10 +947,105 @@ bool SensorRequestManager::configurePlatformSensor(
     if (request.getMode() == SensorMode::Off) {
       sensor.clearLastEvent();
     }
+    updateBatchingLatency(sensor);
   }
   return success;
 }
 
+bool SensorRequestManager::batchSensorDataEventLocked(uint32_t sensorHandle,
+                                                      Sensor &sensor,
+                                                      void *event) {
+  SensorDataBatcher &batcher = sensor.getBatcher();
+  const auto &sensorData = *static_cast<chreSensorThreeAxisData *>(event);
+  batcher.trackDelivery(sensorData);
+
+  if (!batcher.canAppend(sensorData)) {
+    postPendingBatchLocked(sensor);
+    if (!batcher.canAppend(sensorData)) {
+      return false;
+    }
+  }
+
+  bool startsBatch = !batcher.hasPendingBatch();
+  if (!batcher.append(sensorData)) {
+    LOG_OOM();
+    return false;
+  }
+  mPlatformSensorManager.releaseSensorDataEvent(event);
+
+  if (batcher.isReadyToPost()) {
+    postPendingBatchLocked(sensor);
+  } else if (startsBatch) {
+    auto callback = [](uint16_t /*type*/, void *data, void * /*extraData*/) {
+      EventLoopManagerSingleton::get()
+          ->getSensorRequestManager()
+          .onBatchTimeout(NestedDataPtr<BatchTimerData>(data));
+    };
+
+    Nanoseconds now = SystemTime::getMonotonicTime();
+    Nanoseconds deadline = batcher.getPostDeadline();
+    Nanoseconds delay = (deadline > now) ? deadline - now : Nanoseconds(0);
+    BatchTimerData timerData = {static_cast<uint16_t>(sensorHandle),
+                                batcher.startTimerGeneration()};
+    batcher.setTimerHandle(EventLoopManagerSingleton::get()->setDelayedCallback(
+        SystemCallbackType::SensorBatchTimeout,
+        NestedDataPtr<BatchTimerData>(timerData), callback, delay));
+  }
+
+  return true;
+}
+
+void SensorRequestManager::postPendingBatchLocked(Sensor &sensor) {
+  SensorDataBatcher &batcher = sensor.getBatcher();
+  if (batcher.getTimerHandle() != CHRE_TIMER_INVALID) {
+    EventLoopManagerSingleton::get()->cancelDelayedCallback(
+        batcher.getTimerHandle());
+    batcher.setTimerHandle(CHRE_TIMER_INVALID);
+  }
+
+  chreSensorThreeAxisData *batch = batcher.releaseBatch();
+  if (batch != nullptr) {
+    EventLoopManagerSingleton::get()->getEventLoop().postLowPriorityEventOrFree(
+        getSampleEventTypeForSensorType(sensor.getSensorType()), batch,
+        freeEventDataCallback, kSystemInstanceId, kBroadcastInstanceId,
+        sensor.getTargetGroupMask());
+  }
+}
+
+void SensorRequestManager::onBatchTimeout(BatchTimerData timerData) {
+  if (timerData.sensorHandle < mSensors.size()) {
+    LockGuard<Mutex> lock(mBatchMutex);
+    Sensor &sensor = mSensors[timerData.sensorHandle];
+    SensorDataBatcher &batcher = sensor.getBatcher();
+    // A timer cancelled after it fired still runs its callback. By then, the
+    // batch it was armed for was posted, and a newer timer may be armed.
+    if (timerData.generation == batcher.getTimerGeneration()) {
+      batcher.setTimerHandle(CHRE_TIMER_INVALID);
+      postPendingBatchLocked(sensor);
+    }
+  }
+}
+
+void SensorRequestManager::updateBatchingLatency(Sensor &sensor) {
+  if (sensor.supportsFrameworkBatching()) {
+    // The merged latency is the tightest one requested by any nanoapp, so a
+    // shared batch never holds readings longer than a subscriber allows.
+    const SensorRequest &request = sensor.getMaximalRequest();
+    Nanoseconds latency(0);
+    if (sensorModeIsContinuous(request.getMode()) &&
+        request.getLatency() != Nanoseconds(CHRE_SENSOR_LATENCY_DEFAULT)) {
+      latency = request.getLatency();
+    }
+
+    LockGuard<Mutex> lock(mBatchMutex);
+    SensorDataBatcher &batcher = sensor.getBatcher();
+    if (latency < batcher.getLatency()) {
+      postPendingBatchLocked(sensor);
+    }
+    batcher.setLatency(latency);
+  }
+}
+
 uint16_t SensorRequestManager::getActiveTargetGroupMask(
     uint16_t nanoappInstanceId, uint8_t sensorType) {
   uint16_t mask = 0;
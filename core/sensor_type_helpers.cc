@@ -91,6 +91,20 @@ bool SensorTypeHelpers::getBiasEventType(uint8_t sensorType,
   return success;
 }
 
+bool SensorTypeHelpers::isThreeAxis(uint8_t sensorType) {
+  switch (sensorType) {
+    case CHRE_SENSOR_TYPE_ACCELEROMETER:
+    case CHRE_SENSOR_TYPE_GYROSCOPE:
+    case CHRE_SENSOR_TYPE_GEOMAGNETIC_FIELD:
+    case CHRE_SENSOR_TYPE_UNCALIBRATED_ACCELEROMETER:
+    case CHRE_SENSOR_TYPE_UNCALIBRATED_GYROSCOPE:
+    case CHRE_SENSOR_TYPE_UNCALIBRATED_GEOMAGNETIC_FIELD:
+      return true;
+    default:
+      return false;
+  }
+}
+
 size_t SensorTypeHelpers::getLastEventSize(uint8_t sensorType) {
   if (isOnChange(sensorType)) {
     if (isVendorSensorType(sensorType)) {
@@ -0,0 +1,164 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "gtest/gtest.h"
+
+#include <cmath>
+#include <cstring>
+
+#include "chre/core/audio_feature_extractor.h"
+
+using chre::AudioFeatureExtractor;
+
+namespace {
+
+constexpr uint32_t kSampleRate = 16000;
+constexpr size_t kNumSamples = 1024;
+
+//! A 2kHz tone, i.e. bin 32 of a 256 point FFT at 16kHz, at half full scale.
+void fillTone(int16_t *samples, size_t numSamples) {
+  for (size_t i = 0; i < numSamples; i++) {
+    samples[i] = static_cast<int16_t>(
+        16384.0f * sinf(2.0f * 3.14159265f * 2000.0f * i / kSampleRate));
+  }
+}
+
+chreAudioDataEvent makeEvent(const int16_t *samples, uint32_t numSamples) {
+  chreAudioDataEvent event = {};
+  event.version = CHRE_AUDIO_DATA_EVENT_VERSION;
+  event.sampleRate = kSampleRate;
+  event.sampleCount = numSamples;
+  event.format = CHRE_AUDIO_DATA_FORMAT_16_BIT_SIGNED_PCM;
+  event.samplesS16 = samples;
+  return event;
+}
+
+size_t findMaxIndex(const float *values, size_t numValues) {
+  size_t maxIndex = 0;
+  for (size_t i = 1; i < numValues; i++) {
+    if (values[i] > values[maxIndex]) {
+      maxIndex = i;
+    }
+  }
+  return maxIndex;
+}
+
+}  // namespace
+
+TEST(AudioFeatureExtractor, ValidatesConfig) {
+  chreAudioFeatureConfig config = {};
+  config.fftSize = 256;
+  config.featureType = CHRE_AUDIO_FEATURE_TYPE_POWER_SPECTRUM;
+  EXPECT_TRUE(AudioFeatureExtractor::isValidConfig(config));
+
+  config.numMelBands = 16;
+  EXPECT_FALSE(AudioFeatureExtractor::isValidConfig(config));
+  config.featureType = CHRE_AUDIO_FEATURE_TYPE_LOG_MEL;
+  EXPECT_TRUE(AudioFeatureExtractor::isValidConfig(config));
+  config.numMelBands = 0;
+  EXPECT_FALSE(AudioFeatureExtractor::isValidConfig(config));
+  config.numMelBands = CHRE_AUDIO_FEATURE_MAX_MEL_BANDS + 1;
+  EXPECT_FALSE(AudioFeatureExtractor::isValidConfig(config));
+
+  config.numMelBands = 16;
+  config.fftSize = 200;
+  EXPECT_FALSE(AudioFeatureExtractor::isValidConfig(config));
+  config.fftSize = CHRE_AUDIO_FEATURE_MIN_FFT_SIZE / 2;
+  EXPECT_FALSE(AudioFeatureExtractor::isValidConfig(config));
+  config.fftSize = CHRE_AUDIO_FEATURE_MAX_FFT_SIZE * 2;
+  EXPECT_FALSE(AudioFeatureExtractor::isValidConfig(config));
+
+  config.fftSize = 256;
+  config.featureType = 2;
+  EXPECT_FALSE(AudioFeatureExtractor::isValidConfig(config));
+}
+
+TEST(AudioFeatureExtractor, PowerSpectrumPeaksAtToneFrequency) {
+  chreAudioFeatureConfig config = {};
+  config.fftSize = 256;
+  config.featureType = CHRE_AUDIO_FEATURE_TYPE_POWER_SPECTRUM;
+  AudioFeatureExtractor extractor;
+  ASSERT_TRUE(extractor.init(config, kSampleRate));
+  EXPECT_TRUE(extractor.hasConfig(config));
+  ASSERT_EQ(extractor.getFeatureCount(), 129);
+
+  int16_t samples[kNumSamples];
+  fillTone(samples, kNumSamples);
+  float features[129];
+  EXPECT_EQ(extractor.extract(makeEvent(samples, kNumSamples), features), 4);
+
+  EXPECT_EQ(findMaxIndex(features, 129), 32u);
+  // The Hann window halves the amplitude of the tone, and the spectrum of a
+  // real tone of amplitude A has magnitude A / 2 at its frequency.
+  EXPECT_NEAR(features[32], (0.5f / 4) * (0.5f / 4), 0.002f);
+  EXPECT_LT(features[64], features[32] / 1000);
+}
+
+TEST(AudioFeatureExtractor, LogMelPeaksInToneBand) {
+  chreAudioFeatureConfig config = {};
+  config.fftSize = 256;
+  config.featureType = CHRE_AUDIO_FEATURE_TYPE_LOG_MEL;
+  config.numMelBands = 32;
+  AudioFeatureExtractor extractor;
+  ASSERT_TRUE(extractor.init(config, kSampleRate));
+  ASSERT_EQ(extractor.getFeatureCount(), 32);
+
+  int16_t samples[kNumSamples];
+  fillTone(samples, kNumSamples);
+  float features[32];
+  extractor.extract(makeEvent(samples, kNumSamples), features);
+
+  // 2kHz lies between the centers of bands 16 (1.86kHz) and 17 (2.07kHz).
+  EXPECT_EQ(findMaxIndex(features, 32), 17u);
+}
+
+TEST(AudioFeatureExtractor, ULawSilenceMapsToLogFloor) {
+  chreAudioFeatureConfig config = {};
+  config.fftSize = 128;
+  config.featureType = CHRE_AUDIO_FEATURE_TYPE_LOG_MEL;
+  config.numMelBands = 8;
+  AudioFeatureExtractor extractor;
+  ASSERT_TRUE(extractor.init(config, kSampleRate));
+
+  uint8_t samples[kNumSamples];
+  memset(samples, 0xff, sizeof(samples));
+  chreAudioDataEvent event = {};
+  event.sampleRate = kSampleRate;
+  event.sampleCount = kNumSamples;
+  event.format = CHRE_AUDIO_DATA_FORMAT_8_BIT_U_LAW;
+  event.samplesULaw8 = samples;
+
+  float features[8];
+  EXPECT_EQ(extractor.extract(event, features), 8);
+  for (float feature : features) {
+    EXPECT_FLOAT_EQ(feature, logf(1e-10f));
+  }
+}
+
+TEST(AudioFeatureExtractor, PadsShortBuffers) {
+  chreAudioFeatureConfig config = {};
+  config.fftSize = 1024;
+  config.featureType = CHRE_AUDIO_FEATURE_TYPE_POWER_SPECTRUM;
+  AudioFeatureExtractor extractor;
+  ASSERT_TRUE(extractor.init(config, kSampleRate));
+
+  int16_t samples[320];
+  fillTone(samples, 320);
+  float features[513];
+  EXPECT_EQ(extractor.extract(makeEvent(samples, 320), features), 1);
+  // 2kHz is bin 128 of a 1024 point FFT.
+  EXPECT_EQ(findMaxIndex(features, 513), 128u);
+}
@@ -56,3 +56,20 @@ TEST(AudioSampleCountFromRateAndDuration, OneThousandSample) {
       16000, Nanoseconds(62500000));
   EXPECT_EQ(sampleCount, 1000u);
 }
+
+TEST(AudioDecodeULaw8, Silence) {
+  EXPECT_EQ(AudioUtil::decodeULaw8(0xff), 0);
+  EXPECT_EQ(AudioUtil::decodeULaw8(0x7f), 0);
+}
+
+TEST(AudioDecodeULaw8, FullScale) {
+  EXPECT_EQ(AudioUtil::decodeULaw8(0x80), 32124);
+  EXPECT_EQ(AudioUtil::decodeULaw8(0x00), -32124);
+}
+
+TEST(AudioDecodeULaw8, Symmetric) {
+  for (uint16_t sample = 0; sample < 0x80; sample++) {
+    EXPECT_EQ(AudioUtil::decodeULaw8(static_cast<uint8_t>(sample)),
+              -AudioUtil::decodeULaw8(static_cast<uint8_t>(sample | 0x80)));
+  }
+}
@@ -140,3 +140,102 @@ TEST(BleRequest, GetScanFilter) {
   EXPECT_EQ(0, memcmp(scanFilters.get(), retFilter.scanFilters,
                       sizeof(chreBleGenericFilter)));
 }
+
+TEST(BleRequest, RequestWithoutFilterMatchesAnyReport) {
+  BleRequest request(0, true, CHRE_BLE_SCAN_MODE_BACKGROUND,
+                     0 /* reportDelayMs */, nullptr /* filter */);
+  chreBleAdvertisingReport report{};
+  report.rssi = -100;
+
+  EXPECT_FALSE(request.hasFilter());
+  EXPECT_TRUE(request.matches(report));
+}
+
+TEST(BleRequest, MatchesRssiThreshold) {
+  chreBleScanFilter filter{-60 /* rssiThreshold */, 0 /* scanFilterCount */,
+                           nullptr /* scanFilters */};
+  BleRequest request(0, true, CHRE_BLE_SCAN_MODE_BACKGROUND,
+                     0 /* reportDelayMs */, &filter);
+  chreBleAdvertisingReport report{};
+
+  EXPECT_TRUE(request.hasFilter());
+  report.rssi = -60;
+  EXPECT_TRUE(request.matches(report));
+  report.rssi = -61;
+  EXPECT_FALSE(request.matches(report));
+  report.rssi = CHRE_BLE_RSSI_NONE;
+  EXPECT_TRUE(request.matches(report));
+}
+
+TEST(BleRequest, MatchesGenericFilter) {
+  chreBleGenericFilter genericFilter{};
+  genericFilter.type = CHRE_BLE_AD_TYPE_SERVICE_DATA_WITH_UUID_16;
+  genericFilter.len = 3;
+  genericFilter.data[0] = 0x2C;
+  genericFilter.data[1] = 0xFE;
+  genericFilter.data[2] = 0x10;
+  genericFilter.dataMask[0] = 0xFF;
+  genericFilter.dataMask[1] = 0xFF;
+  genericFilter.dataMask[2] = 0xF0;
+  chreBleScanFilter filter{CHRE_BLE_RSSI_THRESHOLD_NONE, 1, &genericFilter};
+  BleRequest request(0, true, CHRE_BLE_SCAN_MODE_BACKGROUND,
+                     0 /* reportDelayMs */, &filter);
+  EXPECT_TRUE(request.hasFilter());
+
+  // Flags followed by service data whose payload matches the masked filter.
+  uint8_t matchingData[] = {0x02, 0x01, 0x06, 0x05, 0x16,
+                            0x2C, 0xFE, 0x1A, 0x00};
+  chreBleAdvertisingReport report{};
+  report.rssi = CHRE_BLE_RSSI_NONE;
+  report.data = matchingData;
+  report.dataLength = sizeof(matchingData);
+  EXPECT_TRUE(request.matches(report));
+
+  uint8_t otherUuidData[] = {0x05, 0x16, 0x2D, 0xFE, 0x1A, 0x00};
+  report.data = otherUuidData;
+  report.dataLength = sizeof(otherUuidData);
+  EXPECT_FALSE(request.matches(report));
+
+  uint8_t otherTypeData[] = {0x05, 0xFF, 0x2C, 0xFE, 0x1A, 0x00};
+  report.data = otherTypeData;
+  report.dataLength = sizeof(otherTypeData);
+  EXPECT_FALSE(request.matches(report));
+
+  uint8_t shortPayloadData[] = {0x03, 0x16, 0x2C, 0xFE};
+  report.data = shortPayloadData;
+  report.dataLength = sizeof(shortPayloadData);
+  EXPECT_FALSE(request.matches(report));
+
+  // The length of the AD structure exceeds the advertising data.
+  uint8_t truncatedData[] = {0x08, 0x16, 0x2C, 0xFE, 0x1A, 0x00};
+  report.data = truncatedData;
+  report.dataLength = sizeof(truncatedData);
+  EXPECT_FALSE(request.matches(report));
+}
+
+TEST(BleRequest, MatchesAnyGenericFilter) {
+  chreBleGenericFilter genericFilters[2] = {};
+  for (size_t i = 0; i < 2; i++) {
+    genericFilters[i].type = CHRE_BLE_AD_TYPE_SERVICE_DATA_WITH_UUID_16;
+    genericFilters[i].len = 1;
+    genericFilters[i].data[0] = static_cast<uint8_t>(i + 1);
+    genericFilters[i].dataMask[0] = 0xFF;
+  }
+  chreBleScanFilter filter{-80 /* rssiThreshold */, 2, genericFilters};
+  BleRequest request(0, true, CHRE_BLE_SCAN_MODE_BACKGROUND,
+                     0 /* reportDelayMs */, &filter);
+
+  uint8_t data[] = {0x02, 0x16, 0x02};
+  chreBleAdvertisingReport report{};
+  report.rssi = -70;
+  report.data = data;
+  report.dataLength = sizeof(data);
+  EXPECT_TRUE(request.matches(report));
+
+  report.rssi = -90;
+  EXPECT_FALSE(request.matches(report));
+
+  report.rssi = -70;
+  data[2] = 0x03;
+  EXPECT_FALSE(request.matches(report));
+}
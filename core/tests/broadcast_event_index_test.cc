@@ -0,0 +1,208 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cinttypes>
+
+#include "gtest/gtest.h"
+
+#include "chre/core/broadcast_event_index.h"
+#include "chre/core/event.h"
+#include "chre/core/nanoapp.h"
+#include "chre/platform/log.h"
+#include "chre/platform/system_time.h"
+#include "chre/util/dynamic_vector.h"
+#include "chre/util/memory.h"
+#include "chre/util/unique_ptr.h"
+
+using chre::BroadcastEventIndex;
+using chre::DynamicVector;
+using chre::Event;
+using chre::kSystemInstanceId;
+using chre::MakeUnique;
+using chre::Nanoapp;
+using chre::Nanoseconds;
+using chre::SystemTime;
+using chre::UniquePtr;
+
+namespace {
+
+constexpr uint16_t kEventType = 0x0100;
+constexpr uint16_t kOtherEventType = 0x0200;
+
+//! Creates a nanoapp with the given instance ID, attached to the given index.
+UniquePtr<Nanoapp> makeNanoapp(uint16_t instanceId,
+                               BroadcastEventIndex *index) {
+  UniquePtr<Nanoapp> app = MakeUnique<Nanoapp>();
+  app->setInstanceId(instanceId);
+  app->setBroadcastEventIndex(index);
+  return app;
+}
+
+}  // namespace
+
+TEST(BroadcastEventIndex, EmptyIndexHasNoSubscribers) {
+  BroadcastEventIndex index;
+  EXPECT_FALSE(index.hasSubscribers(kEventType, UINT16_MAX));
+  EXPECT_EQ(index.getSubscriberCount(kEventType), 0u);
+  EXPECT_EQ(index.findNextSubscriber(kEventType, UINT16_MAX, kSystemInstanceId),
+            nullptr);
+}
+
+TEST(BroadcastEventIndex, RegistrationUpdatesIndex) {
+  BroadcastEventIndex index;
+  UniquePtr<Nanoapp> app = makeNanoapp(1, &index);
+
+  app->registerForBroadcastEvent(kEventType);
+  EXPECT_EQ(index.getSubscriberCount(kEventType), 1u);
+  EXPECT_EQ(index.getEventTypeCount(), 1u);
+  EXPECT_EQ(index.findNextSubscriber(kEventType, UINT16_MAX, kSystemInstanceId),
+            app.get());
+  EXPECT_EQ(index.findNextSubscriber(kEventType, UINT16_MAX, 1), nullptr);
+
+  app->unregisterForBroadcastEvent(kEventType);
+  EXPECT_EQ(index.getSubscriberCount(kEventType), 0u);
+  EXPECT_EQ(index.getEventTypeCount(), 0u);
+}
+
+TEST(BroadcastEventIndex, ExistingRegistrationsAddedOnAttach) {
+  BroadcastEventIndex index;
+  Nanoapp app;
+  app.setInstanceId(1);
+  app.registerForBroadcastEvent(kEventType);
+  EXPECT_EQ(index.getSubscriberCount(kEventType), 0u);
+
+  app.setBroadcastEventIndex(&index);
+  EXPECT_EQ(index.getSubscriberCount(kEventType), 1u);
+
+  app.setBroadcastEventIndex(nullptr);
+  EXPECT_EQ(index.getSubscriberCount(kEventType), 0u);
+}
+
+TEST(BroadcastEventIndex, GroupMaskFiltersSubscribers) {
+  BroadcastEventIndex index;
+  UniquePtr<Nanoapp> app1 = makeNanoapp(1, &index);
+  UniquePtr<Nanoapp> app2 = makeNanoapp(2, &index);
+
+  app1->registerForBroadcastEvent(kEventType, 0x1);
+  app2->registerForBroadcastEvent(kEventType, 0x2);
+
+  EXPECT_TRUE(index.hasSubscribers(kEventType, 0x1));
+  EXPECT_TRUE(index.hasSubscribers(kEventType, 0x3));
+  EXPECT_FALSE(index.hasSubscribers(kEventType, 0x4));
+  EXPECT_EQ(index.findNextSubscriber(kEventType, 0x2, kSystemInstanceId),
+            app2.get());
+  EXPECT_EQ(index.findNextSubscriber(kEventType, 0x4, kSystemInstanceId),
+            nullptr);
+
+  // Partially unregistering keeps the remaining group
+  app1->registerForBroadcastEvent(kEventType, 0x4);
+  app1->unregisterForBroadcastEvent(kEventType, 0x1);
+  EXPECT_FALSE(index.hasSubscribers(kEventType, 0x1));
+  EXPECT_EQ(index.findNextSubscriber(kEventType, 0x4, kSystemInstanceId),
+            app1.get());
+}
+
+TEST(BroadcastEventIndex, SubscribersOrderedByInstanceId) {
+  BroadcastEventIndex index;
+  UniquePtr<Nanoapp> app3 = makeNanoapp(3, &index);
+  UniquePtr<Nanoapp> app1 = makeNanoapp(1, &index);
+  UniquePtr<Nanoapp> app2 = makeNanoapp(2, &index);
+
+  app3->registerForBroadcastEvent(kEventType);
+  app1->registerForBroadcastEvent(kEventType);
+  app2->registerForBroadcastEvent(kEventType);
+  app2->registerForBroadcastEvent(kOtherEventType);
+
+  Nanoapp *app = index.findNextSubscriber(kEventType, UINT16_MAX,
+                                          kSystemInstanceId);
+  ASSERT_EQ(app, app1.get());
+  app = index.findNextSubscriber(kEventType, UINT16_MAX, app->getInstanceId());
+  ASSERT_EQ(app, app2.get());
+  app = index.findNextSubscriber(kEventType, UINT16_MAX, app->getInstanceId());
+  ASSERT_EQ(app, app3.get());
+  EXPECT_EQ(
+      index.findNextSubscriber(kEventType, UINT16_MAX, app->getInstanceId()),
+      nullptr);
+
+  // Removing a subscriber mid-iteration does not skip the following one
+  app2->setBroadcastEventIndex(nullptr);
+  EXPECT_EQ(index.findNextSubscriber(kEventType, UINT16_MAX, 1), app3.get());
+  EXPECT_EQ(index.getSubscriberCount(kOtherEventType), 0u);
+  EXPECT_EQ(index.getEventTypeCount(), 1u);
+}
+
+TEST(BroadcastEventIndex, DispatchCostScalesWithSubscribers) {
+  // Compares the per-event cost of finding the recipients of a broadcast event
+  // by scanning every nanoapp (the previous EventLoop::distributeEvent
+  // behavior) against walking the index, as the number of loaded nanoapps
+  // grows while the number of subscribers stays fixed.
+  constexpr size_t kNanoappCounts[] = {1, 8, 32, 64, 128};
+  constexpr size_t kRegistrationsPerNanoapp = 8;
+  constexpr size_t kSubscriberCount = 2;
+  constexpr size_t kIterations = 2000;
+
+  for (size_t nanoappCount : kNanoappCounts) {
+    BroadcastEventIndex index;
+    DynamicVector<UniquePtr<Nanoapp>> nanoapps;
+    for (size_t i = 0; i < nanoappCount; i++) {
+      UniquePtr<Nanoapp> app =
+          makeNanoapp(static_cast<uint16_t>(i + 1), &index);
+      for (size_t j = 0; j < kRegistrationsPerNanoapp; j++) {
+        app->registerForBroadcastEvent(
+            static_cast<uint16_t>(kOtherEventType + j));
+      }
+      if (i < kSubscriberCount) {
+        app->registerForBroadcastEvent(kEventType);
+      }
+      ASSERT_TRUE(nanoapps.push_back(std::move(app)));
+    }
+
+    Event event(kEventType, /*eventData=*/nullptr, /*freeCallback=*/nullptr);
+    size_t scanMatches = 0;
+    Nanoseconds start = SystemTime::getMonotonicTime();
+    for (size_t i = 0; i < kIterations; i++) {
+      for (const UniquePtr<Nanoapp> &app : nanoapps) {
+        if (app->isRegisteredForBroadcastEvent(&event)) {
+          scanMatches++;
+        }
+      }
+    }
+    Nanoseconds scanTime = SystemTime::getMonotonicTime() - start;
+
+    size_t indexMatches = 0;
+    start = SystemTime::getMonotonicTime();
+    for (size_t i = 0; i < kIterations; i++) {
+      uint16_t lastInstanceId = kSystemInstanceId;
+      Nanoapp *app;
+      while ((app = index.findNextSubscriber(event.eventType,
+                                             event.targetAppGroupMask,
+                                             lastInstanceId)) != nullptr) {
+        lastInstanceId = app->getInstanceId();
+        indexMatches++;
+      }
+    }
+    Nanoseconds indexTime = SystemTime::getMonotonicTime() - start;
+
+    size_t expectedMatches =
+        kIterations * std::min(nanoappCount, kSubscriberCount);
+    EXPECT_EQ(scanMatches, expectedMatches);
+    EXPECT_EQ(indexMatches, expectedMatches);
+    LOGI("%zu nanoapps: scan %" PRIu64 " ns/event, index %" PRIu64
+         " ns/event",
+         nanoappCount, scanTime.toRawNanoseconds() / kIterations,
+         indexTime.toRawNanoseconds() / kIterations);
+  }
+}
@@ -16,6 +16,8 @@
 
 #include "gtest/gtest.h"
 
+#include <vector>
+
 #include "chre/platform/log.h"
 #include "chre/platform/memory.h"
 #include "chre/platform/memory_manager.h"
@@ -105,3 +107,115 @@ TEST(MemoryManager, NegativeAllocationFails) {
   EXPECT_EQ(manager.getTotalAllocatedBytes(), 0u);
   EXPECT_EQ(manager.getAllocationCount(), 0u);
 }
+
+#ifdef CHRE_NANOAPP_SLAB_ALLOCATOR_ENABLED
+TEST(MemoryManager, SmallAllocationsShareASlab) {
+  MemoryManager manager;
+  Nanoapp app;
+  app.setInstanceId(1);
+  void *ptrs[10];
+  for (size_t i = 0; i < 10; i++) {
+    ptrs[i] = manager.nanoappAlloc(&app, 24u);
+    ASSERT_NE(ptrs[i], nullptr);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(ptrs[i]) % alignof(max_align_t), 0u);
+  }
+
+  MemoryManager::SlabStats stats = manager.getSlabStats(1);
+  EXPECT_EQ(stats.slabCount, 1u);
+  EXPECT_EQ(stats.blockBytes, 10 * 32u);
+  EXPECT_EQ(stats.requestedBytes, 10 * 24u);
+  EXPECT_EQ(manager.getTotalAllocatedBytes(), 10 * 24u);
+  EXPECT_EQ(app.getTotalAllocatedBytes(), 10 * 24u);
+  EXPECT_EQ(manager.getAllocationCount(), 10u);
+
+  for (size_t i = 0; i < 10; i++) {
+    manager.nanoappFree(&app, ptrs[i]);
+  }
+  EXPECT_EQ(manager.getTotalAllocatedBytes(), 0u);
+  EXPECT_EQ(manager.getAllocationCount(), 0u);
+
+  // The last slab of a size class is kept for the next allocations.
+  stats = manager.getSlabStats(1);
+  EXPECT_EQ(stats.slabCount, 1u);
+  EXPECT_EQ(stats.requestedBytes, 0u);
+
+  EXPECT_EQ(manager.nanoappFreeAll(&app), 0u);
+  EXPECT_EQ(manager.getSlabStats(1).slabCount, 0u);
+  EXPECT_EQ(manager.getSlabReservedBytes(), 0u);
+  EXPECT_GT(manager.getPeakSlabReservedBytes(), 0u);
+}
+
+TEST(MemoryManager, LargeAllocationsBypassSlabs) {
+  MemoryManager manager;
+  Nanoapp app;
+  void *ptr = manager.nanoappAlloc(&app, 1024u);
+  ASSERT_NE(ptr, nullptr);
+  EXPECT_EQ(manager.getSlabReservedBytes(), 0u);
+  EXPECT_EQ(manager.getTotalAllocatedBytes(), 1024u);
+  manager.nanoappFree(&app, ptr);
+  EXPECT_EQ(manager.getTotalAllocatedBytes(), 0u);
+  EXPECT_EQ(manager.getAllocationCount(), 0u);
+}
+
+TEST(MemoryManager, EmptySlabsAreReleased) {
+  MemoryManager manager;
+  Nanoapp app;
+  app.setInstanceId(1);
+  std::vector<void *> ptrs;
+  while (manager.getSlabStats(1).slabCount < 3) {
+    ptrs.push_back(manager.nanoappAlloc(&app, 16u));
+    ASSERT_NE(ptrs.back(), nullptr);
+  }
+
+  for (void *ptr : ptrs) {
+    manager.nanoappFree(&app, ptr);
+  }
+  EXPECT_EQ(manager.getSlabStats(1).slabCount, 1u);
+  EXPECT_EQ(manager.getAllocationCount(), 0u);
+  manager.nanoappFreeAll(&app);
+}
+
+TEST(MemoryManager, FreeAllReleasesOnlyTheSlabsOfTheNanoapp) {
+  MemoryManager manager;
+  Nanoapp app1;
+  app1.setInstanceId(1);
+  Nanoapp app2;
+  app2.setInstanceId(2);
+
+  for (uint32_t bytes = 1; bytes <= 256; bytes *= 2) {
+    EXPECT_NE(manager.nanoappAlloc(&app1, bytes), nullptr);
+  }
+  EXPECT_NE(manager.nanoappAlloc(&app1, 1024u), nullptr);
+  void *ptr = manager.nanoappAlloc(&app2, 100u);
+  ASSERT_NE(ptr, nullptr);
+
+  EXPECT_EQ(manager.getSlabStats(1).slabCount, 5u);
+  EXPECT_EQ(manager.nanoappFreeAll(&app1), 10u);
+  EXPECT_EQ(manager.getSlabStats(1).slabCount, 0u);
+  EXPECT_EQ(app1.getTotalAllocatedBytes(), 0u);
+  EXPECT_EQ(manager.getTotalAllocatedBytes(), 100u);
+  EXPECT_EQ(manager.getAllocationCount(), 1u);
+
+  MemoryManager::SlabStats stats = manager.getSlabStats(2);
+  EXPECT_EQ(stats.slabCount, 1u);
+  EXPECT_EQ(stats.requestedBytes, 100u);
+  manager.nanoappFree(&app2, ptr);
+  EXPECT_EQ(manager.getTotalAllocatedBytes(), 0u);
+  manager.nanoappFreeAll(&app2);
+  EXPECT_EQ(manager.getSlabReservedBytes(), 0u);
+}
+
+TEST(MemoryManager, DoubleFreeOfSlabBlockIsIgnored) {
+  MemoryManager manager;
+  Nanoapp app;
+  void *ptr1 = manager.nanoappAlloc(&app, 8u);
+  void *ptr2 = manager.nanoappAlloc(&app, 8u);
+  manager.nanoappFree(&app, ptr1);
+  manager.nanoappFree(&app, ptr1);
+  EXPECT_EQ(manager.getTotalAllocatedBytes(), 8u);
+  EXPECT_EQ(manager.getAllocationCount(), 1u);
+  manager.nanoappFree(&app, ptr2);
+  EXPECT_EQ(manager.getAllocationCount(), 0u);
+  manager.nanoappFreeAll(&app);
+}
+#endif  // CHRE_NANOAPP_SLAB_ALLOCATOR_ENABLED
@@ -0,0 +1,189 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <utility>
+
+#include "gtest/gtest.h"
+
+#include "chre/core/sensor_data_batcher.h"
+#include "chre/platform/memory.h"
+#include "chre/util/time.h"
+
+using chre::kOneMillisecondInNanoseconds;
+using chre::memoryFree;
+using chre::Milliseconds;
+using chre::Nanoseconds;
+using chre::SensorDataBatcher;
+
+namespace {
+
+//! A PAL-style event with room for a few readings.
+struct TestEvent {
+  chreSensorThreeAxisData data;
+  chreSensorThreeAxisData::chreSensorThreeAxisSampleData extraReadings[3];
+};
+
+// Builds an event of readingCount samples spaced periodNs apart, with the first
+// sample at firstTimestamp.
+TestEvent makeEvent(uint64_t firstTimestamp, uint16_t readingCount,
+                    uint32_t periodNs, float value = 0.0f) {
+  TestEvent event = {};
+  event.data.header.baseTimestamp = firstTimestamp;
+  event.data.header.readingCount = readingCount;
+  event.data.header.accuracy = CHRE_SENSOR_ACCURACY_HIGH;
+  for (uint16_t i = 0; i < readingCount; i++) {
+    event.data.readings[i].timestampDelta = (i == 0) ? 0 : periodNs;
+    event.data.readings[i].x = value + i;
+  }
+  return event;
+}
+
+uint64_t readingTimestamp(const chreSensorThreeAxisData *event, size_t index) {
+  uint64_t timestamp = event->header.baseTimestamp;
+  for (size_t i = 0; i <= index; i++) {
+    timestamp += event->readings[i].timestampDelta;
+  }
+  return timestamp;
+}
+
+TEST(SensorDataBatcher, DisabledWithoutLatency) {
+  SensorDataBatcher batcher;
+  TestEvent event = makeEvent(1000, 1, 0);
+  batcher.trackDelivery(event.data);
+  EXPECT_FALSE(batcher.isEnabled());
+  EXPECT_FALSE(batcher.canAppend(event.data));
+}
+
+TEST(SensorDataBatcher, MergesEventsAndRewritesTimestampDeltas) {
+  constexpr uint32_t kPeriodNs = 2500000;  // 400 Hz
+  SensorDataBatcher batcher;
+  batcher.setLatency(Milliseconds(100));
+
+  uint64_t timestamp = 10 * kOneMillisecondInNanoseconds;
+  for (int i = 0; i < 4; i++) {
+    TestEvent event = makeEvent(timestamp, 2, kPeriodNs, 10.0f * i);
+    batcher.trackDelivery(event.data);
+    ASSERT_TRUE(batcher.canAppend(event.data));
+    ASSERT_TRUE(batcher.append(event.data));
+    EXPECT_FALSE(batcher.isReadyToPost());
+    timestamp += 2 * kPeriodNs;
+  }
+
+  chreSensorThreeAxisData *batch = batcher.releaseBatch();
+  ASSERT_NE(batch, nullptr);
+  EXPECT_FALSE(batcher.hasPendingBatch());
+  ASSERT_EQ(batch->header.readingCount, 8);
+  EXPECT_EQ(batch->header.accuracy, CHRE_SENSOR_ACCURACY_HIGH);
+  for (size_t i = 0; i < 8; i++) {
+    EXPECT_EQ(readingTimestamp(batch, i),
+              10 * kOneMillisecondInNanoseconds + i * kPeriodNs);
+    EXPECT_FLOAT_EQ(batch->readings[i].x, 10.0f * (i / 2) + (i % 2));
+  }
+  memoryFree(batch);
+}
+
+TEST(SensorDataBatcher, ReadyWhenNextDeliveryWouldExceedLatency) {
+  constexpr uint32_t kPeriodNs = 10 * kOneMillisecondInNanoseconds;
+  SensorDataBatcher batcher;
+  batcher.setLatency(Milliseconds(35));
+
+  // One reading every 10 ms: four readings span 30 ms, and a fifth would
+  // stretch the batch to 40 ms.
+  uint64_t timestamp = kPeriodNs;
+  size_t postedAfter = 0;
+  for (size_t i = 1; i <= 10 && postedAfter == 0; i++) {
+    TestEvent event = makeEvent(timestamp, 1, 0);
+    batcher.trackDelivery(event.data);
+    ASSERT_TRUE(batcher.canAppend(event.data));
+    ASSERT_TRUE(batcher.append(event.data));
+    if (batcher.isReadyToPost()) {
+      postedAfter = i;
+    }
+    timestamp += kPeriodNs;
+  }
+
+  EXPECT_EQ(postedAfter, 4);
+  EXPECT_EQ(batcher.getPostDeadline(), Nanoseconds(kPeriodNs + 35000000));
+  memoryFree(batcher.releaseBatch());
+}
+
+TEST(SensorDataBatcher, DoesNotStartBatchThatCannotGrow) {
+  constexpr uint32_t kPeriodNs = 20 * kOneMillisecondInNanoseconds;
+  SensorDataBatcher batcher;
+  batcher.setLatency(Milliseconds(10));
+
+  TestEvent first = makeEvent(kPeriodNs, 1, 0);
+  TestEvent second = makeEvent(2 * kPeriodNs, 1, 0);
+  batcher.trackDelivery(first.data);
+  batcher.trackDelivery(second.data);
+  EXPECT_FALSE(batcher.canAppend(second.data));
+}
+
+TEST(SensorDataBatcher, RejectsIncompatibleEvents) {
+  SensorDataBatcher batcher;
+  batcher.setLatency(Milliseconds(500));
+
+  TestEvent event = makeEvent(1000000000, 1, 0);
+  ASSERT_TRUE(batcher.append(event.data));
+
+  TestEvent older = makeEvent(999000000, 1, 0);
+  EXPECT_FALSE(batcher.canAppend(older.data));
+
+  TestEvent otherAccuracy = makeEvent(1001000000, 1, 0);
+  otherAccuracy.data.header.accuracy = CHRE_SENSOR_ACCURACY_LOW;
+  EXPECT_FALSE(batcher.canAppend(otherAccuracy.data));
+
+  TestEvent tooFar = makeEvent(1000000000 + UINT64_C(5000000000), 1, 0);
+  EXPECT_FALSE(batcher.canAppend(tooFar.data));
+
+  TestEvent empty = makeEvent(1001000000, 0, 0);
+  EXPECT_FALSE(batcher.canAppend(empty.data));
+
+  memoryFree(batcher.releaseBatch());
+}
+
+TEST(SensorDataBatcher, ReadyWhenFull) {
+  SensorDataBatcher batcher;
+  batcher.setLatency(Milliseconds(1000));
+
+  uint64_t timestamp = 1000;
+  bool ready = false;
+  uint16_t readingCount = 0;
+  while (!ready) {
+    TestEvent event = makeEvent(timestamp, 4, 1000);
+    ASSERT_TRUE(batcher.canAppend(event.data));
+    ASSERT_TRUE(batcher.append(event.data));
+    readingCount += 4;
+    ready = batcher.isReadyToPost();
+    timestamp += 4000;
+  }
+
+  EXPECT_EQ(readingCount, SensorDataBatcher::kMaxReadings);
+  memoryFree(batcher.releaseBatch());
+}
+
+TEST(SensorDataBatcher, TimerGenerationSurvivesMove) {
+  SensorDataBatcher batcher;
+  uint16_t first = batcher.startTimerGeneration();
+  uint16_t second = batcher.startTimerGeneration();
+  EXPECT_NE(first, second);
+  EXPECT_EQ(batcher.getTimerGeneration(), second);
+
+  SensorDataBatcher moved(std::move(batcher));
+  EXPECT_EQ(moved.getTimerGeneration(), second);
+}
+
+}  // namespace
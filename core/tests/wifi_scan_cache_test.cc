@@ -0,0 +1,187 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "gtest/gtest.h"
+
+#include "chre/core/wifi_scan_cache.h"
+#include "chre/util/memory.h"
+
+using chre::Milliseconds;
+using chre::Nanoseconds;
+using chre::WifiScanCache;
+
+namespace {
+
+constexpr uint64_t kScanTimeNs = 10000000000;
+
+chreWifiScanEvent makeScanEvent(const chreWifiScanResult *results,
+                                uint8_t resultCount, uint8_t resultTotal,
+                                uint8_t eventIndex) {
+  chreWifiScanEvent event = {};
+  event.version = CHRE_WIFI_SCAN_EVENT_VERSION;
+  event.resultCount = resultCount;
+  event.resultTotal = resultTotal;
+  event.eventIndex = eventIndex;
+  event.scanType = CHRE_WIFI_SCAN_TYPE_ACTIVE;
+  event.referenceTime = kScanTimeNs;
+  event.results = results;
+  return event;
+}
+
+chreWifiScanParams makeScanParams(uint32_t maxScanAgeMs) {
+  chreWifiScanParams params = {};
+  params.scanType = CHRE_WIFI_SCAN_TYPE_NO_PREFERENCE;
+  params.maxScanAgeMs = maxScanAgeMs;
+  return params;
+}
+
+}  // namespace
+
+TEST(WifiScanCache, EmptyCacheCannotServe) {
+  WifiScanCache cache;
+  EXPECT_FALSE(cache.hasScan());
+  EXPECT_FALSE(cache.canServe(makeScanParams(UINT32_MAX), Nanoseconds(0)));
+}
+
+TEST(WifiScanCache, CachesScanOnceAllResultsReceived) {
+  chreWifiScanResult results[3] = {};
+  for (size_t i = 0; i < 3; i++) {
+    results[i].primaryChannel = 2412 + 5 * i;
+  }
+  WifiScanCache cache;
+
+  cache.addScanEvent(makeScanEvent(&results[0], 2, 3, 0));
+  EXPECT_FALSE(cache.hasScan());
+  cache.addScanEvent(makeScanEvent(&results[2], 1, 3, 1));
+  ASSERT_TRUE(cache.hasScan());
+  EXPECT_EQ(cache.getNumResults(), 3u);
+  EXPECT_EQ(cache.getScanTimeNs(), kScanTimeNs);
+
+  chreWifiScanParams params = makeScanParams(1000);
+  ASSERT_TRUE(cache.canServe(params, Nanoseconds(kScanTimeNs)));
+  chreWifiScanEvent *event = cache.createScanEvent(params);
+  ASSERT_NE(event, nullptr);
+  EXPECT_EQ(event->resultCount, 3);
+  EXPECT_EQ(event->resultTotal, 3);
+  EXPECT_EQ(event->eventIndex, 0);
+  EXPECT_EQ(event->scanType, CHRE_WIFI_SCAN_TYPE_ACTIVE);
+  EXPECT_EQ(event->referenceTime, kScanTimeNs);
+  EXPECT_EQ(event->scannedFreqListLen, 0);
+  for (size_t i = 0; i < 3; i++) {
+    EXPECT_EQ(event->results[i].primaryChannel, results[i].primaryChannel);
+  }
+  chre::memoryFree(event);
+}
+
+TEST(WifiScanCache, KeepsPreviousScanUntilNewScanIsComplete) {
+  chreWifiScanResult results[2] = {};
+  WifiScanCache cache;
+
+  cache.addScanEvent(makeScanEvent(results, 1, 1, 0));
+  ASSERT_TRUE(cache.hasScan());
+  cache.addScanEvent(makeScanEvent(results, 1, 2, 0));
+  EXPECT_EQ(cache.getNumResults(), 1u);
+
+  // An event out of sequence drops the scan being received.
+  cache.addScanEvent(makeScanEvent(results, 1, 2, 2));
+  cache.addScanEvent(makeScanEvent(results, 1, 2, 1));
+  EXPECT_EQ(cache.getNumResults(), 1u);
+
+  cache.addScanEvent(makeScanEvent(results, 2, 2, 0));
+  EXPECT_EQ(cache.getNumResults(), 2u);
+}
+
+TEST(WifiScanCache, HonoursMaxScanAge) {
+  chreWifiScanResult result = {};
+  WifiScanCache cache;
+  cache.addScanEvent(makeScanEvent(&result, 1, 1, 0));
+
+  Nanoseconds now = Nanoseconds(kScanTimeNs) + Milliseconds(500);
+  EXPECT_TRUE(cache.canServe(makeScanParams(500), now));
+  EXPECT_FALSE(cache.canServe(makeScanParams(499), now));
+  EXPECT_FALSE(cache.canServe(makeScanParams(0), Nanoseconds(kScanTimeNs)));
+
+  cache.clear();
+  EXPECT_FALSE(cache.hasScan());
+  EXPECT_FALSE(cache.canServe(makeScanParams(500), now));
+}
+
+TEST(WifiScanCache, HonoursScanTypeAndSsids) {
+  chreWifiScanResult result = {};
+  WifiScanCache cache;
+  chreWifiScanEvent event = makeScanEvent(&result, 1, 1, 0);
+  event.scanType = CHRE_WIFI_SCAN_TYPE_PASSIVE;
+  cache.addScanEvent(event);
+
+  Nanoseconds now(kScanTimeNs);
+  chreWifiScanParams params = makeScanParams(1000);
+  params.scanType = CHRE_WIFI_SCAN_TYPE_PASSIVE;
+  EXPECT_TRUE(cache.canServe(params, now));
+  params.scanType = CHRE_WIFI_SCAN_TYPE_ACTIVE;
+  EXPECT_FALSE(cache.canServe(params, now));
+
+  chreWifiSsidListItem ssid = {};
+  params = makeScanParams(1000);
+  params.ssidListLen = 1;
+  params.ssidList = &ssid;
+  EXPECT_FALSE(cache.canServe(params, now));
+}
+
+TEST(WifiScanCache, FiltersResultsByRequestedFrequencies) {
+  chreWifiScanResult results[3] = {};
+  results[0].primaryChannel = 2412;
+  results[1].primaryChannel = 2437;
+  results[2].primaryChannel = 5180;
+  uint32_t scannedFrequencies[] = {2412, 2437};
+  WifiScanCache cache;
+  chreWifiScanEvent scanEvent = makeScanEvent(results, 2, 2, 0);
+  scanEvent.scannedFreqListLen = 2;
+  scanEvent.scannedFreqList = scannedFrequencies;
+  cache.addScanEvent(scanEvent);
+
+  Nanoseconds now(kScanTimeNs);
+  chreWifiScanParams params = makeScanParams(1000);
+  // A scan limited to some frequencies can't serve a request for all of them.
+  EXPECT_FALSE(cache.canServe(params, now));
+
+  uint32_t frequency = 5180;
+  params.frequencyListLen = 1;
+  params.frequencyList = &frequency;
+  EXPECT_FALSE(cache.canServe(params, now));
+
+  frequency = 2437;
+  ASSERT_TRUE(cache.canServe(params, now));
+  chreWifiScanEvent *event = cache.createScanEvent(params);
+  ASSERT_NE(event, nullptr);
+  ASSERT_EQ(event->resultCount, 1);
+  EXPECT_EQ(event->resultTotal, 1);
+  EXPECT_EQ(event->results[0].primaryChannel, 2437u);
+  ASSERT_EQ(event->scannedFreqListLen, 1);
+  EXPECT_EQ(event->scannedFreqList[0], 2437u);
+  chre::memoryFree(event);
+}
+
+TEST(WifiScanCache, ScanTypeSatisfies) {
+  EXPECT_TRUE(WifiScanCache::scanTypeSatisfies(
+      CHRE_WIFI_SCAN_TYPE_PASSIVE, CHRE_WIFI_SCAN_TYPE_NO_PREFERENCE));
+  EXPECT_TRUE(WifiScanCache::scanTypeSatisfies(
+      CHRE_WIFI_SCAN_TYPE_ACTIVE_PLUS_PASSIVE_DFS,
+      CHRE_WIFI_SCAN_TYPE_ACTIVE));
+  EXPECT_FALSE(WifiScanCache::scanTypeSatisfies(
+      CHRE_WIFI_SCAN_TYPE_ACTIVE, CHRE_WIFI_SCAN_TYPE_ACTIVE_PLUS_PASSIVE_DFS));
+  EXPECT_FALSE(WifiScanCache::scanTypeSatisfies(CHRE_WIFI_SCAN_TYPE_PASSIVE,
+                                                CHRE_WIFI_SCAN_TYPE_ACTIVE));
+}
@@ -49,15 +49,37 @@ uint32_t TimerPool::cancelAllNanoappTimers(const Nanoapp *nanoapp) {
   CHRE_ASSERT(nanoapp != nullptr);
   LockGuard<Mutex> lock(mMutex);
 
-  uint32_t numTimersCancelled = 0;
+  uint16_t instanceId = nanoapp->getInstanceId();
+  bool topCancelled = (!mTimerHeap.empty() &&
+                       mTimerSlots[mTimerHeap[0]].instanceId == instanceId);
 
-  // Iterate backward as we remove requests from the list.
-  for (int i = static_cast<int>(mTimerRequests.size()) - 1; i >= 0; i--) {
-    size_t iAsSize = static_cast<size_t>(i);
-    const TimerRequest &request = mTimerRequests[iAsSize];
-    if (request.instanceId == nanoapp->getInstanceId()) {
+  // Compact the remaining requests to the front of the heap, then restore the
+  // heap property in a single pass rather than removing requests one by one.
+  uint32_t numTimersCancelled = 0;
+  size_t numRemaining = 0;
+  for (size_t i = 0; i < mTimerHeap.size(); i++) {
+    uint8_t slot = mTimerHeap[i];
+    if (mTimerSlots[slot].instanceId == instanceId) {
       numTimersCancelled++;
-      removeTimerRequestLocked(iAsSize);
+      mNumNanoappTimers--;
+      releaseTimerSlotLocked(slot);
+    } else {
+      mTimerSlots[slot].heapIndex = static_cast<uint8_t>(numRemaining);
+      mTimerHeap[numRemaining++] = slot;
+    }
+  }
+
+  if (numTimersCancelled > 0) {
+    while (mTimerHeap.size() > numRemaining) {
+      mTimerHeap.pop_back();
+    }
+    for (size_t i = numRemaining / 2; i > 0; i--) {
+      heapSiftDownLocked(i - 1);
+    }
+
+    if (topCancelled) {
+      mSystemTimer.cancel();
+      handleExpiredTimersAndScheduleNextLocked();
     }
   }
 
@@ -71,38 +93,44 @@ TimerHandle TimerPool::setTimer(uint16_t instanceId, Nanoseconds duration,
                                 bool isOneShot) {
   LockGuard<Mutex> lock(mMutex);
 
+  Nanoseconds currentTime = SystemTime::getMonotonicTime();
   TimerRequest timerRequest;
   timerRequest.instanceId = instanceId;
-  timerRequest.timerHandle = generateTimerHandleLocked();
-  timerRequest.expirationTime = SystemTime::getMonotonicTime() + duration;
+  timerRequest.expirationTime = currentTime + duration;
   timerRequest.duration = duration;
   timerRequest.cookie = cookie;
   timerRequest.systemCallback = systemCallback;
   timerRequest.callbackType = callbackType;
   timerRequest.isOneShot = isOneShot;
 
-  bool newTimerExpiresEarliest =
-      (!mTimerRequests.empty() && mTimerRequests.top() > timerRequest);
-  bool success = insertTimerRequestLocked(timerRequest);
-
-  if (success) {
-    if (newTimerExpiresEarliest) {
-      mSystemTimer.set(handleSystemTimerCallback, this, duration);
-    } else if (mTimerRequests.size() == 1) {
+  TimerHandle timerHandle = CHRE_TIMER_INVALID;
+  uint8_t slot;
+  if (insertTimerRequestLocked(timerRequest, &slot)) {
+    // Grab the handle first, as scheduling may immediately expire the request.
+    timerHandle = mTimerSlots[slot].timerHandle;
+    if (mTimerHeap.size() == 1) {
       // If this timer request was the first, schedule it.
       handleExpiredTimersAndScheduleNextLocked();
+    } else if (mTimerSlots[slot].heapIndex == 0) {
+      if (timerRequest.expirationTime + mTimerSlack < mNextWakeupTime) {
+        setSystemTimerLocked(currentTime, duration + mTimerSlack);
+      } else {
+        // The pending wakeup is within the slack of this timer, so it will
+        // be handled then.
+        mNumSystemTimerSetsSkipped++;
+      }
     }
   }
 
-  return success ? timerRequest.timerHandle : CHRE_TIMER_INVALID;
+  return timerHandle;
 }
 
 bool TimerPool::cancelTimer(uint16_t instanceId, TimerHandle timerHandle) {
   LockGuard<Mutex> lock(mMutex);
-  size_t index;
+  uint8_t slot;
   bool success = false;
   TimerRequest *timerRequest =
-      getTimerRequestByTimerHandleLocked(timerHandle, &index);
+      getTimerRequestByTimerHandleLocked(timerHandle, &slot);
 
   if (timerRequest == nullptr) {
     LOGW("Failed to cancel timer ID %" PRIu32 ": not found", timerHandle);
@@ -110,7 +138,7 @@ bool TimerPool::cancelTimer(uint16_t instanceId, TimerHandle timerHandle) {
     LOGW("Failed to cancel timer ID %" PRIu32 ": permission denied",
          timerHandle);
   } else {
-    removeTimerRequestLocked(index);
+    removeTimerRequestLocked(slot);
     success = true;
   }
 
@@ -118,53 +146,53 @@ bool TimerPool::cancelTimer(uint16_t instanceId, TimerHandle timerHandle) {
 }
 
 TimerPool::TimerRequest *TimerPool::getTimerRequestByTimerHandleLocked(
-    TimerHandle timerHandle, size_t *index) {
-  for (size_t i = 0; i < mTimerRequests.size(); i++) {
-    if (mTimerRequests[i].timerHandle == timerHandle) {
-      if (index != nullptr) {
-        *index = i;
-      }
-      return &mTimerRequests[i];
+    TimerHandle timerHandle, uint8_t *slot) {
+  TimerRequest *timerRequest = nullptr;
+  size_t slotIndex =
+      timerHandle & ((static_cast<uint32_t>(1) << kTimerHandleSlotBits) - 1);
+
+  if (timerHandle != CHRE_TIMER_INVALID && slotIndex < mTimerSlots.size() &&
+      mTimerSlots[slotIndex].timerHandle == timerHandle &&
+      mTimerSlots[slotIndex].heapIndex != kInvalidIndex) {
+    timerRequest = &mTimerSlots[slotIndex];
+    if (slot != nullptr) {
+      *slot = static_cast<uint8_t>(slotIndex);
     }
   }
 
-  return nullptr;
+  return timerRequest;
 }
 
-bool TimerPool::TimerRequest::operator>(const TimerRequest &request) const {
-  return (expirationTime > request.expirationTime);
-}
+TimerHandle TimerPool::generateTimerHandleLocked(uint8_t slot) const {
+  constexpr uint32_t kMaxGeneration = UINT32_MAX >> kTimerHandleSlotBits;
 
-TimerHandle TimerPool::generateTimerHandleLocked() {
-  TimerHandle timerHandle;
-  if (mGenerateTimerHandleMustCheckUniqueness) {
-    timerHandle = generateUniqueTimerHandleLocked();
-  } else {
-    timerHandle = mLastTimerHandle + 1;
-    if (timerHandle == CHRE_TIMER_INVALID) {
-      // TODO: Consider that uniqueness checking can be reset when the number
-      // of timer requests reaches zero.
-      mGenerateTimerHandleMustCheckUniqueness = true;
-      timerHandle = generateUniqueTimerHandleLocked();
-    }
+  // Generation 0 is skipped so that a handle is never CHRE_TIMER_INVALID.
+  uint32_t generation =
+      (mTimerSlots[slot].timerHandle >> kTimerHandleSlotBits) + 1;
+  if (generation > kMaxGeneration) {
+    generation = 1;
   }
 
-  mLastTimerHandle = timerHandle;
-  return timerHandle;
+  return (generation << kTimerHandleSlotBits) | slot;
 }
 
-TimerHandle TimerPool::generateUniqueTimerHandleLocked() {
-  TimerHandle timerHandle = mLastTimerHandle;
-  while (1) {
-    timerHandle++;
-    if (timerHandle != CHRE_TIMER_INVALID) {
-      TimerRequest *timerRequest =
-          getTimerRequestByTimerHandleLocked(timerHandle);
-      if (timerRequest == nullptr) {
-        return timerHandle;
-      }
-    }
+uint8_t TimerPool::allocateTimerSlotLocked() {
+  uint8_t slot = kInvalidIndex;
+  if (mFreeSlotHead != kInvalidIndex) {
+    slot = mFreeSlotHead;
+    mFreeSlotHead = mTimerSlots[slot].nextFreeSlot;
+  } else if (mTimerSlots.size() < kMaxTimerRequests &&
+             mTimerSlots.emplace_back()) {
+    slot = static_cast<uint8_t>(mTimerSlots.size() - 1);
   }
+
+  return slot;
+}
+
+void TimerPool::releaseTimerSlotLocked(uint8_t slot) {
+  mTimerSlots[slot].heapIndex = kInvalidIndex;
+  mTimerSlots[slot].nextFreeSlot = mFreeSlotHead;
+  mFreeSlotHead = slot;
 }
 
 bool TimerPool::isNewTimerAllowedLocked(bool isNanoappTimer) const {
@@ -181,17 +209,36 @@ bool TimerPool::isNewTimerAllowedLocked(bool isNanoappTimer) const {
     // reserved timers for nanoapps.
     constexpr size_t kMaxSystemTimers =
         kMaxTimerRequests - kNumReservedNanoappTimers;
-    size_t numSystemTimers = mTimerRequests.size() - mNumNanoappTimers;
+    size_t numSystemTimers = mTimerHeap.size() - mNumNanoappTimers;
     allowed = (numSystemTimers < kMaxSystemTimers);
   }
 
   return allowed;
 }
 
-bool TimerPool::insertTimerRequestLocked(const TimerRequest &timerRequest) {
+bool TimerPool::insertTimerRequestLocked(const TimerRequest &timerRequest,
+                                         uint8_t *slot) {
   bool isNanoappTimer = (timerRequest.instanceId != kSystemInstanceId);
-  bool success = isNewTimerAllowedLocked(isNanoappTimer) &&
-                 mTimerRequests.push(timerRequest);
+  bool success = false;
+
+  if (isNewTimerAllowedLocked(isNanoappTimer)) {
+    uint8_t newSlot = allocateTimerSlotLocked();
+    if (newSlot != kInvalidIndex) {
+      if (!mTimerHeap.push_back(newSlot)) {
+        releaseTimerSlotLocked(newSlot);
+      } else {
+        TimerHandle timerHandle = generateTimerHandleLocked(newSlot);
+        TimerRequest &request = mTimerSlots[newSlot];
+        request = timerRequest;
+        request.timerHandle = timerHandle;
+        request.heapIndex = static_cast<uint8_t>(mTimerHeap.size() - 1);
+        heapSiftUpLocked(request.heapIndex);
+
+        *slot = newSlot;
+        success = true;
+      }
+    }
+  }
 
   if (!success) {
     LOG_OOM();
@@ -203,45 +250,114 @@ bool TimerPool::insertTimerRequestLocked(const TimerRequest &timerRequest) {
 }
 
 void TimerPool::popTimerRequestLocked() {
-  CHRE_ASSERT(!mTimerRequests.empty());
-  if (!mTimerRequests.empty()) {
-    bool isNanoappTimer =
-        (mTimerRequests.top().instanceId != kSystemInstanceId);
-    mTimerRequests.pop();
-    if (isNanoappTimer) {
-      mNumNanoappTimers--;
-    }
+  CHRE_ASSERT(!mTimerHeap.empty());
+  if (!mTimerHeap.empty()) {
+    releaseTimerRequestLocked(mTimerHeap[0]);
   }
 }
 
-void TimerPool::removeTimerRequestLocked(size_t index) {
-  CHRE_ASSERT(index < mTimerRequests.size());
-  if (index < mTimerRequests.size()) {
-    bool isNanoappTimer =
-        (mTimerRequests[index].instanceId != kSystemInstanceId);
-    mTimerRequests.remove(index);
-    if (isNanoappTimer) {
-      mNumNanoappTimers--;
-    }
+void TimerPool::removeTimerRequestLocked(uint8_t slot) {
+  CHRE_ASSERT(slot < mTimerSlots.size());
+  if (slot < mTimerSlots.size()) {
+    bool wasNextToExpire = (mTimerSlots[slot].heapIndex == 0);
+    releaseTimerRequestLocked(slot);
 
-    if (index == 0) {
+    if (wasNextToExpire) {
       mSystemTimer.cancel();
       handleExpiredTimersAndScheduleNextLocked();
     }
   }
 }
 
+void TimerPool::releaseTimerRequestLocked(uint8_t slot) {
+  size_t index = mTimerSlots[slot].heapIndex;
+  size_t lastIndex = mTimerHeap.size() - 1;
+  if (index != lastIndex) {
+    heapSwapLocked(index, lastIndex);
+  }
+  mTimerHeap.pop_back();
+
+  if (index < mTimerHeap.size()) {
+    // The former last entry may belong either above or below its new position.
+    uint8_t movedSlot = mTimerHeap[index];
+    heapSiftUpLocked(index);
+    heapSiftDownLocked(mTimerSlots[movedSlot].heapIndex);
+  }
+
+  if (mTimerSlots[slot].instanceId != kSystemInstanceId) {
+    mNumNanoappTimers--;
+  }
+  releaseTimerSlotLocked(slot);
+}
+
+bool TimerPool::heapLessLocked(size_t a, size_t b) const {
+  return (mTimerSlots[mTimerHeap[a]].expirationTime <
+          mTimerSlots[mTimerHeap[b]].expirationTime);
+}
+
+void TimerPool::heapSwapLocked(size_t a, size_t b) {
+  uint8_t slotA = mTimerHeap[a];
+  uint8_t slotB = mTimerHeap[b];
+  mTimerHeap[a] = slotB;
+  mTimerHeap[b] = slotA;
+  mTimerSlots[slotA].heapIndex = static_cast<uint8_t>(b);
+  mTimerSlots[slotB].heapIndex = static_cast<uint8_t>(a);
+}
+
+void TimerPool::heapSiftUpLocked(size_t index) {
+  while (index > 0) {
+    size_t parent = (index - 1) / 2;
+    if (!heapLessLocked(index, parent)) {
+      break;
+    }
+    heapSwapLocked(index, parent);
+    index = parent;
+  }
+}
+
+void TimerPool::heapSiftDownLocked(size_t index) {
+  size_t size = mTimerHeap.size();
+  while (true) {
+    size_t smallest = index;
+    size_t left = 2 * index + 1;
+    size_t right = left + 1;
+    if (left < size && heapLessLocked(left, smallest)) {
+      smallest = left;
+    }
+    if (right < size && heapLessLocked(right, smallest)) {
+      smallest = right;
+    }
+    if (smallest == index) {
+      break;
+    }
+    heapSwapLocked(index, smallest);
+    index = smallest;
+  }
+}
+
 bool TimerPool::handleExpiredTimersAndScheduleNext() {
   LockGuard<Mutex> lock(mMutex);
   return handleExpiredTimersAndScheduleNextLocked();
 }
 
+void TimerPool::setSystemTimerLocked(Nanoseconds currentTime,
+                                     Nanoseconds delay) {
+  mSystemTimer.set(handleSystemTimerCallback, this, delay);
+  mNextWakeupTime = currentTime + delay;
+  mNumSystemTimerSets++;
+}
+
 bool TimerPool::handleExpiredTimersAndScheduleNextLocked() {
   bool handledExpiredTimer = false;
+  Nanoseconds firstExpirationTime;
+
+  // Either the system timer has fired or been cancelled, or it is about to be
+  // set again below.
+  mNextWakeupTime = Nanoseconds(UINT64_MAX);
 
-  while (!mTimerRequests.empty()) {
+  while (!mTimerHeap.empty()) {
     Nanoseconds currentTime = SystemTime::getMonotonicTime();
-    TimerRequest &currentTimerRequest = mTimerRequests.top();
+    TimerRequest &currentTimerRequest = mTimerSlots[mTimerHeap[0]];
     if (currentTime >= currentTimerRequest.expirationTime) {
       // This timer has expired, so post an event if it is a nanoapp timer, or
       // submit a deferred callback if it's a system timer.
@@ -255,39 +371,50 @@ bool TimerPool::handleExpiredTimersAndScheduleNextLocked() {
             CHRE_EVENT_TIMER, const_cast<void *>(currentTimerRequest.cookie),
             nullptr /*freeCallback*/, currentTimerRequest.instanceId);
       }
-      handledExpiredTimer = true;
+      if (!handledExpiredTimer) {
+        handledExpiredTimer = true;
+        firstExpirationTime = currentTimerRequest.expirationTime;
+      } else if (currentTimerRequest.expirationTime > firstExpirationTime &&
+                 currentTimerRequest.expirationTime <=
+                     firstExpirationTime + mTimerSlack) {
+        // This timer was deferred to share the wakeup of the first one.
+        mNumTimersCoalesced++;
+      }
+      mNumTimersExpired++;
 
       // Reschedule the timer if needed, and release the current request.
       if (!currentTimerRequest.isOneShot) {
-        // Important: we need to make a copy of currentTimerRequest here,
-        // because it's a reference to memory that may get moved during the
-        // insert operation (thereby invalidating it).
-        TimerRequest cyclicTimerRequest = currentTimerRequest;
-        cyclicTimerRequest.expirationTime =
+        // Cyclic timers keep their slot and handle, so just move the request
+        // down the heap to its new position.
+        currentTimerRequest.expirationTime =
             currentTime + currentTimerRequest.duration;
-        popTimerRequestLocked();
-        CHRE_ASSERT(insertTimerRequestLocked(cyclicTimerRequest));
+        heapSiftDownLocked(0);
       } else {
         popTimerRequestLocked();
       }
     } else {
       // Update the system timer to reflect the duration until the closest
-      // expiry (mTimerRequests is sorted by expiry, so we just do this for
-      // the first timer found which has not expired yet)
+      // expiry (mTimerHeap is ordered by expiry, so we just do this for
+      // the first timer found which has not expired yet). Adding the slack
+      // lets timers expiring shortly after this one share the wakeup.
       Nanoseconds duration = currentTimerRequest.expirationTime - currentTime;
-      mSystemTimer.set(handleSystemTimerCallback, this, duration);
+      setSystemTimerLocked(currentTime, duration + mTimerSlack);
       break;
     }
   }
 
+  if (handledExpiredTimer) {
+    mNumWakeups++;
+  }
+
   return handledExpiredTimer;
 }
 
 bool TimerPool::hasNanoappTimers(uint16_t instanceId) {
   LockGuard<Mutex> lock(mMutex);
 
-  for (size_t i = 0; i < mTimerRequests.size(); i++) {
-    const TimerRequest &request = mTimerRequests[i];
+  for (size_t i = 0; i < mTimerHeap.size(); i++) {
+    const TimerRequest &request = mTimerSlots[mTimerHeap[i]];
     if (request.instanceId == instanceId) {
       return true;
     }
@@ -295,6 +422,21 @@ bool TimerPool::hasNanoappTimers(uint16_t instanceId) {
   return false;
 }
 
+void TimerPool::logStateToBuffer(DebugDumpWrapper &debugDump) const {
+  LockGuard<Mutex> lock(mMutex);
+
+  debugDump.print("\nTimer Pool:\n");
+  debugDump.print("  Active timers: %zu (%zu nanoapp)\n", mTimerHeap.size(),
+                  mNumNanoappTimers);
+  debugDump.print("  Slack: %" PRIu64 "ms\n",
+                  Milliseconds(mTimerSlack).getMilliseconds());
+  debugDump.print("  Expirations: %" PRIu32 " in %" PRIu32
+                  " wakeups (%" PRIu32 " coalesced within the slack)\n",
+                  mNumTimersExpired, mNumWakeups, mNumTimersCoalesced);
+  debugDump.print("  System timer sets: %" PRIu32 " (%" PRIu32 " skipped)\n",
+                  mNumSystemTimerSets, mNumSystemTimerSetsSkipped);
+}
+
 void TimerPool::handleSystemTimerCallback(void *timerPoolPtr) {
   auto callback = [](uint16_t /*type*/, void *data, void * /*extraData*/) {
     auto *timerPool = static_cast<TimerPool *>(data);
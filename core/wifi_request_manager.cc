@@ -25,6 +25,7 @@
 #include "chre/platform/fatal_error.h"
 #include "chre/platform/log.h"
 #include "chre/platform/system_time.h"
+#include "chre/util/macros.h"
 #include "chre/util/nested_data_ptr.h"
 #include "chre/util/system/debug_dump.h"
 #include "chre_api/chre/version.h"
@@ -33,7 +34,7 @@
 
 namespace chre {
 
-WifiRequestManager::WifiRequestManager() {
+WifiRequestManager::WifiRequestManager() : mNumDeferredScanCallbacks(0) {
   // Reserve space for at least one scan monitoring nanoapp. This ensures that
   // the first asynchronous push_back will succeed. Future push_backs will be
   // synchronous and failures will be returned to the client.
@@ -208,13 +209,14 @@ bool WifiRequestManager::requestScan(Nanoapp *nanoapp,
   CHRE_ASSERT(nanoapp);
 
   // TODO(b/65331248): replace with a timer to actively check response timeout
+  Nanoseconds now = SystemTime::getMonotonicTime();
   bool timedOut =
-      (mScanRequestingNanoappInstanceId.has_value() &&
+      (!mPendingScanRequests.empty() &&
        mLastScanRequestTime + Nanoseconds(CHRE_WIFI_SCAN_RESULT_TIMEOUT_NS) <
-           SystemTime::getMonotonicTime());
+           now);
   if (timedOut) {
     LOGE("Scan request async response timed out");
-    mScanRequestingNanoappInstanceId.reset();
+    mPendingScanRequests.clear();
   }
 
   // Handle compatibility with nanoapps compiled against API v1.1, which doesn't
@@ -226,33 +228,69 @@ bool WifiRequestManager::requestScan(Nanoapp *nanoapp,
     params = &paramsCompat;
   }
 
+  uint16_t instanceId = nanoapp->getInstanceId();
+  bool wifiEnabled = EventLoopManagerSingleton::get()
+                         ->getSettingManager()
+                         .getSettingEnabled(Setting::WIFI_AVAILABLE);
   bool success = false;
-  if (mScanRequestingNanoappInstanceId.has_value()) {
-    LOGE("Active wifi scan request made by 0x%" PRIx64
-         " while a request by 0x%" PRIx64 " is in flight",
-         nanoapp->getAppId(),
-         EventLoopManagerSingleton::get()
-             ->getEventLoop()
-             .findNanoappByInstanceId(mScanRequestingNanoappInstanceId.value())
-             ->getAppId());
-  } else if (!EventLoopManagerSingleton::get()
-                  ->getSettingManager()
-                  .getSettingEnabled(Setting::WIFI_AVAILABLE)) {
+  bool newScan = false;
+  bool servedFromCache = false;
+#ifdef CHRE_WIFI_SCAN_CACHE_ENABLED
+  if (wifiEnabled && mScanCache.canServe(*params, now)) {
+    servedFromCache = true;
+    success = postCachedScanResults(instanceId, *params, cookie);
+    if (success) {
+      mNumScanRequestsServedFromCache++;
+    }
+  }
+#endif  // CHRE_WIFI_SCAN_CACHE_ENABLED
+
+  if (servedFromCache) {
+    // The request was answered from the scan cache above.
+  } else if (!mPendingScanRequests.empty()) {
+    if (canCoalesceScanRequest(instanceId, *params)) {
+      success = addPendingScanRequest(instanceId, cookie);
+      if (success) {
+        mNumScanRequestsCoalesced++;
+      }
+    } else {
+      LOGE("Active wifi scan request made by 0x%" PRIx64
+           " while a request by 0x%" PRIx64 " is in flight",
+           nanoapp->getAppId(),
+           EventLoopManagerSingleton::get()
+               ->getEventLoop()
+               .findNanoappByInstanceId(
+                   mPendingScanRequests.front().nanoappInstanceId)
+               ->getAppId());
+    }
+  } else if (!mPendingScanRequests.reserve(1)) {
+    LOG_OOM();
+  } else if (!wifiEnabled) {
     // Treat as success, but send an async failure per API contract.
     success = true;
+    newScan = true;
     handleScanResponse(false /* pending */, CHRE_ERROR_FUNCTION_DISABLED);
   } else {
     success = mPlatformWifi.requestScan(params);
+    newScan = success;
     if (!success) {
       LOGE("Wifi scan request failed");
     }
   }
 
+  if (newScan) {
+    // Memory was reserved above, so this is guaranteed to succeed.
+    mPendingScanRequests.push_back(PendingRequestBase{instanceId, cookie});
+    mPendingScanType = params->scanType;
+    mPendingScanMaxAgeMs = params->maxScanAgeMs;
+    mPendingScanIsFullScan =
+        (params->frequencyListLen == 0 && params->ssidListLen == 0);
+    mScanRequestResultsStarted = false;
+    mLastScanRequestTime = now;
+  }
+
   if (success) {
-    mScanRequestingNanoappInstanceId = nanoapp->getInstanceId();
-    mScanRequestingNanoappCookie = cookie;
-    mLastScanRequestTime = SystemTime::getMonotonicTime();
-    addWifiScanRequestLog(nanoapp->getInstanceId(), params);
+    addWifiScanRequestLog(instanceId, params);
   }
 
   return success;
@@ -267,14 +305,17 @@ void WifiRequestManager::handleScanMonitorStateChange(bool enabled,
 
   auto callback = [](uint16_t /*type*/, void *data, void * /*extraData*/) {
     CallbackState cbState = NestedDataPtr<CallbackState>(data);
-    EventLoopManagerSingleton::get()
-        ->getWifiRequestManager()
-        .handleScanMonitorStateChangeSync(cbState.enabled, cbState.errorCode);
+    WifiRequestManager &manager =
+        EventLoopManagerSingleton::get()->getWifiRequestManager();
+    manager.handleScanMonitorStateChangeSync(cbState.enabled,
+                                             cbState.errorCode);
+    manager.mNumDeferredScanCallbacks.fetch_decrement();
   };
 
   CallbackState cbState = {};
   cbState.enabled = enabled;
   cbState.errorCode = errorCode;
+  mNumDeferredScanCallbacks.fetch_increment();
   EventLoopManagerSingleton::get()->deferCallback(
       SystemCallbackType::WifiScanMonitorStateChange,
       NestedDataPtr<CallbackState>(cbState), callback);
@@ -288,14 +329,16 @@ void WifiRequestManager::handleScanResponse(bool pending, uint8_t errorCode) {
 
   auto callback = [](uint16_t /*type*/, void *data, void * /*extraData*/) {
     CallbackState cbState = NestedDataPtr<CallbackState>(data);
-    EventLoopManagerSingleton::get()
-        ->getWifiRequestManager()
-        .handleScanResponseSync(cbState.pending, cbState.errorCode);
+    WifiRequestManager &manager =
+        EventLoopManagerSingleton::get()->getWifiRequestManager();
+    manager.handleScanResponseSync(cbState.pending, cbState.errorCode);
+    manager.mNumDeferredScanCallbacks.fetch_decrement();
   };
 
   CallbackState cbState = {};
   cbState.pending = pending;
   cbState.errorCode = errorCode;
+  mNumDeferredScanCallbacks.fetch_increment();
   EventLoopManagerSingleton::get()->deferCallback(
       SystemCallbackType::WifiRequestScanResponse,
       NestedDataPtr<CallbackState>(cbState), callback);
@@ -317,15 +360,24 @@ void WifiRequestManager::handleRangingEvent(
 }
 
 void WifiRequestManager::handleScanEvent(struct chreWifiScanEvent *event) {
-  auto callback = [](uint16_t /*type*/, void *data, void * /*extraData*/) {
-    auto *scanEvent = static_cast<struct chreWifiScanEvent *>(data);
-    EventLoopManagerSingleton::get()
-        ->getWifiRequestManager()
-        .postScanEventFatal(scanEvent);
-  };
-
-  EventLoopManagerSingleton::get()->deferCallback(
-      SystemCallbackType::WifiHandleScanEvent, event, callback);
+  // The async results of a scan response are posted from the CHRE thread. If
+  // one is still deferred, the scan event must be deferred behind it so that
+  // nanoapps receive CHRE_EVENT_WIFI_ASYNC_RESULT before the scan results.
+  if (mNumDeferredScanCallbacks.load() == 0) {
+    postScanEventFatal(event);
+  } else {
+    auto callback = [](uint16_t /*type*/, void *data, void * /*extraData*/) {
+      auto *scanEvent = static_cast<struct chreWifiScanEvent *>(data);
+      WifiRequestManager &manager =
+          EventLoopManagerSingleton::get()->getWifiRequestManager();
+      manager.postScanEventFatal(scanEvent);
+      manager.mNumDeferredScanCallbacks.fetch_decrement();
+    };
+
+    mNumDeferredScanCallbacks.fetch_increment();
+    EventLoopManagerSingleton::get()->deferCallback(
+        SystemCallbackType::WifiHandleScanEvent, event, callback);
+  }
 }
 
 void WifiRequestManager::handleNanServiceIdentifierEventSync(
@@ -544,9 +596,9 @@ void WifiRequestManager::logStateToBuffer(DebugDumpWrapper &debugDump) const {
     }
   }
 
-  if (mScanRequestingNanoappInstanceId.has_value()) {
+  for (const PendingRequestBase &request : mPendingScanRequests) {
     debugDump.print(" Wifi request pending nanoappId=%" PRIu16 "\n",
-                    mScanRequestingNanoappInstanceId.value());
+                    request.nanoappInstanceId);
   }
 
   if (!mPendingScanMonitorRequests.empty()) {
@@ -574,6 +626,19 @@ void WifiRequestManager::logStateToBuffer(DebugDumpWrapper &debugDump) const {
   debugDump.print(" Last scan event @ %" PRIu64 " ms\n",
                   mLastScanEventTime.getMilliseconds());
 
+#ifdef CHRE_WIFI_SCAN_CACHE_ENABLED
+  if (mScanCache.hasScan()) {
+    debugDump.print(" Cached scan @ %" PRIu64 " ms with %zu results\n",
+                    Milliseconds(Nanoseconds(mScanCache.getScanTimeNs()))
+                        .getMilliseconds(),
+                    mScanCache.getNumResults());
+  }
+  debugDump.print(" Scan requests served from cache=%" PRIu32 "\n",
+                  mNumScanRequestsServedFromCache);
+#endif  // CHRE_WIFI_SCAN_CACHE_ENABLED
+  debugDump.print(" Scan requests coalesced=%" PRIu32 "\n",
+                  mNumScanRequestsCoalesced);
+
   debugDump.print(" API error distribution (error-code indexed):\n");
   debugDump.print("   Scan monitor:\n");
   debugDump.logErrorHistogram(mScanMonitorErrorHistogram,
@@ -778,9 +843,87 @@ void WifiRequestManager::postScanRequestAsyncResultEventFatal(
 }
 
 void WifiRequestManager::postScanEventFatal(chreWifiScanEvent *event) {
+  // Failure to post this event is a FATAL_ERROR. This is unrecoverable as the
+  // nanoapp will be stuck waiting for wifi scan results but there may be a gap.
+  EventLoopManagerSingleton::get()
+      ->getEventLoop()
+      .postEventWithPreDispatchHookOrDie(CHRE_EVENT_WIFI_SCAN_RESULT, event,
+                                         scanEventPreDispatchHook,
+                                         freeWifiScanEventCallback);
+}
+
+void WifiRequestManager::handleScanEventSync(const chreWifiScanEvent *event) {
   mLastScanEventTime = Milliseconds(SystemTime::getMonotonicTime());
-  EventLoopManagerSingleton::get()->getEventLoop().postEventOrDie(
-      CHRE_EVENT_WIFI_SCAN_RESULT, event, freeWifiScanEventCallback);
+  if (mScanRequestResultsArePending) {
+    mScanRequestResultsStarted = true;
+  }
+#ifdef CHRE_WIFI_SCAN_CACHE_ENABLED
+  mScanCache.addScanEvent(*event);
+#else
+  UNUSED_VAR(event);
+#endif  // CHRE_WIFI_SCAN_CACHE_ENABLED
+}
+
+#ifdef CHRE_WIFI_SCAN_CACHE_ENABLED
+bool WifiRequestManager::postCachedScanResults(
+    uint16_t nanoappInstanceId, const chreWifiScanParams &params,
+    const void *cookie) {
+  bool success = false;
+  chreWifiScanEvent *event = mScanCache.createScanEvent(params);
+  if (event != nullptr) {
+    success = postScanRequestAsyncResultEvent(
+        nanoappInstanceId, true /* success */, CHRE_ERROR_NONE, cookie);
+    if (!success) {
+      memoryFree(event);
+    } else {
+      EventLoopManagerSingleton::get()->getEventLoop().postEventOrDie(
+          CHRE_EVENT_WIFI_SCAN_RESULT, event, freeEventDataCallback,
+          nanoappInstanceId);
+    }
+  }
+  return success;
+}
+#endif  // CHRE_WIFI_SCAN_CACHE_ENABLED
+
+bool WifiRequestManager::canCoalesceScanRequest(
+    uint16_t nanoappInstanceId, const chreWifiScanParams &params) const {
+  // A scan whose results may come from the cache of the PAL only satisfies
+  // requests accepting results at least as old.
+  bool canCoalesce =
+      (!mScanRequestResultsStarted && mPendingScanIsFullScan &&
+       params.frequencyListLen == 0 && params.ssidListLen == 0 &&
+       params.maxScanAgeMs >= mPendingScanMaxAgeMs &&
+       WifiScanCache::scanTypeSatisfies(mPendingScanType, params.scanType));
+
+  for (const PendingRequestBase &request : mPendingScanRequests) {
+    if (request.nanoappInstanceId == nanoappInstanceId) {
+      canCoalesce = false;
+      break;
+    }
+  }
+  return canCoalesce;
+}
+
+bool WifiRequestManager::addPendingScanRequest(uint16_t nanoappInstanceId,
+                                               const void *cookie) {
+  bool success =
+      mPendingScanRequests.push_back(PendingRequestBase{nanoappInstanceId,
+                                                        cookie});
+  if (!success) {
+    LOG_OOM();
+  } else if (mScanRequestResultsArePending) {
+    // The PAL already accepted the scan, but none of its results were
+    // delivered yet.
+    postScanRequestAsyncResultEventFatal(nanoappInstanceId, true /* success */,
+                                         CHRE_ERROR_NONE, cookie);
+    Nanoapp *nanoapp = EventLoopManagerSingleton::get()
+                           ->getEventLoop()
+                           .findNanoappByInstanceId(nanoappInstanceId);
+    if (nanoapp != nullptr) {
+      nanoapp->registerForBroadcastEvent(CHRE_EVENT_WIFI_SCAN_RESULT);
+    }
+  }
+  return success;
 }
 
 void WifiRequestManager::handleScanMonitorStateChangeSync(bool enabled,
@@ -860,10 +1003,10 @@ void WifiRequestManager::postNanAsyncResultEvent(uint16_t nanoappInstanceId,
 void WifiRequestManager::handleScanResponseSync(bool pending,
                                                 uint8_t errorCode) {
   // TODO(b/65206783): re-enable this assertion
-  // CHRE_ASSERT_LOG(mScanRequestingNanoappInstanceId.has_value(),
+  // CHRE_ASSERT_LOG(!mPendingScanRequests.empty(),
   //                "handleScanResponseSync called with no outstanding
   //                request");
-  if (!mScanRequestingNanoappInstanceId.has_value()) {
+  if (mPendingScanRequests.empty()) {
     LOGE("handleScanResponseSync called with no outstanding request");
   }
 
@@ -873,34 +1016,37 @@ void WifiRequestManager::handleScanResponseSync(bool pending,
     errorCode = CHRE_ERROR;
   }
 
-  if (mScanRequestingNanoappInstanceId.has_value()) {
+  if (!mPendingScanRequests.empty()) {
     bool success = (pending && errorCode == CHRE_ERROR_NONE);
     if (!success) {
       LOGW("Wifi scan request failed: pending %d, errorCode %" PRIu8, pending,
            errorCode);
     }
-    postScanRequestAsyncResultEventFatal(*mScanRequestingNanoappInstanceId,
-                                         success, errorCode,
-                                         mScanRequestingNanoappCookie);
 
     // Set a flag to indicate that results may be pending.
     mScanRequestResultsArePending = pending;
-
-    if (pending) {
-      Nanoapp *nanoapp =
-          EventLoopManagerSingleton::get()
-              ->getEventLoop()
-              .findNanoappByInstanceId(*mScanRequestingNanoappInstanceId);
-      if (nanoapp == nullptr) {
-        LOGW("Received WiFi scan response for unknown nanoapp");
-      } else {
-        nanoapp->registerForBroadcastEvent(CHRE_EVENT_WIFI_SCAN_RESULT);
+    mScanRequestResultsStarted = false;
+
+    for (const PendingRequestBase &request : mPendingScanRequests) {
+      postScanRequestAsyncResultEventFatal(request.nanoappInstanceId, success,
+                                           errorCode, request.cookie);
+      if (pending) {
+        Nanoapp *nanoapp =
+            EventLoopManagerSingleton::get()
+                ->getEventLoop()
+                .findNanoappByInstanceId(request.nanoappInstanceId);
+        if (nanoapp == nullptr) {
+          LOGW("Received WiFi scan response for unknown nanoapp");
+        } else {
+          nanoapp->registerForBroadcastEvent(CHRE_EVENT_WIFI_SCAN_RESULT);
+        }
       }
-    } else {
-      // If the scan results are not pending, clear the nanoapp instance ID.
-      // Otherwise, wait for the results to be delivered and then clear the
-      // instance ID.
-      mScanRequestingNanoappInstanceId.reset();
+    }
+
+    // If the scan results are not pending, clear the requests. Otherwise, wait
+    // for the results to be delivered and then clear the requests.
+    if (!pending) {
+      mPendingScanRequests.clear();
     }
   }
 }
@@ -1025,20 +1171,21 @@ void WifiRequestManager::handleFreeWifiScanEvent(chreWifiScanEvent *scanEvent) {
       mScanRequestResultsArePending = false;
     }
 
-    if (!mScanRequestResultsArePending &&
-        mScanRequestingNanoappInstanceId.has_value()) {
-      Nanoapp *nanoapp =
-          EventLoopManagerSingleton::get()
-              ->getEventLoop()
-              .findNanoappByInstanceId(*mScanRequestingNanoappInstanceId);
-      if (nanoapp == nullptr) {
-        LOGW("Attempted to unsubscribe unknown nanoapp from WiFi scan events");
-      } else if (!nanoappHasScanMonitorRequest(
-                     *mScanRequestingNanoappInstanceId)) {
-        nanoapp->unregisterForBroadcastEvent(CHRE_EVENT_WIFI_SCAN_RESULT);
+    if (!mScanRequestResultsArePending) {
+      for (const PendingRequestBase &request : mPendingScanRequests) {
+        Nanoapp *nanoapp =
+            EventLoopManagerSingleton::get()
+                ->getEventLoop()
+                .findNanoappByInstanceId(request.nanoappInstanceId);
+        if (nanoapp == nullptr) {
+          LOGW("Attempted to unsubscribe unknown nanoapp from WiFi scan "
+               "events");
+        } else if (!nanoappHasScanMonitorRequest(request.nanoappInstanceId)) {
+          nanoapp->unregisterForBroadcastEvent(CHRE_EVENT_WIFI_SCAN_RESULT);
+        }
       }
 
-      mScanRequestingNanoappInstanceId.reset();
+      mPendingScanRequests.clear();
     }
   }
 
@@ -1077,6 +1224,15 @@ void WifiRequestManager::freeNanDiscoveryEventCallback(uint16_t /* eventType */,
       .mPlatformWifi.releaseNanDiscoveryEvent(event);
 }
 
+uint16_t WifiRequestManager::scanEventPreDispatchHook(uint16_t /* eventType */,
+                                                      void *eventData) {
+  auto *scanEvent = static_cast<struct chreWifiScanEvent *>(eventData);
+  EventLoopManagerSingleton::get()
+      ->getWifiRequestManager()
+      .handleScanEventSync(scanEvent);
+  return kBroadcastInstanceId;
+}
+
 bool WifiRequestManager::nanSubscribe(
     Nanoapp *nanoapp, const struct chreWifiNanSubscribeConfig *config,
     const void *cookie) {
@@ -1263,6 +1419,9 @@ void WifiRequestManager::onSettingChanged(Setting setting, bool enabled) {
   if ((setting == Setting::WIFI_AVAILABLE) && !enabled) {
     cancelNanPendingRequestsAndInformNanoapps();
     cancelNanSubscriptionsAndInformNanoapps();
+#ifdef CHRE_WIFI_SCAN_CACHE_ENABLED
+    mScanCache.clear();
+#endif  // CHRE_WIFI_SCAN_CACHE_ENABLED
   }
 }
 
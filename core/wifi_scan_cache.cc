@@ -0,0 +1,198 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "chre/core/wifi_scan_cache.h"
+
+#include <cstring>
+
+#include "chre/platform/assert.h"
+#include "chre/platform/log.h"
+#include "chre/util/memory.h"
+
+namespace chre {
+
+void WifiScanCache::addScanEvent(const chreWifiScanEvent &event) {
+  if (event.eventIndex == 0) {
+    // A new scan starts, dropping any scan whose events were not all received.
+    mPendingScan.results.clear();
+    mPendingScan.scannedFrequencies.clear();
+    mPendingScan.referenceTime = event.referenceTime;
+    mPendingScan.scanType = event.scanType;
+    mPendingScan.radioChainPref = event.radioChainPref;
+    mPendingResultTotal = event.resultTotal;
+    mNextEventIndex = 0;
+    mHasPendingScan = true;
+
+    if (!mPendingScan.scannedFrequencies.resize(event.scannedFreqListLen)) {
+      LOG_OOM();
+      mHasPendingScan = false;
+    } else if (event.scannedFreqListLen > 0) {
+      memcpy(mPendingScan.scannedFrequencies.data(), event.scannedFreqList,
+             event.scannedFreqListLen * sizeof(uint32_t));
+    }
+  }
+
+  if (mHasPendingScan) {
+    size_t numResults = mPendingScan.results.size();
+    if (event.eventIndex != mNextEventIndex ||
+        event.resultTotal != mPendingResultTotal ||
+        numResults + event.resultCount > mPendingResultTotal) {
+      LOGW("Dropping inconsistent WiFi scan from the cache");
+      mHasPendingScan = false;
+    } else if (!mPendingScan.results.resize(numResults + event.resultCount)) {
+      LOG_OOM();
+      mHasPendingScan = false;
+    } else {
+      if (event.resultCount > 0) {
+        memcpy(&mPendingScan.results[numResults], event.results,
+               event.resultCount * sizeof(chreWifiScanResult));
+      }
+      mNextEventIndex++;
+      // The referenceTime of the last event is the completion time of the
+      // scan.
+      mPendingScan.referenceTime = event.referenceTime;
+
+      if (mPendingScan.results.size() == mPendingResultTotal) {
+        mScan = std::move(mPendingScan);
+        mHasScan = true;
+        mHasPendingScan = false;
+      }
+    }
+  }
+}
+
+void WifiScanCache::clear() {
+  mScan.results.clear();
+  mScan.scannedFrequencies.clear();
+  mPendingScan.results.clear();
+  mPendingScan.scannedFrequencies.clear();
+  mHasScan = false;
+  mHasPendingScan = false;
+}
+
+bool WifiScanCache::canServe(const chreWifiScanParams &params,
+                             Nanoseconds now) const {
+  bool canServe = (mHasScan && params.maxScanAgeMs > 0 &&
+                   params.ssidListLen == 0 &&
+                   scanTypeSatisfies(mScan.scanType, params.scanType));
+
+  if (canServe) {
+    Nanoseconds scanTime(mScan.referenceTime);
+    Nanoseconds age = (now > scanTime) ? now - scanTime : Nanoseconds(0);
+    canServe = (age <= Milliseconds(params.maxScanAgeMs));
+  }
+
+  if (canServe && !mScan.scannedFrequencies.empty()) {
+    canServe = (params.frequencyListLen > 0);
+    for (uint16_t i = 0; canServe && i < params.frequencyListLen; i++) {
+      canServe = scannedFrequency(params.frequencyList[i]);
+    }
+  }
+
+  return canServe;
+}
+
+chreWifiScanEvent *WifiScanCache::createScanEvent(
+    const chreWifiScanParams &params) const {
+  CHRE_ASSERT(mHasScan);
+
+  size_t numResults = 0;
+  for (const chreWifiScanResult &result : mScan.results) {
+    if (resultMatchesFrequencies(result, params)) {
+      numResults++;
+    }
+  }
+
+  // The results and the scanned frequencies follow the event in the same
+  // allocation.
+  size_t resultsSize = numResults * sizeof(chreWifiScanResult);
+  size_t frequenciesSize = params.frequencyListLen * sizeof(uint32_t);
+  auto *event = static_cast<chreWifiScanEvent *>(
+      memoryAlloc(sizeof(chreWifiScanEvent) + resultsSize + frequenciesSize));
+  if (event == nullptr) {
+    LOG_OOM();
+  } else {
+    auto *results = reinterpret_cast<chreWifiScanResult *>(event + 1);
+    auto *frequencies = reinterpret_cast<uint32_t *>(&results[numResults]);
+
+    size_t resultIndex = 0;
+    for (const chreWifiScanResult &result : mScan.results) {
+      if (resultMatchesFrequencies(result, params)) {
+        results[resultIndex++] = result;
+      }
+    }
+    if (params.frequencyListLen > 0) {
+      memcpy(frequencies, params.frequencyList, frequenciesSize);
+    }
+
+    memset(event, 0, sizeof(chreWifiScanEvent));
+    event->version = CHRE_WIFI_SCAN_EVENT_VERSION;
+    event->resultCount = static_cast<uint8_t>(numResults);
+    event->resultTotal = static_cast<uint8_t>(numResults);
+    event->eventIndex = 0;
+    event->scanType = mScan.scanType;
+    event->ssidSetSize = 0;
+    event->scannedFreqListLen = params.frequencyListLen;
+    event->referenceTime = mScan.referenceTime;
+    event->scannedFreqList = (params.frequencyListLen > 0) ? frequencies
+                                                           : nullptr;
+    event->results = (numResults > 0) ? results : nullptr;
+    event->radioChainPref = mScan.radioChainPref;
+  }
+
+  return event;
+}
+
+bool WifiScanCache::scanTypeSatisfies(uint8_t scanType,
+                                      uint8_t requestedScanType) {
+  bool satisfies = false;
+  switch (requestedScanType) {
+    case CHRE_WIFI_SCAN_TYPE_PASSIVE:
+    case CHRE_WIFI_SCAN_TYPE_NO_PREFERENCE:
+      satisfies = true;
+      break;
+    case CHRE_WIFI_SCAN_TYPE_ACTIVE:
+      satisfies = (scanType == CHRE_WIFI_SCAN_TYPE_ACTIVE ||
+                   scanType == CHRE_WIFI_SCAN_TYPE_ACTIVE_PLUS_PASSIVE_DFS);
+      break;
+    case CHRE_WIFI_SCAN_TYPE_ACTIVE_PLUS_PASSIVE_DFS:
+      satisfies = (scanType == CHRE_WIFI_SCAN_TYPE_ACTIVE_PLUS_PASSIVE_DFS);
+      break;
+  }
+  return satisfies;
+}
+
+bool WifiScanCache::scannedFrequency(uint32_t frequency) const {
+  bool scanned = false;
+  for (uint32_t scannedFrequency : mScan.scannedFrequencies) {
+    if (scannedFrequency == frequency) {
+      scanned = true;
+      break;
+    }
+  }
+  return scanned;
+}
+
+bool WifiScanCache::resultMatchesFrequencies(const chreWifiScanResult &result,
+                                             const chreWifiScanParams &params) {
+  bool matches = (params.frequencyListLen == 0);
+  for (uint16_t i = 0; !matches && i < params.frequencyListLen; i++) {
+    matches = (result.primaryChannel == params.frequencyList[i]);
+  }
+  return matches;
+}
+
+}  // namespace chre
@@ -18,6 +18,12 @@ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
  fixed or floating point complex numbers.  It also delares the kf_ internal functions.
  */
 
+// CHRE modifications begin
+#ifdef CHRE_KISS_FFT_USE_SIMD
+#include "kiss_fft_simd.h"
+#endif
+// CHRE modifications end
+
 // CHRE modifications begin
 #if defined(__clang__)
 #pragma clang diagnostic push
@@ -37,6 +43,20 @@ static void kf_bfly2(
     kiss_fft_cpx * tw1 = st->twiddles;
     kiss_fft_cpx t;
     Fout2 = Fout + m;
+// CHRE modifications begin
+#ifdef CHRE_KISS_FFT_USE_SIMD
+    {
+        /* The scalar loop completes the butterflies the SIMD variant left. */
+        const int done = (int)kiss_fft_simd_bfly2(Fout, fstride, st, (size_t)m);
+        if (done == m)
+            return;
+        Fout += done;
+        Fout2 += done;
+        tw1 += fstride * (size_t)done;
+        m -= done;
+    }
+#endif
+// CHRE modifications end
     do{
         C_FIXDIV(*Fout,2); C_FIXDIV(*Fout2,2);
 
@@ -65,6 +85,22 @@ static void kf_bfly4(
 
     tw3 = tw2 = tw1 = st->twiddles;
 
+// CHRE modifications begin
+#ifdef CHRE_KISS_FFT_USE_SIMD
+    {
+        /* The scalar loop completes the butterflies the SIMD variant left. */
+        const size_t done = kiss_fft_simd_bfly4(Fout, fstride, st, m);
+        if (done == m)
+            return;
+        Fout += done;
+        tw1 += fstride * done;
+        tw2 += fstride * 2 * done;
+        tw3 += fstride * 3 * done;
+        k -= done;
+    }
+#endif
+// CHRE modifications end
+
     do {
         C_FIXDIV(*Fout,4); C_FIXDIV(Fout[m],4); C_FIXDIV(Fout[m2],4); C_FIXDIV(Fout[m3],4);
 
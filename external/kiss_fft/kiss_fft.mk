@@ -14,3 +14,18 @@ COMMON_CFLAGS += -DFIXED_POINT
 
 COMMON_SRCS += external/kiss_fft/kiss_fft.c
 COMMON_SRCS += external/kiss_fft/kiss_fftr.c
+
+# Simulator-specific Compiler Flags ############################################
+
+# Use the vectorized butterflies on the simulator targets.
+SIM_CFLAGS += -DCHRE_KISS_FFT_USE_SIMD
+
+# Simulator-specific Source Files ##############################################
+
+SIM_SRCS += external/kiss_fft/kiss_fft_simd.c
+
+# GoogleTest Source Files ######################################################
+
+GOOGLETEST_SRCS += external/kiss_fft/tests/kiss_fft_scalar.c
+GOOGLETEST_SRCS += external/kiss_fft/tests/kiss_fftr_scalar.c
+GOOGLETEST_SRCS += external/kiss_fft/tests/kiss_fft_simd_test.cc
@@ -0,0 +1,510 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "kiss_fft_simd.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#include "_kiss_fft_guts.h"
+
+/*
+ * Each vector holds complex values stored interleaved as in kiss_fft_cpx. The
+ * butterflies of a stage compute KF_SIMD_WIDTH consecutive values of k at
+ * once, and any remaining butterfly, as in the last stages where m is smaller
+ * than the vectors, is computed on its own with its four or two inputs held in
+ * one 128-bit vector. Every operation reproduces the scalar macros of
+ * _kiss_fft_guts.h exactly:
+ *
+ * - C_ADD and C_SUB wrap around on overflow, as the 16-bit vector additions
+ *   and subtractions do.
+ * - C_MUL sums its products in 32 bits, then rounds with sround() and
+ *   truncates the result to 16 bits.
+ * - C_FIXDIV multiplies by SAMP_MAX / div and rounds with sround(), which
+ *   always fits in 16 bits.
+ *
+ * The twiddles of consecutive values of k are fstride apart, so they are
+ * gathered into a vector.
+ */
+#if defined(FIXED_POINT) && (FIXED_POINT != 32)
+#if defined(__SSE2__)
+#define KF_SIMD_SSE2
+#include <emmintrin.h>
+#if defined(__AVX2__)
+#define KF_SIMD_AVX2
+#include <immintrin.h>
+#endif
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#define KF_SIMD_NEON
+#include <arm_neon.h>
+#endif
+#endif  // defined(FIXED_POINT) && (FIXED_POINT != 32)
+
+/*
+ * 128-bit vectors of four complex values.
+ */
+#if defined(KF_SIMD_SSE2)
+
+typedef __m128i kf_vec4;
+
+static inline kf_vec4 kf4_load(const kiss_fft_cpx *p) {
+  return _mm_loadu_si128((const __m128i *)(const void *)p);
+}
+
+static inline void kf4_store(kiss_fft_cpx *p, kf_vec4 v) {
+  _mm_storeu_si128((__m128i *)(void *)p, v);
+}
+
+//! Loads one complex value into the first lane, and zeroes the others.
+static inline kf_vec4 kf4_load_one(const kiss_fft_cpx *p) {
+  int32_t value;
+  memcpy(&value, p, sizeof(value));
+  return _mm_cvtsi32_si128(value);
+}
+
+//! Stores the complex value of the first lane.
+static inline void kf4_store_one(kiss_fft_cpx *p, kf_vec4 v) {
+  int32_t value = _mm_cvtsi128_si32(v);
+  memcpy(p, &value, sizeof(value));
+}
+
+//! @return [a0, b0, a1, b1]
+static inline kf_vec4 kf4_zip(kf_vec4 a, kf_vec4 b) {
+  return _mm_unpacklo_epi32(a, b);
+}
+
+//! @return [a0, a1, b0, b1]
+static inline kf_vec4 kf4_combine(kf_vec4 a, kf_vec4 b) {
+  return _mm_unpacklo_epi64(a, b);
+}
+
+//! @return [v2, v3, v2, v3]
+static inline kf_vec4 kf4_high(kf_vec4 v) {
+  return _mm_unpackhi_epi64(v, v);
+}
+
+//! @return [v1, v2, v3, any]
+static inline kf_vec4 kf4_next(kf_vec4 v) {
+  return _mm_srli_si128(v, 4);
+}
+
+//! @return [a0, b1, b2, b3]
+static inline kf_vec4 kf4_select_first(kf_vec4 a, kf_vec4 b) {
+  const __m128i firstMask = _mm_setr_epi32(-1, 0, 0, 0);
+  return _mm_or_si128(_mm_and_si128(firstMask, a),
+                      _mm_andnot_si128(firstMask, b));
+}
+
+static inline kf_vec4 kf4_dup0(kf_vec4 v) {
+  return _mm_shuffle_epi32(v, _MM_SHUFFLE(0, 0, 0, 0));
+}
+
+static inline kf_vec4 kf4_dup1(kf_vec4 v) {
+  return _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 1, 1, 1));
+}
+
+static inline kf_vec4 kf4_gather(const kiss_fft_cpx *p, size_t stride) {
+  return kf4_combine(kf4_zip(kf4_load_one(p), kf4_load_one(&p[stride])),
+                     kf4_zip(kf4_load_one(&p[2 * stride]),
+                             kf4_load_one(&p[3 * stride])));
+}
+
+static inline kf_vec4 kf4_add(kf_vec4 a, kf_vec4 b) {
+  return _mm_add_epi16(a, b);
+}
+
+static inline kf_vec4 kf4_sub(kf_vec4 a, kf_vec4 b) {
+  return _mm_sub_epi16(a, b);
+}
+
+static inline kf_vec4 kf4_negate(kf_vec4 v) {
+  return _mm_sub_epi16(_mm_setzero_si128(), v);
+}
+
+//! Swaps the real and imaginary parts.
+static inline kf_vec4 kf4_swap(kf_vec4 v) {
+  return _mm_shufflehi_epi16(_mm_shufflelo_epi16(v, _MM_SHUFFLE(2, 3, 0, 1)),
+                             _MM_SHUFFLE(2, 3, 0, 1));
+}
+
+static inline kf_vec4 kf4_negate_imag(kf_vec4 v) {
+  const __m128i imagMask = _mm_set1_epi32((int)0xffff0000u);
+  return _mm_sub_epi16(_mm_xor_si128(v, imagMask), imagMask);
+}
+
+//! sround(v * scale): the high half of v * 2 * scale, rounded with the top bit
+//! of the low half.
+static inline kf_vec4 kf4_fixdiv(kf_vec4 v, int16_t scale) {
+  const __m128i scale2 = _mm_set1_epi16((int16_t)(scale * 2));
+  return _mm_add_epi16(_mm_mulhi_epi16(v, scale2),
+                       _mm_srli_epi16(_mm_mullo_epi16(v, scale2), 15));
+}
+
+static inline kf_vec4 kf4_cmul(kf_vec4 a, kf_vec4 b) {
+  const __m128i round = _mm_set1_epi32(1 << (FRACBITS - 1));
+  __m128i re = _mm_madd_epi16(a, kf4_negate_imag(b));
+  __m128i im = _mm_madd_epi16(a, kf4_swap(b));
+  re = _mm_srai_epi32(_mm_add_epi32(re, round), FRACBITS);
+  im = _mm_srai_epi32(_mm_add_epi32(im, round), FRACBITS);
+  return _mm_or_si128(_mm_and_si128(re, _mm_set1_epi32(0xffff)),
+                      _mm_slli_epi32(im, 16));
+}
+
+#elif defined(KF_SIMD_NEON)
+
+typedef int16x8_t kf_vec4;
+
+static inline int32x4_t kf4_as_s32(kf_vec4 v) {
+  return vreinterpretq_s32_s16(v);
+}
+
+static inline kf_vec4 kf4_from_s32(int32x4_t v) {
+  return vreinterpretq_s16_s32(v);
+}
+
+static inline kf_vec4 kf4_load(const kiss_fft_cpx *p) {
+  return vld1q_s16((const int16_t *)(const void *)p);
+}
+
+static inline void kf4_store(kiss_fft_cpx *p, kf_vec4 v) {
+  vst1q_s16((int16_t *)(void *)p, v);
+}
+
+//! Loads one complex value into the first lane, and zeroes the others.
+static inline kf_vec4 kf4_load_one(const kiss_fft_cpx *p) {
+  return kf4_from_s32(
+      vld1q_lane_s32((const int32_t *)(const void *)p, vdupq_n_s32(0), 0));
+}
+
+//! Stores the complex value of the first lane.
+static inline void kf4_store_one(kiss_fft_cpx *p, kf_vec4 v) {
+  vst1q_lane_s32((int32_t *)(void *)p, kf4_as_s32(v), 0);
+}
+
+//! @return [a0, b0, a1, b1]
+static inline kf_vec4 kf4_zip(kf_vec4 a, kf_vec4 b) {
+  return kf4_from_s32(vzip1q_s32(kf4_as_s32(a), kf4_as_s32(b)));
+}
+
+//! @return [a0, a1, b0, b1]
+static inline kf_vec4 kf4_combine(kf_vec4 a, kf_vec4 b) {
+  return vcombine_s16(vget_low_s16(a), vget_low_s16(b));
+}
+
+//! @return [v2, v3, v2, v3]
+static inline kf_vec4 kf4_high(kf_vec4 v) {
+  return vcombine_s16(vget_high_s16(v), vget_high_s16(v));
+}
+
+//! @return [v1, v2, v3, any]
+static inline kf_vec4 kf4_next(kf_vec4 v) {
+  return kf4_from_s32(vextq_s32(kf4_as_s32(v), kf4_as_s32(v), 1));
+}
+
+//! @return [a0, b1, b2, b3]
+static inline kf_vec4 kf4_select_first(kf_vec4 a, kf_vec4 b) {
+  const uint32x4_t firstMask = vsetq_lane_u32(0xffffffffu, vdupq_n_u32(0), 0);
+  return vbslq_s16(vreinterpretq_u16_u32(firstMask), a, b);
+}
+
+static inline kf_vec4 kf4_dup0(kf_vec4 v) {
+  return kf4_from_s32(vdupq_laneq_s32(kf4_as_s32(v), 0));
+}
+
+static inline kf_vec4 kf4_dup1(kf_vec4 v) {
+  return kf4_from_s32(vdupq_laneq_s32(kf4_as_s32(v), 1));
+}
+
+static inline kf_vec4 kf4_gather(const kiss_fft_cpx *p, size_t stride) {
+  int32x4_t values = vdupq_n_s32(0);
+  values = vld1q_lane_s32((const int32_t *)(const void *)p, values, 0);
+  values =
+      vld1q_lane_s32((const int32_t *)(const void *)&p[stride], values, 1);
+  values =
+      vld1q_lane_s32((const int32_t *)(const void *)&p[2 * stride], values, 2);
+  values =
+      vld1q_lane_s32((const int32_t *)(const void *)&p[3 * stride], values, 3);
+  return kf4_from_s32(values);
+}
+
+static inline kf_vec4 kf4_add(kf_vec4 a, kf_vec4 b) {
+  return vaddq_s16(a, b);
+}
+
+static inline kf_vec4 kf4_sub(kf_vec4 a, kf_vec4 b) {
+  return vsubq_s16(a, b);
+}
+
+static inline kf_vec4 kf4_negate(kf_vec4 v) {
+  return vnegq_s16(v);
+}
+
+//! Swaps the real and imaginary parts.
+static inline kf_vec4 kf4_swap(kf_vec4 v) {
+  return vrev32q_s16(v);
+}
+
+static inline kf_vec4 kf4_negate_imag(kf_vec4 v) {
+  const int16x8_t imagMask = vreinterpretq_s16_u32(vdupq_n_u32(0xffff0000u));
+  return vsubq_s16(veorq_s16(v, imagMask), imagMask);
+}
+
+//! sround(v * scale), as (2 * v * scale + 2^15) >> 16.
+static inline kf_vec4 kf4_fixdiv(kf_vec4 v, int16_t scale) {
+  return vqrdmulhq_n_s16(v, scale);
+}
+
+static inline kf_vec4 kf4_cmul(kf_vec4 a, kf_vec4 b) {
+  int16x8_t bConj = kf4_negate_imag(b);
+  int16x8_t bSwap = kf4_swap(b);
+  int32x4_t re = vpaddq_s32(vmull_s16(vget_low_s16(a), vget_low_s16(bConj)),
+                            vmull_high_s16(a, bConj));
+  int32x4_t im = vpaddq_s32(vmull_s16(vget_low_s16(a), vget_low_s16(bSwap)),
+                            vmull_high_s16(a, bSwap));
+  int16x4x2_t result =
+      vzip_s16(vrshrn_n_s32(re, FRACBITS), vrshrn_n_s32(im, FRACBITS));
+  return vcombine_s16(result.val[0], result.val[1]);
+}
+
+#endif
+
+/*
+ * The widest vectors of the target, used for consecutive values of k.
+ */
+#if defined(KF_SIMD_AVX2)
+
+#define KF_SIMD_WIDTH 8
+typedef __m256i kf_vec;
+typedef __m256i kf_index;
+
+static inline kf_vec kf_load(const kiss_fft_cpx *p) {
+  return _mm256_loadu_si256((const __m256i *)(const void *)p);
+}
+
+static inline void kf_store(kiss_fft_cpx *p, kf_vec v) {
+  _mm256_storeu_si256((__m256i *)(void *)p, v);
+}
+
+static inline kf_index kf_gather_index(size_t stride) {
+  return _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7),
+                            _mm256_set1_epi32((int)stride));
+}
+
+static inline kf_vec kf_gather(const kiss_fft_cpx *tw, kf_index index) {
+  return _mm256_i32gather_epi32((const int *)(const void *)tw, index, 4);
+}
+
+static inline kf_vec kf_add(kf_vec a, kf_vec b) {
+  return _mm256_add_epi16(a, b);
+}
+
+static inline kf_vec kf_sub(kf_vec a, kf_vec b) {
+  return _mm256_sub_epi16(a, b);
+}
+
+static inline kf_vec kf_swap(kf_vec v) {
+  return _mm256_shufflehi_epi16(
+      _mm256_shufflelo_epi16(v, _MM_SHUFFLE(2, 3, 0, 1)),
+      _MM_SHUFFLE(2, 3, 0, 1));
+}
+
+static inline kf_vec kf_negate_imag(kf_vec v) {
+  const __m256i imagMask = _mm256_set1_epi32((int)0xffff0000u);
+  return _mm256_sub_epi16(_mm256_xor_si256(v, imagMask), imagMask);
+}
+
+static inline kf_vec kf_fixdiv(kf_vec v, int16_t scale) {
+  const __m256i scale2 = _mm256_set1_epi16((int16_t)(scale * 2));
+  return _mm256_add_epi16(
+      _mm256_mulhi_epi16(v, scale2),
+      _mm256_srli_epi16(_mm256_mullo_epi16(v, scale2), 15));
+}
+
+static inline kf_vec kf_cmul(kf_vec a, kf_vec b) {
+  const __m256i round = _mm256_set1_epi32(1 << (FRACBITS - 1));
+  __m256i re = _mm256_madd_epi16(a, kf_negate_imag(b));
+  __m256i im = _mm256_madd_epi16(a, kf_swap(b));
+  re = _mm256_srai_epi32(_mm256_add_epi32(re, round), FRACBITS);
+  im = _mm256_srai_epi32(_mm256_add_epi32(im, round), FRACBITS);
+  return _mm256_or_si256(
+      _mm256_and_si256(re, _mm256_set1_epi32(0xffff)),
+      _mm256_slli_epi32(im, 16));
+}
+
+#elif defined(KF_SIMD_SSE2) || defined(KF_SIMD_NEON)
+
+#define KF_SIMD_WIDTH 4
+typedef kf_vec4 kf_vec;
+typedef size_t kf_index;
+
+#define kf_load kf4_load
+#define kf_store kf4_store
+#define kf_gather kf4_gather
+#define kf_add kf4_add
+#define kf_sub kf4_sub
+#define kf_swap kf4_swap
+#define kf_negate_imag kf4_negate_imag
+#define kf_fixdiv kf4_fixdiv
+#define kf_cmul kf4_cmul
+
+static inline kf_index kf_gather_index(size_t stride) {
+  return stride;
+}
+
+#endif
+
+#ifdef KF_SIMD_WIDTH
+
+/**
+ * Computes one radix-2 butterfly, with its inputs in the first two lanes.
+ */
+static inline void kf_bfly2_one(kiss_fft_cpx *Fout, size_t m,
+                                const kiss_fft_cpx *tw) {
+  kf_vec4 twiddle = kf4_load_one(tw);
+  kf_vec4 f = kf4_zip(kf4_load_one(Fout), kf4_load_one(&Fout[m]));
+  f = kf4_fixdiv(f, SAMP_MAX / 2);
+
+  kf_vec4 t = kf4_dup1(kf4_cmul(f, kf4_zip(twiddle, twiddle)));
+  kf_vec4 f0 = kf4_dup0(f);
+  kf_vec4 out = kf4_zip(kf4_add(f0, t), kf4_sub(f0, t));
+  kf4_store_one(Fout, out);
+  kf4_store_one(&Fout[m], kf4_next(out));
+}
+
+/**
+ * Computes one radix-4 butterfly, with its inputs in the four lanes.
+ */
+static inline void kf_bfly4_one(kiss_fft_cpx *Fout, size_t m,
+                                const kiss_fft_cpx *tw1,
+                                const kiss_fft_cpx *tw2,
+                                const kiss_fft_cpx *tw3, int inverse) {
+  kf_vec4 f = (m == 1) ? kf4_load(Fout) : kf4_gather(Fout, m);
+  f = kf4_fixdiv(f, SAMP_MAX / 4);
+  kf_vec4 tw = kf4_combine(kf4_zip(kf4_load_one(tw1), kf4_load_one(tw1)),
+                           kf4_zip(kf4_load_one(tw2), kf4_load_one(tw3)));
+
+  // [f0, s0, s1, s2] with the scratch values of kf_bfly4().
+  kf_vec4 v = kf4_select_first(f, kf4_cmul(f, tw));
+  kf_vec4 high = kf4_high(v);
+  // [f0 + s1, s3] and [s5, s0 - s2].
+  kf_vec4 sum = kf4_add(v, high);
+  kf_vec4 diff = kf4_sub(v, high);
+  // (s0 - s2) multiplied by -i, or by i for the inverse FFT.
+  kf_vec4 rotated = kf4_negate_imag(kf4_swap(diff));
+  if (inverse) {
+    rotated = kf4_negate(rotated);
+  }
+
+  kf_vec4 x = kf4_zip(sum, diff);
+  kf_vec4 y = kf4_zip(kf4_next(sum), kf4_next(rotated));
+  kf_vec4 out = kf4_combine(kf4_add(x, y), kf4_sub(x, y));
+  if (m == 1) {
+    kf4_store(Fout, out);
+  } else {
+    for (size_t i = 0; i < 4; i++) {
+      kf4_store_one(&Fout[i * m], out);
+      out = kf4_next(out);
+    }
+  }
+}
+
+size_t kiss_fft_simd_bfly2(kiss_fft_cpx *Fout, size_t fstride,
+                           const struct kiss_fft_state *st, size_t m) {
+  const size_t count = m - m % KF_SIMD_WIDTH;
+  const kf_index twIndex = kf_gather_index(fstride);
+  kiss_fft_cpx *Fout2 = Fout + m;
+
+  for (size_t k = 0; k < count; k += KF_SIMD_WIDTH) {
+    kf_vec f0 = kf_fixdiv(kf_load(&Fout[k]), SAMP_MAX / 2);
+    kf_vec f1 = kf_fixdiv(kf_load(&Fout2[k]), SAMP_MAX / 2);
+    kf_vec t = kf_cmul(f1, kf_gather(&st->twiddles[k * fstride], twIndex));
+    kf_store(&Fout2[k], kf_sub(f0, t));
+    kf_store(&Fout[k], kf_add(f0, t));
+  }
+
+  for (size_t k = count; k < m; k++) {
+    kf_bfly2_one(&Fout[k], m, &st->twiddles[k * fstride]);
+  }
+
+  return m;
+}
+
+size_t kiss_fft_simd_bfly4(kiss_fft_cpx *Fout, size_t fstride,
+                           const struct kiss_fft_state *st, size_t m) {
+  const size_t count = m - m % KF_SIMD_WIDTH;
+  const kf_index tw1Index = kf_gather_index(fstride);
+  const kf_index tw2Index = kf_gather_index(fstride * 2);
+  const kf_index tw3Index = kf_gather_index(fstride * 3);
+
+  for (size_t k = 0; k < count; k += KF_SIMD_WIDTH) {
+    kf_vec f0 = kf_fixdiv(kf_load(&Fout[k]), SAMP_MAX / 4);
+    kf_vec f1 = kf_fixdiv(kf_load(&Fout[k + m]), SAMP_MAX / 4);
+    kf_vec f2 = kf_fixdiv(kf_load(&Fout[k + 2 * m]), SAMP_MAX / 4);
+    kf_vec f3 = kf_fixdiv(kf_load(&Fout[k + 3 * m]), SAMP_MAX / 4);
+
+    kf_vec s0 = kf_cmul(f1, kf_gather(&st->twiddles[k * fstride], tw1Index));
+    kf_vec s1 =
+        kf_cmul(f2, kf_gather(&st->twiddles[k * fstride * 2], tw2Index));
+    kf_vec s2 =
+        kf_cmul(f3, kf_gather(&st->twiddles[k * fstride * 3], tw3Index));
+
+    kf_vec s5 = kf_sub(f0, s1);
+    f0 = kf_add(f0, s1);
+    kf_vec s3 = kf_add(s0, s2);
+    // (s0 - s2) multiplied by -i.
+    kf_vec s4 = kf_negate_imag(kf_swap(kf_sub(s0, s2)));
+
+    kf_store(&Fout[k + 2 * m], kf_sub(f0, s3));
+    kf_store(&Fout[k], kf_add(f0, s3));
+    if (st->inverse) {
+      kf_store(&Fout[k + m], kf_sub(s5, s4));
+      kf_store(&Fout[k + 3 * m], kf_add(s5, s4));
+    } else {
+      kf_store(&Fout[k + m], kf_add(s5, s4));
+      kf_store(&Fout[k + 3 * m], kf_sub(s5, s4));
+    }
+  }
+
+  for (size_t k = count; k < m; k++) {
+    kf_bfly4_one(&Fout[k], m, &st->twiddles[k * fstride],
+                 &st->twiddles[k * fstride * 2],
+                 &st->twiddles[k * fstride * 3], st->inverse);
+  }
+
+  return m;
+}
+
+#else  // KF_SIMD_WIDTH
+
+size_t kiss_fft_simd_bfly2(kiss_fft_cpx *Fout, size_t fstride,
+                           const struct kiss_fft_state *st, size_t m) {
+  (void)Fout;
+  (void)fstride;
+  (void)st;
+  (void)m;
+  return 0;
+}
+
+size_t kiss_fft_simd_bfly4(kiss_fft_cpx *Fout, size_t fstride,
+                           const struct kiss_fft_state *st, size_t m) {
+  (void)Fout;
+  (void)fstride;
+  (void)st;
+  (void)m;
+  return 0;
+}
+
+#endif  // KF_SIMD_WIDTH
@@ -0,0 +1,68 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef KISS_FFT_SIMD_H
+#define KISS_FFT_SIMD_H
+
+/**
+ * Vectorized radix-2 and radix-4 butterflies of the 16-bit fixed-point
+ * kiss_fft, used by kiss_fft.c when built with CHRE_KISS_FFT_USE_SIMD.
+ *
+ * The butterflies produce the same output as the scalar ones, bit for bit, so
+ * that the variant can be enabled without changing the results of kiss_fft()
+ * and kiss_fftr(). They use AVX2 when the compiler targets it, SSE2 on other
+ * x86-64 targets and NEON on AArch64. On any other target, or when kiss_fft is
+ * not built with 16-bit FIXED_POINT, they process nothing and the scalar
+ * butterflies do all the work.
+ */
+
+#include <stddef.h>
+
+#include "kiss_fft.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct kiss_fft_state;
+
+/**
+ * Computes the butterflies of kf_bfly2() with vectors.
+ *
+ * @param Fout The output of the stage, as passed to kf_bfly2().
+ * @param fstride The twiddle stride of the stage.
+ * @param st The FFT configuration.
+ * @param m The number of butterflies of the stage.
+ * @return The number of butterflies computed: m, or 0 on targets without a
+ *     vectorized implementation, the scalar implementation then completing the
+ *     stage starting from that index.
+ */
+size_t kiss_fft_simd_bfly2(kiss_fft_cpx *Fout, size_t fstride,
+                           const struct kiss_fft_state *st, size_t m);
+
+/**
+ * Computes the butterflies of kf_bfly4() with vectors.
+ *
+ * @see kiss_fft_simd_bfly2
+ */
+size_t kiss_fft_simd_bfly4(kiss_fft_cpx *Fout, size_t fstride,
+                           const struct kiss_fft_state *st, size_t m);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // KISS_FFT_SIMD_H
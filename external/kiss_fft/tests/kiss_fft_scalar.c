@@ -0,0 +1,26 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Compiles kiss_fft.c without the SIMD variant, under the names declared in
+// kiss_fft_scalar.h.
+#undef CHRE_KISS_FFT_USE_SIMD
+#define kiss_fft_alloc scalar_kiss_fft_alloc
+#define kiss_fft scalar_kiss_fft
+#define kiss_fft_stride scalar_kiss_fft_stride
+#define kiss_fft_cleanup scalar_kiss_fft_cleanup
+#define kiss_fft_next_fast_size scalar_kiss_fft_next_fast_size
+
+#include "../kiss_fft.c"
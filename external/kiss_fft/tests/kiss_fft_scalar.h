@@ -0,0 +1,51 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef KISS_FFT_SCALAR_H
+#define KISS_FFT_SCALAR_H
+
+/**
+ * The scalar build of kiss_fft, compiled under different names so that it can
+ * be linked alongside the SIMD variant, to validate and benchmark it.
+ */
+
+#include "kiss_fft.h"
+#include "kiss_fftr.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+kiss_fft_cfg scalar_kiss_fft_alloc(int nfft, int inverse_fft, void *mem,
+                                   size_t *lenmem);
+
+void scalar_kiss_fft(kiss_fft_cfg cfg, const kiss_fft_cpx *fin,
+                     kiss_fft_cpx *fout);
+
+kiss_fftr_cfg scalar_kiss_fftr_alloc(int nfft, int inverse_fft, void *mem,
+                                     size_t *lenmem);
+
+void scalar_kiss_fftr(kiss_fftr_cfg cfg, const kiss_fft_scalar *timedata,
+                      kiss_fft_cpx *freqdata);
+
+void scalar_kiss_fftri(kiss_fftr_cfg cfg, const kiss_fft_cpx *freqdata,
+                       kiss_fft_scalar *timedata);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // KISS_FFT_SCALAR_H
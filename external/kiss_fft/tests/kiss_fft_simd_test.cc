@@ -0,0 +1,141 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "gtest/gtest.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+#include "kiss_fft.h"
+#include "kiss_fft_scalar.h"
+#include "kiss_fftr.h"
+
+namespace {
+
+//! The real FFT sizes used by the audio nanoapps and the audio feature
+//! extraction, and some around them.
+constexpr int kRealFftSizes[] = {32, 64, 128, 256, 512, 1024, 2048};
+
+//! Complex FFT sizes with every radix, so that the vectorized stages are
+//! mixed with the scalar radix-3, radix-5 and generic ones.
+constexpr int kComplexFftSizes[] = {4,  8,  12,  16,  24,  40,
+                                   60, 96, 250, 256, 1000};
+
+//! Pseudo-random full scale samples, reproducible across runs.
+std::vector<int16_t> makeRandomSamples(size_t numSamples, uint32_t seed) {
+  std::vector<int16_t> samples(numSamples);
+  for (int16_t &sample : samples) {
+    seed = seed * 1664525 + 1013904223;
+    sample = static_cast<int16_t>(seed >> 16);
+  }
+  return samples;
+}
+
+void expectSameSpectrum(const std::vector<kiss_fft_cpx> &expected,
+                        const std::vector<kiss_fft_cpx> &actual, int nfft) {
+  ASSERT_EQ(expected.size(), actual.size());
+  for (size_t i = 0; i < expected.size(); i++) {
+    EXPECT_EQ(expected[i].r, actual[i].r) << "nfft " << nfft << " bin " << i;
+    EXPECT_EQ(expected[i].i, actual[i].i) << "nfft " << nfft << " bin " << i;
+  }
+}
+
+void expectRealFftMatchesScalar(int nfft, const std::vector<int16_t> &input) {
+  kiss_fftr_cfg config =
+      kiss_fftr_alloc(nfft, 0 /* inverse_fft */, nullptr, nullptr);
+  kiss_fftr_cfg scalarConfig =
+      scalar_kiss_fftr_alloc(nfft, 0 /* inverse_fft */, nullptr, nullptr);
+  ASSERT_NE(config, nullptr);
+  ASSERT_NE(scalarConfig, nullptr);
+
+  std::vector<kiss_fft_cpx> spectrum(nfft / 2 + 1);
+  std::vector<kiss_fft_cpx> scalarSpectrum(nfft / 2 + 1);
+  kiss_fftr(config, input.data(), spectrum.data());
+  scalar_kiss_fftr(scalarConfig, input.data(), scalarSpectrum.data());
+  expectSameSpectrum(scalarSpectrum, spectrum, nfft);
+
+  kiss_fftr_free(config);
+  kiss_fftr_free(scalarConfig);
+}
+
+}  // namespace
+
+TEST(KissFftSimd, RealFftMatchesScalarBuild) {
+  for (int nfft : kRealFftSizes) {
+    expectRealFftMatchesScalar(nfft, makeRandomSamples(nfft, nfft));
+  }
+}
+
+TEST(KissFftSimd, RealFftMatchesScalarBuildAtFullScale) {
+  for (int nfft : kRealFftSizes) {
+    expectRealFftMatchesScalar(nfft, std::vector<int16_t>(nfft, INT16_MIN));
+    expectRealFftMatchesScalar(nfft, std::vector<int16_t>(nfft, INT16_MAX));
+
+    std::vector<int16_t> alternating(nfft);
+    for (int i = 0; i < nfft; i++) {
+      alternating[i] = (i % 2 == 0) ? INT16_MAX : INT16_MIN;
+    }
+    expectRealFftMatchesScalar(nfft, alternating);
+  }
+}
+
+TEST(KissFftSimd, InverseRealFftMatchesScalarBuild) {
+  for (int nfft : kRealFftSizes) {
+    kiss_fftr_cfg config = kiss_fftr_alloc(nfft, 1 /* inverse_fft */, nullptr,
+                                           nullptr);
+    kiss_fftr_cfg scalarConfig =
+        scalar_kiss_fftr_alloc(nfft, 1 /* inverse_fft */, nullptr, nullptr);
+    ASSERT_NE(config, nullptr);
+    ASSERT_NE(scalarConfig, nullptr);
+
+    std::vector<int16_t> random = makeRandomSamples(nfft + 2, nfft);
+    const auto *spectrum =
+        reinterpret_cast<const kiss_fft_cpx *>(random.data());
+    std::vector<int16_t> output(nfft);
+    std::vector<int16_t> scalarOutput(nfft);
+    kiss_fftri(config, spectrum, output.data());
+    scalar_kiss_fftri(scalarConfig, spectrum, scalarOutput.data());
+    EXPECT_EQ(scalarOutput, output) << "nfft " << nfft;
+
+    kiss_fftr_free(config);
+    kiss_fftr_free(scalarConfig);
+  }
+}
+
+TEST(KissFftSimd, ComplexFftMatchesScalarBuild) {
+  for (int inverse = 0; inverse <= 1; inverse++) {
+    for (int nfft : kComplexFftSizes) {
+      kiss_fft_cfg config = kiss_fft_alloc(nfft, inverse, nullptr, nullptr);
+      kiss_fft_cfg scalarConfig =
+          scalar_kiss_fft_alloc(nfft, inverse, nullptr, nullptr);
+      ASSERT_NE(config, nullptr);
+      ASSERT_NE(scalarConfig, nullptr);
+
+      std::vector<int16_t> random = makeRandomSamples(2 * nfft, nfft);
+      const auto *input =
+          reinterpret_cast<const kiss_fft_cpx *>(random.data());
+      std::vector<kiss_fft_cpx> output(nfft);
+      std::vector<kiss_fft_cpx> scalarOutput(nfft);
+      kiss_fft(config, input, output.data());
+      scalar_kiss_fft(scalarConfig, input, scalarOutput.data());
+      expectSameSpectrum(scalarOutput, output, nfft);
+
+      kiss_fft_free(config);
+      kiss_fft_free(scalarConfig);
+    }
+  }
+}
@@ -0,0 +1,25 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Compiles kiss_fftr.c on top of the scalar kiss_fft, under the names declared
+// in kiss_fft_scalar.h.
+#define kiss_fft_alloc scalar_kiss_fft_alloc
+#define kiss_fft scalar_kiss_fft
+#define kiss_fftr_alloc scalar_kiss_fftr_alloc
+#define kiss_fftr scalar_kiss_fftr
+#define kiss_fftri scalar_kiss_fftri
+
+#include "../kiss_fftr.c"
@@ -2639,7 +2639,9 @@ struct LogMessageV2 FLATBUFFERS_FINAL_CLASS : private flatbuffers::Table {
   /// uint8_t                 - Log metadata, encoded as follows:
   ///                           [EI(Upper nibble) | Level(Lower nibble)]
   ///                            * EI: Encoding indicator (eg: via tokenization)
-  ///                              (0 = No encoding, 1 = Tokenized log)
+  ///                              (0 = No encoding, 1 = Tokenized log,
+  ///                               2 = Deferred formatting, see
+  ///                               log_format_common.h)
   ///                            * LogBuffer log level (1 = error, 2 = warn,
   ///                                                   3 = info,  4 = debug,
   ///                                                   5 = verbose)
@@ -0,0 +1,108 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CHRE_HOST_LOG_FORMAT_TABLE_H_
+#define CHRE_HOST_LOG_FORMAT_TABLE_H_
+
+#include <cinttypes>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace android {
+namespace chre {
+
+/**
+ * Maps the format string hashes sent by CHRE in logs with deferred formatting
+ * to the format strings, and formats these logs. See log_format_common.h for
+ * the encoding.
+ *
+ * The table is built from the format strings that the CHRE log macros place
+ * in the CHRE_LOG_FORMAT_SECTION section. If two different format strings
+ * have the same hash, logs with that hash are reported as unknown rather than
+ * formatted with the wrong string.
+ */
+class LogFormatTable {
+ public:
+  /**
+   * Adds the format strings found in a file to the table. The file is either
+   * the CHRE ELF binary, in which case the strings of its
+   * CHRE_LOG_FORMAT_SECTION section are added, or that section extracted with
+   * objcopy -O binary, i.e. libchre_log_formats.bin.
+   *
+   * @param path The path of the file to read.
+   * @return true if the file was read and parsed.
+   */
+  bool loadFromFile(const char *path);
+
+  /**
+   * Adds the null-terminated format strings in a buffer to the table.
+   *
+   * @param data A buffer of null-terminated format strings.
+   * @param size The size of data in bytes.
+   */
+  void addStrings(const char *data, size_t size);
+
+  /**
+   * @param formatHash The hash of a format string, see hashLogFormat().
+   * @return The format string with the given hash, or nullptr if it isn't in
+   *         the table or several format strings have that hash.
+   */
+  const char *lookup(uint32_t formatHash) const;
+
+  /**
+   * @return The number of hashes indexed by the table.
+   */
+  size_t size() const {
+    return mOffsets.size();
+  }
+
+  /**
+   * Formats a log from its format string and packed arguments.
+   *
+   * @param format The format string.
+   * @param args The packed arguments.
+   * @param argsSize The size of args in bytes.
+   * @param log Non-null pointer to a string that the formatted log is appended
+   *        to.
+   * @return true if all arguments were decoded. On false, log holds the part
+   *         of the message that could be formatted.
+   */
+  static bool formatLog(const char *format, const uint8_t *args,
+                        size_t argsSize, std::string *log);
+
+ private:
+  //! The offset of hashes shared by different format strings.
+  static constexpr size_t kAmbiguousOffset = SIZE_MAX;
+
+  //! Returns true if the data is an ELF file, whose strings were added.
+  bool addElfStrings(const std::vector<uint8_t> &data);
+
+  //! Indexes a format string, marking its hash ambiguous on a collision.
+  void addString(const char *str);
+
+  //! Every string added to the table, each followed by a null terminator.
+  std::vector<char> mStrings;
+
+  //! Maps the hash of a string to its offset in mStrings, or to
+  //! kAmbiguousOffset.
+  std::unordered_map<uint32_t, size_t> mOffsets;
+};
+
+}  // namespace chre
+}  // namespace android
+
+#endif  // CHRE_HOST_LOG_FORMAT_TABLE_H_
@@ -21,6 +21,7 @@
 #include <cinttypes>
 #include <memory>
 #include "chre/util/time.h"
+#include "chre_host/log_format_table.h"
 
 #include <android/log.h>
 
@@ -44,7 +45,8 @@ class LogMessageParser {
 
   /**
    * Initializes the log message parser by reading the log token database,
-   * and instantiates a detokenizer to handle encoded log messages.
+   * and instantiates a detokenizer to handle encoded log messages. Also loads
+   * the format strings used to decode logs with deferred formatting.
    */
   void init();
 
@@ -107,6 +109,9 @@ class LogMessageParser {
 
   std::unique_ptr<Detokenizer> mDetokenizer;
 
+  //! Format strings of logs with deferred formatting.
+  LogFormatTable mLogFormatTable;
+
   static android_LogPriority chreLogLevelToAndroidLogPriority(uint8_t level);
 
   void updateAndPrintDroppedLogs(uint32_t numLogsDropped);
@@ -124,6 +129,15 @@ class LogMessageParser {
    */
   size_t parseAndEmitTokenizedLogMessageAndGetSize(const LogMessageV2 *message);
 
+  /**
+   * Formats and emits a log message with deferred formatting while also
+   * returning the size of the parsed message for buffer index bookkeeping.
+   *
+   * @return Size of the encoded log message payload, including the 1 byte
+   * size header.
+   */
+  size_t parseAndEmitDeferredLogMessageAndGetSize(const LogMessageV2 *message);
+
   void emitLogMessage(uint8_t level, uint32_t timestampMillis,
                       const char *logMessage);
 
@@ -149,14 +163,14 @@ class LogMessageParser {
   inline uint8_t getLogLevelFromMetadata(uint8_t metadata);
 
   /**
-   * Helper function to check the metadata whether the log message was encoded.
+   * Helper function to get the encoding of the log message from its metadata.
    *
    * @param metadata A byte from the log message payload containing the
    *        log level and encoding information.
    *
-   * @return true if an encoding was used on the log message payload.
+   * @return The encoding indicator, 0 if the log message payload is a string.
    */
-  inline bool isLogMessageEncoded(uint8_t metadata);
+  inline uint8_t getLogEncodingFromMetadata(uint8_t metadata);
 };
 
 }  // namespace chre
@@ -17,11 +17,11 @@
 #ifndef CHRE_HOST_SOCKET_SERVER_H_
 #define CHRE_HOST_SOCKET_SERVER_H_
 
-#include <poll.h>
-
 #include <atomic>
+#include <deque>
 #include <functional>
 #include <map>
+#include <memory>
 #include <mutex>
 #include <vector>
 
@@ -34,6 +34,7 @@ namespace chre {
 class SocketServer {
  public:
   SocketServer();
+  ~SocketServer();
 
   /**
    * Defines the function signature of the callback given to run() which
@@ -62,7 +63,26 @@ class SocketServer {
            ClientMessageCallback clientMessageCallback);
 
   /**
-   * Delivers data to all connected clients. This method is thread-safe.
+   * Same as run(), but services an already-created SOCK_SEQPACKET socket
+   * instead of resolving one by name. The socket is closed before returning.
+   *
+   * @param socketFd The socket to listen on
+   * @param clientMessageCallback Callback to be invoked when a message is
+   *        received from a client
+   */
+  void runWithSocket(int socketFd, ClientMessageCallback clientMessageCallback);
+
+  /**
+   * Requests that the receive loop started by run() exits, as if SIGINT had
+   * been received. This method is thread-safe.
+   */
+  void stop();
+
+  /**
+   * Delivers data to all connected clients. This method is thread-safe and
+   * never blocks on a client: data that can't be written immediately is
+   * copied once into a buffer shared by the outbound queues of every client
+   * that is behind.
    *
    * @param data Pointer to buffer containing message data
    * @param length Number of bytes of data to send
@@ -71,16 +91,26 @@ class SocketServer {
 
   /**
    * Sends a message to one client, specified via its unique client ID. This
-   * method is thread-safe.
+   * method is thread-safe and never blocks on the client.
    *
    * @param data
    * @param length
    * @param clientId
    *
-   * @return true if the message was successfully sent to the specified client
+   * @return true if the message was sent or queued for the specified client,
+   *         false if the client doesn't exist, its socket is in error, or its
+   *         outbound queue is full
    */
   bool sendToClientById(const void *data, size_t length, uint16_t clientId);
 
+  /**
+   * @return The total number of messages dropped across all clients because
+   *         their outbound queue was full. This method is thread-safe.
+   */
+  uint64_t getDroppedMessageCount() const {
+    return mDroppedMessageCount;
+  }
+
  private:
   DISALLOW_COPY_AND_ASSIGN(SocketServer);
 
@@ -89,13 +119,46 @@ class SocketServer {
       static_cast<int>(kMaxActiveClients);
   static constexpr size_t kMaxPacketSize = 1024 * 1024;
 
+  //! Bounds on the data waiting to be written to a single client. Messages
+  //! that would exceed either bound are dropped for that client only.
+  static constexpr size_t kMaxQueuedPacketsPerClient = 64;
+  static constexpr size_t kMaxQueuedBytesPerClient = 2 * kMaxPacketSize;
+
+  //! Maximum number of epoll events handled per loop iteration.
+  static constexpr int kMaxEpollEvents = 1 + kMaxActiveClients;
+
+  //! An immutable message buffer that can be queued for several clients.
+  typedef std::shared_ptr<const std::vector<uint8_t>> SharedBuffer;
+
+  enum class SendResult {
+    kSent,
+    kQueued,
+    kDropped,
+    kFailed,
+  };
+
   int mSockFd = INVALID_SOCKET;
+  int mEpollFd = -1;
+  //! eventfd used by stop() to wake up the receive loop. Lives as long as the
+  //! SocketServer so that stop() never races with it being closed.
+  int mWakeFd = -1;
   uint16_t mNextClientId = 1;
-  // TODO: std::vector-ify this
-  struct pollfd mPollFds[1 + kMaxActiveClients] = {};
 
   struct ClientData {
     uint16_t clientId;
+
+    //! Messages that couldn't be written without blocking, oldest first.
+    std::deque<SharedBuffer> sendQueue;
+
+    //! Sum of the sizes of the messages in sendQueue.
+    size_t queuedBytes = 0;
+
+    //! Number of messages dropped for this client since its queue last
+    //! drained.
+    uint32_t droppedCount = 0;
+
+    //! true if EPOLLOUT is currently requested for this client's socket.
+    bool writeWatched = false;
   };
 
   // Maps from socket FD to ClientData
@@ -105,17 +168,48 @@ class SocketServer {
   // the stack.
   std::vector<uint8_t> mRecvBuffer = std::vector<uint8_t>(kMaxPacketSize);
 
-  // Ensures that mClients can be safely iterated over from other threads
-  // without worrying about potential modification from the RX thread
+  // Ensures that mClients and the per-client send queues can be safely
+  // accessed from other threads without worrying about potential modification
+  // from the RX thread. Nothing blocks while holding this lock.
   std::mutex mClientsMutex;
 
+  std::atomic<uint64_t> mDroppedMessageCount{0};
+
+  //! Set by stop() to make the receive loop exit.
+  std::atomic<bool> mStopRequested{false};
+
   ClientMessageCallback mClientMessageCallback;
 
   void acceptClientConnection();
   void disconnectClient(int clientSocket);
   void handleClientData(int clientSocket);
-  bool sendToClientSocket(const void *data, size_t length, int clientSocket,
-                          uint16_t clientId);
+
+  /**
+   * Writes a message to a client without blocking, or appends it to the
+   * client's send queue if the socket is full or older messages are already
+   * waiting. Must be called with mClientsMutex held.
+   *
+   * @param sharedBuffer Lazily populated with a copy of data the first time a
+   *        message needs to be queued, so that a broadcast copies its payload
+   *        at most once regardless of how many clients are behind
+   */
+  SendResult sendOrQueueLocked(const void *data, size_t length,
+                               int clientSocket, ClientData &client,
+                               SharedBuffer &sharedBuffer);
+
+  /**
+   * Writes as much of a client's send queue as its socket accepts. Called
+   * from the RX thread when the socket becomes writable.
+   */
+  void flushSendQueue(int clientSocket);
+
+  /**
+   * Enables or disables EPOLLOUT notifications for a client socket. Must be
+   * called with mClientsMutex held.
+   */
+  void setWriteWatchedLocked(int clientSocket, ClientData &client,
+                             bool watched);
+
   void serviceSocket();
 
   static std::atomic<bool> sSignalReceived;
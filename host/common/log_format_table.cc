@@ -0,0 +1,326 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "chre_host/log_format_table.h"
+
+#include <elf.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+#include "chre/platform/shared/log_format_common.h"
+#include "chre_host/log.h"
+
+using ::chre::decodeLogVarint;
+using ::chre::hashLogFormat;
+using ::chre::kLogMaxStringArgLength;
+using ::chre::kLogStringArgTruncated;
+using ::chre::LogArgLength;
+using ::chre::LogArgType;
+using ::chre::LogFormatConversion;
+using ::chre::parseLogFormatConversion;
+using ::chre::zigzagDecode;
+
+namespace android {
+namespace chre {
+
+namespace {
+
+/**
+ * Calls addStrings with the content of the CHRE_LOG_FORMAT_SECTION section of
+ * an ELF file of the given class.
+ */
+template <typename ElfEhdr, typename ElfShdr>
+void addFormatSection(const std::vector<uint8_t> &data,
+                      LogFormatTable *table) {
+  if (data.size() < sizeof(ElfEhdr)) {
+    LOGE("Truncated ELF header");
+    return;
+  }
+  const auto *header = reinterpret_cast<const ElfEhdr *>(data.data());
+  size_t sectionsEnd = header->e_shoff +
+                       static_cast<size_t>(header->e_shnum) * sizeof(ElfShdr);
+  if (header->e_shentsize != sizeof(ElfShdr) || sectionsEnd > data.size() ||
+      header->e_shstrndx >= header->e_shnum) {
+    LOGE("Malformed ELF section header table");
+    return;
+  }
+
+  const auto *sections =
+      reinterpret_cast<const ElfShdr *>(&data[header->e_shoff]);
+  const ElfShdr &names = sections[header->e_shstrndx];
+  if (names.sh_offset + names.sh_size > data.size()) {
+    LOGE("Malformed ELF section names");
+    return;
+  }
+  const char *namesData =
+      reinterpret_cast<const char *>(&data[names.sh_offset]);
+  for (size_t i = 0; i < header->e_shnum; i++) {
+    const ElfShdr &section = sections[i];
+    if (section.sh_name >= names.sh_size) {
+      continue;
+    }
+    std::string name(&namesData[section.sh_name],
+                     strnlen(&namesData[section.sh_name],
+                             names.sh_size - section.sh_name));
+    if (name == CHRE_LOG_FORMAT_SECTION && section.sh_type == SHT_PROGBITS &&
+        section.sh_offset + section.sh_size <= data.size()) {
+      table->addStrings(reinterpret_cast<const char *>(&data[section.sh_offset]),
+                        section.sh_size);
+    }
+  }
+}
+
+/**
+ * @return true if an integer argument of the given length is formatted from
+ *         an int, false if it is formatted from a 64-bit value.
+ */
+bool isPromotedToInt(LogArgLength argLength) {
+  return (argLength == LogArgLength::CHAR || argLength == LogArgLength::SHORT);
+}
+
+/**
+ * @return The length modifier to format an integer argument of the given
+ *         length with.
+ */
+const char *getHostLengthModifier(LogArgLength argLength) {
+  switch (argLength) {
+    case LogArgLength::CHAR:
+      return "hh";
+    case LogArgLength::SHORT:
+      return "h";
+    default:
+      return "ll";
+  }
+}
+
+/**
+ * Appends a value formatted with a printf conversion specification.
+ */
+template <typename T>
+void appendFormatted(const std::string &spec, T value, std::string *log) {
+  char formatted[256];
+  int length = snprintf(formatted, sizeof(formatted), spec.c_str(), value);
+  if (length > 0) {
+    log->append(formatted, std::min(static_cast<size_t>(length),
+                                    sizeof(formatted) - 1));
+  }
+}
+
+}  // anonymous namespace
+
+bool LogFormatTable::loadFromFile(const char *path) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file) {
+    LOGE("Failed to open log format file %s", path);
+    return false;
+  }
+  std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)),
+                            std::istreambuf_iterator<char>());
+
+  if (!addElfStrings(data)) {
+    addStrings(reinterpret_cast<const char *>(data.data()), data.size());
+  }
+  LOGD("Log format table has %zu format strings", mOffsets.size());
+  return true;
+}
+
+bool LogFormatTable::addElfStrings(const std::vector<uint8_t> &data) {
+  if (data.size() < EI_NIDENT || memcmp(data.data(), ELFMAG, SELFMAG) != 0) {
+    return false;
+  }
+
+  if (data[EI_CLASS] == ELFCLASS32) {
+    addFormatSection<Elf32_Ehdr, Elf32_Shdr>(data, this);
+  } else if (data[EI_CLASS] == ELFCLASS64) {
+    addFormatSection<Elf64_Ehdr, Elf64_Shdr>(data, this);
+  } else {
+    LOGE("Unsupported ELF class %" PRIu8, data[EI_CLASS]);
+  }
+  // Malformed ELF files are not treated as string blobs either.
+  return true;
+}
+
+void LogFormatTable::addStrings(const char *data, size_t size) {
+  size_t start = 0;
+  while (start < size) {
+    const char *str = &data[start];
+    size_t length = strnlen(str, size - start);
+    if (length > 0 && start + length < size) {
+      addString(str);
+    }
+    start += length + 1;
+  }
+}
+
+void LogFormatTable::addString(const char *str) {
+  uint32_t hash = hashLogFormat(str);
+  auto it = mOffsets.find(hash);
+  if (it == mOffsets.end()) {
+    mOffsets.emplace(hash, mStrings.size());
+    mStrings.insert(mStrings.end(), str, str + strlen(str) + 1);
+  } else if (it->second != kAmbiguousOffset &&
+             strcmp(&mStrings[it->second], str) != 0) {
+    // Formatting the arguments of one string with the other would print
+    // garbage, so logs with this hash are reported as unknown.
+    LOGW("Log formats \"%s\" and \"%s\" have the same hash %" PRIu32,
+         &mStrings[it->second], str, hash);
+    it->second = kAmbiguousOffset;
+  }
+}
+
+const char *LogFormatTable::lookup(uint32_t formatHash) const {
+  auto it = mOffsets.find(formatHash);
+  return (it != mOffsets.end() && it->second != kAmbiguousOffset)
+             ? &mStrings[it->second]
+             : nullptr;
+}
+
+bool LogFormatTable::formatLog(const char *format, const uint8_t *args,
+                               size_t argsSize, std::string *log) {
+  size_t argsIndex = 0;
+  auto readVarint = [&](uint64_t *value) {
+    size_t size =
+        decodeLogVarint(&args[argsIndex], argsSize - argsIndex, value);
+    argsIndex += size;
+    return (size > 0);
+  };
+
+  const char *c = format;
+  while (*c != '\0') {
+    const char *specStart = strchr(c, '%');
+    if (specStart == nullptr) {
+      log->append(c);
+      break;
+    }
+    log->append(c, specStart - c);
+
+    LogFormatConversion conversion;
+    if (!parseLogFormatConversion(specStart, &conversion) ||
+        conversion.argType == LogArgType::UNSUPPORTED) {
+      return false;
+    }
+    c = specStart + conversion.length;
+    if (conversion.argType == LogArgType::NONE) {
+      log->push_back('%');
+      continue;
+    }
+
+    // Rebuild the specification with '*' replaced by the packed values, and
+    // the length modifier replaced by one matching the decoded value. Integers
+    // are formatted as 64 bits, except char and short ones.
+    std::string spec = "%";
+    for (size_t i = 1; i <= conversion.flagsLength; i++) {
+      if (specStart[i] == '*') {
+        uint64_t value;
+        if (!readVarint(&value)) {
+          return false;
+        }
+        spec += std::to_string(zigzagDecode(value));
+      } else {
+        spec += specStart[i];
+      }
+    }
+
+    switch (conversion.argType) {
+      case LogArgType::SIGNED_INT: {
+        uint64_t value;
+        if (!readVarint(&value)) {
+          return false;
+        }
+        int64_t signedValue = zigzagDecode(value);
+        spec += getHostLengthModifier(conversion.argLength);
+        spec += conversion.conversion;
+        if (isPromotedToInt(conversion.argLength)) {
+          appendFormatted(spec, static_cast<int>(signedValue), log);
+        } else {
+          appendFormatted(spec, static_cast<long long>(signedValue), log);
+        }
+        break;
+      }
+      case LogArgType::UNSIGNED_INT: {
+        uint64_t value;
+        if (!readVarint(&value)) {
+          return false;
+        }
+        if (conversion.conversion == 'c') {
+          spec += 'c';
+          appendFormatted(spec, static_cast<int>(value), log);
+        } else {
+          spec += getHostLengthModifier(conversion.argLength);
+          spec += conversion.conversion;
+          if (isPromotedToInt(conversion.argLength)) {
+            appendFormatted(spec, static_cast<unsigned int>(value), log);
+          } else {
+            appendFormatted(spec, static_cast<unsigned long long>(value), log);
+          }
+        }
+        break;
+      }
+      case LogArgType::POINTER: {
+        uint64_t value;
+        if (!readVarint(&value)) {
+          return false;
+        }
+        spec += 'p';
+        appendFormatted(spec,
+                        reinterpret_cast<void *>(static_cast<uintptr_t>(value)),
+                        log);
+        break;
+      }
+      case LogArgType::DOUBLE: {
+        double value;
+        if (argsSize - argsIndex < sizeof(value)) {
+          return false;
+        }
+        memcpy(&value, &args[argsIndex], sizeof(value));
+        argsIndex += sizeof(value);
+        spec += conversion.conversion;
+        appendFormatted(spec, value, log);
+        break;
+      }
+      case LogArgType::STRING: {
+        if (argsIndex >= argsSize) {
+          return false;
+        }
+        size_t length = args[argsIndex] & kLogMaxStringArgLength;
+        bool truncated = (args[argsIndex] & kLogStringArgTruncated) != 0;
+        argsIndex++;
+        if (argsSize - argsIndex < length) {
+          return false;
+        }
+        std::string str(reinterpret_cast<const char *>(&args[argsIndex]),
+                        length);
+        argsIndex += length;
+        if (truncated) {
+          str += "...";
+        }
+        spec += 's';
+        appendFormatted(spec, str.c_str(), log);
+        break;
+      }
+      default:
+        return false;
+    }
+  }
+
+  return (argsIndex == argsSize);
+}
+
+}  // namespace chre
+}  // namespace android
@@ -16,11 +16,15 @@
 
 #include "chre_host/log_message_parser.h"
 #include <endian.h>
+#include <unistd.h>
+#include "chre/platform/shared/log_format_common.h"
 #include "chre/util/time.h"
 #include "chre_host/daemon_base.h"
 #include "chre_host/log.h"
 #include "include/chre_host/log_message_parser.h"
 
+using chre::kLogEncodingDeferredFormat;
+using chre::kLogFormatHashSize;
 using chre::kOneMillisecondInNanoseconds;
 using chre::kOneSecondInMilliseconds;
 
@@ -61,6 +65,13 @@ std::unique_ptr<Detokenizer> LogMessageParser::logDetokenizerInit() {
 
 void LogMessageParser::init() {
   mDetokenizer = logDetokenizerInit();
+  // The table is only installed when CHRE is built with deferred log
+  // formatting, which the host build cannot know about.
+  constexpr const char kLogFormatsFilePath[] =
+      "/vendor/etc/chre/libchre_log_formats.bin";
+  if (access(kLogFormatsFilePath, R_OK) == 0) {
+    mLogFormatTable.loadFromFile(kLogFormatsFilePath);
+  }
 }
 
 void LogMessageParser::dump(const uint8_t *buffer, size_t size) {
@@ -127,10 +138,10 @@ uint8_t LogMessageParser::getLogLevelFromMetadata(uint8_t metadata) {
   return (metadata & 0xf);
 }
 
-bool LogMessageParser::isLogMessageEncoded(uint8_t metadata) {
+uint8_t LogMessageParser::getLogEncodingFromMetadata(uint8_t metadata) {
   // The upper nibble of the metadata denotes the encoding, as indicated
   // by the schema in host_messages.fbs.
-  return (((metadata >> 4) & 0xf) != 0);
+  return ((metadata >> 4) & 0xf);
 }
 
 void LogMessageParser::log(const uint8_t *logBuffer, size_t logBufferSize) {
@@ -166,6 +177,34 @@ size_t LogMessageParser::parseAndEmitTokenizedLogMessageAndGetSize(
   return logMessageSize;
 }
 
+size_t LogMessageParser::parseAndEmitDeferredLogMessageAndGetSize(
+    const LogMessageV2 *message) {
+  const auto *encodedLog =
+      reinterpret_cast<const EncodedLog *>(message->logMessage);
+  const auto *data = reinterpret_cast<const uint8_t *>(encodedLog->data);
+  std::string decodedString;
+
+  if (encodedLog->size < kLogFormatHashSize) {
+    LOGE("Deferred log message too short (%" PRIu8 " bytes)", encodedLog->size);
+  } else {
+    uint32_t formatHash;
+    memcpy(&formatHash, data, sizeof(formatHash));
+    formatHash = le32toh(formatHash);
+
+    const char *format = mLogFormatTable.lookup(formatHash);
+    if (format == nullptr) {
+      decodedString = "<unknown log format " + std::to_string(formatHash) + ">";
+    } else if (!LogFormatTable::formatLog(
+                   format, &data[kLogFormatHashSize],
+                   encodedLog->size - kLogFormatHashSize, &decodedString)) {
+      decodedString += " <malformed log arguments>";
+    }
+    emitLogMessage(getLogLevelFromMetadata(message->metadata),
+                   le32toh(message->timestampMillis), decodedString.c_str());
+  }
+  return encodedLog->size + sizeof(struct EncodedLog);
+}
+
 void LogMessageParser::parseAndEmitLogMessage(const LogMessageV2 *message) {
   emitLogMessage(getLogLevelFromMetadata(message->metadata),
                  le32toh(message->timestampMillis), message->logMessage);
@@ -206,7 +245,10 @@ void LogMessageParser::logV2(const uint8_t *logBuffer, size_t logBufferSize,
         reinterpret_cast<const LogMessageV2 *>(&logBuffer[bufferIndex]);
     size_t bufferIndexDelta = logBufferSize - bufferIndex;
     size_t logMessageSize;
-    if (isLogMessageEncoded(message->metadata)) {
+    uint8_t encoding = getLogEncodingFromMetadata(message->metadata);
+    if (encoding == kLogEncodingDeferredFormat) {
+      logMessageSize = parseAndEmitDeferredLogMessageAndGetSize(message);
+    } else if (encoding != 0) {
       logMessageSize = parseAndEmitTokenizedLogMessageAndGetSize(message);
     } else {
       parseAndEmitLogMessage(message);
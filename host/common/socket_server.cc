@@ -16,12 +16,17 @@
 
 #include "chre_host/socket_server.h"
 
-#include <poll.h>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
 
 #include <cassert>
 #include <cinttypes>
 #include <csignal>
 #include <cstdlib>
+#include <cstring>
 #include <map>
 #include <mutex>
 
@@ -54,66 +59,99 @@ void maskAllSignalsExceptIntAndTerm() {
   }
 }
 
+bool setNonBlocking(int fd) {
+  int flags = fcntl(fd, F_GETFL);
+  return (flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0);
+}
+
+bool isWouldBlock(int error) {
+  return (error == EAGAIN || error == EWOULDBLOCK);
+}
+
 }  // anonymous namespace
 
 SocketServer::SocketServer() {
-  // Initialize the socket fds field for all inactive client slots to -1, so
-  // poll skips over it, and we don't attempt to send on it
-  for (size_t i = 1; i <= kMaxActiveClients; i++) {
-    mPollFds[i].fd = -1;
-    mPollFds[i].events = POLLIN;
+  mWakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (mWakeFd < 0) {
+    LOG_ERROR("Couldn't create wake eventfd", errno);
+  }
+}
+
+SocketServer::~SocketServer() {
+  if (mWakeFd >= 0) {
+    close(mWakeFd);
   }
 }
 
 void SocketServer::run(const char *socketName, bool allowSocketCreation,
                        ClientMessageCallback clientMessageCallback) {
-  mClientMessageCallback = clientMessageCallback;
-
-  mSockFd = android_get_control_socket(socketName);
-  if (mSockFd == INVALID_SOCKET && allowSocketCreation) {
+  int sockFd = android_get_control_socket(socketName);
+  if (sockFd == INVALID_SOCKET && allowSocketCreation) {
     LOGI("Didn't inherit socket, creating...");
-    mSockFd = socket_local_server(socketName, ANDROID_SOCKET_NAMESPACE_RESERVED,
-                                  SOCK_SEQPACKET);
+    sockFd = socket_local_server(socketName, ANDROID_SOCKET_NAMESPACE_RESERVED,
+                                 SOCK_SEQPACKET);
   }
 
-  if (mSockFd == INVALID_SOCKET) {
+  if (sockFd == INVALID_SOCKET) {
     LOGE("Couldn't get/create socket");
   } else {
-    int ret = listen(mSockFd, kMaxPendingConnectionRequests);
-    if (ret < 0) {
-      LOG_ERROR("Couldn't listen on socket", errno);
-    } else {
-      serviceSocket();
-    }
+    runWithSocket(sockFd, clientMessageCallback);
+  }
+}
 
-    {
-      std::lock_guard<std::mutex> lock(mClientsMutex);
-      for (const auto &pair : mClients) {
-        int clientSocket = pair.first;
-        if (close(clientSocket) != 0) {
-          LOGI("Couldn't close client %" PRIu16 "'s socket: %s",
-               pair.second.clientId, strerror(errno));
-        }
+void SocketServer::runWithSocket(int socketFd,
+                                 ClientMessageCallback clientMessageCallback) {
+  mClientMessageCallback = clientMessageCallback;
+  mSockFd = socketFd;
+
+  mEpollFd = epoll_create1(EPOLL_CLOEXEC);
+  if (mEpollFd < 0) {
+    LOG_ERROR("Couldn't create epoll instance", errno);
+  } else if (listen(mSockFd, kMaxPendingConnectionRequests) < 0) {
+    LOG_ERROR("Couldn't listen on socket", errno);
+  } else {
+    serviceSocket();
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mClientsMutex);
+    for (const auto &pair : mClients) {
+      int clientSocket = pair.first;
+      if (close(clientSocket) != 0) {
+        LOGI("Couldn't close client %" PRIu16 "'s socket: %s",
+             pair.second.clientId, strerror(errno));
       }
-      mClients.clear();
     }
-    close(mSockFd);
+    mClients.clear();
+  }
+  if (mEpollFd >= 0) {
+    close(mEpollFd);
+    mEpollFd = -1;
+  }
+  close(mSockFd);
+  mSockFd = INVALID_SOCKET;
+}
+
+void SocketServer::stop() {
+  mStopRequested = true;
+  if (mWakeFd >= 0) {
+    uint64_t value = 1;
+    if (write(mWakeFd, &value, sizeof(value)) < 0) {
+      LOG_ERROR("Couldn't wake up the receive loop", errno);
+    }
   }
 }
 
 void SocketServer::sendToAllClients(const void *data, size_t length) {
   std::lock_guard<std::mutex> lock(mClientsMutex);
 
+  SharedBuffer sharedBuffer;
   int deliveredCount = 0;
-  for (const auto &pair : mClients) {
-    int clientSocket = pair.first;
-    uint16_t clientId = pair.second.clientId;
-    if (sendToClientSocket(data, length, clientSocket, clientId)) {
+  for (auto &pair : mClients) {
+    SendResult result =
+        sendOrQueueLocked(data, length, pair.first, pair.second, sharedBuffer);
+    if (result == SendResult::kSent || result == SendResult::kQueued) {
       deliveredCount++;
-    } else if (errno == EINTR) {
-      // Exit early if we were interrupted - we should only get this for
-      // SIGINT/SIGTERM, so we should exit quickly
-      break;
     }
   }
 
@@ -127,11 +165,12 @@ bool SocketServer::sendToClientById(const void *data, size_t length,
   std::lock_guard<std::mutex> lock(mClientsMutex);
 
   bool sent = false;
-  for (const auto &pair : mClients) {
-    uint16_t thisClientId = pair.second.clientId;
-    if (thisClientId == clientId) {
-      int clientSocket = pair.first;
-      sent = sendToClientSocket(data, length, clientSocket, thisClientId);
+  for (auto &pair : mClients) {
+    if (pair.second.clientId == clientId) {
+      SharedBuffer sharedBuffer;
+      SendResult result =
+          sendOrQueueLocked(data, length, pair.first, pair.second, sharedBuffer);
+      sent = (result == SendResult::kSent || result == SendResult::kQueued);
       break;
     }
   }
@@ -140,47 +179,39 @@ bool SocketServer::sendToClientById(const void *data, size_t length,
 }
 
 void SocketServer::acceptClientConnection() {
-  int clientSocket = accept(mSockFd, NULL, NULL);
+  int clientSocket = accept4(mSockFd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
   if (clientSocket < 0) {
     LOG_ERROR("Couldn't accept client connection", errno);
   } else if (mClients.size() >= kMaxActiveClients) {
     LOGW("Rejecting client request - maximum number of clients reached");
     close(clientSocket);
   } else {
-    ClientData clientData;
-    clientData.clientId = mNextClientId++;
+    uint16_t clientId = mNextClientId++;
 
     // We currently don't handle wraparound - if we're getting this many
     // connects/disconnects, then something is wrong.
     // TODO: can handle this properly by iterating over the existing clients to
     // avoid a conflict.
-    if (clientData.clientId == 0) {
+    if (clientId == 0) {
       LOGE("Couldn't allocate client ID");
       std::exit(-1);
     }
 
-    bool slotFound = false;
-    for (size_t i = 1; i <= kMaxActiveClients; i++) {
-      if (mPollFds[i].fd < 0) {
-        mPollFds[i].fd = clientSocket;
-        slotFound = true;
-        break;
-      }
-    }
-
-    if (!slotFound) {
-      LOGE("Couldn't find slot for client!");
-      assert(slotFound);
+    struct epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.fd = clientSocket;
+    if (epoll_ctl(mEpollFd, EPOLL_CTL_ADD, clientSocket, &event) != 0) {
+      LOG_ERROR("Couldn't add client socket to epoll", errno);
       close(clientSocket);
     } else {
       {
         std::lock_guard<std::mutex> lock(mClientsMutex);
-        mClients[clientSocket] = clientData;
+        mClients[clientSocket].clientId = clientId;
       }
       LOGI(
           "Accepted new client connection (count %zu), assigned client ID "
           "%" PRIu16,
-          mClients.size(), clientData.clientId);
+          mClients.size(), clientId);
     }
   }
 }
@@ -192,8 +223,10 @@ void SocketServer::handleClientData(int clientSocket) {
   ssize_t packetSize =
       recv(clientSocket, mRecvBuffer.data(), mRecvBuffer.size(), MSG_DONTWAIT);
   if (packetSize < 0) {
-    LOGE("Couldn't get packet from client %" PRIu16 ": %s", clientId,
-         strerror(errno));
+    if (!isWouldBlock(errno)) {
+      LOGE("Couldn't get packet from client %" PRIu16 ": %s", clientId,
+           strerror(errno));
+    }
   } else if (packetSize == 0) {
     LOGI("Client %" PRIu16 " disconnected", clientId);
     disconnectClient(clientSocket);
@@ -204,93 +237,185 @@ void SocketServer::handleClientData(int clientSocket) {
 }
 
 void SocketServer::disconnectClient(int clientSocket) {
+  size_t erased;
   {
     std::lock_guard<std::mutex> lock(mClientsMutex);
-    mClients.erase(clientSocket);
+    erased = mClients.erase(clientSocket);
   }
+
+  if (erased == 0) {
+    LOGE("Out of sync");
+    assert(erased != 0);
+  }
+
+  // Closing the socket also removes it from the epoll set.
   close(clientSocket);
+}
 
-  bool removed = false;
-  for (size_t i = 1; i <= kMaxActiveClients; i++) {
-    if (mPollFds[i].fd == clientSocket) {
-      mPollFds[i].fd = -1;
-      removed = true;
-      break;
+SocketServer::SendResult SocketServer::sendOrQueueLocked(
+    const void *data, size_t length, int clientSocket, ClientData &client,
+    SharedBuffer &sharedBuffer) {
+  // Preserve ordering: once something is queued, new messages go behind it.
+  if (client.sendQueue.empty()) {
+    ssize_t bytesSent =
+        send(clientSocket, data, length, MSG_DONTWAIT | MSG_NOSIGNAL);
+    if (bytesSent > 0) {
+      LOGV("Delivered message of size %zu bytes to client %" PRIu16, length,
+           client.clientId);
+      return SendResult::kSent;
+    } else if (bytesSent == 0) {
+      LOGW("Client %" PRIu16 " disconnected before message could be delivered",
+           client.clientId);
+      return SendResult::kFailed;
+    } else if (!isWouldBlock(errno)) {
+      LOGE("Error sending packet of size %zu to client %" PRIu16 ": %s",
+           length, client.clientId, strerror(errno));
+      return SendResult::kFailed;
     }
   }
 
-  if (!removed) {
-    LOGE("Out of sync");
-    assert(removed);
+  if (client.sendQueue.size() >= kMaxQueuedPacketsPerClient ||
+      client.queuedBytes + length > kMaxQueuedBytesPerClient) {
+    if (client.droppedCount++ == 0) {
+      LOGW("Send queue for client %" PRIu16 " is full, dropping messages",
+           client.clientId);
+    }
+    mDroppedMessageCount++;
+    return SendResult::kDropped;
+  }
+
+  if (sharedBuffer == nullptr) {
+    const auto *bytes = static_cast<const uint8_t *>(data);
+    sharedBuffer =
+        std::make_shared<const std::vector<uint8_t>>(bytes, bytes + length);
   }
+  client.sendQueue.push_back(sharedBuffer);
+  client.queuedBytes += length;
+  setWriteWatchedLocked(clientSocket, client, true /* watched */);
+  return SendResult::kQueued;
 }
 
-bool SocketServer::sendToClientSocket(const void *data, size_t length,
-                                      int clientSocket, uint16_t clientId) {
-  errno = 0;
-  ssize_t bytesSent = send(clientSocket, data, length, 0);
-  if (bytesSent < 0) {
-    LOGE("Error sending packet of size %zu to client %" PRIu16 ": %s", length,
-         clientId, strerror(errno));
-  } else if (bytesSent == 0) {
-    LOGW("Client %" PRIu16 " disconnected before message could be delivered",
-         clientId);
-  } else {
-    LOGV("Delivered message of size %zu bytes to client %" PRIu16, length,
-         clientId);
+void SocketServer::flushSendQueue(int clientSocket) {
+  std::lock_guard<std::mutex> lock(mClientsMutex);
+
+  auto it = mClients.find(clientSocket);
+  if (it == mClients.end()) {
+    return;
+  }
+
+  ClientData &client = it->second;
+  while (!client.sendQueue.empty()) {
+    const std::vector<uint8_t> &packet = *client.sendQueue.front();
+    ssize_t bytesSent = send(clientSocket, packet.data(), packet.size(),
+                             MSG_DONTWAIT | MSG_NOSIGNAL);
+    if (bytesSent < 0 && isWouldBlock(errno)) {
+      break;
+    } else if (bytesSent <= 0) {
+      // The hangup will be reported via EPOLLIN, so just discard the backlog.
+      LOGE("Error flushing %zu queued packets to client %" PRIu16 ": %s",
+           client.sendQueue.size(), client.clientId, strerror(errno));
+      client.sendQueue.clear();
+      client.queuedBytes = 0;
+      break;
+    }
+
+    client.queuedBytes -= packet.size();
+    client.sendQueue.pop_front();
   }
 
-  return (bytesSent > 0);
+  if (client.sendQueue.empty()) {
+    if (client.droppedCount > 0) {
+      LOGW("Client %" PRIu16 " caught up after %" PRIu32 " dropped messages",
+           client.clientId, client.droppedCount);
+      client.droppedCount = 0;
+    }
+    setWriteWatchedLocked(clientSocket, client, false /* watched */);
+  }
+}
+
+void SocketServer::setWriteWatchedLocked(int clientSocket, ClientData &client,
+                                         bool watched) {
+  if (client.writeWatched != watched) {
+    struct epoll_event event = {};
+    event.events = watched ? (EPOLLIN | EPOLLOUT) : EPOLLIN;
+    event.data.fd = clientSocket;
+    if (epoll_ctl(mEpollFd, EPOLL_CTL_MOD, clientSocket, &event) != 0) {
+      LOG_ERROR("Couldn't update client socket epoll events", errno);
+    } else {
+      client.writeWatched = watched;
+    }
+  }
 }
 
 void SocketServer::serviceSocket() {
-  constexpr size_t kListenIndex = 0;
-  static_assert(kListenIndex == 0,
-                "Code assumes that the first index is always the listen "
-                "socket");
+  if (!setNonBlocking(mSockFd)) {
+    LOG_ERROR("Couldn't make listen socket non-blocking", errno);
+  }
 
-  mPollFds[kListenIndex].fd = mSockFd;
-  mPollFds[kListenIndex].events = POLLIN;
+  struct epoll_event event = {};
+  event.events = EPOLLIN;
+  event.data.fd = mSockFd;
+  if (epoll_ctl(mEpollFd, EPOLL_CTL_ADD, mSockFd, &event) != 0) {
+    LOG_ERROR("Couldn't add listen socket to epoll", errno);
+    return;
+  }
+  event.data.fd = mWakeFd;
+  if (mWakeFd >= 0 &&
+      epoll_ctl(mEpollFd, EPOLL_CTL_ADD, mWakeFd, &event) != 0) {
+    LOG_ERROR("Couldn't add wake eventfd to epoll", errno);
+    return;
+  }
 
-  // Signal mask used with ppoll() so we gracefully handle SIGINT and SIGTERM,
-  // and ignore other signals
+  // Signal mask used with epoll_pwait() so we gracefully handle SIGINT and
+  // SIGTERM, and ignore other signals
   sigset_t signalMask;
   sigfillset(&signalMask);
   sigdelset(&signalMask, SIGINT);
   sigdelset(&signalMask, SIGTERM);
 
   // Masking signals here ensure that after this point, we won't handle INT/TERM
-  // until after we call into ppoll()
+  // until after we call into epoll_pwait()
   maskAllSignals();
   std::signal(SIGINT, signalHandler);
   std::signal(SIGTERM, signalHandler);
 
+  struct epoll_event events[kMaxEpollEvents];
+
   LOGI("Ready to accept connections");
-  while (!sSignalReceived) {
+  while (!sSignalReceived && !mStopRequested) {
     int ret = TEMP_FAILURE_RETRY(
-        ppoll(mPollFds, 1 + kMaxActiveClients, nullptr, &signalMask));
+        epoll_pwait(mEpollFd, events, kMaxEpollEvents, -1, &signalMask));
     maskAllSignalsExceptIntAndTerm();
     if (ret == -1) {
       LOGI("Exiting poll loop: %s", strerror(errno));
       break;
     }
 
-    if (mPollFds[kListenIndex].revents & POLLIN) {
-      acceptClientConnection();
-    }
-
-    for (size_t i = 1; i <= kMaxActiveClients; i++) {
-      if (mPollFds[i].fd < 0) {
-        continue;
-      }
+    for (int i = 0; i < ret; i++) {
+      int fd = events[i].data.fd;
+      uint32_t revents = events[i].events;
 
-      if (mPollFds[i].revents & POLLIN) {
-        handleClientData(mPollFds[i].fd);
+      if (fd == mSockFd) {
+        acceptClientConnection();
+      } else if (fd == mWakeFd) {
+        uint64_t value;
+        if (read(mWakeFd, &value, sizeof(value)) < 0) {
+          LOG_ERROR("Couldn't read wake eventfd", errno);
+        }
+      } else if (mClients.find(fd) != mClients.end()) {
+        // A client may have been disconnected by an earlier event in this
+        // batch, in which case its fd is skipped above.
+        if (revents & EPOLLOUT) {
+          flushSendQueue(fd);
+        }
+        if (revents & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+          handleClientData(fd);
+        }
       }
     }
 
     // Mask all signals to ensure that sSignalReceived can't become true between
-    // checking it in the while condition and calling into ppoll()
+    // checking it in the while condition and calling into epoll_pwait()
     maskAllSignals();
   }
 }
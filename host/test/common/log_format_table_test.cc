@@ -0,0 +1,172 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "chre_host/log_format_table.h"
+
+#include <cinttypes>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "chre/platform/shared/log_format_common.h"
+#include "gtest/gtest.h"
+
+namespace android::chre {
+namespace {
+
+using ::chre::encodeLogArgsVa;
+using ::chre::hashLogFormat;
+
+// Placed where the CHRE log macros put format strings.
+__attribute__((section(CHRE_LOG_FORMAT_SECTION), used)) constexpr char
+    kFormatInBinary[] = "Format string in the test binary: %d";
+
+// Formats a log both with snprintf and by packing the arguments as CHRE does,
+// then unpacking them with LogFormatTable::formatLog().
+void expectSameAsSnprintf(const char *format, ...) {
+  va_list args;
+  va_start(args, format);
+  va_list argsCopy;
+  va_copy(argsCopy, args);
+
+  char expected[256];
+  vsnprintf(expected, sizeof(expected), format, args);
+
+  uint8_t encoded[256];
+  size_t encodedSize;
+  ASSERT_TRUE(encodeLogArgsVa(format, argsCopy, encoded, sizeof(encoded),
+                              &encodedSize));
+  va_end(argsCopy);
+  va_end(args);
+
+  std::string log;
+  EXPECT_TRUE(LogFormatTable::formatLog(format, encoded, encodedSize, &log));
+  EXPECT_EQ(log, expected);
+}
+
+TEST(LogFormatTableTest, FormatMatchesSnprintf) {
+  expectSameAsSnprintf("No arguments");
+  expectSameAsSnprintf("%d %i %u %x %X %o %c", -42, INT32_MIN, UINT32_MAX,
+                       0xbeefu, 0xbeefu, 8u, 'z');
+  expectSameAsSnprintf("%" PRId64 " %" PRIu64 " %zu %" PRIx32,
+                       static_cast<int64_t>(INT64_MIN),
+                       static_cast<uint64_t>(UINT64_MAX),
+                       static_cast<size_t>(12345), static_cast<uint32_t>(7));
+  expectSameAsSnprintf("%hhd %hu %ld %lld", -1, 65535, -123456L, -1LL);
+  expectSameAsSnprintf("%hd %hhd %hu %hhx", 70000, 300, -1, -1);
+  expectSameAsSnprintf("[%-8s] [%8s] [%.2s] [%*.*s]", "left", "right",
+                       "truncated", 6, 3, "star");
+  expectSameAsSnprintf("%08.3f %+d %5d%% %#x", 3.25, 7, 99, 255u);
+  expectSameAsSnprintf("%s", "");
+}
+
+TEST(LogFormatTableTest, DoublesKeepTheirPrecision) {
+  expectSameAsSnprintf("%.17g %.17g %e", 0.1, 1.0 / 3.0, 1e300);
+}
+
+TEST(LogFormatTableTest, TruncatedStringIsMarked) {
+  std::string longStr(200, 'a');
+  uint8_t encoded[256];
+  size_t encodedSize;
+  auto encode = [&](const char *fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    bool success =
+        encodeLogArgsVa(fmt, args, encoded, sizeof(encoded), &encodedSize);
+    va_end(args);
+    return success;
+  };
+  ASSERT_TRUE(encode("%s", longStr.c_str()));
+
+  std::string log;
+  EXPECT_TRUE(LogFormatTable::formatLog("%s", encoded, encodedSize, &log));
+  EXPECT_EQ(log, std::string(::chre::kLogMaxStringArgLength, 'a') + "...");
+}
+
+TEST(LogFormatTableTest, MalformedArguments) {
+  std::string log;
+  const uint8_t kTruncatedVarint[] = {0x80};
+  EXPECT_FALSE(LogFormatTable::formatLog("value %u", kTruncatedVarint,
+                                         sizeof(kTruncatedVarint), &log));
+  EXPECT_EQ(log, "value ");
+
+  log.clear();
+  const uint8_t kExtraBytes[] = {0x01, 0x02};
+  EXPECT_FALSE(LogFormatTable::formatLog("%u", kExtraBytes,
+                                         sizeof(kExtraBytes), &log));
+
+  log.clear();
+  const uint8_t kShortString[] = {0x05, 'a', 'b'};
+  EXPECT_FALSE(LogFormatTable::formatLog("%s", kShortString,
+                                         sizeof(kShortString), &log));
+
+  log.clear();
+  EXPECT_FALSE(LogFormatTable::formatLog("%n", nullptr, 0, &log));
+}
+
+TEST(LogFormatTableTest, LookupWholeStrings) {
+  const char kStrings[] = "Found %d items\0\0Other\0Unterminated";
+  LogFormatTable table;
+  table.addStrings(kStrings, sizeof(kStrings) - 1);
+
+  EXPECT_EQ(table.size(), 2u);
+  EXPECT_STREQ(table.lookup(hashLogFormat("Found %d items")),
+               "Found %d items");
+  EXPECT_STREQ(table.lookup(hashLogFormat("Other")), "Other");
+  EXPECT_EQ(table.lookup(hashLogFormat("%d items")), nullptr);
+  EXPECT_EQ(table.lookup(hashLogFormat("Unterminated")), nullptr);
+  EXPECT_EQ(table.lookup(hashLogFormat("Missing")), nullptr);
+}
+
+TEST(LogFormatTableTest, CollidingHashesAreUnknown) {
+  // Distinct strings with the same FNV-1a hash.
+  static_assert(hashLogFormat("nakmvxxv") == hashLogFormat("tbdxatiq"));
+  const char kStrings[] = "nakmvxxv\0Other\0tbdxatiq\0nakmvxxv";
+  LogFormatTable table;
+  table.addStrings(kStrings, sizeof(kStrings));
+
+  EXPECT_EQ(table.lookup(hashLogFormat("nakmvxxv")), nullptr);
+  EXPECT_STREQ(table.lookup(hashLogFormat("Other")), "Other");
+}
+
+TEST(LogFormatTableTest, DuplicateStringsAreNotCollisions) {
+  const char kStrings[] = "Same %d\0Same %d";
+  LogFormatTable table;
+  table.addStrings(kStrings, sizeof(kStrings));
+
+  EXPECT_EQ(table.size(), 1u);
+  EXPECT_STREQ(table.lookup(hashLogFormat("Same %d")), "Same %d");
+}
+
+TEST(LogFormatTableTest, LoadFromElf) {
+  LogFormatTable table;
+  ASSERT_TRUE(table.loadFromFile("/proc/self/exe"));
+  EXPECT_GT(table.size(), 0u);
+  EXPECT_STREQ(table.lookup(hashLogFormat(kFormatInBinary)), kFormatInBinary);
+  EXPECT_EQ(table.lookup(hashLogFormat("Format string in the test binary")),
+            nullptr);
+}
+
+TEST(LogFormatTableTest, LoadMissingFile) {
+  LogFormatTable table;
+  EXPECT_FALSE(table.loadFromFile("/nonexistent/log_formats.bin"));
+  EXPECT_EQ(table.size(), 0u);
+}
+
+}  // namespace
+}  // namespace android::chre
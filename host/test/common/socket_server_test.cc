@@ -0,0 +1,202 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "chre_host/socket_server.h"
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cinttypes>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace android::chre {
+namespace {
+
+using std::chrono::steady_clock;
+
+// Builds an address in the abstract namespace that is unique to this process.
+sockaddr_un makeAddress(socklen_t *length) {
+  sockaddr_un addr = {};
+  addr.sun_family = AF_UNIX;
+  int nameLen = snprintf(addr.sun_path + 1, sizeof(addr.sun_path) - 1,
+                         "chre_socket_server_test_%d", getpid());
+  *length = static_cast<socklen_t>(offsetof(sockaddr_un, sun_path) + 1 +
+                                   nameLen);
+  return addr;
+}
+
+class SocketServerTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    mAddr = makeAddress(&mAddrLen);
+    int fd = socket(AF_UNIX, SOCK_SEQPACKET, 0);
+    ASSERT_GE(fd, 0);
+    ASSERT_EQ(bind(fd, reinterpret_cast<sockaddr *>(&mAddr), mAddrLen), 0);
+
+    // Listen before handing the socket over so that clients can connect
+    // without racing the server thread's startup.
+    ASSERT_EQ(listen(fd, 8 /* backlog */), 0);
+
+    mThread = std::thread([this, fd]() {
+      mServer.runWithSocket(
+          fd, [this](uint16_t /* clientId */, void * /* data */,
+                     size_t /* len */) { mHelloCount++; });
+    });
+  }
+
+  void TearDown() override {
+    for (int fd : mClientFds) {
+      close(fd);
+    }
+    mServer.stop();
+    mThread.join();
+  }
+
+  // Connects a client and waits until the server has registered it.
+  int connectClient(int receiveBufferSize) {
+    int fd = socket(AF_UNIX, SOCK_SEQPACKET, 0);
+    EXPECT_GE(fd, 0);
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &receiveBufferSize,
+               sizeof(receiveBufferSize));
+    EXPECT_EQ(connect(fd, reinterpret_cast<sockaddr *>(&mAddr), mAddrLen), 0);
+    mClientFds.push_back(fd);
+
+    size_t expected = mClientFds.size();
+    uint8_t hello = 0;
+    EXPECT_EQ(send(fd, &hello, sizeof(hello), 0), 1);
+    auto deadline = steady_clock::now() + std::chrono::seconds(5);
+    while (mHelloCount < expected && steady_clock::now() < deadline) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return fd;
+  }
+
+  SocketServer mServer;
+  std::thread mThread;
+  sockaddr_un mAddr;
+  socklen_t mAddrLen;
+  std::vector<int> mClientFds;
+  std::atomic<size_t> mHelloCount{0};
+};
+
+TEST_F(SocketServerTest, StalledClientDoesNotBlockFanOut) {
+  constexpr size_t kFastClientCount = 6;
+  constexpr size_t kMessageCount = 1000;
+  constexpr size_t kMessageSize = 4096;
+
+  // Never read from this client, and give it a small receive buffer so its
+  // socket fills up quickly.
+  connectClient(4096 /* receiveBufferSize */);
+
+  std::vector<int> fastClients;
+  for (size_t i = 0; i < kFastClientCount; i++) {
+    fastClients.push_back(connectClient(1024 * 1024 /* receiveBufferSize */));
+  }
+
+  std::atomic<bool> done{false};
+  std::vector<size_t> receivedCounts(kFastClientCount);
+  std::thread reader([&]() {
+    std::vector<uint8_t> buffer(kMessageSize);
+    std::vector<pollfd> fds;
+    for (int fd : fastClients) {
+      fds.push_back({fd, POLLIN, 0});
+    }
+    while (!done) {
+      if (poll(fds.data(), fds.size(), 10 /* timeoutMs */) <= 0) {
+        continue;
+      }
+      for (size_t i = 0; i < fds.size(); i++) {
+        if ((fds[i].revents & POLLIN) &&
+            recv(fds[i].fd, buffer.data(), buffer.size(), MSG_DONTWAIT) > 0) {
+          receivedCounts[i]++;
+        }
+      }
+    }
+  });
+
+  std::vector<uint8_t> message(kMessageSize, 0xAB);
+  std::vector<int64_t> latenciesUs;
+  latenciesUs.reserve(kMessageCount);
+  for (size_t i = 0; i < kMessageCount; i++) {
+    auto start = steady_clock::now();
+    mServer.sendToAllClients(message.data(), message.size());
+    latenciesUs.push_back(std::chrono::duration_cast<std::chrono::microseconds>(
+                              steady_clock::now() - start)
+                              .count());
+
+    // Pace the broadcast like a busy log stream, so the fast clients can keep
+    // up and only the stalled client falls behind.
+    std::this_thread::sleep_for(std::chrono::microseconds(100));
+  }
+
+  // Give the fast clients time to drain anything that had to be queued.
+  auto deadline = steady_clock::now() + std::chrono::seconds(5);
+  auto allReceived = [&]() {
+    return std::all_of(receivedCounts.begin(), receivedCounts.end(),
+                       [](size_t count) { return count == kMessageCount; });
+  };
+  while (!allReceived() && steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+  done = true;
+  reader.join();
+
+  for (size_t count : receivedCounts) {
+    EXPECT_EQ(count, kMessageCount);
+  }
+
+  // The stalled client's queue overflowed, and only its messages were lost.
+  EXPECT_GT(mServer.getDroppedMessageCount(), 0);
+
+  std::sort(latenciesUs.begin(), latenciesUs.end());
+  int64_t p50 = latenciesUs[latenciesUs.size() / 2];
+  int64_t p99 = latenciesUs[latenciesUs.size() * 99 / 100];
+  printf("sendToAllClients latency: p50 %" PRId64 " us, p99 %" PRId64
+         " us, max %" PRId64 " us\n",
+         p50, p99, latenciesUs.back());
+
+  // A blocking send to the stalled client would take until the test times out;
+  // a non-blocking fan-out stays within a small multiple of a syscall each.
+  EXPECT_LT(latenciesUs.back(), 100 * 1000);
+}
+
+TEST_F(SocketServerTest, SendToClientByIdReportsBackpressure) {
+  connectClient(4096 /* receiveBufferSize */);
+
+  std::vector<uint8_t> message(4096, 0xCD);
+  bool rejected = false;
+  for (size_t i = 0; i < 1000 && !rejected; i++) {
+    rejected = !mServer.sendToClientById(message.data(), message.size(),
+                                         1 /* clientId */);
+  }
+
+  EXPECT_TRUE(rejected);
+  EXPECT_EQ(mServer.getDroppedMessageCount(), 1);
+  EXPECT_FALSE(mServer.sendToClientById(message.data(), message.size(),
+                                        100 /* clientId */));
+}
+
+}  // namespace
+}  // namespace android::chre
@@ -0,0 +1,2 @@
+DEFAULT_CHRE_API_VERSION_MAJOR = 0x01
+DEFAULT_CHRE_API_VERSION_MINOR = 0x06
@@ -67,15 +67,34 @@ void sendFlatbufferToHost(T &message, uint16_t hostClientId) {
 /**
  * Handles a message directed to a nanoapp from the system.
  *
- * @param message The message to deliver to a nanoapp.
+ * The socket server reuses its receive buffer, so the message container is
+ * copied once into a HostReceiveBuffer, which the message delivered to the
+ * nanoapp references instead of a copy of its payload. This replaces the
+ * copies into the unpacked container and into the nanoapp message.
+ *
+ * @param message The verified message container holding the message.
+ * @param length The size of the message container.
  */
-void handleNanoappMessage(const fbs::NanoappMessageT &message) {
+void handleNanoappMessage(const void *message, size_t length) {
   LOGD("handleNanoappMessage");
+  SharedPtr<HostReceiveBuffer> receiveBuffer =
+      HostReceiveBuffer::create(length);
+  if (receiveBuffer.isNull()) {
+    LOGE("Dropping message from host (length %zu)", length);
+    return;
+  }
+
+  memcpy(receiveBuffer->data(), message, length);
+  const fbs::NanoappMessage *nanoappMsg =
+      fbs::GetMessageContainer(receiveBuffer->data())
+          ->message_as_NanoappMessage();
+  const flatbuffers::Vector<uint8_t> *msgData = nanoappMsg->message();
   HostCommsManager &manager =
       EventLoopManagerSingleton::get()->getHostCommsManager();
   manager.sendMessageToNanoappFromHost(
-      message.app_id, message.message_type, message.host_endpoint,
-      message.message.data(), message.message.size());
+      nanoappMsg->app_id(), nanoappMsg->message_type(),
+      nanoappMsg->host_endpoint(), receiveBuffer, msgData->data(),
+      msgData->size());
 }
 
 /**
@@ -174,15 +193,14 @@ void handleDebugDumpRequest(uint16_t hostClientId) {
 
 bool handleMessageFromHost(void *message, size_t length) {
   bool success = HostProtocolCommon::verifyMessage(message, length);
-  if (success) {
+  if (success && fbs::GetMessageContainer(message)->message_type() ==
+                     fbs::ChreMessage::NanoappMessage) {
+    handleNanoappMessage(message, length);
+  } else if (success) {
     fbs::MessageContainerT container;
     fbs::GetMessageContainer(message)->UnPackTo(&container);
     uint16_t hostClientId = container.host_addr->client_id();
     switch (container.message.type) {
-      case fbs::ChreMessage::NanoappMessage:
-        handleNanoappMessage(*container.message.AsNanoappMessage());
-        break;
-
       case fbs::ChreMessage::HubInfoRequest:
         handleHubInfoRequest(hostClientId);
         break;
@@ -79,6 +79,11 @@ inline uint32_t AtomicUint32::fetch_decrement() {
   return mAtomic.fetch_sub(1);
 }
 
+inline bool AtomicUint32::compare_exchange(uint32_t &expected,
+                                           uint32_t desired) {
+  return mAtomic.compare_exchange_strong(expected, desired);
+}
+
 }  // namespace chre
 
 #endif  // CHRE_PLATFORM_FREERTOS_ATOMIC_BASE_IMPL_H_
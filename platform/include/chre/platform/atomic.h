@@ -166,6 +166,19 @@ class AtomicUint32 : public AtomicUint32Base, public NonCopyable {
    * @return The previous value of the object.
    */
   uint32_t fetch_decrement();
+
+  /**
+   * Atomically replaces the current value of the object with the desired value
+   * if it is equal to the expected value. Otherwise, loads the current value
+   * into expected. Equivalent to std::atomic::compare_exchange_strong().
+   *
+   * @param expected The value the object is expected to hold. Updated with the
+   *     current value of the object if the exchange fails.
+   * @param desired The value to store if the current value equals expected.
+   *
+   * @return true if the value was replaced.
+   */
+  bool compare_exchange(uint32_t &expected, uint32_t desired);
 };
 
 }  // namespace chre
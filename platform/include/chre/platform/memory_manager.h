@@ -30,11 +30,23 @@
 #define CHRE_MAX_ALLOCATION_BYTES 262144  // 256 * 1024
 #endif
 
+// This default value can be overridden in the variant-specific makefile.
+#ifndef CHRE_NANOAPP_SLAB_BYTES
+#define CHRE_NANOAPP_SLAB_BYTES 2048
+#endif
+
 namespace chre {
 
 /**
  * The MemoryManager keeps track of heap memory allocated/deallocated by all
  * nanoapps.
+ *
+ * When CHRE_NANOAPP_SLAB_ALLOCATOR_ENABLED is defined, small allocations are
+ * served from fixed-size blocks carved out of slabs owned by the requesting
+ * nanoapp. This avoids the per-allocation header and platform heap call, and
+ * lets all the slabs of a nanoapp be released at once when it is unloaded.
+ * Larger allocations, or small ones for which no slab could be allocated, go
+ * to the platform heap.
  */
 class MemoryManager : public NonCopyable {
  public:
@@ -98,6 +110,44 @@ class MemoryManager : public NonCopyable {
     return kMaxAllocationCount;
   }
 
+#ifdef CHRE_NANOAPP_SLAB_ALLOCATOR_ENABLED
+  //! The slab usage of a nanoapp.
+  struct SlabStats {
+    //! The number of slabs owned by the nanoapp.
+    size_t slabCount = 0;
+
+    //! The memory reserved by the slabs in bytes, including their headers.
+    size_t reservedBytes = 0;
+
+    //! The memory of the allocated blocks in bytes, rounded up to the sizes
+    //! of their size classes.
+    size_t blockBytes = 0;
+
+    //! The memory requested by the nanoapp from its slabs in bytes.
+    size_t requestedBytes = 0;
+  };
+
+  /**
+   * @param instanceId The instance ID of the nanoapp.
+   * @return The current slab usage of the nanoapp.
+   */
+  SlabStats getSlabStats(uint16_t instanceId) const;
+
+  /**
+   * @return current memory reserved by the slabs of all nanoapps in bytes.
+   */
+  size_t getSlabReservedBytes() const {
+    return mSlabReservedBytes;
+  }
+
+  /**
+   * @return peak memory reserved by the slabs of all nanoapps in bytes.
+   */
+  size_t getPeakSlabReservedBytes() const {
+    return mPeakSlabReservedBytes;
+  }
+#endif  // CHRE_NANOAPP_SLAB_ALLOCATOR_ENABLED
+
   /**
    * Prints state in a string buffer. Must only be called from the context of
    * the main CHRE thread.
@@ -123,6 +173,131 @@ class MemoryManager : public NonCopyable {
   //! The maximum allowable count of memory allocations for all nanoapps.
   static constexpr size_t kMaxAllocationCount = (8 * 1024);
 
+  /**
+   * Frees a block allocated with a HeapBlockHeader.
+   *
+   * @param app The nanoapp freeing the block.
+   * @param ptr The pointer past the header of the block.
+   * @param instanceId Set to the instance ID of the nanoapp that allocated
+   *     the block.
+   * @return The size of the block in bytes, not including the header.
+   */
+  uint32_t freeHeapBlock(Nanoapp *app, void *ptr, uint16_t *instanceId);
+
+#ifdef CHRE_NANOAPP_SLAB_ALLOCATOR_ENABLED
+  /**
+   * Header at the start of each slab. It is followed by the requested size of
+   * each block, zero for a free block, and then by the blocks themselves.
+   */
+  union SlabHeader {
+    struct {
+      //! The next slab in the list of the slabs of all nanoapps.
+      SlabHeader *next;
+
+      //! The free blocks of the slab, linked through their first word.
+      void *freeList;
+
+      //! The number of allocated blocks.
+      uint16_t usedBlocks;
+
+      //! The instance ID of the nanoapp owning the slab.
+      uint16_t instanceId;
+
+      //! The index of the size class of the blocks.
+      uint8_t sizeClass;
+    } data;
+
+    //! Makes sure header is a multiple of the size of max_align_t
+    max_align_t aligner;
+  };
+
+  //! The size of a slab in bytes, including its header.
+  static constexpr size_t kSlabBytes = CHRE_NANOAPP_SLAB_BYTES;
+
+  //! The block size of the smallest size class. Each following class doubles
+  //! the block size.
+  static constexpr size_t kMinSlabBlockSize = 16;
+
+  //! The number of size classes.
+  static constexpr uint8_t kNumSlabSizeClasses = 5;
+
+  static_assert(kMinSlabBlockSize % alignof(max_align_t) == 0,
+                "Slab blocks must keep the alignment of max_align_t");
+
+  /**
+   * @return The block size of the given size class in bytes.
+   */
+  static constexpr size_t getSlabBlockSize(uint8_t sizeClass) {
+    return kMinSlabBlockSize << sizeClass;
+  }
+
+  /**
+   * @return The number of blocks of a slab of the given size class.
+   */
+  static constexpr size_t getSlabBlockCount(uint8_t sizeClass) {
+    return (kSlabBytes - sizeof(SlabHeader) - (alignof(max_align_t) - 1)) /
+           (getSlabBlockSize(sizeClass) + sizeof(uint16_t));
+  }
+
+  //! The head of the list of the slabs of all nanoapps.
+  SlabHeader *mFirstSlab = nullptr;
+
+  //! The total memory reserved by slabs in bytes.
+  size_t mSlabReservedBytes = 0;
+
+  //! The peak memory reserved by slabs in bytes.
+  size_t mPeakSlabReservedBytes = 0;
+
+  /**
+   * @return The requested sizes of the blocks of a slab.
+   */
+  static uint16_t *getSlabRequestedSizes(SlabHeader *slab) {
+    return reinterpret_cast<uint16_t *>(slab + 1);
+  }
+
+  /**
+   * @return A pointer to the first block of a slab.
+   */
+  static uint8_t *getSlabBlocks(SlabHeader *slab);
+
+  /**
+   * Allocates a block from a slab of the nanoapp, creating a new slab if all
+   * the slabs of the right size class are full.
+   *
+   * @return The allocated block, nullptr if the allocation is too large for
+   *     the slabs or no slab could be allocated.
+   */
+  void *slabAlloc(Nanoapp *app, uint32_t bytes);
+
+  /**
+   * @return The slab containing the given pointer, nullptr if the pointer
+   *     does not belong to a slab.
+   */
+  SlabHeader *findSlab(const void *ptr) const;
+
+  /**
+   * Returns a block to its slab. An empty slab is released unless it is the
+   * only slab of its owner with free blocks of that size class, so that a
+   * nanoapp repeatedly allocating and freeing a block does not churn slabs.
+   *
+   * @return The requested size of the block, 0 if the block was not
+   *     allocated.
+   */
+  uint32_t slabFree(Nanoapp *app, SlabHeader *slab, void *ptr);
+
+  /**
+   * Releases all the slabs of the nanoapp.
+   *
+   * @return The number of allocated blocks released.
+   */
+  uint32_t slabFreeAll(Nanoapp *app);
+
+  /**
+   * Unlinks the slab from the slab list and returns it to the platform heap.
+   */
+  void releaseSlab(Nanoapp *app, SlabHeader *slab);
+#endif  // CHRE_NANOAPP_SLAB_ALLOCATOR_ENABLED
+
   /**
    * Called by nanoappAlloc to perform the appropriate call to memory alloc.
    *
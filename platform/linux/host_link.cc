@@ -23,9 +23,13 @@ void HostLink::flushMessagesSentByNanoapp(uint64_t /* appId */) {
   // TODO: implement
 }
 
-bool HostLink::sendMessage(const MessageToHost * /* message */) {
-  // TODO: implement
-  return false;
+bool HostLink::sendMessage(const MessageToHost *message) {
+  // There is no host on the Linux platform: simulate one that consumes each
+  // message as soon as it is sent, so that the nanoapp's free callback runs.
+  EventLoopManagerSingleton::get()
+      ->getHostCommsManager()
+      .onMessageToHostComplete(message);
+  return true;
 }
 
 void HostLinkBase::sendNanConfiguration(bool enable) {
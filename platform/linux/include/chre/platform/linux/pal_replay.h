@@ -0,0 +1,344 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CHRE_PLATFORM_LINUX_PAL_REPLAY_H_
+#define CHRE_PLATFORM_LINUX_PAL_REPLAY_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+#include "chre/platform/linux/pal_task.h"
+#include "chre/util/non_copyable.h"
+#include "chre_api/chre/ble.h"
+#include "chre_api/chre/gnss.h"
+#include "chre_api/chre/sensor.h"
+#include "chre_api/chre/wifi.h"
+
+namespace chre {
+
+/**
+ * Replays a recorded trace of sensor samples, GNSS locations, WiFi scans and
+ * BLE advertisements through the Linux PALs, to reproduce production load in
+ * simulation and stress the request managers and the event loop.
+ *
+ * When a trace is loaded before CHRE is initialized, the Linux sensor, GNSS,
+ * WiFi and BLE PALs are replaced by replay PALs:
+ * - The sensors are the ones declared in the trace. Enabling a sensor streams
+ *   its samples at their recorded times, regardless of the requested interval.
+ * - Starting a location session streams the recorded locations.
+ * - Enabling WiFi scan monitoring streams the recorded scans, and each scan
+ *   request is answered with the next recorded scan.
+ * - Starting a BLE scan streams the recorded advertisements.
+ *
+ * A stream starts from its first record when it is enabled, and the time
+ * between records is divided by the speed-up. The replay follows the
+ * VirtualClock if it is enabled.
+ *
+ * The delivery lag of each event, from its scheduled time to the time CHRE
+ * releases it after delivering it to all the nanoapps, is recorded per record
+ * type.
+ *
+ * The trace is a little-endian binary file made of a TraceHeader followed by
+ * records, each made of a RecordHeader and its payload. Records of a stream
+ * must be in chronological order. PalReplayTraceWriter creates traces.
+ */
+class PalReplay : public NonCopyable {
+ public:
+  //! The type of the records of a trace.
+  enum class RecordType : uint8_t {
+    //! Declares the sensor whose index is the record stream. Sensors must be
+    //! declared in order. The payload is a SensorInfo followed by the
+    //! null-terminated sensor name.
+    SensorInfo = 0,
+    //! A sample of the sensor whose index is the record stream. The payload
+    //! is 3 floats for three-axis sensors, 1 float for float sensors, or empty
+    //! for occurrence sensors.
+    SensorSample,
+    //! A GNSS location. The payload is a GnssLocation.
+    GnssLocation,
+    //! A WiFi scan. The payload is an array of WifiScanResult.
+    WifiScan,
+    //! A BLE advertisement. The payload is a BleAdvertisement followed by the
+    //! advertising data.
+    BleAdvertisement,
+    NumTypes,
+  };
+
+  //! The value of TraceHeader::magic, "CHRT".
+  static constexpr uint32_t kTraceMagic = 0x54524843;
+  static constexpr uint16_t kTraceVersion = 1;
+
+  struct TraceHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t reserved;
+  } __attribute__((packed));
+
+  struct RecordHeader {
+    //! The time of the record, in the timebase of the recording.
+    uint64_t timestampNs;
+    //! The size of the payload following the header.
+    uint16_t size;
+    RecordType type;
+    //! The sensor index for sensor records, 0 otherwise.
+    uint8_t stream;
+  } __attribute__((packed));
+
+  struct SensorInfo {
+    uint8_t sensorType;
+    uint8_t isOnChange;
+    uint8_t reserved[2];
+    uint64_t minIntervalNs;
+  } __attribute__((packed));
+
+  struct GnssLocation {
+    int32_t latitudeDegE7;
+    int32_t longitudeDegE7;
+    float altitude;
+    float speed;
+    float bearing;
+    float accuracy;
+    uint16_t flags;
+  } __attribute__((packed));
+
+  struct WifiScanResult {
+    uint8_t bssid[CHRE_WIFI_BSSID_LEN];
+    uint8_t ssidLen;
+    uint8_t ssid[CHRE_WIFI_SSID_MAX_LEN];
+    int8_t rssi;
+    uint8_t band;
+    uint32_t primaryChannel;
+  } __attribute__((packed));
+
+  struct BleAdvertisement {
+    uint8_t address[CHRE_BLE_ADDRESS_LEN];
+    uint8_t addressType;
+    int8_t rssi;
+  } __attribute__((packed));
+
+  //! A record of the loaded trace. The payload points into the trace.
+  struct Record {
+    uint64_t timestampNs;
+    const uint8_t *payload;
+    uint16_t size;
+  };
+
+  //! The delivery lag of the events of a record type.
+  struct LagStats {
+    uint32_t numEvents = 0;
+    uint64_t totalLagNs = 0;
+    uint64_t maxLagNs = 0;
+  };
+
+  /**
+   * Delivers the records of a stream at their recorded times, divided by the
+   * speed-up, starting when the stream is started.
+   */
+  class Stream : public NonCopyable {
+   public:
+    typedef std::function<void(const Record &record, uint64_t scheduledTimeNs)>
+        DeliverFunction;
+
+    /**
+     * Starts the stream, stopping any previous run first. Does nothing if
+     * there are no records.
+     *
+     * @param records The records to deliver, which must outlive the run.
+     * @param deliver Invoked for each record, with the time at which it was
+     *     scheduled.
+     */
+    void start(const std::vector<Record> &records, DeliverFunction deliver);
+
+    void stop() {
+      mTask.stop();
+    }
+
+   private:
+    PalTask mTask;
+  };
+
+  /**
+   * @return The replay engine of the process.
+   */
+  static PalReplay &getInstance();
+
+  /**
+   * Loads a trace from a file, replacing any loaded trace. Must not be called
+   * while CHRE is initialized.
+   *
+   * @return true if the trace was read and is valid.
+   */
+  bool load(const char *path);
+
+  /**
+   * Loads a trace from memory, copying it. @see load.
+   */
+  bool loadFromBuffer(const void *data, size_t size);
+
+  /**
+   * Unloads the trace so that the simulated PALs are used again, and resets
+   * the lag statistics. Must not be called while CHRE is initialized.
+   */
+  void unload();
+
+  bool isLoaded() const {
+    return mLoaded;
+  }
+
+  /**
+   * Sets how much faster than recorded the streams started afterwards run.
+   *
+   * @param speedUp The speed-up factor, which must be positive.
+   */
+  void setSpeedUp(double speedUp);
+
+  double getSpeedUp() const {
+    return mSpeedUp;
+  }
+
+  /**
+   * @return The sensors declared in the trace.
+   */
+  const std::vector<struct chreSensorInfo> &getSensors() const {
+    return mSensors;
+  }
+
+  /**
+   * @param type The type of the records, other than SensorInfo.
+   * @param stream The sensor index for SensorSample records.
+   * @return The records of a stream, in chronological order.
+   */
+  const std::vector<Record> &getRecords(RecordType type,
+                                        uint8_t stream = 0) const;
+
+  /**
+   * Allocates a zero-filled event delivered for a record scheduled at a given
+   * time, which must be freed with releaseEvent().
+   */
+  template <typename T>
+  static T *allocateEvent(uint64_t scheduledTimeNs) {
+    return static_cast<T *>(allocateEvent(sizeof(T), scheduledTimeNs));
+  }
+
+  /**
+   * Records the delivery lag of an event allocated with allocateEvent() and
+   * frees it.
+   */
+  void releaseEvent(RecordType type, void *event);
+
+  /**
+   * @return The delivery lag of the events of a record type.
+   */
+  LagStats getLagStats(RecordType type);
+
+  /**
+   * Logs the delivery lag of each record type.
+   */
+  void logLagStats();
+
+ private:
+  //! The events are preceded by the time at which their record was scheduled,
+  //! padded so that the events are suitably aligned.
+  static constexpr size_t kEventOffset = alignof(std::max_align_t);
+
+  static void *allocateEvent(size_t size, uint64_t scheduledTimeNs);
+
+  //! Parses mTrace.
+  bool parseTrace();
+
+  //! Records the lag of an event scheduled at a given time.
+  void recordLag(RecordType type, uint64_t scheduledTimeNs);
+
+  bool mLoaded = false;
+  double mSpeedUp = 1.0;
+
+  std::vector<uint8_t> mTrace;
+  std::vector<struct chreSensorInfo> mSensors;
+
+  //! The samples of each sensor.
+  std::vector<std::vector<Record>> mSensorSamples;
+
+  //! The records of the other types, indexed by type.
+  std::vector<Record> mRecords[static_cast<size_t>(RecordType::NumTypes)];
+
+  //! Protects mLagStats, which is updated on the event loop thread.
+  std::mutex mLagStatsMutex;
+  LagStats mLagStats[static_cast<size_t>(RecordType::NumTypes)];
+};
+
+/**
+ * Creates traces that can be replayed by PalReplay.
+ */
+class PalReplayTraceWriter {
+ public:
+  PalReplayTraceWriter();
+
+  /**
+   * Declares the next sensor. Its index is the number of sensors declared
+   * before it.
+   */
+  void addSensor(const struct chreSensorInfo &info);
+
+  /**
+   * @param values The sample values: 3 for three-axis sensors, 1 for float
+   *     sensors, none for occurrence sensors.
+   */
+  void addSensorSample(uint64_t timestampNs, uint8_t sensorIndex,
+                       const float *values, size_t numValues);
+
+  void addGnssLocation(uint64_t timestampNs,
+                       const struct chreGnssLocationEvent &location);
+
+  void addWifiScan(uint64_t timestampNs,
+                   const struct chreWifiScanResult *results,
+                   uint8_t numResults);
+
+  void addBleAdvertisement(uint64_t timestampNs,
+                           const struct chreBleAdvertisingReport &report);
+
+  const std::vector<uint8_t> &getData() const {
+    return mData;
+  }
+
+  /**
+   * @return true if the trace was written to the file.
+   */
+  bool writeToFile(const char *path) const;
+
+ private:
+  void addRecord(uint64_t timestampNs, PalReplay::RecordType type,
+                 uint8_t stream, const void *payload, size_t size,
+                 const void *extraPayload = nullptr, size_t extraSize = 0);
+
+  std::vector<uint8_t> mData;
+  uint8_t mNumSensors = 0;
+};
+
+}  // namespace chre
+
+const struct chrePalSensorApi *chrePalReplaySensorGetApi(
+    uint32_t requestedApiVersion);
+const struct chrePalGnssApi *chrePalReplayGnssGetApi(
+    uint32_t requestedApiVersion);
+const struct chrePalWifiApi *chrePalReplayWifiGetApi(
+    uint32_t requestedApiVersion);
+const struct chrePalBleApi *chrePalReplayBleGetApi(
+    uint32_t requestedApiVersion);
+
+#endif  // CHRE_PLATFORM_LINUX_PAL_REPLAY_H_
@@ -0,0 +1,101 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CHRE_PLATFORM_LINUX_PAL_TASK_H_
+#define CHRE_PLATFORM_LINUX_PAL_TASK_H_
+
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <thread>
+
+#include "chre/util/non_copyable.h"
+
+namespace chre {
+
+/**
+ * Runs a function on behalf of a simulated PAL, e.g. to deliver asynchronous
+ * data, after a delay and optionally periodically afterwards.
+ *
+ * The function runs on a dedicated thread, or from the VirtualClock if it is
+ * enabled when the task is started, so that the PAL follows virtual time.
+ */
+class PalTask : public NonCopyable {
+ public:
+  typedef std::function<void()> Function;
+
+  /**
+   * A function that runs on its own schedule. Returns the delay between the
+   * deadline of the current run and the next one, or kStop to stop the task.
+   */
+  typedef std::function<uint64_t()> ScheduledFunction;
+
+  //! Returned by a ScheduledFunction to stop the task.
+  static constexpr uint64_t kStop = UINT64_MAX;
+
+  ~PalTask();
+
+  /**
+   * Starts running a function, stopping any previous run first.
+   *
+   * @param function The function to run.
+   * @param delayNs The delay before the first run.
+   * @param intervalNs The interval between subsequent runs, or 0 to run the
+   *     function only once.
+   */
+  void start(Function function, uint64_t delayNs, uint64_t intervalNs = 0);
+
+  /**
+   * Starts running a function that schedules its next run itself, stopping
+   * any previous run first. Deadlines are computed from the previous deadline
+   * rather than from the time the function returned, so that they don't
+   * drift.
+   *
+   * @param function The function to run.
+   * @param delayNs The delay before the first run.
+   */
+  void startScheduled(ScheduledFunction function, uint64_t delayNs);
+
+  /**
+   * Stops the task. Once this returns, the function is not running and won't
+   * be invoked anymore. Must not be called from the function itself.
+   */
+  void stop();
+
+ private:
+  //! Runs the function in real time.
+  void run();
+
+  //! Runs the function when the virtual clock reaches its deadline.
+  static void virtualAlarmCallback(void *data);
+
+  ScheduledFunction mFunction;
+  uint64_t mDelayNs = 0;
+
+  std::thread mThread;
+  std::promise<void> mStopThread;
+
+  //! Whether the task was started with the virtual clock enabled.
+  bool mIsVirtual = false;
+
+  //! The pending alarm of the task, and its deadline, in virtual time.
+  uint64_t mAlarmId = 0;
+  uint64_t mDeadlineNs = 0;
+};
+
+}  // namespace chre
+
+#endif  // CHRE_PLATFORM_LINUX_PAL_TASK_H_
@@ -22,4 +22,23 @@
  */
 bool chrePalWifiIsScanMonitoringActive();
 
+/**
+ * Delays the response and the results of on-demand scan requests until
+ * chrePalWifiStartSendingScanResponse is called.
+ *
+ * Use this if you need to control the timing between when CHRE requests a
+ * WiFi scan and when the async callback and events are delivered.
+ *
+ * The default is to respond immediately to CHRE.
+ */
+void chrePalWifiDelayScanResponse(bool enable);
+
+/**
+ * Sends the response and the results of the pending scan request, if any.
+ *
+ * Note: This function must only be called after a call to
+ *       chrePalWifiDelayScanResponse with enable set to true.
+ */
+void chrePalWifiStartSendingScanResponse();
+
 #endif  // CHRE_PLATFORM_LINUX_PAL_WIFI_H_
\ No newline at end of file
@@ -0,0 +1,129 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CHRE_PLATFORM_LINUX_TIMERFD_DISPATCHER_H_
+#define CHRE_PLATFORM_LINUX_TIMERFD_DISPATCHER_H_
+
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+#include "chre/util/non_copyable.h"
+
+namespace chre {
+
+/**
+ * Multiplexes any number of one-shot timers, each backed by a timerfd on
+ * CLOCK_MONOTONIC, through epoll on a single long-lived thread. Timer
+ * callbacks are invoked from that thread.
+ *
+ * This avoids the thread that glibc may create for every expiration of a
+ * POSIX timer using SIGEV_THREAD notification, and the jitter that comes with
+ * it. The thread can optionally run with SCHED_FIFO priority.
+ */
+class TimerFdDispatcher : public NonCopyable {
+ public:
+  typedef void(Callback)(void *data);
+
+  /**
+   * The state of a timer registered with the dispatcher. Owned by the caller,
+   * and must outlive the registration.
+   */
+  struct Timer {
+    int fd = -1;
+    uint64_t id = 0;
+    Callback *callback = nullptr;
+    void *data = nullptr;
+  };
+
+  /**
+   * @return The dispatcher shared by the timers of the process. Its priority
+   *     is set by CHRE_LINUX_TIMER_DISPATCHER_PRIORITY if defined.
+   */
+  static TimerFdDispatcher &getInstance();
+
+  /**
+   * Starts the dispatcher thread.
+   *
+   * @param realtimePriority If non-zero, the SCHED_FIFO priority of the
+   *     dispatcher thread. Failing to set it, e.g. without CAP_SYS_NICE, is
+   *     logged and the thread keeps the default policy.
+   */
+  explicit TimerFdDispatcher(int realtimePriority = 0);
+
+  /**
+   * Stops the dispatcher thread. All timers must have been removed.
+   */
+  ~TimerFdDispatcher();
+
+  /**
+   * Creates the timerfd of a timer and starts watching it.
+   *
+   * @param timer The timer to initialize.
+   * @param callback Invoked from the dispatcher thread when the timer fires.
+   * @param data Passed to the callback.
+   * @return true on success.
+   */
+  bool addTimer(Timer *timer, Callback *callback, void *data);
+
+  /**
+   * Stops watching a timer and closes its timerfd. Once this returns, the
+   * callback of the timer is not running and won't be invoked anymore, unless
+   * this is called from the callback itself.
+   */
+  void removeTimer(Timer *timer);
+
+  /**
+   * Arms a timer to fire once after a delay, or disarms it. Pending
+   * expirations that weren't dispatched yet are discarded.
+   *
+   * @param delayNs The delay in nanoseconds, or 0 to disarm the timer.
+   * @return true on success.
+   */
+  static bool setTimer(const Timer &timer, uint64_t delayNs);
+
+  /**
+   * @return true if the timer is armed.
+   */
+  static bool isTimerActive(const Timer &timer);
+
+ private:
+  //! The maximum number of expirations handled per epoll_wait() call.
+  static constexpr int kMaxEvents = 16;
+
+  void run(int realtimePriority);
+
+  int mEpollFd = -1;
+
+  //! An eventfd used to wake the dispatcher thread up when stopping it.
+  int mWakeFd = -1;
+
+  std::thread mThread;
+
+  //! Held while dispatching, so that removeTimer() can wait for an in-flight
+  //! callback. Recursive so that timers can be removed from a callback.
+  std::recursive_mutex mMutex;
+
+  //! The registered timers, by ID. IDs are never reused, so that an
+  //! expiration reported by epoll for a removed timer is ignored.
+  std::unordered_map<uint64_t, Timer *> mTimers;
+  uint64_t mNextTimerId = 1;
+};
+
+}  // namespace chre
+
+#endif  // CHRE_PLATFORM_LINUX_TIMERFD_DISPATCHER_H_
@@ -0,0 +1,165 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CHRE_PLATFORM_LINUX_VIRTUAL_CLOCK_H_
+#define CHRE_PLATFORM_LINUX_VIRTUAL_CLOCK_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+
+#include "chre/util/non_copyable.h"
+
+namespace chre {
+
+/**
+ * A discrete-event clock for the Linux platform. While enabled, it is the
+ * source of SystemTime::getMonotonicTime(), SystemTimer expirations and the
+ * samples generated by the simulated PALs, which all schedule alarms on it.
+ *
+ * Time only moves forward when the event loop runs out of events: the clock
+ * then jumps straight to the deadline of the next alarm and invokes its
+ * callback, on the event loop thread. This lets scenarios spanning hours of
+ * timers and sensor samples run as fast as the events can be processed.
+ *
+ * Alarms added from other threads while the event loop is blocked waiting for
+ * events are dispatched by a helper thread. Alarm callbacks are expected to
+ * post an event, or the clock stops until the next event is posted.
+ */
+class VirtualClock : public NonCopyable {
+ public:
+  typedef void(Callback)(void *data);
+
+  /**
+   * @return The clock of the process.
+   */
+  static VirtualClock &getInstance();
+
+  /**
+   * Switches to virtual time, starting from the current monotonic time. Must
+   * be called before CHRE is initialized, as timers that are already armed
+   * keep running in real time.
+   */
+  void enable();
+
+  /**
+   * Switches back to real time and drops any pending alarm. Must be called
+   * after CHRE is deinitialized. The monotonic time may go backwards.
+   */
+  void disable();
+
+  bool isEnabled() const {
+    return mEnabled.load(std::memory_order_relaxed);
+  }
+
+  /**
+   * @return The current virtual time in nanoseconds.
+   */
+  uint64_t getTimeNs() const {
+    return mNowNs.load(std::memory_order_relaxed);
+  }
+
+  /**
+   * Schedules a callback at a virtual time. Alarms with the same deadline
+   * fire in the order they were added.
+   *
+   * @param deadlineNs The virtual time at which the callback is invoked. A
+   *     deadline in the past fires at the next opportunity.
+   * @param callback Invoked when the deadline is reached.
+   * @param data Passed to the callback.
+   * @return The ID of the alarm, never 0.
+   */
+  uint64_t addAlarm(uint64_t deadlineNs, Callback *callback, void *data);
+
+  /**
+   * Cancels an alarm. Once this returns, the callback of the alarm is not
+   * running, unless this is called from an alarm callback.
+   *
+   * @param alarmId The alarm to cancel. Reset to 0.
+   * @return true if the alarm was pending.
+   */
+  bool cancelAlarm(uint64_t *alarmId);
+
+  /**
+   * @return true if the alarm was added and hasn't fired nor been cancelled.
+   */
+  bool isAlarmPending(uint64_t alarmId);
+
+  /**
+   * Invoked on the event loop thread when it has no pending events. Jumps to
+   * the next deadline and dispatches the first alarm due.
+   *
+   * @return true if an alarm was dispatched, false if there was none, in
+   *     which case the event loop is marked as idle.
+   */
+  bool onEventLoopIdle();
+
+  /**
+   * Invoked on the event loop thread when it starts processing events.
+   */
+  void onEventLoopBusy();
+
+ private:
+  //! The alarms, ordered by deadline then ID, to their callback and data.
+  typedef std::map<std::pair<uint64_t, uint64_t>, std::pair<Callback *, void *>>
+      AlarmMap;
+
+  /**
+   * Dispatches the first alarm due, jumping to its deadline if it is in the
+   * future.
+   *
+   * @param markIdle Whether to mark the event loop idle if there was no alarm.
+   * @return true if an alarm was dispatched.
+   */
+  bool dispatchNextAlarm(bool markIdle);
+
+  //! Dispatches alarms added while the event loop is idle.
+  void runWakeThread();
+
+  std::atomic<bool> mEnabled{false};
+  std::atomic<uint64_t> mNowNs{0};
+
+  //! Protects the state below.
+  std::mutex mMutex;
+
+  //! Held while an alarm callback runs, so that cancelAlarm() can wait for it.
+  //! Recursive so that alarms can be cancelled from a callback.
+  std::recursive_mutex mDispatchMutex;
+
+  AlarmMap mAlarms;
+
+  //! The deadline of each pending alarm, by ID.
+  std::unordered_map<uint64_t, uint64_t> mAlarmDeadlines;
+  uint64_t mNextAlarmId = 1;
+
+  //! Whether the event loop is blocked waiting for events, and won't dispatch
+  //! alarms until one is posted.
+  bool mEventLoopIdle = false;
+
+  std::thread mWakeThread;
+  std::condition_variable mWakeCondVar;
+  bool mWakeRequested = false;
+  bool mStopWakeThread = false;
+};
+
+}  // namespace chre
+
+#endif  // CHRE_PLATFORM_LINUX_VIRTUAL_CLOCK_H_
@@ -21,8 +21,36 @@
 #include <time.h>
 #include <cinttypes>
 
+#ifdef CHRE_LINUX_TIMERFD_SYSTEM_TIMER_ENABLED
+#include "chre/platform/linux/timerfd_dispatcher.h"
+#endif  // CHRE_LINUX_TIMERFD_SYSTEM_TIMER_ENABLED
+
 namespace chre {
 
+#ifdef CHRE_LINUX_TIMERFD_SYSTEM_TIMER_ENABLED
+
+/**
+ * The Linux base class for the SystemTimer. The timerfd implementation
+ * multiplexes all timers on the thread of the TimerFdDispatcher.
+ */
+class SystemTimerBase {
+ protected:
+  //! The timerfd of this timer, registered with the dispatcher.
+  TimerFdDispatcher::Timer mTimer;
+
+  //! Tracks whether the timer has been initialized correctly.
+  bool mInitialized = false;
+
+  //! The pending alarm of this timer while the virtual clock is enabled.
+  uint64_t mVirtualAlarmId = 0;
+
+  //! A static method that is invoked by the dispatcher thread, or by the
+  //! virtual clock.
+  static void systemTimerNotifyCallback(void *data);
+};
+
+#else
+
 /**
  * The Linux base class for the SystemTimer. The Linux implementation uses a
  * POSIX timer.
@@ -35,13 +63,21 @@ class SystemTimerBase {
   //! Tracks whether the timer has been initialized correctly.
   bool mInitialized = false;
 
+  //! The pending alarm of this timer while the virtual clock is enabled.
+  uint64_t mVirtualAlarmId = 0;
+
   //! A static method that is invoked by the underlying POSIX timer.
   static void systemTimerNotifyCallback(union sigval cookie);
 
+  //! A static method that is invoked by the virtual clock.
+  static void virtualAlarmCallback(void *data);
+
   //! A utility function to set a POSIX timer.
   bool setInternal(uint64_t delayNs);
 };
 
+#endif  // CHRE_LINUX_TIMERFD_SYSTEM_TIMER_ENABLED
+
 }  // namespace chre
 
 #endif  // CHRE_PLATFORM_LINUX_SYSTEM_TIMER_BASE_H_
@@ -16,6 +16,7 @@
 
 #include "chre/pal/ble.h"
 
+#include "chre/platform/linux/pal_replay.h"
 #include "chre/util/memory.h"
 #include "chre/util/unique_ptr.h"
 
@@ -145,6 +146,10 @@ bool chrePalIsBleEnabled() {
 }
 
 const struct chrePalBleApi *chrePalBleGetApi(uint32_t requestedApiVersion) {
+  if (chre::PalReplay::getInstance().isLoaded()) {
+    return chrePalReplayBleGetApi(requestedApiVersion);
+  }
+
   static const struct chrePalBleApi kApi = {
       .moduleVersion = CHRE_PAL_BLE_API_CURRENT_VERSION,
       .open = chrePalBleApiOpen,
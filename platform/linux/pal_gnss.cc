@@ -17,13 +17,13 @@
 #include "chre/platform/linux/pal_gnss.h"
 #include "chre/pal/gnss.h"
 
+#include "chre/platform/linux/pal_replay.h"
+#include "chre/platform/linux/pal_task.h"
 #include "chre/util/memory.h"
+#include "chre/util/time.h"
 #include "chre/util/unique_ptr.h"
 
-#include <chrono>
 #include <cinttypes>
-#include <future>
-#include <thread>
 
 /**
  * A simulated implementation of the GNSS PAL for the linux platform.
@@ -32,54 +32,64 @@ namespace {
 const struct chrePalSystemApi *gSystemApi = nullptr;
 const struct chrePalGnssCallbacks *gCallbacks = nullptr;
 
-//! Thread to deliver asynchronous location data after a CHRE request.
-std::thread gLocationEventsThread;
-std::promise<void> gStopLocationEventsThread;
-std::promise<void> gStartLocationEvents;
+//! Task to deliver asynchronous location data after a CHRE request.
+chre::PalTask gLocationEventsTask;
 bool gDelaySendingLocationEvents = false;
 bool gIsLocationEnabled = false;
 
-//! Thead to use when delivering a location status update.
-std::thread gLocationStatusThread;
+//! Whether a location session is waiting for
+//! chrePalGnssStartSendingLocationEvents() to start, and its interval.
+bool gLocationStartPending = false;
+uint32_t gLocationMinIntervalMs = 0;
 
-//! Thread to deliver asynchronous measurement data after a CHRE request.
-std::thread gMeasurementEventsThread;
-std::promise<void> gStopMeasurementEventsThread;
+//! Task to use when delivering a location status update.
+chre::PalTask gLocationStatusTask;
+
+//! Task to deliver asynchronous measurement data after a CHRE request.
+chre::PalTask gMeasurementEventsTask;
 bool gIsMeasurementEnabled = false;
 
-//! Thead to use when delivering a measurement status update.
-std::thread gMeasurementStatusThread;
+//! Task to use when delivering a measurement status update.
+chre::PalTask gMeasurementStatusTask;
 
-void sendLocationEvents(uint32_t minIntervalMs) {
-  if (gDelaySendingLocationEvents) {
-    gStartLocationEvents.get_future().wait();
-  }
-  gCallbacks->locationStatusChangeCallback(true, CHRE_ERROR_NONE);
-
-  std::future<void> signal = gStopLocationEventsThread.get_future();
-  while (signal.wait_for(std::chrono::milliseconds(minIntervalMs)) ==
-         std::future_status::timeout) {
-    auto event = chre::MakeUniqueZeroFill<struct chreGnssLocationEvent>();
-    event->timestamp = gSystemApi->getCurrentTime();
-    gCallbacks->locationEventCallback(event.release());
-  }
+void sendLocationEvent() {
+  auto event = chre::MakeUniqueZeroFill<struct chreGnssLocationEvent>();
+  event->timestamp = gSystemApi->getCurrentTime();
+  gCallbacks->locationEventCallback(event.release());
 }
 
-void sendMeasurementEvents(uint32_t minIntervalMs) {
-  gCallbacks->measurementStatusChangeCallback(true, CHRE_ERROR_NONE);
+void sendMeasurementEvent() {
+  auto event = chre::MakeUniqueZeroFill<struct chreGnssDataEvent>();
+  auto measurement = chre::MakeUniqueZeroFill<struct chreGnssMeasurement>();
+  measurement->c_n0_dbhz = 63.0f;
 
-  std::future<void> signal = gStopMeasurementEventsThread.get_future();
-  while (signal.wait_for(std::chrono::milliseconds(minIntervalMs)) ==
-         std::future_status::timeout) {
-    auto event = chre::MakeUniqueZeroFill<struct chreGnssDataEvent>();
-    auto measurement = chre::MakeUniqueZeroFill<struct chreGnssMeasurement>();
-    measurement->c_n0_dbhz = 63.0f;
+  event->measurements = measurement.release();
+  event->measurement_count = 1;
+  event->clock.time_ns = static_cast<int64_t>(gSystemApi->getCurrentTime());
+  gCallbacks->measurementEventCallback(event.release());
+}
 
-    event->measurements = measurement.release();
-    event->measurement_count = 1;
-    event->clock.time_ns = static_cast<int64_t>(gSystemApi->getCurrentTime());
-    gCallbacks->measurementEventCallback(event.release());
-  }
+void startLocation(uint32_t minIntervalMs) {
+  gLocationStatusTask.start(
+      [minIntervalMs]() {
+        gCallbacks->locationStatusChangeCallback(true, CHRE_ERROR_NONE);
+        uint64_t intervalNs =
+            minIntervalMs * chre::kOneMillisecondInNanoseconds;
+        gLocationEventsTask.start(sendLocationEvent, intervalNs, intervalNs);
+      },
+      0 /* delayNs */);
+}
+
+void startMeasurement(uint32_t minIntervalMs) {
+  gMeasurementStatusTask.start(
+      [minIntervalMs]() {
+        gCallbacks->measurementStatusChangeCallback(true, CHRE_ERROR_NONE);
+        uint64_t intervalNs =
+            minIntervalMs * chre::kOneMillisecondInNanoseconds;
+        gMeasurementEventsTask.start(sendMeasurementEvent, intervalNs,
+                                     intervalNs);
+      },
+      0 /* delayNs */);
 }
 
 void stopLocation() {
@@ -90,24 +100,14 @@ void stopMeasurement() {
   gCallbacks->measurementStatusChangeCallback(false, CHRE_ERROR_NONE);
 }
 
-void stopLocationThreads() {
-  if (gLocationEventsThread.joinable()) {
-    gStopLocationEventsThread.set_value();
-    gLocationEventsThread.join();
-  }
-  if (gLocationStatusThread.joinable()) {
-    gLocationStatusThread.join();
-  }
+void stopLocationTasks() {
+  gLocationStatusTask.stop();
+  gLocationEventsTask.stop();
 }
 
-void stopMeasurementThreads() {
-  if (gMeasurementEventsThread.joinable()) {
-    gStopMeasurementEventsThread.set_value();
-    gMeasurementEventsThread.join();
-  }
-  if (gMeasurementStatusThread.joinable()) {
-    gMeasurementStatusThread.join();
-  }
+void stopMeasurementTasks() {
+  gMeasurementStatusTask.stop();
+  gMeasurementEventsTask.stop();
 }
 
 uint32_t chrePalGnssGetCapabilities() {
@@ -117,14 +117,18 @@ uint32_t chrePalGnssGetCapabilities() {
 
 bool chrePalControlLocationSession(bool enable, uint32_t minIntervalMs,
                                    uint32_t /* minTimeToNextFixMs */) {
-  stopLocationThreads();
+  stopLocationTasks();
+  gLocationStartPending = false;
 
   if (enable) {
-    gStartLocationEvents = std::promise<void>();
-    gStopLocationEventsThread = std::promise<void>();
-    gLocationEventsThread = std::thread(sendLocationEvents, minIntervalMs);
+    if (gDelaySendingLocationEvents) {
+      gLocationStartPending = true;
+      gLocationMinIntervalMs = minIntervalMs;
+    } else {
+      startLocation(minIntervalMs);
+    }
   } else {
-    gLocationStatusThread = std::thread(stopLocation);
+    gLocationStatusTask.start(stopLocation, 0 /* delayNs */);
   }
 
   gIsLocationEnabled = enable;
@@ -137,14 +141,12 @@ void chrePalGnssReleaseLocationEvent(struct chreGnssLocationEvent *event) {
 }
 
 bool chrePalControlMeasurementSession(bool enable, uint32_t minIntervalMs) {
-  stopMeasurementThreads();
+  stopMeasurementTasks();
 
   if (enable) {
-    gStopMeasurementEventsThread = std::promise<void>();
-    gMeasurementEventsThread =
-        std::thread(sendMeasurementEvents, minIntervalMs);
+    startMeasurement(minIntervalMs);
   } else {
-    gMeasurementStatusThread = std::thread(stopMeasurement);
+    gMeasurementStatusTask.start(stopMeasurement, 0 /* delayNs */);
   }
 
   gIsMeasurementEnabled = enable;
@@ -159,8 +161,8 @@ void chrePalGnssReleaseMeasurementDataEvent(struct chreGnssDataEvent *event) {
 }
 
 void chrePalGnssApiClose() {
-  stopLocationThreads();
-  stopMeasurementThreads();
+  stopLocationTasks();
+  stopMeasurementTasks();
 }
 
 bool chrePalGnssApiOpen(const struct chrePalSystemApi *systemApi,
@@ -204,10 +206,17 @@ void chrePalGnssDelaySendingLocationEvents(bool enabled) {
 
 void chrePalGnssStartSendingLocationEvents() {
   CHRE_ASSERT(gDelaySendingLocationEvents);
-  gStartLocationEvents.set_value();
+  if (gLocationStartPending) {
+    gLocationStartPending = false;
+    startLocation(gLocationMinIntervalMs);
+  }
 }
 
 const struct chrePalGnssApi *chrePalGnssGetApi(uint32_t requestedApiVersion) {
+  if (chre::PalReplay::getInstance().isLoaded()) {
+    return chrePalReplayGnssGetApi(requestedApiVersion);
+  }
+
   static const struct chrePalGnssApi kApi = {
       .moduleVersion = CHRE_PAL_GNSS_API_CURRENT_VERSION,
       .open = chrePalGnssApiOpen,
@@ -0,0 +1,404 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "chre/platform/linux/pal_replay.h"
+
+#include <cinttypes>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+#include "chre/platform/assert.h"
+#include "chre/platform/log.h"
+#include "chre/platform/memory.h"
+#include "chre/platform/system_time.h"
+
+namespace chre {
+
+namespace {
+
+const char *getRecordTypeName(PalReplay::RecordType type) {
+  switch (type) {
+    case PalReplay::RecordType::SensorInfo:
+      return "sensor info";
+    case PalReplay::RecordType::SensorSample:
+      return "sensor";
+    case PalReplay::RecordType::GnssLocation:
+      return "GNSS location";
+    case PalReplay::RecordType::WifiScan:
+      return "WiFi scan";
+    case PalReplay::RecordType::BleAdvertisement:
+      return "BLE advertisement";
+    default:
+      return "unknown";
+  }
+}
+
+//! Whether the size of a sensor sample payload matches a known sample layout.
+bool isValidSensorSampleSize(size_t size) {
+  return size == 0 || size == sizeof(float) || size == 3 * sizeof(float);
+}
+
+}  // anonymous namespace
+
+void PalReplay::Stream::start(const std::vector<Record> &records,
+                              DeliverFunction deliver) {
+  stop();
+  if (records.empty()) {
+    return;
+  }
+
+  const uint64_t startTimeNs =
+      SystemTime::getMonotonicTime().toRawNanoseconds();
+  const uint64_t firstTimestampNs = records.front().timestampNs;
+  const double speedUp = PalReplay::getInstance().getSpeedUp();
+  auto getScheduledTimeNs = [=](const Record &record) {
+    return startTimeNs + static_cast<uint64_t>(
+                             (record.timestampNs - firstTimestampNs) / speedUp);
+  };
+
+  size_t next = 0;
+  mTask.startScheduled(
+      [&records, deliver = std::move(deliver), getScheduledTimeNs,
+       next]() mutable {
+        const uint64_t scheduledTimeNs = getScheduledTimeNs(records[next]);
+        deliver(records[next], scheduledTimeNs);
+        if (++next == records.size()) {
+          return PalTask::kStop;
+        }
+        return getScheduledTimeNs(records[next]) - scheduledTimeNs;
+      },
+      0 /* delayNs */);
+}
+
+PalReplay &PalReplay::getInstance() {
+  // Leaked so that it outlives the PALs during static destruction.
+  static PalReplay *instance = new PalReplay();
+  return *instance;
+}
+
+bool PalReplay::load(const char *path) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file) {
+    LOGE("Failed to open replay trace %s", path);
+    return false;
+  }
+
+  unload();
+  mTrace.assign(std::istreambuf_iterator<char>(file),
+                std::istreambuf_iterator<char>());
+  mLoaded = parseTrace();
+  if (!mLoaded) {
+    LOGE("Invalid replay trace %s", path);
+    unload();
+  }
+  return mLoaded;
+}
+
+bool PalReplay::loadFromBuffer(const void *data, size_t size) {
+  unload();
+  const auto *bytes = static_cast<const uint8_t *>(data);
+  mTrace.assign(bytes, bytes + size);
+  mLoaded = parseTrace();
+  if (!mLoaded) {
+    LOGE("Invalid replay trace");
+    unload();
+  }
+  return mLoaded;
+}
+
+void PalReplay::unload() {
+  mLoaded = false;
+  mTrace.clear();
+  mSensors.clear();
+  mSensorSamples.clear();
+  for (std::vector<Record> &records : mRecords) {
+    records.clear();
+  }
+
+  std::lock_guard<std::mutex> lock(mLagStatsMutex);
+  for (LagStats &stats : mLagStats) {
+    stats = LagStats();
+  }
+}
+
+void PalReplay::setSpeedUp(double speedUp) {
+  CHRE_ASSERT(speedUp > 0);
+  mSpeedUp = speedUp;
+}
+
+const std::vector<PalReplay::Record> &PalReplay::getRecords(
+    RecordType type, uint8_t stream) const {
+  CHRE_ASSERT(type != RecordType::SensorInfo && type < RecordType::NumTypes);
+  if (type == RecordType::SensorSample) {
+    return mSensorSamples[stream];
+  }
+  return mRecords[static_cast<size_t>(type)];
+}
+
+PalReplay::LagStats PalReplay::getLagStats(RecordType type) {
+  std::lock_guard<std::mutex> lock(mLagStatsMutex);
+  return mLagStats[static_cast<size_t>(type)];
+}
+
+void PalReplay::logLagStats() {
+  std::lock_guard<std::mutex> lock(mLagStatsMutex);
+  for (size_t i = 0; i < static_cast<size_t>(RecordType::NumTypes); i++) {
+    const LagStats &stats = mLagStats[i];
+    if (stats.numEvents > 0) {
+      LOGI("Replay %s events: %" PRIu32 ", mean lag %" PRIu64
+           " ns, max lag %" PRIu64 " ns",
+           getRecordTypeName(static_cast<RecordType>(i)), stats.numEvents,
+           stats.totalLagNs / stats.numEvents, stats.maxLagNs);
+    }
+  }
+}
+
+bool PalReplay::parseTrace() {
+  TraceHeader traceHeader;
+  if (mTrace.size() < sizeof(traceHeader)) {
+    return false;
+  }
+  memcpy(&traceHeader, mTrace.data(), sizeof(traceHeader));
+  if (traceHeader.magic != kTraceMagic ||
+      traceHeader.version != kTraceVersion) {
+    LOGE("Unsupported replay trace magic 0x%" PRIx32 " version %" PRIu16,
+         traceHeader.magic, traceHeader.version);
+    return false;
+  }
+
+  size_t offset = sizeof(traceHeader);
+  while (offset < mTrace.size()) {
+    RecordHeader header;
+    if (mTrace.size() - offset < sizeof(header)) {
+      LOGE("Truncated replay record header at offset %zu", offset);
+      return false;
+    }
+    memcpy(&header, &mTrace[offset], sizeof(header));
+    offset += sizeof(header);
+    if (mTrace.size() - offset < header.size) {
+      LOGE("Truncated replay record payload at offset %zu", offset);
+      return false;
+    }
+
+    const Record record = {
+        .timestampNs = header.timestampNs,
+        .payload = &mTrace[offset],
+        .size = header.size,
+    };
+    offset += header.size;
+
+    bool valid = true;
+    std::vector<Record> *records = nullptr;
+    switch (header.type) {
+      case RecordType::SensorInfo: {
+        SensorInfo info;
+        valid = header.stream == mSensors.size() &&
+                header.size > sizeof(info) &&
+                record.payload[header.size - 1] == '\0';
+        if (valid) {
+          memcpy(&info, record.payload, sizeof(info));
+          struct chreSensorInfo sensor = {};
+          sensor.sensorName =
+              reinterpret_cast<const char *>(record.payload + sizeof(info));
+          sensor.sensorType = info.sensorType;
+          sensor.isOnChange = info.isOnChange;
+          sensor.minInterval = info.minIntervalNs;
+          sensor.sensorIndex = CHRE_SENSOR_INDEX_DEFAULT;
+          mSensors.push_back(sensor);
+          mSensorSamples.emplace_back();
+        }
+        break;
+      }
+
+      case RecordType::SensorSample:
+        valid = header.stream < mSensors.size() &&
+                isValidSensorSampleSize(header.size);
+        if (valid) {
+          records = &mSensorSamples[header.stream];
+        }
+        break;
+
+      case RecordType::GnssLocation:
+        valid = header.size == sizeof(GnssLocation);
+        break;
+
+      case RecordType::WifiScan:
+        valid = header.size > 0 && header.size % sizeof(WifiScanResult) == 0 &&
+                header.size / sizeof(WifiScanResult) <= UINT8_MAX;
+        break;
+
+      case RecordType::BleAdvertisement:
+        valid = header.size >= sizeof(BleAdvertisement);
+        break;
+
+      default:
+        valid = false;
+    }
+
+    if (!valid) {
+      LOGE("Invalid replay %s record at offset %zu",
+           getRecordTypeName(header.type), offset - header.size);
+      return false;
+    }
+
+    if (header.type != RecordType::SensorInfo) {
+      if (records == nullptr) {
+        records = &mRecords[static_cast<size_t>(header.type)];
+      }
+      if (!records->empty() &&
+          records->back().timestampNs > record.timestampNs) {
+        LOGE("Out of order replay %s record at offset %zu",
+             getRecordTypeName(header.type), offset - header.size);
+        return false;
+      }
+      records->push_back(record);
+    }
+  }
+
+  return true;
+}
+
+void *PalReplay::allocateEvent(size_t size, uint64_t scheduledTimeNs) {
+  auto *block = static_cast<uint8_t *>(memoryAlloc(kEventOffset + size));
+  if (block == nullptr) {
+    return nullptr;
+  }
+  memset(block, 0, kEventOffset + size);
+  memcpy(block, &scheduledTimeNs, sizeof(scheduledTimeNs));
+  return block + kEventOffset;
+}
+
+void PalReplay::releaseEvent(RecordType type, void *event) {
+  uint8_t *block = static_cast<uint8_t *>(event) - kEventOffset;
+  uint64_t scheduledTimeNs;
+  memcpy(&scheduledTimeNs, block, sizeof(scheduledTimeNs));
+  recordLag(type, scheduledTimeNs);
+  memoryFree(block);
+}
+
+void PalReplay::recordLag(RecordType type, uint64_t scheduledTimeNs) {
+  const uint64_t nowNs = SystemTime::getMonotonicTime().toRawNanoseconds();
+  const uint64_t lagNs =
+      (nowNs > scheduledTimeNs) ? nowNs - scheduledTimeNs : 0;
+
+  std::lock_guard<std::mutex> lock(mLagStatsMutex);
+  LagStats &stats = mLagStats[static_cast<size_t>(type)];
+  stats.numEvents++;
+  stats.totalLagNs += lagNs;
+  if (lagNs > stats.maxLagNs) {
+    stats.maxLagNs = lagNs;
+  }
+}
+
+PalReplayTraceWriter::PalReplayTraceWriter() {
+  PalReplay::TraceHeader header = {
+      .magic = PalReplay::kTraceMagic,
+      .version = PalReplay::kTraceVersion,
+      .reserved = 0,
+  };
+  const auto *bytes = reinterpret_cast<const uint8_t *>(&header);
+  mData.insert(mData.end(), bytes, bytes + sizeof(header));
+}
+
+void PalReplayTraceWriter::addSensor(const struct chreSensorInfo &info) {
+  PalReplay::SensorInfo payload = {};
+  payload.sensorType = info.sensorType;
+  payload.isOnChange = info.isOnChange;
+  payload.minIntervalNs = info.minInterval;
+  addRecord(0 /* timestampNs */, PalReplay::RecordType::SensorInfo,
+            mNumSensors++, &payload, sizeof(payload), info.sensorName,
+            strlen(info.sensorName) + 1);
+}
+
+void PalReplayTraceWriter::addSensorSample(uint64_t timestampNs,
+                                           uint8_t sensorIndex,
+                                           const float *values,
+                                           size_t numValues) {
+  addRecord(timestampNs, PalReplay::RecordType::SensorSample, sensorIndex,
+            values, numValues * sizeof(float));
+}
+
+void PalReplayTraceWriter::addGnssLocation(
+    uint64_t timestampNs, const struct chreGnssLocationEvent &location) {
+  PalReplay::GnssLocation payload = {
+      .latitudeDegE7 = location.latitude_deg_e7,
+      .longitudeDegE7 = location.longitude_deg_e7,
+      .altitude = location.altitude,
+      .speed = location.speed,
+      .bearing = location.bearing,
+      .accuracy = location.accuracy,
+      .flags = location.flags,
+  };
+  addRecord(timestampNs, PalReplay::RecordType::GnssLocation, 0 /* stream */,
+            &payload, sizeof(payload));
+}
+
+void PalReplayTraceWriter::addWifiScan(
+    uint64_t timestampNs, const struct chreWifiScanResult *results,
+    uint8_t numResults) {
+  std::vector<PalReplay::WifiScanResult> payload(numResults);
+  for (uint8_t i = 0; i < numResults; i++) {
+    memcpy(payload[i].bssid, results[i].bssid, CHRE_WIFI_BSSID_LEN);
+    payload[i].ssidLen = results[i].ssidLen;
+    memcpy(payload[i].ssid, results[i].ssid, CHRE_WIFI_SSID_MAX_LEN);
+    payload[i].rssi = results[i].rssi;
+    payload[i].band = results[i].band;
+    payload[i].primaryChannel = results[i].primaryChannel;
+  }
+  addRecord(timestampNs, PalReplay::RecordType::WifiScan, 0 /* stream */,
+            payload.data(), payload.size() * sizeof(payload[0]));
+}
+
+void PalReplayTraceWriter::addBleAdvertisement(
+    uint64_t timestampNs, const struct chreBleAdvertisingReport &report) {
+  PalReplay::BleAdvertisement payload = {};
+  memcpy(payload.address, report.address, CHRE_BLE_ADDRESS_LEN);
+  payload.addressType = report.addressType;
+  payload.rssi = report.rssi;
+  addRecord(timestampNs, PalReplay::RecordType::BleAdvertisement,
+            0 /* stream */, &payload, sizeof(payload), report.data,
+            report.dataLength);
+}
+
+bool PalReplayTraceWriter::writeToFile(const char *path) const {
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  file.write(reinterpret_cast<const char *>(mData.data()), mData.size());
+  return static_cast<bool>(file);
+}
+
+void PalReplayTraceWriter::addRecord(uint64_t timestampNs,
+                                     PalReplay::RecordType type,
+                                     uint8_t stream, const void *payload,
+                                     size_t size, const void *extraPayload,
+                                     size_t extraSize) {
+  CHRE_ASSERT(size + extraSize <= UINT16_MAX);
+  PalReplay::RecordHeader header = {
+      .timestampNs = timestampNs,
+      .size = static_cast<uint16_t>(size + extraSize),
+      .type = type,
+      .stream = stream,
+  };
+
+  const auto *bytes = reinterpret_cast<const uint8_t *>(&header);
+  mData.insert(mData.end(), bytes, bytes + sizeof(header));
+  bytes = static_cast<const uint8_t *>(payload);
+  mData.insert(mData.end(), bytes, bytes + size);
+  bytes = static_cast<const uint8_t *>(extraPayload);
+  mData.insert(mData.end(), bytes, bytes + extraSize);
+}
+
+}  // namespace chre
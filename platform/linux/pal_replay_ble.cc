@@ -0,0 +1,167 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "chre/pal/ble.h"
+
+#include "chre/platform/linux/pal_replay.h"
+#include "chre/platform/linux/pal_task.h"
+#include "chre/platform/log.h"
+#include "chre/platform/memory.h"
+#include "chre/util/unique_ptr.h"
+
+#include <cstring>
+
+/**
+ * An implementation of the BLE PAL for the linux platform that replays the
+ * advertisements of the trace loaded in PalReplay.
+ */
+namespace {
+using chre::PalReplay;
+
+const struct chrePalSystemApi *gSystemApi = nullptr;
+const struct chrePalBleCallbacks *gCallbacks = nullptr;
+
+PalReplay::Stream gAdvertisementStream;
+
+//! Task to use when delivering a scan status update.
+chre::PalTask gScanStatusTask;
+
+void sendAdvertisementEvent(const PalReplay::Record &record,
+                            uint64_t scheduledTimeNs) {
+  PalReplay::BleAdvertisement advertisement;
+  memcpy(&advertisement, record.payload, sizeof(advertisement));
+  const uint16_t dataLength =
+      static_cast<uint16_t>(record.size - sizeof(advertisement));
+
+  auto report = chre::MakeUniqueZeroFill<struct chreBleAdvertisingReport>();
+  auto *data = static_cast<uint8_t *>(chre::memoryAlloc(dataLength));
+  auto *event = PalReplay::allocateEvent<struct chreBleAdvertisementEvent>(
+      scheduledTimeNs);
+  if (report.isNull() || (data == nullptr && dataLength > 0) ||
+      event == nullptr) {
+    LOG_OOM();
+    chre::memoryFree(data);
+    if (event != nullptr) {
+      PalReplay::getInstance().releaseEvent(
+          PalReplay::RecordType::BleAdvertisement, event);
+    }
+    return;
+  }
+
+  memcpy(data, record.payload + sizeof(advertisement), dataLength);
+  report->timestamp = scheduledTimeNs;
+  report->eventTypeAndDataStatus = CHRE_BLE_EVENT_TYPE_LEGACY_ADV_IND;
+  report->addressType = advertisement.addressType;
+  memcpy(report->address, advertisement.address, CHRE_BLE_ADDRESS_LEN);
+  report->primaryPhy = CHRE_BLE_PHY_1M;
+  report->txPower = CHRE_BLE_TX_POWER_NONE;
+  report->rssi = advertisement.rssi;
+  report->data = data;
+  report->dataLength = dataLength;
+
+  event->numReports = 1;
+  event->reports = report.release();
+  gCallbacks->advertisingEventCallback(event);
+}
+
+uint32_t chrePalReplayBleGetCapabilities() {
+  return CHRE_BLE_CAPABILITIES_SCAN;
+}
+
+uint32_t chrePalReplayBleGetFilterCapabilities() {
+  return CHRE_BLE_FILTER_CAPABILITIES_NONE;
+}
+
+bool chrePalReplayBleStartScan(chreBleScanMode /* mode */,
+                               uint32_t /* reportDelayMs */,
+                               const struct chreBleScanFilter * /* filter */) {
+  gScanStatusTask.stop();
+  gAdvertisementStream.stop();
+
+  gScanStatusTask.start(
+      []() {
+        gCallbacks->scanStatusChangeCallback(true, CHRE_ERROR_NONE);
+        gAdvertisementStream.start(
+            PalReplay::getInstance().getRecords(
+                PalReplay::RecordType::BleAdvertisement),
+            sendAdvertisementEvent);
+      },
+      0 /* delayNs */);
+  return true;
+}
+
+bool chrePalReplayBleStopScan() {
+  gScanStatusTask.stop();
+  gAdvertisementStream.stop();
+
+  gScanStatusTask.start(
+      []() { gCallbacks->scanStatusChangeCallback(false, CHRE_ERROR_NONE); },
+      0 /* delayNs */);
+  return true;
+}
+
+void chrePalReplayBleReleaseAdvertisingEvent(
+    struct chreBleAdvertisementEvent *event) {
+  for (uint16_t i = 0; i < event->numReports; i++) {
+    chre::memoryFree(const_cast<uint8_t *>(event->reports[i].data));
+  }
+  chre::memoryFree(
+      const_cast<struct chreBleAdvertisingReport *>(event->reports));
+  PalReplay::getInstance().releaseEvent(PalReplay::RecordType::BleAdvertisement,
+                                        event);
+}
+
+void chrePalReplayBleApiClose() {
+  gScanStatusTask.stop();
+  gAdvertisementStream.stop();
+}
+
+bool chrePalReplayBleApiOpen(const struct chrePalSystemApi *systemApi,
+                             const struct chrePalBleCallbacks *callbacks) {
+  chrePalReplayBleApiClose();
+
+  bool success = false;
+  if (systemApi != nullptr && callbacks != nullptr) {
+    gSystemApi = systemApi;
+    gCallbacks = callbacks;
+    success = true;
+  }
+
+  return success;
+}
+
+}  // anonymous namespace
+
+const struct chrePalBleApi *chrePalReplayBleGetApi(
+    uint32_t requestedApiVersion) {
+  static const struct chrePalBleApi kApi = {
+      .moduleVersion = CHRE_PAL_BLE_API_CURRENT_VERSION,
+      .open = chrePalReplayBleApiOpen,
+      .close = chrePalReplayBleApiClose,
+      .getCapabilities = chrePalReplayBleGetCapabilities,
+      .getFilterCapabilities = chrePalReplayBleGetFilterCapabilities,
+      .startScan = chrePalReplayBleStartScan,
+      .stopScan = chrePalReplayBleStopScan,
+      .releaseAdvertisingEvent = chrePalReplayBleReleaseAdvertisingEvent,
+  };
+
+  if (!CHRE_PAL_VERSIONS_ARE_COMPATIBLE(kApi.moduleVersion,
+                                        requestedApiVersion)) {
+    return nullptr;
+  } else {
+    return &kApi;
+  }
+}
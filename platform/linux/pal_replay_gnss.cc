@@ -0,0 +1,147 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "chre/pal/gnss.h"
+
+#include "chre/platform/linux/pal_replay.h"
+#include "chre/platform/linux/pal_task.h"
+#include "chre/platform/log.h"
+
+#include <cstring>
+
+/**
+ * An implementation of the GNSS PAL for the linux platform that replays the
+ * locations of the trace loaded in PalReplay.
+ */
+namespace {
+using chre::PalReplay;
+
+const struct chrePalSystemApi *gSystemApi = nullptr;
+const struct chrePalGnssCallbacks *gCallbacks = nullptr;
+
+PalReplay::Stream gLocationStream;
+
+//! Task to use when delivering a location status update.
+chre::PalTask gLocationStatusTask;
+
+void sendLocationEvent(const PalReplay::Record &record,
+                       uint64_t scheduledTimeNs) {
+  PalReplay::GnssLocation location;
+  memcpy(&location, record.payload, sizeof(location));
+
+  auto *event =
+      PalReplay::allocateEvent<struct chreGnssLocationEvent>(scheduledTimeNs);
+  if (event == nullptr) {
+    LOG_OOM();
+    return;
+  }
+  event->timestamp = scheduledTimeNs;
+  event->latitude_deg_e7 = location.latitudeDegE7;
+  event->longitude_deg_e7 = location.longitudeDegE7;
+  event->altitude = location.altitude;
+  event->speed = location.speed;
+  event->bearing = location.bearing;
+  event->accuracy = location.accuracy;
+  event->flags = location.flags;
+  gCallbacks->locationEventCallback(event);
+}
+
+uint32_t chrePalReplayGnssGetCapabilities() {
+  return CHRE_GNSS_CAPABILITIES_LOCATION;
+}
+
+bool chrePalReplayControlLocationSession(bool enable,
+                                         uint32_t /* minIntervalMs */,
+                                         uint32_t /* minTimeToNextFixMs */) {
+  gLocationStatusTask.stop();
+  gLocationStream.stop();
+
+  gLocationStatusTask.start(
+      [enable]() {
+        gCallbacks->locationStatusChangeCallback(enable, CHRE_ERROR_NONE);
+        if (enable) {
+          gLocationStream.start(PalReplay::getInstance().getRecords(
+                                    PalReplay::RecordType::GnssLocation),
+                                sendLocationEvent);
+        }
+      },
+      0 /* delayNs */);
+
+  return true;
+}
+
+void chrePalReplayGnssReleaseLocationEvent(
+    struct chreGnssLocationEvent *event) {
+  PalReplay::getInstance().releaseEvent(PalReplay::RecordType::GnssLocation,
+                                        event);
+}
+
+bool chrePalReplayControlMeasurementSession(bool /* enable */,
+                                            uint32_t /* minIntervalMs */) {
+  return false;
+}
+
+void chrePalReplayGnssReleaseMeasurementDataEvent(
+    struct chreGnssDataEvent * /* event */) {}
+
+bool chrePalReplayGnssConfigurePassiveLocationListener(bool /* enable */) {
+  return false;
+}
+
+void chrePalReplayGnssApiClose() {
+  gLocationStatusTask.stop();
+  gLocationStream.stop();
+}
+
+bool chrePalReplayGnssApiOpen(const struct chrePalSystemApi *systemApi,
+                              const struct chrePalGnssCallbacks *callbacks) {
+  chrePalReplayGnssApiClose();
+
+  bool success = false;
+  if (systemApi != nullptr && callbacks != nullptr) {
+    gSystemApi = systemApi;
+    gCallbacks = callbacks;
+    success = true;
+  }
+
+  return success;
+}
+
+}  // anonymous namespace
+
+const struct chrePalGnssApi *chrePalReplayGnssGetApi(
+    uint32_t requestedApiVersion) {
+  static const struct chrePalGnssApi kApi = {
+      .moduleVersion = CHRE_PAL_GNSS_API_CURRENT_VERSION,
+      .open = chrePalReplayGnssApiOpen,
+      .close = chrePalReplayGnssApiClose,
+      .getCapabilities = chrePalReplayGnssGetCapabilities,
+      .controlLocationSession = chrePalReplayControlLocationSession,
+      .releaseLocationEvent = chrePalReplayGnssReleaseLocationEvent,
+      .controlMeasurementSession = chrePalReplayControlMeasurementSession,
+      .releaseMeasurementDataEvent =
+          chrePalReplayGnssReleaseMeasurementDataEvent,
+      .configurePassiveLocationListener =
+          chrePalReplayGnssConfigurePassiveLocationListener,
+  };
+
+  if (!CHRE_PAL_VERSIONS_ARE_COMPATIBLE(kApi.moduleVersion,
+                                        requestedApiVersion)) {
+    return nullptr;
+  } else {
+    return &kApi;
+  }
+}
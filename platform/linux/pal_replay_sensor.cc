@@ -0,0 +1,229 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "chre/pal/sensor.h"
+
+#include "chre/platform/linux/pal_replay.h"
+#include "chre/platform/memory.h"
+#include "chre/util/macros.h"
+#include "chre/util/memory.h"
+#include "chre/util/unique_ptr.h"
+
+#include <cstring>
+#include <memory>
+
+/**
+ * An implementation of the Sensor PAL for the linux platform that replays the
+ * sensor samples of the trace loaded in PalReplay.
+ */
+namespace {
+using chre::PalReplay;
+
+const struct chrePalSystemApi *gSystemApi = nullptr;
+const struct chrePalSensorCallbacks *gCallbacks = nullptr;
+
+//! The streams of the sensors, indexed like the sensors of the trace.
+std::unique_ptr<PalReplay::Stream[]> gStreams;
+size_t gNumStreams = 0;
+
+void stopStreams() {
+  for (size_t i = 0; i < gNumStreams; i++) {
+    gStreams[i].stop();
+  }
+}
+
+void chrePalReplaySensorApiClose() {
+  stopStreams();
+  gStreams.reset();
+  gNumStreams = 0;
+}
+
+bool chrePalReplaySensorApiOpen(
+    const struct chrePalSystemApi *systemApi,
+    const struct chrePalSensorCallbacks *callbacks) {
+  chrePalReplaySensorApiClose();
+
+  if (systemApi != nullptr && callbacks != nullptr) {
+    gSystemApi = systemApi;
+    gCallbacks = callbacks;
+    gNumStreams = PalReplay::getInstance().getSensors().size();
+    gStreams.reset(new PalReplay::Stream[gNumStreams]);
+    return true;
+  }
+
+  return false;
+}
+
+bool chrePalReplaySensorApiGetSensors(const struct chreSensorInfo **sensors,
+                                      uint32_t *arraySize) {
+  const std::vector<struct chreSensorInfo> &traceSensors =
+      PalReplay::getInstance().getSensors();
+  if (sensors != nullptr) {
+    *sensors = traceSensors.data();
+  }
+  if (arraySize != nullptr) {
+    *arraySize = static_cast<uint32_t>(traceSensors.size());
+  }
+  return true;
+}
+
+void sendStatusUpdate(uint32_t sensorInfoIndex, uint64_t intervalNs,
+                      bool enabled) {
+  auto status = chre::MakeUniqueZeroFill<struct chreSensorSamplingStatus>();
+  status->interval = intervalNs;
+  status->latency = 0;
+  status->enabled = enabled;
+  gCallbacks->samplingStatusUpdateCallback(sensorInfoIndex, status.release());
+}
+
+/**
+ * Allocates the data event of a sample, whose layout is given by the number
+ * of values of the sample.
+ */
+struct chreSensorDataHeader *allocateDataEvent(
+    const PalReplay::Record &record, uint64_t scheduledTimeNs) {
+  struct chreSensorDataHeader *header = nullptr;
+  if (record.size == 3 * sizeof(float)) {
+    auto *data = PalReplay::allocateEvent<struct chreSensorThreeAxisData>(
+        scheduledTimeNs);
+    if (data != nullptr) {
+      memcpy(data->readings[0].values, record.payload, record.size);
+      header = &data->header;
+    }
+  } else if (record.size == sizeof(float)) {
+    auto *data =
+        PalReplay::allocateEvent<struct chreSensorFloatData>(scheduledTimeNs);
+    if (data != nullptr) {
+      memcpy(&data->readings[0].value, record.payload, record.size);
+      header = &data->header;
+    }
+  } else {
+    auto *data = PalReplay::allocateEvent<struct chreSensorOccurrenceData>(
+        scheduledTimeNs);
+    if (data != nullptr) {
+      header = &data->header;
+    }
+  }
+  return header;
+}
+
+bool chrePalReplaySensorApiConfigureSensor(uint32_t sensorInfoIndex,
+                                           enum chreSensorConfigureMode mode,
+                                           uint64_t intervalNs,
+                                           uint64_t latencyNs) {
+  UNUSED_VAR(latencyNs);
+  if (sensorInfoIndex >= gNumStreams) {
+    return false;
+  }
+
+  PalReplay::Stream &stream = gStreams[sensorInfoIndex];
+  if (mode == CHRE_SENSOR_CONFIGURE_MODE_CONTINUOUS) {
+    stream.stop();
+    sendStatusUpdate(sensorInfoIndex, intervalNs, true /*enabled*/);
+    stream.start(
+        PalReplay::getInstance().getRecords(
+            PalReplay::RecordType::SensorSample,
+            static_cast<uint8_t>(sensorInfoIndex)),
+        [sensorInfoIndex](const PalReplay::Record &record,
+                          uint64_t scheduledTimeNs) {
+          struct chreSensorDataHeader *header =
+              allocateDataEvent(record, scheduledTimeNs);
+          if (header == nullptr) {
+            LOG_OOM();
+            return;
+          }
+          header->baseTimestamp = scheduledTimeNs;
+          header->sensorHandle = sensorInfoIndex;
+          header->readingCount = 1;
+          header->accuracy = CHRE_SENSOR_ACCURACY_HIGH;
+          gCallbacks->dataEventCallback(sensorInfoIndex, header);
+        });
+    return true;
+  }
+
+  if (mode == CHRE_SENSOR_CONFIGURE_MODE_DONE) {
+    stream.stop();
+    sendStatusUpdate(sensorInfoIndex, intervalNs, false /*enabled*/);
+    return true;
+  }
+
+  return false;
+}
+
+bool chrePalReplaySensorApiFlush(uint32_t sensorInfoIndex,
+                                 uint32_t *flushRequestId) {
+  UNUSED_VAR(sensorInfoIndex);
+  UNUSED_VAR(flushRequestId);
+  return false;
+}
+
+bool chrePalReplaySensorApiConfigureBiasEvents(uint32_t sensorInfoIndex,
+                                               bool enable,
+                                               uint64_t latencyNs) {
+  UNUSED_VAR(sensorInfoIndex);
+  UNUSED_VAR(enable);
+  UNUSED_VAR(latencyNs);
+  return false;
+}
+
+bool chrePalReplaySensorApiGetThreeAxisBias(
+    uint32_t sensorInfoIndex, struct chreSensorThreeAxisData *bias) {
+  UNUSED_VAR(sensorInfoIndex);
+  UNUSED_VAR(bias);
+  return false;
+}
+
+void chrePalReplaySensorApiReleaseSensorDataEvent(void *data) {
+  PalReplay::getInstance().releaseEvent(
+      PalReplay::RecordType::SensorSample,
+      static_cast<struct chreSensorDataHeader *>(data));
+}
+
+void chrePalReplaySensorApiReleaseSamplingStatusEvent(
+    struct chreSensorSamplingStatus *status) {
+  chre::memoryFree(status);
+}
+
+void chrePalReplaySensorApiReleaseBiasEvent(void *bias) {
+  chre::memoryFree(bias);
+}
+
+}  // namespace
+
+const struct chrePalSensorApi *chrePalReplaySensorGetApi(
+    uint32_t requestedApiVersion) {
+  static const struct chrePalSensorApi kApi = {
+      .moduleVersion = CHRE_PAL_SENSOR_API_CURRENT_VERSION,
+      .open = chrePalReplaySensorApiOpen,
+      .close = chrePalReplaySensorApiClose,
+      .getSensors = chrePalReplaySensorApiGetSensors,
+      .configureSensor = chrePalReplaySensorApiConfigureSensor,
+      .flush = chrePalReplaySensorApiFlush,
+      .configureBiasEvents = chrePalReplaySensorApiConfigureBiasEvents,
+      .getThreeAxisBias = chrePalReplaySensorApiGetThreeAxisBias,
+      .releaseSensorDataEvent = chrePalReplaySensorApiReleaseSensorDataEvent,
+      .releaseSamplingStatusEvent =
+          chrePalReplaySensorApiReleaseSamplingStatusEvent,
+      .releaseBiasEvent = chrePalReplaySensorApiReleaseBiasEvent,
+  };
+
+  if (!CHRE_PAL_VERSIONS_ARE_COMPATIBLE(kApi.moduleVersion,
+                                        requestedApiVersion)) {
+    return nullptr;
+  } else {
+    return &kApi;
+  }
+}
@@ -0,0 +1,211 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "chre/pal/wifi.h"
+
+#include "chre/platform/linux/pal_replay.h"
+#include "chre/platform/linux/pal_task.h"
+#include "chre/platform/log.h"
+#include "chre/platform/memory.h"
+#include "chre/platform/system_time.h"
+
+#include <cstring>
+
+/**
+ * An implementation of the WiFi PAL for the linux platform that replays the
+ * scans of the trace loaded in PalReplay.
+ */
+namespace {
+using chre::PalReplay;
+
+const struct chrePalSystemApi *gSystemApi = nullptr;
+const struct chrePalWifiCallbacks *gCallbacks = nullptr;
+
+//! Streams the scans while scan monitoring is active.
+PalReplay::Stream gScanMonitorStream;
+
+//! Task to use when delivering a scan monitor status update.
+chre::PalTask gScanMonitorStatusTask;
+
+//! Task to deliver the result of a scan request.
+chre::PalTask gScanRequestTask;
+
+//! The index of the scan delivered for the next scan request.
+size_t gNextRequestedScan = 0;
+
+void sendScanEvent(const PalReplay::Record &record, uint64_t scheduledTimeNs) {
+  const uint8_t resultCount =
+      static_cast<uint8_t>(record.size / sizeof(PalReplay::WifiScanResult));
+  auto *event =
+      PalReplay::allocateEvent<struct chreWifiScanEvent>(scheduledTimeNs);
+  auto *results = static_cast<struct chreWifiScanResult *>(
+      chre::memoryAlloc(resultCount * sizeof(struct chreWifiScanResult)));
+  if (event == nullptr || results == nullptr) {
+    LOG_OOM();
+    if (event != nullptr) {
+      PalReplay::getInstance().releaseEvent(PalReplay::RecordType::WifiScan,
+                                            event);
+    }
+    chre::memoryFree(results);
+    return;
+  }
+
+  memset(results, 0, resultCount * sizeof(struct chreWifiScanResult));
+  for (uint8_t i = 0; i < resultCount; i++) {
+    PalReplay::WifiScanResult result;
+    memcpy(&result, record.payload + i * sizeof(result), sizeof(result));
+    memcpy(results[i].bssid, result.bssid, CHRE_WIFI_BSSID_LEN);
+    results[i].ssidLen = result.ssidLen;
+    memcpy(results[i].ssid, result.ssid, CHRE_WIFI_SSID_MAX_LEN);
+    results[i].rssi = result.rssi;
+    results[i].band = result.band;
+    results[i].primaryChannel = result.primaryChannel;
+    results[i].centerFreqPrimary = result.primaryChannel;
+  }
+
+  event->version = CHRE_WIFI_SCAN_EVENT_VERSION;
+  event->resultCount = resultCount;
+  event->resultTotal = resultCount;
+  event->scanType = CHRE_WIFI_SCAN_TYPE_ACTIVE;
+  event->referenceTime = scheduledTimeNs;
+  event->results = results;
+  gCallbacks->scanEventCallback(event);
+}
+
+uint32_t chrePalReplayWifiGetCapabilities() {
+  return CHRE_WIFI_CAPABILITIES_SCAN_MONITORING |
+         CHRE_WIFI_CAPABILITIES_ON_DEMAND_SCAN;
+}
+
+bool chrePalReplayWifiConfigureScanMonitor(bool enable) {
+  gScanMonitorStatusTask.stop();
+  gScanMonitorStream.stop();
+
+  gScanMonitorStatusTask.start(
+      [enable]() {
+        gCallbacks->scanMonitorStatusChangeCallback(enable, CHRE_ERROR_NONE);
+        if (enable) {
+          gScanMonitorStream.start(PalReplay::getInstance().getRecords(
+                                       PalReplay::RecordType::WifiScan),
+                                   sendScanEvent);
+        }
+      },
+      0 /* delayNs */);
+
+  return true;
+}
+
+bool chrePalReplayWifiApiRequestScan(
+    const struct chreWifiScanParams * /* params */) {
+  const std::vector<PalReplay::Record> &scans =
+      PalReplay::getInstance().getRecords(PalReplay::RecordType::WifiScan);
+  if (scans.empty()) {
+    return false;
+  }
+
+  const PalReplay::Record &scan = scans[gNextRequestedScan];
+  gNextRequestedScan = (gNextRequestedScan + 1) % scans.size();
+  gScanRequestTask.start(
+      [&scan]() {
+        gCallbacks->scanResponseCallback(true, CHRE_ERROR_NONE);
+        sendScanEvent(
+            scan, chre::SystemTime::getMonotonicTime().toRawNanoseconds());
+      },
+      0 /* delayNs */);
+
+  return true;
+}
+
+bool chrePalReplayWifiApiRequestRanging(
+    const struct chreWifiRangingParams * /* params */) {
+  return false;
+}
+
+void chrePalReplayWifiApiReleaseScanEvent(struct chreWifiScanEvent *event) {
+  chre::memoryFree(const_cast<struct chreWifiScanResult *>(event->results));
+  PalReplay::getInstance().releaseEvent(PalReplay::RecordType::WifiScan,
+                                        event);
+}
+
+void chrePalReplayWifiApiReleaseRangingEvent(
+    struct chreWifiRangingEvent * /* event */) {}
+
+bool chrePalReplayWifiApiNanSubscribe(
+    const struct chreWifiNanSubscribeConfig * /* config */) {
+  return false;
+}
+
+bool chrePalReplayWifiApiNanSubscribeCancel(
+    const uint32_t /* subscriptionId */) {
+  return false;
+}
+
+void chrePalReplayWifiApiNanReleaseDiscoveryEvent(
+    struct chreWifiNanDiscoveryEvent * /* event */) {}
+
+bool chrePalReplayWifiApiRequestNanRanging(
+    const struct chreWifiNanRangingParams * /* params */) {
+  return false;
+}
+
+void chrePalReplayWifiApiClose() {
+  gScanRequestTask.stop();
+  gScanMonitorStatusTask.stop();
+  gScanMonitorStream.stop();
+}
+
+bool chrePalReplayWifiApiOpen(const struct chrePalSystemApi *systemApi,
+                              const struct chrePalWifiCallbacks *callbacks) {
+  chrePalReplayWifiApiClose();
+
+  bool success = false;
+  if (systemApi != nullptr && callbacks != nullptr) {
+    gSystemApi = systemApi;
+    gCallbacks = callbacks;
+    gNextRequestedScan = 0;
+    success = true;
+  }
+
+  return success;
+}
+
+}  // anonymous namespace
+
+const struct chrePalWifiApi *chrePalReplayWifiGetApi(
+    uint32_t requestedApiVersion) {
+  static const struct chrePalWifiApi kApi = {
+      .moduleVersion = CHRE_PAL_WIFI_API_CURRENT_VERSION,
+      .open = chrePalReplayWifiApiOpen,
+      .close = chrePalReplayWifiApiClose,
+      .getCapabilities = chrePalReplayWifiGetCapabilities,
+      .configureScanMonitor = chrePalReplayWifiConfigureScanMonitor,
+      .requestScan = chrePalReplayWifiApiRequestScan,
+      .releaseScanEvent = chrePalReplayWifiApiReleaseScanEvent,
+      .requestRanging = chrePalReplayWifiApiRequestRanging,
+      .releaseRangingEvent = chrePalReplayWifiApiReleaseRangingEvent,
+      .nanSubscribe = chrePalReplayWifiApiNanSubscribe,
+      .nanSubscribeCancel = chrePalReplayWifiApiNanSubscribeCancel,
+      .releaseNanDiscoveryEvent = chrePalReplayWifiApiNanReleaseDiscoveryEvent,
+      .requestNanRanging = chrePalReplayWifiApiRequestNanRanging,
+  };
+
+  if (!CHRE_PAL_VERSIONS_ARE_COMPATIBLE(kApi.moduleVersion,
+                                        requestedApiVersion)) {
+    return nullptr;
+  } else {
+    return &kApi;
+  }
+}
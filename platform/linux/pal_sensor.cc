@@ -16,16 +16,15 @@
 
 #include "chre/pal/sensor.h"
 
+#include "chre/platform/linux/pal_replay.h"
+#include "chre/platform/linux/pal_task.h"
 #include "chre/platform/memory.h"
 #include "chre/util/macros.h"
 #include "chre/util/memory.h"
 #include "chre/util/unique_ptr.h"
 
-#include <chrono>
 #include <cinttypes>
 #include <cstdint>
-#include <future>
-#include <thread>
 
 /**
  * A simulated implementation of the Sensor PAL for the linux platform.
@@ -48,20 +47,12 @@ struct chreSensorInfo gSensors[] = {
     },
 };
 
-//! Thread to deliver asynchronous sensor data after a CHRE request.
-std::thread gSensor0Thread;
-std::promise<void> gStopSensor0Thread;
+//! Task to deliver asynchronous sensor data after a CHRE request.
+chre::PalTask gSensor0Task;
 bool gIsSensor0Enabled = false;
 
-void stopSensor0Thread() {
-  if (gSensor0Thread.joinable()) {
-    gStopSensor0Thread.set_value();
-    gSensor0Thread.join();
-  }
-}
-
 void chrePalSensorApiClose() {
-  stopSensor0Thread();
+  gSensor0Task.stop();
 }
 
 bool chrePalSensorApiOpen(const struct chrePalSystemApi *systemApi,
@@ -96,20 +87,16 @@ void sendSensor0StatusUpdate(uint64_t intervalNs, bool enabled) {
   gCallbacks->samplingStatusUpdateCallback(0, status.release());
 }
 
-void sendSensor0Events(uint64_t intervalNs) {
-  std::future<void> signal = gStopSensor0Thread.get_future();
-  while (signal.wait_for(std::chrono::nanoseconds(intervalNs)) ==
-         std::future_status::timeout) {
-    auto data = chre::MakeUniqueZeroFill<struct chreSensorThreeAxisData>();
+void sendSensor0Event() {
+  auto data = chre::MakeUniqueZeroFill<struct chreSensorThreeAxisData>();
 
-    data->header.baseTimestamp = gSystemApi->getCurrentTime();
-    data->header.sensorHandle = 0;
-    data->header.readingCount = 1;
-    data->header.accuracy = CHRE_SENSOR_ACCURACY_UNRELIABLE;
-    data->header.reserved = 0;
+  data->header.baseTimestamp = gSystemApi->getCurrentTime();
+  data->header.sensorHandle = 0;
+  data->header.readingCount = 1;
+  data->header.accuracy = CHRE_SENSOR_ACCURACY_UNRELIABLE;
+  data->header.reserved = 0;
 
-    gCallbacks->dataEventCallback(0, data.release());
-  }
+  gCallbacks->dataEventCallback(0, data.release());
 }
 
 bool chrePalSensorApiConfigureSensor(uint32_t sensorInfoIndex,
@@ -126,16 +113,15 @@ bool chrePalSensorApiConfigureSensor(uint32_t sensorInfoIndex,
   }
 
   if (mode == CHRE_SENSOR_CONFIGURE_MODE_CONTINUOUS) {
-    stopSensor0Thread();
+    gSensor0Task.stop();
     gIsSensor0Enabled = true;
     sendSensor0StatusUpdate(intervalNs, true /*enabled*/);
-    gStopSensor0Thread = std::promise<void>();
-    gSensor0Thread = std::thread(sendSensor0Events, intervalNs);
+    gSensor0Task.start(sendSensor0Event, intervalNs /* delayNs */, intervalNs);
     return true;
   }
 
   if (mode == CHRE_SENSOR_CONFIGURE_MODE_DONE) {
-    stopSensor0Thread();
+    gSensor0Task.stop();
     gIsSensor0Enabled = false;
     sendSensor0StatusUpdate(intervalNs, false /*enabled*/);
     return true;
@@ -185,6 +171,10 @@ bool chrePalSensorIsSensor0Enabled() {
 }
 
 const chrePalSensorApi *chrePalSensorGetApi(uint32_t requestedApiVersion) {
+  if (chre::PalReplay::getInstance().isLoaded()) {
+    return chrePalReplaySensorGetApi(requestedApiVersion);
+  }
+
   static const struct chrePalSensorApi kApi = {
       .moduleVersion = CHRE_PAL_SENSOR_API_CURRENT_VERSION,
       .open = chrePalSensorApiOpen,
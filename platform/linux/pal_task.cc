@@ -0,0 +1,91 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "chre/platform/linux/pal_task.h"
+
+#include <chrono>
+
+#include "chre/platform/linux/virtual_clock.h"
+
+namespace chre {
+
+PalTask::~PalTask() {
+  stop();
+}
+
+void PalTask::start(Function function, uint64_t delayNs, uint64_t intervalNs) {
+  startScheduled(
+      [function = std::move(function), intervalNs]() {
+        function();
+        return (intervalNs == 0) ? kStop : intervalNs;
+      },
+      delayNs);
+}
+
+void PalTask::startScheduled(ScheduledFunction function, uint64_t delayNs) {
+  stop();
+
+  mFunction = std::move(function);
+  mDelayNs = delayNs;
+
+  VirtualClock &virtualClock = VirtualClock::getInstance();
+  mIsVirtual = virtualClock.isEnabled();
+  if (mIsVirtual) {
+    mDeadlineNs = virtualClock.getTimeNs() + delayNs;
+    mAlarmId = virtualClock.addAlarm(mDeadlineNs, virtualAlarmCallback, this);
+  } else {
+    mStopThread = std::promise<void>();
+    mThread = std::thread(&PalTask::run, this);
+  }
+}
+
+void PalTask::stop() {
+  if (mIsVirtual) {
+    VirtualClock::getInstance().cancelAlarm(&mAlarmId);
+    mIsVirtual = false;
+  } else if (mThread.joinable()) {
+    mStopThread.set_value();
+    mThread.join();
+  }
+}
+
+void PalTask::run() {
+  std::future<void> signal = mStopThread.get_future();
+  auto deadline =
+      std::chrono::steady_clock::now() + std::chrono::nanoseconds(mDelayNs);
+
+  while (signal.wait_until(deadline) == std::future_status::timeout) {
+    uint64_t nextDelayNs = mFunction();
+    if (nextDelayNs == kStop) {
+      break;
+    }
+    deadline += std::chrono::nanoseconds(nextDelayNs);
+  }
+}
+
+void PalTask::virtualAlarmCallback(void *data) {
+  auto *task = static_cast<PalTask *>(data);
+  task->mAlarmId = 0;
+  uint64_t nextDelayNs = task->mFunction();
+
+  if (nextDelayNs != PalTask::kStop) {
+    task->mDeadlineNs += nextDelayNs;
+    task->mAlarmId = VirtualClock::getInstance().addAlarm(
+        task->mDeadlineNs, virtualAlarmCallback, task);
+  }
+}
+
+}  // namespace chre
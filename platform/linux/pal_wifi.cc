@@ -20,10 +20,11 @@
 #include "chre/util/unique_ptr.h"
 
 #include "chre/platform/linux/pal_nan.h"
+#include "chre/platform/linux/pal_replay.h"
+#include "chre/platform/linux/pal_task.h"
 
-#include <chrono>
+#include <atomic>
 #include <cinttypes>
-#include <thread>
 
 /**
  * A simulated implementation of the WiFi PAL for the linux platform.
@@ -32,15 +33,21 @@ namespace {
 const struct chrePalSystemApi *gSystemApi = nullptr;
 const struct chrePalWifiCallbacks *gCallbacks = nullptr;
 
-//! Thread to deliver asynchronous WiFi scan results after a CHRE request.
-std::thread gScanEventsThread;
+//! Task to deliver asynchronous WiFi scan results after a CHRE request.
+chre::PalTask gScanEventsTask;
 
-//! Thread to use when delivering a scan monitor status update.
-std::thread gScanMonitorStatusThread;
+//! Task to use when delivering a scan monitor status update.
+chre::PalTask gScanMonitorStatusTask;
 
 //! Whether scan monitoring is active.
 bool gScanMonitoringActive = false;
 
+//! Whether scan responses are held until chrePalWifiStartSendingScanResponse()
+//! is called, and whether a scan request is waiting for it. Atomic as they are
+//! accessed from the test, CHRE and PAL threads.
+std::atomic<bool> gDelayScanResponse = false;
+std::atomic<bool> gScanResponsePending = false;
+
 void sendScanResponse() {
   gCallbacks->scanResponseCallback(true, CHRE_ERROR_NONE);
 
@@ -58,36 +65,25 @@ void sendScanMonitorResponse(bool enable) {
   gCallbacks->scanMonitorStatusChangeCallback(enable, CHRE_ERROR_NONE);
 }
 
-void stopScanEventThreads() {
-  if (gScanEventsThread.joinable()) {
-    gScanEventsThread.join();
-  }
-}
-
-void stopScanMonitorThreads() {
-  if (gScanMonitorStatusThread.joinable()) {
-    gScanMonitorStatusThread.join();
-  }
-}
-
 uint32_t chrePalWifiGetCapabilities() {
   return CHRE_WIFI_CAPABILITIES_SCAN_MONITORING |
          CHRE_WIFI_CAPABILITIES_ON_DEMAND_SCAN | CHRE_WIFI_CAPABILITIES_NAN_SUB;
 }
 
 bool chrePalWifiConfigureScanMonitor(bool enable) {
-  stopScanMonitorThreads();
-
-  gScanMonitorStatusThread = std::thread(sendScanMonitorResponse, enable);
+  gScanMonitorStatusTask.start([enable]() { sendScanMonitorResponse(enable); },
+                               0 /* delayNs */);
   gScanMonitoringActive = enable;
 
   return true;
 }
 
 bool chrePalWifiApiRequestScan(const struct chreWifiScanParams * /* params */) {
-  stopScanEventThreads();
-
-  gScanEventsThread = std::thread(sendScanResponse);
+  if (gDelayScanResponse) {
+    gScanResponsePending = true;
+  } else {
+    gScanEventsTask.start(sendScanResponse, 0 /* delayNs */);
+  }
 
   return true;
 }
@@ -152,8 +148,9 @@ bool chrePalWifiApiRequestNanRanging(
 }
 
 void chrePalWifiApiClose() {
-  stopScanEventThreads();
-  stopScanMonitorThreads();
+  gScanResponsePending = false;
+  gScanEventsTask.stop();
+  gScanMonitorStatusTask.stop();
 }
 
 bool chrePalWifiApiOpen(const struct chrePalSystemApi *systemApi,
@@ -179,7 +176,22 @@ bool chrePalWifiIsScanMonitoringActive() {
   return gScanMonitoringActive;
 }
 
+void chrePalWifiDelayScanResponse(bool enable) {
+  gDelayScanResponse = enable;
+}
+
+void chrePalWifiStartSendingScanResponse() {
+  CHRE_ASSERT(gDelayScanResponse);
+  if (gScanResponsePending.exchange(false)) {
+    gScanEventsTask.start(sendScanResponse, 0 /* delayNs */);
+  }
+}
+
 const struct chrePalWifiApi *chrePalWifiGetApi(uint32_t requestedApiVersion) {
+  if (chre::PalReplay::getInstance().isLoaded()) {
+    return chrePalReplayWifiGetApi(requestedApiVersion);
+  }
+
   static const struct chrePalWifiApi kApi = {
       .moduleVersion = CHRE_PAL_WIFI_API_CURRENT_VERSION,
       .open = chrePalWifiApiOpen,
@@ -16,11 +16,29 @@
 
 #include "chre/platform/power_control_manager.h"
 
+#include "chre/core/event_loop_manager.h"
+#include "chre/platform/linux/virtual_clock.h"
+
 namespace chre {
 
-void PowerControlManager::preEventLoopProcess(size_t /* numPendingEvents */) {}
+void PowerControlManager::preEventLoopProcess(size_t /* numPendingEvents */) {
+  VirtualClock &virtualClock = VirtualClock::getInstance();
+  if (virtualClock.isEnabled()) {
+    virtualClock.onEventLoopBusy();
+  }
+}
 
-void PowerControlManager::postEventLoopProcess(size_t /* numPendingEvents */) {}
+void PowerControlManager::postEventLoopProcess(size_t numPendingEvents) {
+  VirtualClock &virtualClock = VirtualClock::getInstance();
+  if (virtualClock.isEnabled()) {
+    // Before blocking for events, jump to the next virtual deadlines until one
+    // of them produces an event.
+    EventLoop &eventLoop = EventLoopManagerSingleton::get()->getEventLoop();
+    while (numPendingEvents == 0 && virtualClock.onEventLoopIdle()) {
+      numPendingEvents = eventLoop.getNumPendingEvents();
+    }
+  }
+}
 
 bool PowerControlManager::hostIsAwake() {
   return true;
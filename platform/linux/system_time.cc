@@ -21,11 +21,17 @@
 #include <ctime>
 
 #include "chre/platform/assert.h"
+#include "chre/platform/linux/virtual_clock.h"
 #include "chre/platform/log.h"
 
 namespace chre {
 
 Nanoseconds SystemTime::getMonotonicTime() {
+  const VirtualClock &virtualClock = VirtualClock::getInstance();
+  if (virtualClock.isEnabled()) {
+    return Nanoseconds(virtualClock.getTimeNs());
+  }
+
   struct timespec timeNow;
   if (clock_gettime(CLOCK_MONOTONIC, &timeNow)) {
     CHRE_ASSERT_LOG(false, "Failed to obtain time with error: %s",
@@ -14,8 +14,11 @@
  * limitations under the License.
  */
 
+#ifndef CHRE_LINUX_TIMERFD_SYSTEM_TIMER_ENABLED
+
 #include "chre/platform/system_timer.h"
 
+#include "chre/platform/linux/virtual_clock.h"
 #include "chre/platform/log.h"
 #include "chre/util/time.h"
 
@@ -42,9 +45,18 @@ void SystemTimerBase::systemTimerNotifyCallback(union sigval cookie) {
   sysTimer->mCallback(sysTimer->mData);
 }
 
+void SystemTimerBase::virtualAlarmCallback(void *data) {
+  SystemTimer *sysTimer = static_cast<SystemTimer *>(data);
+  sysTimer->mCallback(sysTimer->mData);
+}
+
 SystemTimer::SystemTimer() {}
 
 SystemTimer::~SystemTimer() {
+  if (mVirtualAlarmId != 0) {
+    VirtualClock::getInstance().cancelAlarm(&mVirtualAlarmId);
+  }
+
   if (mInitialized) {
     int ret = timer_delete(mTimerId);
     if (ret != 0) {
@@ -86,6 +98,16 @@ bool SystemTimer::set(SystemTimerCallback *callback, void *data,
   if (mInitialized) {
     mCallback = callback;
     mData = data;
+
+    VirtualClock &virtualClock = VirtualClock::getInstance();
+    if (virtualClock.isEnabled()) {
+      virtualClock.cancelAlarm(&mVirtualAlarmId);
+      mVirtualAlarmId = virtualClock.addAlarm(
+          virtualClock.getTimeNs() + delay.toRawNanoseconds(),
+          virtualAlarmCallback, this);
+      return true;
+    }
+
     return setInternal(delay.toRawNanoseconds());
   } else {
     return false;
@@ -94,6 +116,10 @@ bool SystemTimer::set(SystemTimerCallback *callback, void *data,
 
 bool SystemTimer::cancel() {
   if (mInitialized) {
+    if (mVirtualAlarmId != 0) {
+      VirtualClock::getInstance().cancelAlarm(&mVirtualAlarmId);
+    }
+
     // Setting delay to 0 disarms the timer.
     return setInternal(0);
   } else {
@@ -103,7 +129,10 @@ bool SystemTimer::cancel() {
 
 bool SystemTimer::isActive() {
   bool isActive = false;
-  if (mInitialized) {
+  if (mVirtualAlarmId != 0 &&
+      VirtualClock::getInstance().isAlarmPending(mVirtualAlarmId)) {
+    isActive = true;
+  } else if (mInitialized) {
     struct itimerspec spec = {};
     int ret = timer_gettime(mTimerId, &spec);
     if (ret != 0) {
@@ -135,3 +164,5 @@ bool SystemTimerBase::setInternal(uint64_t delayNs) {
 }
 
 }  // namespace chre
+
+#endif  // CHRE_LINUX_TIMERFD_SYSTEM_TIMER_ENABLED
@@ -0,0 +1,106 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifdef CHRE_LINUX_TIMERFD_SYSTEM_TIMER_ENABLED
+
+#include "chre/platform/system_timer.h"
+
+#include "chre/platform/linux/timerfd_dispatcher.h"
+#include "chre/platform/linux/virtual_clock.h"
+#include "chre/platform/log.h"
+
+namespace chre {
+
+void SystemTimerBase::systemTimerNotifyCallback(void *data) {
+  SystemTimer *sysTimer = static_cast<SystemTimer *>(data);
+  sysTimer->mCallback(sysTimer->mData);
+}
+
+SystemTimer::SystemTimer() {}
+
+SystemTimer::~SystemTimer() {
+  if (mVirtualAlarmId != 0) {
+    VirtualClock::getInstance().cancelAlarm(&mVirtualAlarmId);
+  }
+
+  if (mInitialized) {
+    TimerFdDispatcher::getInstance().removeTimer(&mTimer);
+    mInitialized = false;
+  }
+}
+
+bool SystemTimer::init() {
+  if (mInitialized) {
+    LOGW("Tried re-initializing timer");
+  } else {
+    mInitialized = TimerFdDispatcher::getInstance().addTimer(
+        &mTimer, systemTimerNotifyCallback, this);
+  }
+
+  return mInitialized;
+}
+
+bool SystemTimer::set(SystemTimerCallback *callback, void *data,
+                      Nanoseconds delay) {
+  // 0 disarms a timerfd. In our API, a value of 0 just means fire right away.
+  if (delay.toRawNanoseconds() == 0) {
+    delay = Nanoseconds(1);
+  }
+
+  if (mInitialized) {
+    mCallback = callback;
+    mData = data;
+
+    VirtualClock &virtualClock = VirtualClock::getInstance();
+    if (virtualClock.isEnabled()) {
+      virtualClock.cancelAlarm(&mVirtualAlarmId);
+      mVirtualAlarmId = virtualClock.addAlarm(
+          virtualClock.getTimeNs() + delay.toRawNanoseconds(),
+          systemTimerNotifyCallback, this);
+      return true;
+    }
+
+    return TimerFdDispatcher::setTimer(mTimer, delay.toRawNanoseconds());
+  } else {
+    return false;
+  }
+}
+
+bool SystemTimer::cancel() {
+  if (mInitialized) {
+    if (mVirtualAlarmId != 0) {
+      VirtualClock::getInstance().cancelAlarm(&mVirtualAlarmId);
+    }
+
+    // Setting delay to 0 disarms the timer.
+    return TimerFdDispatcher::setTimer(mTimer, 0);
+  } else {
+    return false;
+  }
+}
+
+bool SystemTimer::isActive() {
+  if (mVirtualAlarmId != 0 &&
+      VirtualClock::getInstance().isAlarmPending(mVirtualAlarmId)) {
+    return true;
+  }
+
+  return mInitialized && TimerFdDispatcher::isTimerActive(mTimer);
+}
+
+}  // namespace chre
+
+#endif  // CHRE_LINUX_TIMERFD_SYSTEM_TIMER_ENABLED
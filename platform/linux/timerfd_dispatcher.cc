@@ -0,0 +1,196 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "chre/platform/linux/timerfd_dispatcher.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#include "chre/platform/fatal_error.h"
+#include "chre/platform/log.h"
+#include "chre/util/time.h"
+
+namespace chre {
+
+namespace {
+
+//! The epoll data of the eventfd that stops the dispatcher. Timer IDs start
+//! at 1.
+constexpr uint64_t kWakeFdId = 0;
+
+}  // anonymous namespace
+
+TimerFdDispatcher &TimerFdDispatcher::getInstance() {
+#ifdef CHRE_LINUX_TIMER_DISPATCHER_PRIORITY
+  constexpr int kPriority = CHRE_LINUX_TIMER_DISPATCHER_PRIORITY;
+#else
+  constexpr int kPriority = 0;
+#endif
+
+  // Never destroyed, so that timers owned by static objects can still be
+  // removed during process exit.
+  static TimerFdDispatcher *dispatcher = new TimerFdDispatcher(kPriority);
+  return *dispatcher;
+}
+
+TimerFdDispatcher::TimerFdDispatcher(int realtimePriority) {
+  mEpollFd = epoll_create1(EPOLL_CLOEXEC);
+  mWakeFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  if (mEpollFd < 0 || mWakeFd < 0) {
+    FATAL_ERROR("Couldn't create timer dispatcher: %s", strerror(errno));
+  }
+
+  struct epoll_event event = {};
+  event.events = EPOLLIN;
+  event.data.u64 = kWakeFdId;
+  if (epoll_ctl(mEpollFd, EPOLL_CTL_ADD, mWakeFd, &event) != 0) {
+    FATAL_ERROR("Couldn't watch timer dispatcher eventfd: %s",
+                strerror(errno));
+  }
+
+  mThread = std::thread(&TimerFdDispatcher::run, this, realtimePriority);
+}
+
+TimerFdDispatcher::~TimerFdDispatcher() {
+  uint64_t value = 1;
+  if (write(mWakeFd, &value, sizeof(value)) != sizeof(value)) {
+    LOGE("Couldn't stop timer dispatcher: %s", strerror(errno));
+  }
+  mThread.join();
+
+  if (!mTimers.empty()) {
+    LOGW("Timer dispatcher destroyed with %zu timers", mTimers.size());
+  }
+  close(mWakeFd);
+  close(mEpollFd);
+}
+
+bool TimerFdDispatcher::addTimer(Timer *timer, Callback *callback,
+                                 void *data) {
+  int fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
+  if (fd < 0) {
+    LOGE("Couldn't create timerfd: %s", strerror(errno));
+    return false;
+  }
+
+  std::lock_guard<std::recursive_mutex> lock(mMutex);
+  timer->fd = fd;
+  timer->id = mNextTimerId++;
+  timer->callback = callback;
+  timer->data = data;
+
+  struct epoll_event event = {};
+  event.events = EPOLLIN;
+  event.data.u64 = timer->id;
+  if (epoll_ctl(mEpollFd, EPOLL_CTL_ADD, fd, &event) != 0) {
+    LOGE("Couldn't watch timerfd: %s", strerror(errno));
+    close(fd);
+    timer->fd = -1;
+    return false;
+  }
+
+  mTimers[timer->id] = timer;
+  return true;
+}
+
+void TimerFdDispatcher::removeTimer(Timer *timer) {
+  // Waits for a callback being dispatched on the dispatcher thread.
+  std::lock_guard<std::recursive_mutex> lock(mMutex);
+  if (timer->fd >= 0) {
+    if (epoll_ctl(mEpollFd, EPOLL_CTL_DEL, timer->fd, nullptr) != 0) {
+      LOGE("Couldn't stop watching timerfd: %s", strerror(errno));
+    }
+    close(timer->fd);
+    timer->fd = -1;
+    mTimers.erase(timer->id);
+  }
+}
+
+bool TimerFdDispatcher::setTimer(const Timer &timer, uint64_t delayNs) {
+  struct itimerspec spec = {};
+  spec.it_value.tv_sec = delayNs / kOneSecondInNanoseconds;
+  spec.it_value.tv_nsec = delayNs % kOneSecondInNanoseconds;
+
+  bool success =
+      (timerfd_settime(timer.fd, 0 /* flags */, &spec, nullptr) == 0);
+  if (!success) {
+    LOGE("Couldn't set timerfd: %s", strerror(errno));
+  }
+  return success;
+}
+
+bool TimerFdDispatcher::isTimerActive(const Timer &timer) {
+  struct itimerspec spec = {};
+  if (timerfd_gettime(timer.fd, &spec) != 0) {
+    LOGE("Couldn't get timerfd configuration: %s", strerror(errno));
+  }
+  return (spec.it_value.tv_sec > 0 || spec.it_value.tv_nsec > 0);
+}
+
+void TimerFdDispatcher::run(int realtimePriority) {
+  pthread_setname_np(pthread_self(), "chre_timer");
+  if (realtimePriority > 0) {
+    struct sched_param param = {};
+    param.sched_priority = realtimePriority;
+    int ret = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+    if (ret != 0) {
+      LOGW("Couldn't set timer dispatcher priority to SCHED_FIFO %d: %s",
+           realtimePriority, strerror(ret));
+    }
+  }
+
+  struct epoll_event events[kMaxEvents];
+  while (true) {
+    int count = epoll_wait(mEpollFd, events, kMaxEvents, -1 /* timeout */);
+    if (count < 0) {
+      if (errno != EINTR) {
+        LOGE("Timer dispatcher epoll_wait failed: %s", strerror(errno));
+      }
+      continue;
+    }
+
+    std::lock_guard<std::recursive_mutex> lock(mMutex);
+    for (int i = 0; i < count; i++) {
+      uint64_t id = events[i].data.u64;
+      if (id == kWakeFdId) {
+        return;
+      }
+
+      auto it = mTimers.find(id);
+      if (it == mTimers.end()) {
+        // Removed since epoll_wait() returned.
+        continue;
+      }
+
+      // Reading fails with EAGAIN if the timer was re-armed or disarmed since
+      // it fired, in which case this expiration is stale.
+      Timer *timer = it->second;
+      uint64_t expirations;
+      if (read(timer->fd, &expirations, sizeof(expirations)) ==
+          sizeof(expirations)) {
+        timer->callback(timer->data);
+      }
+    }
+  }
+}
+
+}  // namespace chre
@@ -0,0 +1,165 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "chre/platform/linux/virtual_clock.h"
+
+#include <pthread.h>
+#include <ctime>
+
+#include "chre/platform/log.h"
+#include "chre/util/time.h"
+
+namespace chre {
+
+VirtualClock &VirtualClock::getInstance() {
+  // Never destroyed, so that timers and PAL tasks owned by static objects can
+  // still cancel their alarms during process exit.
+  static VirtualClock *clock = new VirtualClock();
+  return *clock;
+}
+
+void VirtualClock::enable() {
+  std::lock_guard<std::mutex> lock(mMutex);
+  if (mEnabled) {
+    LOGW("Virtual clock already enabled");
+    return;
+  }
+
+  struct timespec timeNow;
+  clock_gettime(CLOCK_MONOTONIC, &timeNow);
+  mNowNs = static_cast<uint64_t>(timeNow.tv_sec) * kOneSecondInNanoseconds +
+           static_cast<uint64_t>(timeNow.tv_nsec);
+  // The event loop may not be running yet, in which case it is waiting for
+  // events.
+  mEventLoopIdle = true;
+  mWakeRequested = false;
+  mStopWakeThread = false;
+  mWakeThread = std::thread(&VirtualClock::runWakeThread, this);
+  mEnabled = true;
+}
+
+void VirtualClock::disable() {
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (!mEnabled) {
+      return;
+    }
+
+    mEnabled = false;
+    if (!mAlarms.empty()) {
+      LOGW("Dropping %zu pending virtual alarms", mAlarms.size());
+      mAlarms.clear();
+      mAlarmDeadlines.clear();
+    }
+    mStopWakeThread = true;
+    mWakeCondVar.notify_one();
+  }
+
+  mWakeThread.join();
+}
+
+uint64_t VirtualClock::addAlarm(uint64_t deadlineNs, Callback *callback,
+                                void *data) {
+  std::lock_guard<std::mutex> lock(mMutex);
+  uint64_t alarmId = mNextAlarmId++;
+  mAlarms.emplace(std::make_pair(deadlineNs, alarmId),
+                  std::make_pair(callback, data));
+  mAlarmDeadlines[alarmId] = deadlineNs;
+
+  if (mEventLoopIdle) {
+    mEventLoopIdle = false;
+    mWakeRequested = true;
+    mWakeCondVar.notify_one();
+  }
+
+  return alarmId;
+}
+
+bool VirtualClock::cancelAlarm(uint64_t *alarmId) {
+  std::lock_guard<std::recursive_mutex> dispatchLock(mDispatchMutex);
+  std::lock_guard<std::mutex> lock(mMutex);
+
+  bool pending = false;
+  auto it = mAlarmDeadlines.find(*alarmId);
+  if (it != mAlarmDeadlines.end()) {
+    mAlarms.erase(std::make_pair(it->second, *alarmId));
+    mAlarmDeadlines.erase(it);
+    pending = true;
+  }
+
+  *alarmId = 0;
+  return pending;
+}
+
+bool VirtualClock::isAlarmPending(uint64_t alarmId) {
+  std::lock_guard<std::mutex> lock(mMutex);
+  return mAlarmDeadlines.find(alarmId) != mAlarmDeadlines.end();
+}
+
+bool VirtualClock::onEventLoopIdle() {
+  return dispatchNextAlarm(true /* markIdle */);
+}
+
+void VirtualClock::onEventLoopBusy() {
+  std::lock_guard<std::mutex> lock(mMutex);
+  mEventLoopIdle = false;
+}
+
+bool VirtualClock::dispatchNextAlarm(bool markIdle) {
+  std::lock_guard<std::recursive_mutex> dispatchLock(mDispatchMutex);
+  Callback *callback;
+  void *data;
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mAlarms.empty()) {
+      mEventLoopIdle = markIdle;
+      return false;
+    }
+
+    auto it = mAlarms.begin();
+    uint64_t deadlineNs = it->first.first;
+    if (deadlineNs > mNowNs) {
+      mNowNs = deadlineNs;
+    }
+    callback = it->second.first;
+    data = it->second.second;
+    mAlarmDeadlines.erase(it->first.second);
+    mAlarms.erase(it);
+  }
+
+  callback(data);
+  return true;
+}
+
+void VirtualClock::runWakeThread() {
+  pthread_setname_np(pthread_self(), "chre_vclock");
+
+  std::unique_lock<std::mutex> lock(mMutex);
+  while (true) {
+    mWakeCondVar.wait(lock,
+                      [this]() { return mWakeRequested || mStopWakeThread; });
+    if (mStopWakeThread) {
+      break;
+    }
+
+    mWakeRequested = false;
+    lock.unlock();
+    dispatchNextAlarm(false /* markIdle */);
+    lock.lock();
+  }
+}
+
+}  // namespace chre
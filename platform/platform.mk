@@ -182,6 +182,7 @@ SLPI_QSH_SRCS += platform/slpi/qsh/qsh_proto_shim.cc
 ifeq ($(CHRE_USE_BUFFERED_LOGGING), true)
 SLPI_QSH_SRCS += platform/shared/log_buffer.cc
 SLPI_QSH_SRCS += platform/shared/log_buffer_manager.cc
+SLPI_QSH_SRCS += platform/shared/log_format_common.cc
 SLPI_QSH_SRCS += platform/slpi/log_buffer_manager.cc
 endif
 
@@ -199,6 +200,8 @@ SIM_SRCS += platform/linux/fatal_error.cc
 SIM_SRCS += platform/linux/host_link.cc
 SIM_SRCS += platform/linux/memory.cc
 SIM_SRCS += platform/linux/memory_manager.cc
+SIM_SRCS += platform/linux/pal_replay.cc
+SIM_SRCS += platform/linux/pal_task.cc
 SIM_SRCS += platform/linux/platform_debug_dump_manager.cc
 SIM_SRCS += platform/linux/platform_log.cc
 SIM_SRCS += platform/linux/platform_pal.cc
@@ -207,6 +210,9 @@ SIM_SRCS += platform/linux/platform_sensor_type_helpers.cc
 SIM_SRCS += platform/linux/power_control_manager.cc
 SIM_SRCS += platform/linux/system_time.cc
 SIM_SRCS += platform/linux/system_timer.cc
+SIM_SRCS += platform/linux/system_timer_timerfd.cc
+SIM_SRCS += platform/linux/timerfd_dispatcher.cc
+SIM_SRCS += platform/linux/virtual_clock.cc
 SIM_SRCS += platform/linux/platform_nanoapp.cc
 SIM_SRCS += platform/linux/platform_sensor.cc
 SIM_SRCS += platform/shared/chre_api_audio.cc
@@ -233,17 +239,20 @@ endif
 # Optional BLE support.
 ifeq ($(CHRE_BLE_SUPPORT_ENABLED), true)
 SIM_SRCS += platform/linux/pal_ble.cc
+SIM_SRCS += platform/linux/pal_replay_ble.cc
 SIM_SRCS += platform/shared/platform_ble.cc
 endif
 
 # Optional GNSS support.
 ifeq ($(CHRE_GNSS_SUPPORT_ENABLED), true)
 SIM_SRCS += platform/linux/pal_gnss.cc
+SIM_SRCS += platform/linux/pal_replay_gnss.cc
 SIM_SRCS += platform/shared/platform_gnss.cc
 endif
 
 # Optional sensor support.
 ifeq ($(CHRE_SENSORS_SUPPORT_ENABLED), true)
+SIM_SRCS += platform/linux/pal_replay_sensor.cc
 SIM_SRCS += platform/linux/pal_sensor.cc
 SIM_SRCS += platform/shared/platform_sensor_manager.cc
 endif
@@ -253,6 +262,7 @@ ifeq ($(CHRE_WIFI_SUPPORT_ENABLED), true)
 ifeq ($(CHRE_WIFI_NAN_SUPPORT_ENABLED), true)
 SIM_SRCS += platform/linux/pal_nan.cc
 endif
+SIM_SRCS += platform/linux/pal_replay_wifi.cc
 SIM_SRCS += platform/linux/pal_wifi.cc
 SIM_SRCS += platform/shared/platform_wifi.cc
 endif
@@ -338,7 +348,12 @@ GOOGLETEST_COMMON_SRCS += platform/linux/assert.cc
 GOOGLETEST_COMMON_SRCS += platform/linux/sim/audio_source.cc
 GOOGLETEST_COMMON_SRCS += platform/linux/sim/platform_audio.cc
 GOOGLETEST_COMMON_SRCS += platform/tests/log_buffer_test.cc
+GOOGLETEST_COMMON_SRCS += platform/tests/log_format_common_test.cc
+GOOGLETEST_COMMON_SRCS += platform/tests/symbol_lookup_test.cc
+GOOGLETEST_COMMON_SRCS += platform/tests/system_timer_test.cc
+GOOGLETEST_COMMON_SRCS += platform/tests/virtual_clock_test.cc
 GOOGLETEST_COMMON_SRCS += platform/shared/log_buffer.cc
+GOOGLETEST_COMMON_SRCS += platform/shared/log_format_common.cc
 ifeq ($(CHRE_WIFI_NAN_SUPPORT_ENABLED), true)
 GOOGLETEST_COMMON_SRCS += platform/linux/pal_nan.cc
 endif
@@ -65,3 +65,19 @@ DLL_EXPORT bool chreAudioConfigureSource(uint32_t handle, bool enable,
   return false;
 #endif  // CHRE_AUDIO_SUPPORT_ENABLED
 }
+
+DLL_EXPORT bool chreAudioConfigureFeatures(
+    uint32_t handle, bool enable, const struct chreAudioFeatureConfig *config) {
+#ifdef CHRE_AUDIO_SUPPORT_ENABLED
+  Nanoapp *nanoapp = EventLoopManager::validateChreApiCall(__func__);
+  return nanoapp->permitPermissionUse(NanoappPermissions::CHRE_PERMS_AUDIO) &&
+         EventLoopManagerSingleton::get()
+             ->getAudioRequestManager()
+             .configureFeatures(nanoapp, handle, enable, config);
+#else
+  UNUSED_VAR(handle);
+  UNUSED_VAR(enable);
+  UNUSED_VAR(config);
+  return false;
+#endif  // CHRE_AUDIO_SUPPORT_ENABLED
+}
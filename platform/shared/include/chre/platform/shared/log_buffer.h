@@ -21,7 +21,9 @@
 #include <cstdarg>
 #include <cstring>
 
+#include "chre/platform/atomic.h"
 #include "chre/platform/mutex.h"
+#include "chre/platform/shared/log_format_common.h"
 
 namespace chre {
 
@@ -50,6 +52,39 @@ enum class LogBufferLogLevel : uint8_t {
   VERBOSE
 };
 
+/**
+ * Values that select how writers store logs into a LogBuffer.
+ *
+ * LOCKED - Each log is formatted into a temporary buffer and then copied into
+ *          the ring while holding the buffer's mutex. When the buffer is full,
+ *          the oldest logs are discarded to make room.
+ * RESERVE_COMMIT - Writers claim space in the ring with an atomic
+ *                  compare-and-exchange, write the log into that space and
+ *                  then publish it, without taking the buffer's mutex.
+ *                  Readers only consume logs that have been published.
+ *                  Since a writer cannot discard logs that a reader may be
+ *                  copying, a log that does not fit is dropped instead of the
+ *                  oldest one. The content returned by getBufferData() is not
+ *                  in the wire format in this mode, so logs must be read out
+ *                  with copyLogs() or transferTo().
+ */
+enum class LogBufferWriteMode : uint8_t { LOCKED, RESERVE_COMMIT };
+
+/**
+ * The encoding indicator stored in the upper nibble of a log's metadata, see
+ * LogMessageV2 in host_messages.fbs.
+ *
+ * NONE - The log is a null-terminated string.
+ * TOKENIZED - The log was encoded by pw_tokenizer.
+ * DEFERRED_FORMAT - The log is a format string hash followed by packed
+ *                   arguments, see log_format_common.h.
+ */
+enum class LogBufferEncoding : uint8_t {
+  NONE = 0,
+  TOKENIZED = 1,
+  DEFERRED_FORMAT = kLogEncodingDeferredFormat,
+};
+
 // Forward declaration for LogBufferCallbackInterface.
 class LogBuffer;
 
@@ -92,9 +127,12 @@ class LogBuffer {
    *                    message.
    * @param bufferSize The number of bytes in the buffer. This value must be >
    *                   kBufferMinSize
+   * @param writeMode How writers store logs into the buffer, see
+   *                  LogBufferWriteMode.
    */
   LogBuffer(LogBufferCallbackInterface *callback, void *buffer,
-            size_t bufferSize);
+            size_t bufferSize,
+            LogBufferWriteMode writeMode = LogBufferWriteMode::LOCKED);
 
   /**
    * Buffer this log and possibly call on logs ready callback depending on the
@@ -121,8 +159,18 @@ class LogBuffer {
   void handleLogVa(LogBufferLogLevel logLevel, uint32_t timestampMs,
                    const char *logFormat, va_list args);
 
-  void handleEncodedLog(LogBufferLogLevel logLevel, uint32_t timestampMs,
-                        const uint8_t *log, size_t logSize);
+  /**
+   * Buffer a log that was encoded by the caller, see handleLog.
+   *
+   * @param log The encoded log data.
+   * @param logSize The size of the encoded log data in bytes.
+   * @param encoding The encoding of the log data, which the host uses to
+   *                 decode it.
+   */
+  void handleEncodedLog(
+      LogBufferLogLevel logLevel, uint32_t timestampMs, const uint8_t *log,
+      size_t logSize,
+      LogBufferEncoding encoding = LogBufferEncoding::TOKENIZED);
 
   // TODO(b/179786399): Remove the copyLogs method when the LogBufferManager is
   // refactored to no longer use it.
@@ -154,7 +202,8 @@ class LogBuffer {
 
   /**
    * Transfer all data from one log buffer to another. The destination log
-   * buffer must have equal or greater capacity than this buffer. The
+   * buffer must have equal or greater capacity than this buffer and must use
+   * LogBufferWriteMode::LOCKED. The
    * otherBuffer will be reset prior to this buffer's data being transferred to
    * it and after the transfer this buffer will be reset. This method is
    * thread-safe and will ensure that logs are kept in FIFO ordering during a
@@ -188,7 +237,8 @@ class LogBuffer {
   /**
    * The data inside the buffer that is returned may be altered by
    * another thread so it is up to the calling code to ensure that race
-   * conditions do not occur on writes to the data.
+   * conditions do not occur on writes to the data. Only meaningful in
+   * LogBufferWriteMode::LOCKED.
    *
    * @return The pointer to the underlying data buffer.
    */
@@ -274,21 +324,24 @@ class LogBuffer {
    * is used) and dispatch it.
    */
   void processLog(LogBufferLogLevel logLevel, uint32_t timestampMs,
-                  const void *log, size_t logSize, bool encoded = true);
+                  const void *log, size_t logSize,
+                  LogBufferEncoding encoding = LogBufferEncoding::TOKENIZED);
 
   /**
    * First ensure that there's enough space for the log by discarding older
    * logs, then encode and copy this log into the internal log buffer.
    */
   void copyLogToBuffer(LogBufferLogLevel level, uint32_t timestampMs,
-                       const void *logBuffer, uint8_t logLen, bool encoded);
+                       const void *logBuffer, uint8_t logLen,
+                       LogBufferEncoding encoding);
 
   /**
    * Invalidate memory allocated for log at head while the buffer is greater
    * than max size. This function must only be called with the log buffer mutex
    * locked.
    */
-  void discardExcessOldLogsLocked(bool encoded, uint8_t currentLogLen);
+  void discardExcessOldLogsLocked(LogBufferEncoding encoding,
+                                  uint8_t currentLogLen);
 
   /**
    * Add an encoding header to the log message if the encoding param is true.
@@ -296,7 +349,7 @@ class LogBuffer {
    */
   void encodeAndCopyLogLocked(LogBufferLogLevel level, uint32_t timestampMs,
                               const void *logBuffer, uint8_t logLen,
-                              bool encoded);
+                              LogBufferEncoding encoding);
 
   /**
    * Send ready to dispatch logs over, based on the current log notification
@@ -304,6 +357,75 @@ class LogBuffer {
    */
   void dispatch();
 
+  /**
+   * Formats a log and copies it into space reserved in the ring. Used in
+   * LogBufferWriteMode::RESERVE_COMMIT.
+   */
+  void reserveAndFormatLogVa(LogBufferLogLevel logLevel, uint32_t timestampMs,
+                             const char *logFormat, va_list args);
+
+  /**
+   * Copies an already formatted or encoded log into space reserved in the
+   * ring. Used in LogBufferWriteMode::RESERVE_COMMIT.
+   */
+  void reserveAndCopyLog(LogBufferLogLevel logLevel, uint32_t timestampMs,
+                         const void *log, uint8_t logLen,
+                         LogBufferEncoding encoding);
+
+  /**
+   * Claims space for a record holding wireSize bytes of log data in the wire
+   * format. This function is lock-free. If the log does not fit in the
+   * remaining space, it is counted as dropped.
+   *
+   * @param wireSize The number of bytes of the log in the wire format.
+   * @param recordOffset Non-null pointer that will be set to the offset of the
+   *        reserved record in the ring.
+   * @return A pointer to wireSize contiguous bytes where the log must be
+   *         written, or nullptr if the log was dropped.
+   */
+  uint8_t *reserveRecord(size_t wireSize, size_t *recordOffset);
+
+  /**
+   * Publishes a record previously reserved with reserveRecord() so that it
+   * can be consumed by readers. This function is lock-free.
+   */
+  void commitRecord(size_t recordOffset, size_t wireSize);
+
+  /**
+   * Same as copyLogsLocked for LogBufferWriteMode::RESERVE_COMMIT. Consumes
+   * committed records in order, stopping at the first record that is still
+   * being written.
+   *
+   * @param destination The memory location to copy to, or nullptr to discard
+   *        all committed records.
+   */
+  size_t copyCommittedLogsLocked(void *destination, size_t size);
+
+  /**
+   * @param recordOffset The offset of a record in the ring, which is always
+   *        aligned to kRecordAlignment.
+   * @return The header word of the record at the given offset.
+   */
+  AtomicUint32 *getRecordHeader(size_t recordOffset) {
+    return reinterpret_cast<AtomicUint32 *>(&mRingData[recordOffset]);
+  }
+
+  //! The size of the header preceding each record in the ring in
+  //! LogBufferWriteMode::RESERVE_COMMIT.
+  static constexpr size_t kRecordHeaderSize = sizeof(uint32_t);
+  //! The alignment of records in the ring, so that headers can be accessed
+  //! atomically.
+  static constexpr size_t kRecordAlignment = sizeof(uint32_t);
+  //! Set in a record header once the record may be consumed.
+  static constexpr uint32_t kRecordCommitted = UINT32_C(1) << 31;
+  //! Set in a record header if the record only pads the end of the ring.
+  static constexpr uint32_t kRecordPadding = UINT32_C(1) << 30;
+  //! Mask and shift of the number of wire format bytes in a record header.
+  static constexpr uint32_t kRecordWireSizeMask = 0xfff;
+  static constexpr uint32_t kRecordWireSizeShift = 16;
+  //! Mask of the total size of a record, including its header and alignment.
+  static constexpr uint32_t kRecordSizeMask = 0xffff;
+
   /**
    * The buffer data is stored in the format
    *
@@ -345,6 +467,34 @@ class LogBuffer {
   // TODO(b/170870354): Setup a more appropriate min size
   static constexpr size_t kBufferMinSize = 1024;  // 1KB
 
+  //! How writers store logs into the buffer.
+  const LogBufferWriteMode mWriteMode;
+
+  //! In LogBufferWriteMode::RESERVE_COMMIT, the buffer is used as a ring of
+  //! records, each preceded by a header word:
+  //!
+  //! [ committed (1b), padding (1b), unused (2b), wire size (12b),
+  //!   record size (16b) ]
+  //!
+  //! followed by the log in the wire format described above. Records start at
+  //! offsets aligned to kRecordAlignment and never wrap around the end of the
+  //! ring: a padding record fills the end of the ring instead. Consumed
+  //! records are zeroed so that space that has not been written yet never
+  //! looks committed.
+  uint8_t *mRingData = nullptr;
+  //! The usable size of the ring, a multiple of kRecordAlignment.
+  uint32_t mRingCapacity = 0;
+  //! The position of the next record to be reserved. Positions are kept
+  //! modulo twice the capacity so that a full ring can be told apart from an
+  //! empty one.
+  AtomicUint32 mReservePosition{0};
+  //! The position of the oldest record that has not been consumed.
+  AtomicUint32 mReadPosition{0};
+  //! The number of wire format bytes in committed, unconsumed records.
+  AtomicUint32 mCommittedBytes{0};
+  //! The number of logs dropped by writers because the ring was full.
+  AtomicUint32 mNumReserveDropped{0};
+
   //! The callback object
   LogBufferCallbackInterface *mCallback;
   //! The notification setting object
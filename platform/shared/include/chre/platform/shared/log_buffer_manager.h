@@ -52,7 +52,12 @@ class LogBufferManager : public LogBufferCallbackInterface {
  public:
   LogBufferManager(uint8_t *primaryBufferData, uint8_t *secondaryBufferData,
                    size_t bufferSize)
-      : mPrimaryLogBuffer(this, primaryBufferData, bufferSize),
+      : mPrimaryLogBuffer(this, primaryBufferData, bufferSize,
+#ifdef CHRE_LOG_BUFFER_RESERVE_COMMIT_ENABLED
+                          LogBufferWriteMode::RESERVE_COMMIT),
+#else
+                          LogBufferWriteMode::LOCKED),
+#endif  // CHRE_LOG_BUFFER_RESERVE_COMMIT_ENABLED
         mSecondaryLogBuffer(nullptr /* callback */, secondaryBufferData,
                             bufferSize) {}
 
@@ -73,6 +78,16 @@ class LogBufferManager : public LogBufferCallbackInterface {
    */
   void logVa(chreLogLevel logLevel, const char *formatStr, va_list args);
 
+  /**
+   * Logs message with deferred formatting: the hash of the format string and
+   * the packed arguments are buffered, and the host formats the message. Falls
+   * back to logVa() if the arguments can't be encoded.
+   *
+   * @param formatHash The hashLogFormat() of formatStr.
+   */
+  void logDeferredVa(chreLogLevel logLevel, uint32_t formatHash,
+                     const char *formatStr, va_list args);
+
   /**
    * Overrides required method from LogBufferCallbackInterface.
    */
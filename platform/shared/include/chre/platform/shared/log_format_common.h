@@ -0,0 +1,195 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CHRE_PLATFORM_SHARED_LOG_FORMAT_COMMON_H_
+#define CHRE_PLATFORM_SHARED_LOG_FORMAT_COMMON_H_
+
+#include <cstdarg>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @file
+ * Definitions shared by CHRE and the host for logs with deferred formatting.
+ *
+ * Instead of running vsnprintf, CHRE sends a hash of the log's format string
+ * followed by its arguments in a packed binary form. The log macros place the
+ * format strings in the CHRE_LOG_FORMAT_SECTION section of the CHRE binary,
+ * which the build extracts into libchre_log_formats.bin. The host indexes
+ * these strings by the same hash and formats the log itself. The payload of
+ * such a log is:
+ *
+ * uint32_t, little-endian - hashLogFormat() of the format string
+ * uint8_t[]               - The arguments, in the order the format string
+ *                           consumes them (including '*' widths and
+ *                           precisions), each encoded as:
+ *   * Integers, characters and pointers: unsigned LEB128 varint of the value
+ *     widened to 64 bits. Signed values are zigzag-encoded first.
+ *   * Floating point values: double, little-endian.
+ *   * Strings: one byte holding the length in the lower 7 bits and a
+ *     truncation flag in the upper bit, followed by that many characters
+ *     without a null terminator.
+ *
+ * The encoding is identified by kLogEncodingDeferredFormat in the upper
+ * nibble of the log metadata, see LogMessageV2 in host_messages.fbs.
+ */
+
+//! The section holding the format strings of logs with deferred formatting.
+//! Keeping them out of the mergeable string sections prevents the linker from
+//! storing a format string as the tail of another literal.
+#define CHRE_LOG_FORMAT_SECTION ".chre_log_formats"
+
+namespace chre {
+
+//! The encoding indicator of a log with deferred formatting.
+constexpr uint8_t kLogEncodingDeferredFormat = 2;
+
+//! The size of the format string hash that precedes the packed arguments.
+constexpr size_t kLogFormatHashSize = sizeof(uint32_t);
+
+//! The maximum number of characters of a string argument that are sent.
+constexpr size_t kLogMaxStringArgLength = 0x7f;
+
+//! Set in the length byte of a string argument if it was truncated.
+constexpr uint8_t kLogStringArgTruncated = 0x80;
+
+/**
+ * Computes the 32-bit FNV-1a hash of a format string. This is constexpr so
+ * that logging macros can compute it at compile time.
+ *
+ * @param format A null-terminated format string.
+ * @return The hash identifying the format string.
+ */
+constexpr uint32_t hashLogFormat(const char *format) {
+  uint32_t hash = UINT32_C(2166136261);
+  for (const char *c = format; *c != '\0'; c++) {
+    hash = (hash ^ static_cast<uint8_t>(*c)) * UINT32_C(16777619);
+  }
+  return hash;
+}
+
+/**
+ * The kind of argument consumed by a printf conversion specification.
+ */
+enum class LogArgType : uint8_t {
+  //! The conversion consumes no argument, e.g. "%%".
+  NONE,
+  SIGNED_INT,
+  UNSIGNED_INT,
+  DOUBLE,
+  STRING,
+  POINTER,
+  //! The conversion can't be encoded, e.g. "%n" or "%Lf".
+  UNSUPPORTED,
+};
+
+/**
+ * The C type an integer argument was passed as, from the length modifier of
+ * its conversion specification. CHRE needs it to read the argument from a
+ * va_list. The host formats integers as 64 bits, except char and short ones
+ * which keep their length modifier.
+ */
+enum class LogArgLength : uint8_t {
+  DEFAULT,
+  CHAR,
+  SHORT,
+  LONG,
+  LONG_LONG,
+  SIZE_T,
+  INTMAX_T,
+  PTRDIFF_T,
+};
+
+/**
+ * A parsed printf conversion specification.
+ */
+struct LogFormatConversion {
+  //! The number of characters in the specification, including the '%'.
+  size_t length;
+
+  //! The number of flag, width and precision characters following the '%'.
+  size_t flagsLength;
+
+  //! The conversion character, e.g. 'd'.
+  char conversion;
+
+  LogArgType argType;
+  LogArgLength argLength;
+
+  //! true if the width and/or precision are passed as int arguments ('*'),
+  //! which precede the converted argument.
+  bool widthFromArg;
+  bool precisionFromArg;
+};
+
+/**
+ * Parses the conversion specification at the start of the given string.
+ *
+ * @param spec A pointer to a '%' in a format string.
+ * @param conversion Non-null pointer populated with the result.
+ * @return true if a complete specification was parsed. On false, the format
+ *         string is malformed and the log can't be encoded.
+ */
+bool parseLogFormatConversion(const char *spec,
+                              LogFormatConversion *conversion);
+
+/**
+ * Writes an unsigned LEB128 varint.
+ *
+ * @return The number of bytes written, or 0 if the value doesn't fit in
+ *         bufferSize bytes.
+ */
+size_t encodeLogVarint(uint64_t value, uint8_t *buffer, size_t bufferSize);
+
+/**
+ * Reads an unsigned LEB128 varint.
+ *
+ * @return The number of bytes read, or 0 if the buffer ends before the varint
+ *         or the varint is longer than 64 bits.
+ */
+size_t decodeLogVarint(const uint8_t *buffer, size_t bufferSize,
+                       uint64_t *value);
+
+inline uint64_t zigzagEncode(int64_t value) {
+  return (static_cast<uint64_t>(value) << 1) ^
+         static_cast<uint64_t>(value >> 63);
+}
+
+inline int64_t zigzagDecode(uint64_t value) {
+  return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+/**
+ * Packs the arguments of a log into the deferred formatting encoding. This
+ * walks the format string to find the type of each argument but does not
+ * format anything.
+ *
+ * @param format The format string of the log.
+ * @param args The arguments of the log.
+ * @param buffer Where the packed arguments are written.
+ * @param bufferSize The size of buffer.
+ * @param encodedSize Non-null pointer populated with the number of bytes
+ *        written on success.
+ * @return true on success, false if the format string uses a conversion that
+ *         can't be encoded or the arguments don't fit in the buffer. The
+ *         caller should then fall back to formatting the log as text.
+ */
+bool encodeLogArgsVa(const char *format, va_list args, uint8_t *buffer,
+                     size_t bufferSize, size_t *encodedSize);
+
+}  // namespace chre
+
+#endif  // CHRE_PLATFORM_SHARED_LOG_FORMAT_COMMON_H_
@@ -72,7 +72,9 @@ class NanoappLoader {
 
   /**
    * Method for pointer lookup by symbol name. Only function pointers
-   * are currently supported.
+   * are currently supported. Uses the binary's DT_GNU_HASH or DT_HASH section
+   * if it has one, falling back to a scan of the full symbol table for symbols
+   * that are not dynamically exported.
    *
    * @return function pointer on successful lookup, nullptr otherwise
    */
@@ -132,6 +134,15 @@ class NanoappLoader {
   size_t mNumSectionHeaders = 0;
   //! Size of the data pointed to by mSymbolTablePtr.
   size_t mSymbolTableSize = 0;
+  //! Pointer to the mapped dynamic symbol table.
+  const ElfSym *mDynamicSymbolTablePtr = nullptr;
+  //! Pointer to the mapped table of dynamic symbol names.
+  const char *mDynamicStringTablePtr = nullptr;
+  //! Pointer to the mapped DT_GNU_HASH section, if present.
+  const uint32_t *mGnuHashTablePtr = nullptr;
+  //! Pointer to the mapped DT_HASH section, if present and there is no
+  //! DT_GNU_HASH section.
+  const uint32_t *mHashTablePtr = nullptr;
 
   //! The ELF that is being mapped into the system. This pointer will be invalid
   //! after open returns.
@@ -278,6 +289,13 @@ class NanoappLoader {
    */
   DynamicHeader *getDynamicHeader();
 
+  /**
+   * Locates the dynamic symbol table and its hash section in the mapped
+   * binary, so that findSymbolByName() can use them after the ELF binary is
+   * released. Must be called after the mappings are created.
+   */
+  void initDynamicSymbolLookup();
+
   /**
    * @return The address of the first read-only segment. nullptr if not found.
    */
@@ -0,0 +1,126 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CHRE_PLATFORM_SHARED_SYMBOL_LOOKUP_H_
+#define CHRE_PLATFORM_SHARED_SYMBOL_LOOKUP_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include "chre/platform/shared/loader_util.h"
+#include "chre/util/non_copyable.h"
+
+/**
+ * @file
+ * Helpers used by the NanoappLoader to look up symbols by name without
+ * scanning entire symbol tables: a hash table over the symbols CHRE exports to
+ * nanoapps, and lookups through the hash sections (DT_GNU_HASH or DT_HASH) of
+ * a nanoapp's dynamic symbol table.
+ *
+ * Only the 32-bit ELF layout is supported, matching the NanoappLoader.
+ */
+
+namespace chre {
+
+/**
+ * @return The hash of the given symbol name, as used in DT_GNU_HASH sections.
+ */
+uint32_t elfGnuHash(const char *name);
+
+/**
+ * @return The hash of the given symbol name, as used in DT_HASH sections.
+ */
+uint32_t elfSysvHash(const char *name);
+
+/**
+ * Looks up a defined symbol by name using a DT_GNU_HASH section.
+ *
+ * @param gnuHashTable The contents of the DT_GNU_HASH section.
+ * @param symbolTable The dynamic symbol table the hash section refers to.
+ * @param stringTable The dynamic string table the symbol names refer to.
+ * @param name The null-terminated name of the symbol to find.
+ * @return The symbol, or nullptr if it is not defined in the symbol table.
+ */
+const Elf32_Sym *elfGnuHashLookup(const uint32_t *gnuHashTable,
+                                  const Elf32_Sym *symbolTable,
+                                  const char *stringTable, const char *name);
+
+/**
+ * Looks up a defined symbol by name using a DT_HASH section.
+ *
+ * @param hashTable The contents of the DT_HASH section.
+ * @param symbolTable The dynamic symbol table the hash section refers to.
+ * @param stringTable The dynamic string table the symbol names refer to.
+ * @param name The null-terminated name of the symbol to find.
+ * @return The symbol, or nullptr if it is not defined in the symbol table.
+ */
+const Elf32_Sym *elfSysvHashLookup(const uint32_t *hashTable,
+                                   const Elf32_Sym *symbolTable,
+                                   const char *stringTable, const char *name);
+
+/**
+ * A read-only hash table over a fixed array of symbols exported to nanoapps,
+ * so that resolving one of a nanoapp's imports costs hashing its name and
+ * usually a single string comparison, instead of comparing against every
+ * exported symbol.
+ *
+ * The table is built once on construction, using open addressing with linear
+ * probing and at least twice as many slots as symbols.
+ *
+ * @tparam kNumSymbols The number of exported symbols.
+ */
+template <size_t kNumSymbols>
+class ExportedSymbolTable : public NonCopyable {
+ public:
+  /**
+   * @param symbols The exported symbols, which must outlive this object. Names
+   *     must be unique.
+   */
+  explicit ExportedSymbolTable(const ExportedData (&symbols)[kNumSymbols]);
+
+  /**
+   * @param name The null-terminated name of the symbol to find.
+   * @return The address of the exported symbol, or nullptr if not found.
+   */
+  void *find(const char *name) const;
+
+ private:
+  //! Rounds up to the next power of 2.
+  static constexpr size_t roundUpToPowerOfTwo(size_t value,
+                                              size_t result = 1) {
+    return (result >= value) ? result
+                             : roundUpToPowerOfTwo(value, result * 2);
+  }
+
+  static constexpr size_t kNumSlots = roundUpToPowerOfTwo(2 * kNumSymbols);
+  static constexpr uint16_t kEmptySlot = UINT16_MAX;
+  static_assert(kNumSymbols < kEmptySlot, "Too many exported symbols");
+
+  //! The exported symbols.
+  const ExportedData *mSymbols;
+
+  //! The hash of each exported symbol's name, indexed like mSymbols.
+  uint32_t mHashes[kNumSymbols];
+
+  //! Indices into mSymbols, or kEmptySlot.
+  uint16_t mSlots[kNumSlots];
+};
+
+}  // namespace chre
+
+#include "chre/platform/shared/symbol_lookup_impl.h"
+
+#endif  // CHRE_PLATFORM_SHARED_SYMBOL_LOOKUP_H_
@@ -0,0 +1,152 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CHRE_PLATFORM_SHARED_SYMBOL_LOOKUP_IMPL_H_
+#define CHRE_PLATFORM_SHARED_SYMBOL_LOOKUP_IMPL_H_
+
+#include <cstring>
+
+#include "chre/platform/shared/symbol_lookup.h"
+
+namespace chre {
+
+inline uint32_t elfGnuHash(const char *name) {
+  uint32_t hash = 5381;
+  for (; *name != '\0'; name++) {
+    hash = (hash << 5) + hash + static_cast<uint8_t>(*name);
+  }
+  return hash;
+}
+
+inline uint32_t elfSysvHash(const char *name) {
+  uint32_t hash = 0;
+  for (; *name != '\0'; name++) {
+    hash = (hash << 4) + static_cast<uint8_t>(*name);
+    uint32_t high = hash & 0xf0000000;
+    hash ^= high >> 24;
+    hash &= ~high;
+  }
+  return hash;
+}
+
+inline const Elf32_Sym *elfGnuHashLookup(const uint32_t *gnuHashTable,
+                                         const Elf32_Sym *symbolTable,
+                                         const char *stringTable,
+                                         const char *name) {
+  constexpr uint32_t kBloomWordBits = 8 * sizeof(Elf32_Addr);
+  const uint32_t numBuckets = gnuHashTable[0];
+  const uint32_t symbolOffset = gnuHashTable[1];
+  const uint32_t bloomSize = gnuHashTable[2];
+  const uint32_t bloomShift = gnuHashTable[3];
+  const auto *bloom = reinterpret_cast<const Elf32_Addr *>(&gnuHashTable[4]);
+  const auto *buckets = reinterpret_cast<const uint32_t *>(&bloom[bloomSize]);
+  const uint32_t *chain = &buckets[numBuckets];
+
+  if (numBuckets == 0 || bloomSize == 0) {
+    return nullptr;
+  }
+
+  // The bloom filter rejects most names that are not in the table without
+  // touching the buckets or the symbols.
+  uint32_t hash = elfGnuHash(name);
+  Elf32_Addr bloomWord = bloom[(hash / kBloomWordBits) % bloomSize];
+  Elf32_Addr bloomMask =
+      (Elf32_Addr{1} << (hash % kBloomWordBits)) |
+      (Elf32_Addr{1} << ((hash >> bloomShift) % kBloomWordBits));
+  if ((bloomWord & bloomMask) != bloomMask) {
+    return nullptr;
+  }
+
+  uint32_t index = buckets[hash % numBuckets];
+  if (index < symbolOffset) {
+    return nullptr;
+  }
+
+  // Symbols in the same bucket are contiguous, and the low bit of the chain
+  // entry marks the last symbol of the bucket.
+  while (true) {
+    const Elf32_Sym *symbol = &symbolTable[index];
+    uint32_t chainHash = chain[index - symbolOffset];
+    if ((hash | 1) == (chainHash | 1) && symbol->st_shndx != SHN_UNDEF &&
+        strcmp(&stringTable[symbol->st_name], name) == 0) {
+      return symbol;
+    }
+    if ((chainHash & 1) != 0) {
+      return nullptr;
+    }
+    index++;
+  }
+}
+
+inline const Elf32_Sym *elfSysvHashLookup(const uint32_t *hashTable,
+                                          const Elf32_Sym *symbolTable,
+                                          const char *stringTable,
+                                          const char *name) {
+  const uint32_t numBuckets = hashTable[0];
+  const uint32_t *buckets = &hashTable[2];
+  const uint32_t *chain = &buckets[numBuckets];
+
+  if (numBuckets == 0) {
+    return nullptr;
+  }
+
+  uint32_t hash = elfSysvHash(name);
+  for (uint32_t index = buckets[hash % numBuckets]; index != STN_UNDEF;
+       index = chain[index]) {
+    const Elf32_Sym *symbol = &symbolTable[index];
+    if (symbol->st_shndx != SHN_UNDEF &&
+        strcmp(&stringTable[symbol->st_name], name) == 0) {
+      return symbol;
+    }
+  }
+  return nullptr;
+}
+
+template <size_t kNumSymbols>
+ExportedSymbolTable<kNumSymbols>::ExportedSymbolTable(
+    const ExportedData (&symbols)[kNumSymbols])
+    : mSymbols(symbols) {
+  for (size_t i = 0; i < kNumSlots; i++) {
+    mSlots[i] = kEmptySlot;
+  }
+
+  for (size_t i = 0; i < kNumSymbols; i++) {
+    mHashes[i] = elfGnuHash(symbols[i].dataName);
+    size_t slot = mHashes[i] & (kNumSlots - 1);
+    while (mSlots[slot] != kEmptySlot) {
+      slot = (slot + 1) & (kNumSlots - 1);
+    }
+    mSlots[slot] = static_cast<uint16_t>(i);
+  }
+}
+
+template <size_t kNumSymbols>
+void *ExportedSymbolTable<kNumSymbols>::find(const char *name) const {
+  uint32_t hash = elfGnuHash(name);
+  for (size_t slot = hash & (kNumSlots - 1); mSlots[slot] != kEmptySlot;
+       slot = (slot + 1) & (kNumSlots - 1)) {
+    uint16_t index = mSlots[slot];
+    if (mHashes[index] == hash &&
+        strcmp(mSymbols[index].dataName, name) == 0) {
+      return mSymbols[index].data;
+    }
+  }
+  return nullptr;
+}
+
+}  // namespace chre
+
+#endif  // CHRE_PLATFORM_SHARED_SYMBOL_LOOKUP_IMPL_H_
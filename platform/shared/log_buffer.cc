@@ -19,17 +19,40 @@
 #include "chre/util/lock_guard.h"
 #include "include/chre/platform/shared/log_buffer.h"
 
+#include <algorithm>
 #include <cstdarg>
 #include <cstdio>
 
 namespace chre {
 
+namespace {
+
+size_t roundUpToRecordAlignment(size_t size, size_t alignment) {
+  return (size + alignment - 1) & ~(alignment - 1);
+}
+
+}  // namespace
+
 LogBuffer::LogBuffer(LogBufferCallbackInterface *callback, void *buffer,
-                     size_t bufferSize)
+                     size_t bufferSize, LogBufferWriteMode writeMode)
     : mBufferData(static_cast<uint8_t *>(buffer)),
       mBufferMaxSize(bufferSize),
+      mWriteMode(writeMode),
       mCallback(callback) {
   CHRE_ASSERT(bufferSize >= kBufferMinSize);
+
+  if (mWriteMode == LogBufferWriteMode::RESERVE_COMMIT) {
+    static_assert(sizeof(AtomicUint32) == kRecordHeaderSize,
+                  "Record headers must be accessible as AtomicUint32");
+    uintptr_t bufferAddress = reinterpret_cast<uintptr_t>(buffer);
+    size_t alignmentOffset =
+        roundUpToRecordAlignment(bufferAddress, kRecordAlignment) -
+        bufferAddress;
+    mRingData = &mBufferData[alignmentOffset];
+    mRingCapacity = static_cast<uint32_t>((bufferSize - alignmentOffset) &
+                                          ~(kRecordAlignment - 1));
+    memset(mRingData, 0, mRingCapacity);
+  }
 }
 
 void LogBuffer::handleLog(LogBufferLogLevel logLevel, uint32_t timestampMs,
@@ -42,17 +65,41 @@ void LogBuffer::handleLog(LogBufferLogLevel logLevel, uint32_t timestampMs,
 
 void LogBuffer::handleLogVa(LogBufferLogLevel logLevel, uint32_t timestampMs,
                             const char *logFormat, va_list args) {
+  if (mWriteMode == LogBufferWriteMode::RESERVE_COMMIT) {
+    reserveAndFormatLogVa(logLevel, timestampMs, logFormat, args);
+    return;
+  }
+
   constexpr size_t maxLogLen = kLogMaxSize - kLogDataOffset;
   char tempBuffer[maxLogLen];
   int logLenSigned = vsnprintf(tempBuffer, maxLogLen, logFormat, args);
   processLog(logLevel, timestampMs, tempBuffer, logLenSigned,
-             false /* encoded */);
+             LogBufferEncoding::NONE);
 }
 
 void LogBuffer::handleEncodedLog(LogBufferLogLevel logLevel,
                                  uint32_t timestampMs, const uint8_t *log,
-                                 size_t logSize) {
-  processLog(logLevel, timestampMs, log, logSize);
+                                 size_t logSize, LogBufferEncoding encoding) {
+  constexpr size_t kMaxLogLen = kLogMaxSize - kLogDataOffset;
+  if (mWriteMode != LogBufferWriteMode::RESERVE_COMMIT) {
+    processLog(logLevel, timestampMs, log, logSize, encoding);
+  } else if (logSize >= kMaxLogLen) {
+    // See processLog(): an encoded log can't be truncated, so a generic
+    // failure message is logged instead. The caller's buffer is left intact.
+    char errorMsg[kMaxLogLen];
+    int errorMsgLen = std::snprintf(errorMsg, kMaxLogLen,
+                                    "Encoded log msg @t=%" PRIu32
+                                    "ms too large (%zub)",
+                                    timestampMs, logSize);
+    size_t errorMsgSize =
+        std::min(static_cast<size_t>(errorMsgLen), kMaxLogLen - 1);
+    reserveAndCopyLog(logLevel, timestampMs, errorMsg,
+                      static_cast<uint8_t>(errorMsgSize),
+                      LogBufferEncoding::NONE);
+  } else if (logSize > 0) {
+    reserveAndCopyLog(logLevel, timestampMs, log,
+                      static_cast<uint8_t>(logSize), encoding);
+  }
 }
 
 size_t LogBuffer::copyLogs(void *destination, size_t size,
@@ -62,6 +109,18 @@ size_t LogBuffer::copyLogs(void *destination, size_t size,
 }
 
 bool LogBuffer::logWouldCauseOverflow(size_t logSize) {
+  if (mWriteMode == LogBufferWriteMode::RESERVE_COMMIT) {
+    // Read the read position first: it never passes the reserve position.
+    uint32_t readPosition = mReadPosition.load();
+    uint32_t reservePosition = mReservePosition.load();
+    uint32_t used = (reservePosition + 2 * mRingCapacity - readPosition) %
+                    (2 * mRingCapacity);
+    size_t recordSize = roundUpToRecordAlignment(
+        kRecordHeaderSize + kLogDataOffset + logSize + 1 /* nullptr */,
+        kRecordAlignment);
+    return (used + recordSize > mRingCapacity);
+  }
+
   LockGuard<Mutex> lock(mLock);
   return (mBufferDataSize + logSize + kLogDataOffset + 1 /* nullptr */ >
           mBufferMaxSize);
@@ -75,13 +134,21 @@ void LogBuffer::transferTo(LogBuffer &buffer) {
     LockGuard<Mutex> lockGuardThis(mLock);
     // The buffer being transferred to should be as big or bigger.
     CHRE_ASSERT(buffer.mBufferMaxSize >= mBufferMaxSize);
+    CHRE_ASSERT(buffer.mWriteMode == LogBufferWriteMode::LOCKED);
 
     buffer.resetLocked();
 
     bytesCopied = copyLogsLocked(buffer.mBufferData, buffer.mBufferMaxSize,
                                  &numLogsDropped);
 
-    resetLocked();
+    if (mWriteMode == LogBufferWriteMode::RESERVE_COMMIT) {
+      // Writers may have committed more logs since the copy, which must not
+      // be discarded. Only clear the drops that were handed over, keeping any
+      // that raced with the copy.
+      mNumReserveDropped.fetch_sub(static_cast<uint32_t>(numLogsDropped));
+    } else {
+      resetLocked();
+    }
   }
   buffer.mBufferDataTailIndex = bytesCopied % buffer.mBufferMaxSize;
   buffer.mBufferDataSize = bytesCopied;
@@ -106,11 +173,19 @@ const uint8_t *LogBuffer::getBufferData() {
 }
 
 size_t LogBuffer::getBufferSize() {
+  if (mWriteMode == LogBufferWriteMode::RESERVE_COMMIT) {
+    return mCommittedBytes.load();
+  }
+
   LockGuard<Mutex> lockGuard(mLock);
   return mBufferDataSize;
 }
 
 size_t LogBuffer::getNumLogsDropped() {
+  if (mWriteMode == LogBufferWriteMode::RESERVE_COMMIT) {
+    return mNumReserveDropped.load();
+  }
+
   LockGuard<Mutex> lockGuard(mLock);
   return mNumLogsDropped;
 }
@@ -152,6 +227,12 @@ void LogBuffer::copyFromBuffer(size_t size, void *destination) {
 
 size_t LogBuffer::copyLogsLocked(void *destination, size_t size,
                                  size_t *numLogsDropped) {
+  if (mWriteMode == LogBufferWriteMode::RESERVE_COMMIT) {
+    *numLogsDropped = mNumReserveDropped.load();
+    return (destination != nullptr) ? copyCommittedLogsLocked(destination, size)
+                                    : 0;
+  }
+
   size_t copySize = 0;
 
   if (size != 0 && destination != nullptr && mBufferDataSize != 0) {
@@ -177,6 +258,14 @@ size_t LogBuffer::copyLogsLocked(void *destination, size_t size,
 }
 
 void LogBuffer::resetLocked() {
+  if (mWriteMode == LogBufferWriteMode::RESERVE_COMMIT) {
+    // Records that are still being written are kept, the ring can't be
+    // rewound under the writers.
+    copyCommittedLogsLocked(nullptr /* destination */, 0 /* size */);
+    mNumReserveDropped = 0;
+    return;
+  }
+
   mBufferDataHeadIndex = 0;
   mBufferDataTailIndex = 0;
   mBufferDataSize = 0;
@@ -209,12 +298,13 @@ size_t LogBuffer::getLogDataLength(size_t startingIndex) {
 }
 
 void LogBuffer::processLog(LogBufferLogLevel logLevel, uint32_t timestampMs,
-                           const void *logBuffer, size_t size, bool encoded) {
+                           const void *logBuffer, size_t size,
+                           LogBufferEncoding encoding) {
   if (size > 0) {
     constexpr size_t kMaxLogLen = kLogMaxSize - kLogDataOffset;
     auto logLen = static_cast<uint8_t>(size);
     if (size >= kMaxLogLen) {
-      if (!encoded) {
+      if (encoding == LogBufferEncoding::NONE) {
         // Leave space for nullptr to be copied on end
         logLen = static_cast<uint8_t>(kMaxLogLen - 1);
       } else {
@@ -227,26 +317,28 @@ void LogBuffer::processLog(LogBufferLogLevel logLevel, uint32_t timestampMs,
             "Encoded log msg @t=%" PRIu32 "ms too large (%zub)";
         std::snprintf(static_cast<char *>(const_cast<void *>(logBuffer)),
                       kMaxLogLen, kGenericErrorMsg, timestampMs, size);
-        encoded = false;
+        encoding = LogBufferEncoding::NONE;
       }
     }
-    copyLogToBuffer(logLevel, timestampMs, logBuffer, logLen, encoded);
+    copyLogToBuffer(logLevel, timestampMs, logBuffer, logLen, encoding);
     dispatch();
   }
 }
 
 void LogBuffer::copyLogToBuffer(LogBufferLogLevel level, uint32_t timestampMs,
                                 const void *logBuffer, uint8_t logLen,
-                                bool encoded) {
+                                LogBufferEncoding encoding) {
   LockGuard<Mutex> lockGuard(mLock);
-  discardExcessOldLogsLocked(encoded, logLen);
-  encodeAndCopyLogLocked(level, timestampMs, logBuffer, logLen, encoded);
+  discardExcessOldLogsLocked(encoding, logLen);
+  encodeAndCopyLogLocked(level, timestampMs, logBuffer, logLen, encoding);
 }
 
-void LogBuffer::discardExcessOldLogsLocked(bool encoded,
+void LogBuffer::discardExcessOldLogsLocked(LogBufferEncoding encoding,
                                            uint8_t currentLogLen) {
   size_t totalLogSize =
-      kLogDataOffset + (encoded ? currentLogLen + 1 : currentLogLen);
+      kLogDataOffset + ((encoding != LogBufferEncoding::NONE)
+                            ? currentLogLen + 1
+                            : currentLogLen);
   while (mBufferDataSize + totalLogSize > mBufferMaxSize) {
     mNumLogsDropped++;
     size_t logSize;
@@ -258,24 +350,27 @@ void LogBuffer::discardExcessOldLogsLocked(bool encoded,
 void LogBuffer::encodeAndCopyLogLocked(LogBufferLogLevel level,
                                        uint32_t timestampMs,
                                        const void *logBuffer, uint8_t logLen,
-                                       bool encoded) {
+                                       LogBufferEncoding encoding) {
   uint8_t metadata =
-      (static_cast<uint8_t>(encoded) << 4) | static_cast<uint8_t>(level);
+      (static_cast<uint8_t>(encoding) << 4) | static_cast<uint8_t>(level);
 
   copyToBuffer(sizeof(uint8_t), &metadata);
   copyToBuffer(sizeof(timestampMs), &timestampMs);
 
-  if (encoded) {
+  if (encoding != LogBufferEncoding::NONE) {
     copyToBuffer(sizeof(uint8_t), &logLen);
   }
   copyToBuffer(logLen, logBuffer);
-  if (!encoded) {
+  if (encoding == LogBufferEncoding::NONE) {
     copyToBuffer(1, reinterpret_cast<const void *>("\0"));
   }
 }
 
 void LogBuffer::dispatch() {
   if (mCallback != nullptr) {
+    size_t bufferSize = (mWriteMode == LogBufferWriteMode::RESERVE_COMMIT)
+                            ? mCommittedBytes.load()
+                            : mBufferDataSize;
     switch (mNotificationSetting) {
       case LogBufferNotificationSetting::ALWAYS: {
         mCallback->onLogsReady();
@@ -285,7 +380,7 @@ void LogBuffer::dispatch() {
         break;
       }
       case LogBufferNotificationSetting::THRESHOLD: {
-        if (mBufferDataSize > mNotificationThresholdBytes) {
+        if (bufferSize > mNotificationThresholdBytes) {
           mCallback->onLogsReady();
         }
         break;
@@ -294,4 +389,141 @@ void LogBuffer::dispatch() {
   }
 }
 
+void LogBuffer::reserveAndFormatLogVa(LogBufferLogLevel logLevel,
+                                      uint32_t timestampMs,
+                                      const char *logFormat, va_list args) {
+  // The log is formatted on the stack rather than in the ring: the size of a
+  // record must be known to reserve it, and measuring the log with a first
+  // vsnprintf pass costs more than copying the formatted log.
+  constexpr size_t kMaxLogLen = kLogMaxSize - kLogDataOffset;
+  char tempBuffer[kMaxLogLen];
+  int logLenSigned = vsnprintf(tempBuffer, kMaxLogLen, logFormat, args);
+  if (logLenSigned > 0) {
+    // Leave space for nullptr to be copied on end
+    size_t logLen = std::min(static_cast<size_t>(logLenSigned), kMaxLogLen - 1);
+    reserveAndCopyLog(logLevel, timestampMs, tempBuffer,
+                      static_cast<uint8_t>(logLen), LogBufferEncoding::NONE);
+  }
+}
+
+void LogBuffer::reserveAndCopyLog(LogBufferLogLevel logLevel,
+                                  uint32_t timestampMs, const void *log,
+                                  uint8_t logLen, LogBufferEncoding encoding) {
+  size_t wireSize = kLogDataOffset + logLen + 1;
+  size_t recordOffset;
+  uint8_t *record = reserveRecord(wireSize, &recordOffset);
+  if (record != nullptr) {
+    uint8_t metadata =
+        (static_cast<uint8_t>(encoding) << 4) | static_cast<uint8_t>(logLevel);
+    record[0] = metadata;
+    memcpy(&record[1], &timestampMs, sizeof(timestampMs));
+    if (encoding != LogBufferEncoding::NONE) {
+      record[kLogDataOffset] = logLen;
+      memcpy(&record[kLogDataOffset + 1], log, logLen);
+    } else {
+      memcpy(&record[kLogDataOffset], log, logLen);
+      record[kLogDataOffset + logLen] = '\0';
+    }
+    commitRecord(recordOffset, wireSize);
+  }
+  dispatch();
+}
+
+uint8_t *LogBuffer::reserveRecord(size_t wireSize, size_t *recordOffset) {
+  const uint32_t positionModulus = 2 * mRingCapacity;
+  size_t recordSize =
+      roundUpToRecordAlignment(kRecordHeaderSize + wireSize, kRecordAlignment);
+
+  uint32_t reservePosition;
+  size_t offset;
+  size_t paddingSize;
+  bool reserved = false;
+  while (!reserved) {
+    // The read position is loaded first so that it can't be ahead of the
+    // reserve position. A stale read position only underestimates the free
+    // space.
+    uint32_t readPosition = mReadPosition.load();
+    reservePosition = mReservePosition.load();
+
+    offset = reservePosition % mRingCapacity;
+    paddingSize =
+        (offset + recordSize > mRingCapacity) ? mRingCapacity - offset : 0;
+    uint32_t used = (reservePosition + positionModulus - readPosition) %
+                    positionModulus;
+    size_t totalSize = paddingSize + recordSize;
+    if (used + totalSize > mRingCapacity) {
+      mNumReserveDropped.fetch_increment();
+      return nullptr;
+    }
+
+    uint32_t newReservePosition = static_cast<uint32_t>(
+        (reservePosition + totalSize) % positionModulus);
+    reserved =
+        mReservePosition.compare_exchange(reservePosition, newReservePosition);
+  }
+
+  if (paddingSize > 0) {
+    getRecordHeader(offset)->store(kRecordCommitted | kRecordPadding |
+                                   static_cast<uint32_t>(paddingSize));
+    offset = 0;
+  }
+
+  *recordOffset = offset;
+  return &mRingData[offset + kRecordHeaderSize];
+}
+
+void LogBuffer::commitRecord(size_t recordOffset, size_t wireSize) {
+  size_t recordSize =
+      roundUpToRecordAlignment(kRecordHeaderSize + wireSize, kRecordAlignment);
+  getRecordHeader(recordOffset)
+      ->store(kRecordCommitted |
+              (static_cast<uint32_t>(wireSize) << kRecordWireSizeShift) |
+              static_cast<uint32_t>(recordSize));
+  mCommittedBytes.fetch_add(static_cast<uint32_t>(wireSize));
+}
+
+size_t LogBuffer::copyCommittedLogsLocked(void *destination, size_t size) {
+  uint8_t *destinationBytes = static_cast<uint8_t *>(destination);
+  const uint32_t positionModulus = 2 * mRingCapacity;
+  uint32_t readPosition = mReadPosition.load();
+  size_t copySize = 0;
+  size_t consumedSize = 0;
+
+  while (consumedSize < mRingCapacity) {
+    size_t offset = readPosition % mRingCapacity;
+    uint32_t header = getRecordHeader(offset)->load();
+    if ((header & kRecordCommitted) == 0) {
+      break;
+    }
+
+    size_t recordSize = header & kRecordSizeMask;
+    if ((header & kRecordPadding) == 0) {
+      size_t wireSize =
+          (header >> kRecordWireSizeShift) & kRecordWireSizeMask;
+      if (destinationBytes != nullptr) {
+        if (copySize + wireSize > size) {
+          break;
+        }
+        memcpy(&destinationBytes[copySize],
+               &mRingData[offset + kRecordHeaderSize], wireSize);
+      }
+      copySize += wireSize;
+    }
+
+    // Zero the record before releasing its space so that a header written
+    // later at any offset within it starts out uncommitted.
+    memset(&mRingData[offset], 0, recordSize);
+    consumedSize += recordSize;
+    readPosition =
+        static_cast<uint32_t>((readPosition + recordSize) % positionModulus);
+  }
+
+  if (consumedSize > 0) {
+    mCommittedBytes.fetch_sub(static_cast<uint32_t>(copySize));
+    mReadPosition = readPosition;
+  }
+
+  return (destinationBytes != nullptr) ? copySize : 0;
+}
+
 }  // namespace chre
@@ -29,6 +29,18 @@ void chrePlatformLogToBuffer(chreLogLevel chreLogLevel, const char *format,
   va_end(args);
 }
 
+void chrePlatformDeferredLogToBuffer(chreLogLevel chreLogLevel,
+                                     uint32_t formatHash, const char *format,
+                                     ...) {
+  va_list args;
+  va_start(args, format);
+  if (chre::LogBufferManagerSingleton::isInitialized()) {
+    chre::LogBufferManagerSingleton::get()->logDeferredVa(
+        chreLogLevel, formatHash, format, args);
+  }
+  va_end(args);
+}
+
 void chrePlatformEncodedLogToBuffer(chreLogLevel level, const uint8_t *msg,
                                     size_t msgSize) {
   if (chre::LogBufferManagerSingleton::isInitialized()) {
@@ -141,6 +153,28 @@ void LogBufferManager::logVa(chreLogLevel logLevel, const char *formatStr,
                                 getTimestampMs(), formatStr, args);
 }
 
+void LogBufferManager::logDeferredVa(chreLogLevel logLevel,
+                                     uint32_t formatHash,
+                                     const char *formatStr, va_list args) {
+  // The encoded log carries a size byte, which the LogBuffer adds.
+  constexpr size_t kMaxEncodedLogSize =
+      LogBuffer::kLogMaxSize - LogBuffer::kLogDataOffset - 1;
+  uint8_t encodedLog[kMaxEncodedLogSize];
+  memcpy(encodedLog, &formatHash, kLogFormatHashSize);
+
+  size_t argsSize;
+  if (encodeLogArgsVa(formatStr, args, &encodedLog[kLogFormatHashSize],
+                      kMaxEncodedLogSize - kLogFormatHashSize, &argsSize)) {
+    size_t encodedLogSize = kLogFormatHashSize + argsSize;
+    bufferOverflowGuard(encodedLogSize);
+    mPrimaryLogBuffer.handleEncodedLog(
+        chreToLogBufferLogLevel(logLevel), getTimestampMs(), encodedLog,
+        encodedLogSize, LogBufferEncoding::DEFERRED_FORMAT);
+  } else {
+    logVa(logLevel, formatStr, args);
+  }
+}
+
 void LogBufferManager::logEncoded(chreLogLevel logLevel,
                                   const uint8_t *encodedLog,
                                   size_t encodedLogSize) {
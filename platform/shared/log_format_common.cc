@@ -0,0 +1,298 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "chre/platform/shared/log_format_common.h"
+
+#include <cstddef>
+#include <cstring>
+
+namespace chre {
+
+namespace {
+
+bool isFlagOrDigit(char c) {
+  return (c == '-' || c == '+' || c == ' ' || c == '#' || c == '0' ||
+          (c >= '1' && c <= '9'));
+}
+
+/**
+ * Reads an integer argument of the given length from args and widens it to 64
+ * bits. The value is sign-extended if isSigned.
+ */
+uint64_t readIntegerArg(va_list &args, LogArgLength argLength, bool isSigned) {
+  switch (argLength) {
+    case LogArgLength::LONG:
+      return isSigned ? static_cast<uint64_t>(va_arg(args, long))
+                      : va_arg(args, unsigned long);
+    case LogArgLength::LONG_LONG:
+      return isSigned ? static_cast<uint64_t>(va_arg(args, long long))
+                      : va_arg(args, unsigned long long);
+    case LogArgLength::SIZE_T:
+      return va_arg(args, size_t);
+    case LogArgLength::INTMAX_T:
+      return isSigned ? static_cast<uint64_t>(va_arg(args, intmax_t))
+                      : va_arg(args, uintmax_t);
+    case LogArgLength::PTRDIFF_T:
+      return static_cast<uint64_t>(va_arg(args, ptrdiff_t));
+    case LogArgLength::CHAR:
+      // char and short arguments are promoted to int, and converted back as
+      // printf() would do.
+      return isSigned ? static_cast<uint64_t>(
+                            static_cast<signed char>(va_arg(args, int)))
+                      : static_cast<unsigned char>(va_arg(args, unsigned int));
+    case LogArgLength::SHORT:
+      return isSigned
+                 ? static_cast<uint64_t>(static_cast<short>(va_arg(args, int)))
+                 : static_cast<unsigned short>(va_arg(args, unsigned int));
+    default:
+      return isSigned ? static_cast<uint64_t>(va_arg(args, int))
+                      : va_arg(args, unsigned int);
+  }
+}
+
+}  // anonymous namespace
+
+bool parseLogFormatConversion(const char *spec,
+                              LogFormatConversion *conversion) {
+  size_t i = 1;  // Skip the '%'
+  conversion->widthFromArg = false;
+  conversion->precisionFromArg = false;
+
+  while (isFlagOrDigit(spec[i]) || spec[i] == '*' || spec[i] == '.') {
+    if (spec[i] == '*') {
+      // A '*' after the '.' is the precision, otherwise the width
+      bool afterDot = false;
+      for (size_t j = 1; j < i; j++) {
+        afterDot |= (spec[j] == '.');
+      }
+      if (afterDot) {
+        conversion->precisionFromArg = true;
+      } else {
+        conversion->widthFromArg = true;
+      }
+    }
+    i++;
+  }
+  conversion->flagsLength = i - 1;
+
+  conversion->argLength = LogArgLength::DEFAULT;
+  bool supportedLength = true;
+  switch (spec[i]) {
+    case 'h':
+      if (spec[i + 1] == 'h') {
+        conversion->argLength = LogArgLength::CHAR;
+        i += 2;
+      } else {
+        conversion->argLength = LogArgLength::SHORT;
+        i++;
+      }
+      break;
+    case 'l':
+      if (spec[i + 1] == 'l') {
+        conversion->argLength = LogArgLength::LONG_LONG;
+        i += 2;
+      } else {
+        conversion->argLength = LogArgLength::LONG;
+        i++;
+      }
+      break;
+    case 'z':
+      conversion->argLength = LogArgLength::SIZE_T;
+      i++;
+      break;
+    case 'j':
+      conversion->argLength = LogArgLength::INTMAX_T;
+      i++;
+      break;
+    case 't':
+      conversion->argLength = LogArgLength::PTRDIFF_T;
+      i++;
+      break;
+    case 'L':
+      supportedLength = false;
+      i++;
+      break;
+    default:
+      break;
+  }
+
+  conversion->conversion = spec[i];
+  switch (spec[i]) {
+    case 'd':
+    case 'i':
+      conversion->argType = LogArgType::SIGNED_INT;
+      break;
+    case 'u':
+    case 'x':
+    case 'X':
+    case 'o':
+    case 'c':
+      conversion->argType = LogArgType::UNSIGNED_INT;
+      break;
+    case 'f':
+    case 'F':
+    case 'e':
+    case 'E':
+    case 'g':
+    case 'G':
+    case 'a':
+    case 'A':
+      conversion->argType = LogArgType::DOUBLE;
+      break;
+    case 's':
+      conversion->argType = LogArgType::STRING;
+      break;
+    case 'p':
+      conversion->argType = LogArgType::POINTER;
+      break;
+    case '%':
+      conversion->argType = LogArgType::NONE;
+      break;
+    case '\0':
+      return false;
+    default:
+      conversion->argType = LogArgType::UNSUPPORTED;
+      break;
+  }
+
+  if (!supportedLength || (conversion->argLength != LogArgLength::DEFAULT &&
+                           (conversion->argType == LogArgType::STRING ||
+                            conversion->argType == LogArgType::DOUBLE))) {
+    // Wide strings and long doubles are not supported
+    conversion->argType = LogArgType::UNSUPPORTED;
+  }
+
+  conversion->length = i + 1;
+  return true;
+}
+
+size_t encodeLogVarint(uint64_t value, uint8_t *buffer, size_t bufferSize) {
+  size_t size = 0;
+  do {
+    if (size == bufferSize) {
+      return 0;
+    }
+    uint8_t byte = value & 0x7f;
+    value >>= 7;
+    buffer[size++] = (value != 0) ? (byte | 0x80) : byte;
+  } while (value != 0);
+  return size;
+}
+
+size_t decodeLogVarint(const uint8_t *buffer, size_t bufferSize,
+                       uint64_t *value) {
+  uint64_t result = 0;
+  for (size_t i = 0; i < bufferSize && i < 10; i++) {
+    result |= static_cast<uint64_t>(buffer[i] & 0x7f) << (7 * i);
+    if ((buffer[i] & 0x80) == 0) {
+      *value = result;
+      return i + 1;
+    }
+  }
+  return 0;
+}
+
+bool encodeLogArgsVa(const char *format, va_list args, uint8_t *buffer,
+                     size_t bufferSize, size_t *encodedSize) {
+  size_t size = 0;
+  bool success = true;
+
+  // Work on a local copy, which can be passed by reference to
+  // readIntegerArg() whatever the ABI's va_list type is.
+  va_list argsCopy;
+  va_copy(argsCopy, args);
+
+  for (const char *c = strchr(format, '%'); success && c != nullptr;
+       c = strchr(c, '%')) {
+    LogFormatConversion conversion;
+    if (!parseLogFormatConversion(c, &conversion) ||
+        conversion.argType == LogArgType::UNSUPPORTED) {
+      success = false;
+      break;
+    }
+    c += conversion.length;
+    if (conversion.argType == LogArgType::NONE) {
+      continue;
+    }
+
+    for (int i = 0; i < conversion.widthFromArg + conversion.precisionFromArg;
+         i++) {
+      size_t written = encodeLogVarint(zigzagEncode(va_arg(argsCopy, int)),
+                                       &buffer[size], bufferSize - size);
+      success &= (written > 0);
+      size += written;
+    }
+
+    size_t written = 0;
+    switch (conversion.argType) {
+      case LogArgType::SIGNED_INT: {
+        auto value = static_cast<int64_t>(
+            readIntegerArg(argsCopy, conversion.argLength, true /* isSigned */));
+        written = encodeLogVarint(zigzagEncode(value), &buffer[size],
+                                  bufferSize - size);
+        break;
+      }
+      case LogArgType::UNSIGNED_INT:
+        written = encodeLogVarint(
+            readIntegerArg(argsCopy, conversion.argLength, false /* isSigned */),
+            &buffer[size], bufferSize - size);
+        break;
+      case LogArgType::POINTER:
+        written = encodeLogVarint(
+            reinterpret_cast<uintptr_t>(va_arg(argsCopy, void *)),
+            &buffer[size], bufferSize - size);
+        break;
+      case LogArgType::DOUBLE: {
+        double value = va_arg(argsCopy, double);
+        if (bufferSize - size >= sizeof(value)) {
+          // CHRE platforms are little-endian, as is the host
+          memcpy(&buffer[size], &value, sizeof(value));
+          written = sizeof(value);
+        }
+        break;
+      }
+      case LogArgType::STRING: {
+        const char *str = va_arg(argsCopy, const char *);
+        if (str == nullptr) {
+          str = "(null)";
+        }
+        size_t length = strnlen(str, kLogMaxStringArgLength + 1);
+        uint8_t lengthByte = static_cast<uint8_t>(length);
+        if (length > kLogMaxStringArgLength) {
+          length = kLogMaxStringArgLength;
+          lengthByte = static_cast<uint8_t>(length) | kLogStringArgTruncated;
+        }
+        if (bufferSize - size >= length + 1) {
+          buffer[size] = lengthByte;
+          memcpy(&buffer[size + 1], str, length);
+          written = length + 1;
+        }
+        break;
+      }
+      default:
+        break;
+    }
+
+    success &= (written > 0);
+    size += written;
+  }
+
+  va_end(argsCopy);
+  *encodedSize = size;
+  return success;
+}
+
+}  // namespace chre
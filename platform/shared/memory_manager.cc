@@ -16,13 +16,16 @@
 
 #include "chre/platform/memory_manager.h"
 
+#include <algorithm>
+#include <cstring>
+
 #include "chre/platform/assert.h"
 #include "chre/util/system/debug_dump.h"
 
 namespace chre {
 
 void *MemoryManager::nanoappAlloc(Nanoapp *app, uint32_t bytes) {
-  HeapBlockHeader *header = nullptr;
+  void *ptr = nullptr;
   if (bytes > 0) {
     if (mAllocationCount >= kMaxAllocationCount) {
       LOGE("Failed to allocate memory from Nanoapp ID %" PRIu16
@@ -34,58 +37,78 @@ void *MemoryManager::nanoappAlloc(Nanoapp *app, uint32_t bytes) {
            ": not enough space.",
            app->getInstanceId());
     } else {
-      header = static_cast<HeapBlockHeader *>(
-          doAlloc(app, sizeof(HeapBlockHeader) + bytes));
+#ifdef CHRE_NANOAPP_SLAB_ALLOCATOR_ENABLED
+      ptr = slabAlloc(app, bytes);
+#endif  // CHRE_NANOAPP_SLAB_ALLOCATOR_ENABLED
 
-      if (header != nullptr) {
+      if (ptr == nullptr) {
+        HeapBlockHeader *header = static_cast<HeapBlockHeader *>(
+            doAlloc(app, sizeof(HeapBlockHeader) + bytes));
+        if (header != nullptr) {
+          app->linkHeapBlock(header);
+          header->data.bytes = bytes;
+          header->data.instanceId = app->getInstanceId();
+          ptr = header + 1;
+        }
+      }
+
+      if (ptr != nullptr) {
         app->setTotalAllocatedBytes(app->getTotalAllocatedBytes() + bytes);
         mTotalAllocatedBytes += bytes;
         if (mTotalAllocatedBytes > mPeakAllocatedBytes) {
           mPeakAllocatedBytes = mTotalAllocatedBytes;
         }
         mAllocationCount++;
-        app->linkHeapBlock(header);
-        header->data.bytes = bytes;
-        header->data.instanceId = app->getInstanceId();
-        header++;
       }
     }
   }
-  return header;
+  return ptr;
 }
 
 void MemoryManager::nanoappFree(Nanoapp *app, void *ptr) {
   if (ptr != nullptr) {
-    HeapBlockHeader *header = static_cast<HeapBlockHeader *>(ptr);
-    header--;
+    uint32_t bytes;
+    uint16_t instanceId;
+#ifdef CHRE_NANOAPP_SLAB_ALLOCATOR_ENABLED
+    SlabHeader *slab = findSlab(ptr);
+    if (slab != nullptr) {
+      instanceId = slab->data.instanceId;
+      bytes = slabFree(app, slab, ptr);
+      if (bytes == 0) {
+        LOGE("Nanoapp ID=%" PRIu16 " freed an unallocated block",
+             app->getInstanceId());
+        return;
+      }
+    } else {
+      bytes = freeHeapBlock(app, ptr, &instanceId);
+    }
+#else
+    bytes = freeHeapBlock(app, ptr, &instanceId);
+#endif  // CHRE_NANOAPP_SLAB_ALLOCATOR_ENABLED
 
     // TODO: Clean up API contract of chreSendEvent to specify nanoapps can't
     // release ownership of data to other nanoapps so a CHRE_ASSERT_LOG can be
     // used below and the code can return.
-    if (app->getInstanceId() != header->data.instanceId) {
+    if (app->getInstanceId() != instanceId) {
       LOGW("Nanoapp ID=%" PRIu16 " tried to free data from nanoapp ID=%" PRIu16,
-           app->getInstanceId(), header->data.instanceId);
+           app->getInstanceId(), instanceId);
     }
 
     size_t nanoAppTotalAllocatedBytes = app->getTotalAllocatedBytes();
-    if (nanoAppTotalAllocatedBytes >= header->data.bytes) {
-      app->setTotalAllocatedBytes(nanoAppTotalAllocatedBytes -
-                                  header->data.bytes);
+    if (nanoAppTotalAllocatedBytes >= bytes) {
+      app->setTotalAllocatedBytes(nanoAppTotalAllocatedBytes - bytes);
     } else {
       app->setTotalAllocatedBytes(0);
     }
 
-    if (mTotalAllocatedBytes >= header->data.bytes) {
-      mTotalAllocatedBytes -= header->data.bytes;
+    if (mTotalAllocatedBytes >= bytes) {
+      mTotalAllocatedBytes -= bytes;
     } else {
       mTotalAllocatedBytes = 0;
     }
     if (mAllocationCount > 0) {
       mAllocationCount--;
     }
-
-    app->unlinkHeapBlock(header);
-    doFree(app, header);
   }
 }
 
@@ -109,6 +132,10 @@ uint32_t MemoryManager::nanoappFreeAll(Nanoapp *app) {
     totalNumBlocks--;
   }
 
+#ifdef CHRE_NANOAPP_SLAB_ALLOCATOR_ENABLED
+  numFreedBlocks += slabFreeAll(app);
+#endif  // CHRE_NANOAPP_SLAB_ALLOCATOR_ENABLED
+
   return numFreedBlocks;
 }
 
@@ -117,6 +144,226 @@ void MemoryManager::logStateToBuffer(DebugDumpWrapper &debugDump) const {
       "\nNanoapp heap usage: %zu bytes allocated, %zu peak bytes"
       " allocated, count %zu\n",
       getTotalAllocatedBytes(), getPeakAllocatedBytes(), getAllocationCount());
+
+#ifdef CHRE_NANOAPP_SLAB_ALLOCATOR_ENABLED
+  debugDump.print(
+      "Nanoapp slab usage: %zu bytes reserved, %zu peak bytes reserved\n",
+      getSlabReservedBytes(), getPeakSlabReservedBytes());
+  for (SlabHeader *slab = mFirstSlab; slab != nullptr;
+       slab = slab->data.next) {
+    // Print each nanoapp once, at its first slab in the list.
+    const uint16_t instanceId = slab->data.instanceId;
+    SlabHeader *previous = mFirstSlab;
+    while (previous != slab && previous->data.instanceId != instanceId) {
+      previous = previous->data.next;
+    }
+
+    if (previous == slab) {
+      SlabStats stats = getSlabStats(instanceId);
+      // Fragmentation is the share of the reserved memory not requested by
+      // the nanoapp, within blocks (internal) and in free blocks (external).
+      debugDump.print(" Id=%" PRIu16
+                      " slabs=%zu reserved=%zu blocks=%zu requested=%zu"
+                      " internalFrag=%zu%% externalFrag=%zu%%\n",
+                      instanceId, stats.slabCount, stats.reservedBytes,
+                      stats.blockBytes, stats.requestedBytes,
+                      (stats.blockBytes - stats.requestedBytes) * 100 /
+                          stats.reservedBytes,
+                      (stats.reservedBytes - stats.blockBytes) * 100 /
+                          stats.reservedBytes);
+    }
+  }
+#endif  // CHRE_NANOAPP_SLAB_ALLOCATOR_ENABLED
+}
+
+uint32_t MemoryManager::freeHeapBlock(Nanoapp *app, void *ptr,
+                                      uint16_t *instanceId) {
+  HeapBlockHeader *header = static_cast<HeapBlockHeader *>(ptr);
+  header--;
+
+  const uint32_t bytes = header->data.bytes;
+  *instanceId = header->data.instanceId;
+  app->unlinkHeapBlock(header);
+  doFree(app, header);
+  return bytes;
+}
+
+#ifdef CHRE_NANOAPP_SLAB_ALLOCATOR_ENABLED
+MemoryManager::SlabStats MemoryManager::getSlabStats(
+    uint16_t instanceId) const {
+  SlabStats stats;
+  for (SlabHeader *slab = mFirstSlab; slab != nullptr;
+       slab = slab->data.next) {
+    if (slab->data.instanceId == instanceId) {
+      const uint16_t *requestedSizes = getSlabRequestedSizes(slab);
+      stats.slabCount++;
+      stats.reservedBytes += kSlabBytes;
+      stats.blockBytes +=
+          slab->data.usedBlocks * getSlabBlockSize(slab->data.sizeClass);
+      for (size_t i = 0; i < getSlabBlockCount(slab->data.sizeClass); i++) {
+        stats.requestedBytes += requestedSizes[i];
+      }
+    }
+  }
+  return stats;
+}
+
+uint8_t *MemoryManager::getSlabBlocks(SlabHeader *slab) {
+  constexpr size_t kAlignment = alignof(max_align_t);
+  const size_t sizesBytes =
+      getSlabBlockCount(slab->data.sizeClass) * sizeof(uint16_t);
+  return reinterpret_cast<uint8_t *>(slab + 1) +
+         (sizesBytes + kAlignment - 1) / kAlignment * kAlignment;
+}
+
+void *MemoryManager::slabAlloc(Nanoapp *app, uint32_t bytes) {
+  static_assert(getSlabBlockCount(kNumSlabSizeClasses - 1) > 0,
+                "Slabs must hold at least one block of each size class");
+
+  if (bytes > getSlabBlockSize(kNumSlabSizeClasses - 1)) {
+    return nullptr;
+  }
+
+  uint8_t sizeClass = 0;
+  while (getSlabBlockSize(sizeClass) < bytes) {
+    sizeClass++;
+  }
+
+  SlabHeader *slab = mFirstSlab;
+  while (slab != nullptr &&
+         (slab->data.instanceId != app->getInstanceId() ||
+          slab->data.sizeClass != sizeClass ||
+          slab->data.freeList == nullptr)) {
+    slab = slab->data.next;
+  }
+
+  if (slab == nullptr) {
+    slab = static_cast<SlabHeader *>(doAlloc(app, kSlabBytes));
+    if (slab == nullptr) {
+      return nullptr;
+    }
+
+    const size_t blockCount = getSlabBlockCount(sizeClass);
+    const size_t blockSize = getSlabBlockSize(sizeClass);
+    slab->data.freeList = nullptr;
+    slab->data.usedBlocks = 0;
+    slab->data.instanceId = app->getInstanceId();
+    slab->data.sizeClass = sizeClass;
+    memset(getSlabRequestedSizes(slab), 0, blockCount * sizeof(uint16_t));
+
+    // Link the blocks in reverse so that they are handed out in address
+    // order.
+    uint8_t *blocks = getSlabBlocks(slab);
+    for (size_t i = blockCount; i > 0; i--) {
+      void *block = blocks + (i - 1) * blockSize;
+      *static_cast<void **>(block) = slab->data.freeList;
+      slab->data.freeList = block;
+    }
+
+    slab->data.next = mFirstSlab;
+    mFirstSlab = slab;
+    mSlabReservedBytes += kSlabBytes;
+    if (mSlabReservedBytes > mPeakSlabReservedBytes) {
+      mPeakSlabReservedBytes = mSlabReservedBytes;
+    }
+  }
+
+  void *block = slab->data.freeList;
+  slab->data.freeList = *static_cast<void **>(block);
+  slab->data.usedBlocks++;
+  const size_t index = (static_cast<uint8_t *>(block) - getSlabBlocks(slab)) /
+                       getSlabBlockSize(sizeClass);
+  getSlabRequestedSizes(slab)[index] = static_cast<uint16_t>(bytes);
+  return block;
+}
+
+MemoryManager::SlabHeader *MemoryManager::findSlab(const void *ptr) const {
+  const uint8_t *address = static_cast<const uint8_t *>(ptr);
+  SlabHeader *slab = mFirstSlab;
+  while (slab != nullptr) {
+    const uint8_t *start = reinterpret_cast<const uint8_t *>(slab);
+    if (address >= start && address < start + kSlabBytes) {
+      break;
+    }
+    slab = slab->data.next;
+  }
+  return slab;
+}
+
+uint32_t MemoryManager::slabFree(Nanoapp *app, SlabHeader *slab, void *ptr) {
+  const size_t blockSize = getSlabBlockSize(slab->data.sizeClass);
+  uint8_t *blocks = getSlabBlocks(slab);
+  const size_t offset = static_cast<uint8_t *>(ptr) - blocks;
+  if (static_cast<uint8_t *>(ptr) < blocks || offset % blockSize != 0 ||
+      offset / blockSize >= getSlabBlockCount(slab->data.sizeClass)) {
+    return 0;
+  }
+
+  uint16_t *requestedSize = &getSlabRequestedSizes(slab)[offset / blockSize];
+  if (*requestedSize == 0) {
+    return 0;
+  }
+
+  const uint32_t bytes = *requestedSize;
+  *requestedSize = 0;
+  *static_cast<void **>(ptr) = slab->data.freeList;
+  slab->data.freeList = ptr;
+  slab->data.usedBlocks--;
+
+  if (slab->data.usedBlocks == 0) {
+    SlabHeader *other = mFirstSlab;
+    while (other != nullptr &&
+           (other == slab || other->data.instanceId != slab->data.instanceId ||
+            other->data.sizeClass != slab->data.sizeClass ||
+            other->data.freeList == nullptr)) {
+      other = other->data.next;
+    }
+
+    if (other != nullptr) {
+      releaseSlab(app, slab);
+    }
+  }
+
+  return bytes;
+}
+
+uint32_t MemoryManager::slabFreeAll(Nanoapp *app) {
+  uint32_t numFreedBlocks = 0;
+  SlabHeader *slab = mFirstSlab;
+  while (slab != nullptr) {
+    SlabHeader *next = slab->data.next;
+    if (slab->data.instanceId == app->getInstanceId()) {
+      const uint16_t *requestedSizes = getSlabRequestedSizes(slab);
+      size_t bytes = 0;
+      for (size_t i = 0; i < getSlabBlockCount(slab->data.sizeClass); i++) {
+        bytes += requestedSizes[i];
+      }
+
+      app->setTotalAllocatedBytes(app->getTotalAllocatedBytes() -
+                                  std::min(app->getTotalAllocatedBytes(),
+                                           bytes));
+      mTotalAllocatedBytes -= std::min(mTotalAllocatedBytes, bytes);
+      mAllocationCount -=
+          std::min(mAllocationCount, size_t(slab->data.usedBlocks));
+      numFreedBlocks += slab->data.usedBlocks;
+      releaseSlab(app, slab);
+    }
+    slab = next;
+  }
+
+  return numFreedBlocks;
+}
+
+void MemoryManager::releaseSlab(Nanoapp *app, SlabHeader *slab) {
+  SlabHeader **link = &mFirstSlab;
+  while (*link != slab) {
+    link = &(*link)->data.next;
+  }
+  *link = slab->data.next;
+
+  mSlabReservedBytes -= kSlabBytes;
+  doFree(app, slab);
 }
+#endif  // CHRE_NANOAPP_SLAB_ALLOCATOR_ENABLED
 
 }  // namespace chre
@@ -202,6 +202,13 @@ bool chreAudioGetStatus(uint32_t handle, struct chreAudioSourceStatus *status) {
   return (fptr != nullptr) ? fptr(handle, status) : false;
 }
 
+WEAK_SYMBOL
+bool chreAudioConfigureFeatures(uint32_t handle, bool enable,
+                                const struct chreAudioFeatureConfig *config) {
+  auto *fptr = CHRE_NSL_LAZY_LOOKUP(chreAudioConfigureFeatures);
+  return (fptr != nullptr) ? fptr(handle, enable, config) : false;
+}
+
 #endif /* CHRE_NANOAPP_USES_AUDIO */
 
 #ifdef CHRE_NANOAPP_USES_BLE
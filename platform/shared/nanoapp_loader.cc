@@ -28,6 +28,7 @@
 #include "chre/platform/fatal_error.h"
 #include "chre/platform/shared/debug_dump.h"
 #include "chre/platform/shared/memory.h"
+#include "chre/platform/shared/symbol_lookup.h"
 #include "chre/target_platform/platform_cache_management.h"
 #include "chre/util/dynamic_vector.h"
 #include "chre/util/macros.h"
@@ -50,11 +51,6 @@ namespace {
 using ElfHeader = ElfW(Ehdr);
 using ProgramHeader = ElfW(Phdr);
 
-struct ExportedData {
-  void *data;
-  const char *dataName;
-};
-
 //! If non-null, a nanoapp is currently being loaded. This allows certain C
 //! functions to access the nanoapp if called during static init.
 NanoappLoader *gCurrentlyLoadingNanoapp = nullptr;
@@ -218,6 +214,7 @@ const ExportedData gExportedData[] = {
     ADD_EXPORTED_C_SYMBOL(ashSetMultiCalibration),
     /* CHRE symbols */
     ADD_EXPORTED_C_SYMBOL(chreAbort),
+    ADD_EXPORTED_C_SYMBOL(chreAudioConfigureFeatures),
     ADD_EXPORTED_C_SYMBOL(chreAudioConfigureSource),
     ADD_EXPORTED_C_SYMBOL(chreAudioGetSource),
     ADD_EXPORTED_C_SYMBOL(chreBleGetCapabilities),
@@ -286,6 +283,10 @@ const ExportedData gExportedData[] = {
 CHRE_DEPRECATED_EPILOGUE
 // clang-format on
 
+//! Hash table over gExportedData, used to resolve nanoapp imports by name.
+const ExportedSymbolTable<ARRAY_SIZE(gExportedData)> gExportedSymbolTable(
+    gExportedData);
+
 }  // namespace
 
 void *NanoappLoader::create(void *elfInput, bool mapIntoTcm) {
@@ -313,16 +314,11 @@ void NanoappLoader::destroy(NanoappLoader *loader) {
 }
 
 void *NanoappLoader::findExportedSymbol(const char *name) {
-  size_t nameLen = strlen(name);
-  for (size_t i = 0; i < ARRAY_SIZE(gExportedData); i++) {
-    if (nameLen == strlen(gExportedData[i].dataName) &&
-        strncmp(name, gExportedData[i].dataName, nameLen) == 0) {
-      return gExportedData[i].data;
-    }
+  void *symbol = gExportedSymbolTable.find(name);
+  if (symbol == nullptr) {
+    LOGE("Unable to find %s", name);
   }
-
-  LOGE("Unable to find %s", name);
-  return nullptr;
+  return symbol;
 }
 
 bool NanoappLoader::open() {
@@ -337,6 +333,8 @@ bool NanoappLoader::open() {
     } else if (!resolveGot()) {
       LOGE("Failed to resolve GOT");
     } else {
+      initDynamicSymbolLookup();
+
       // Wipe caches before calling init array to ensure initializers are not in
       // the data cache.
       wipeSystemCaches();
@@ -363,17 +361,32 @@ void NanoappLoader::close() {
 
 void *NanoappLoader::findSymbolByName(const char *name) {
   void *symbol = nullptr;
-  uint8_t *index = mSymbolTablePtr;
-  while (index < (mSymbolTablePtr + mSymbolTableSize)) {
-    ElfSym *currSym = reinterpret_cast<ElfSym *>(index);
-    const char *symbolName = &mStringTablePtr[currSym->st_name];
+  const ElfSym *dynamicSymbol = nullptr;
+  if (mGnuHashTablePtr != nullptr) {
+    dynamicSymbol = elfGnuHashLookup(mGnuHashTablePtr, mDynamicSymbolTablePtr,
+                                     mDynamicStringTablePtr, name);
+  } else if (mHashTablePtr != nullptr) {
+    dynamicSymbol = elfSysvHashLookup(mHashTablePtr, mDynamicSymbolTablePtr,
+                                      mDynamicStringTablePtr, name);
+  }
 
-    if (strncmp(symbolName, name, strlen(name)) == 0) {
-      symbol = mMapping + currSym->st_value;
-      break;
-    }
+  if (dynamicSymbol != nullptr) {
+    symbol = mMapping + dynamicSymbol->st_value;
+  } else {
+    // Symbols that are not exported through the dynamic symbol table can
+    // still be found in the full symbol table
+    uint8_t *index = mSymbolTablePtr;
+    while (index < (mSymbolTablePtr + mSymbolTableSize)) {
+      ElfSym *currSym = reinterpret_cast<ElfSym *>(index);
+      const char *symbolName = &mStringTablePtr[currSym->st_name];
+
+      if (strcmp(symbolName, name) == 0) {
+        symbol = mMapping + currSym->st_value;
+        break;
+      }
 
-    index += sizeof(ElfSym);
+      index += sizeof(ElfSym);
+    }
   }
   return symbol;
 }
@@ -807,6 +820,36 @@ NanoappLoader::DynamicHeader *NanoappLoader::getDynamicHeader() {
   return dyn;
 }
 
+void NanoappLoader::initDynamicSymbolLookup() {
+  DynamicHeader *dyn = getDynamicHeader();
+  if (dyn != nullptr) {
+    // The dynamic symbols, their names and the hash sections are part of a
+    // load segment, so they remain accessible through the mapping after the
+    // ELF binary is released.
+    ElfWord symbolTableAddr = getDynEntry(dyn, DT_SYMTAB);
+    ElfWord stringTableAddr = getDynEntry(dyn, DT_STRTAB);
+    ElfWord gnuHashTableAddr = getDynEntry(dyn, DT_GNU_HASH);
+    ElfWord hashTableAddr = getDynEntry(dyn, DT_HASH);
+
+    if (symbolTableAddr != 0 && stringTableAddr != 0) {
+      mDynamicSymbolTablePtr =
+          reinterpret_cast<const ElfSym *>(mLoadBias + symbolTableAddr);
+      mDynamicStringTablePtr =
+          reinterpret_cast<const char *>(mLoadBias + stringTableAddr);
+      if (gnuHashTableAddr != 0) {
+        mGnuHashTablePtr =
+            reinterpret_cast<const uint32_t *>(mLoadBias + gnuHashTableAddr);
+      } else if (hashTableAddr != 0) {
+        mHashTablePtr =
+            reinterpret_cast<const uint32_t *>(mLoadBias + hashTableAddr);
+      }
+    }
+  }
+
+  LOGV("Dynamic symbol hash sections: GNU %p SysV %p", mGnuHashTablePtr,
+       mHashTablePtr);
+}
+
 NanoappLoader::ProgramHeader *NanoappLoader::getFirstRoSegHeader() {
   // return the first read only segment found
   ProgramHeader *ro = nullptr;
@@ -42,16 +42,50 @@ extern "C" {
 void chrePlatformLogToBuffer(enum chreLogLevel chreLogLevel, const char *format,
                              ...);
 
+/**
+ * Log via the PlatformLogBufferSingleton deferred formatting method, which
+ * sends the format string hash and packed arguments to the host instead of
+ * the formatted log.
+ *
+ * Defined in platform/shared/log_buffer_manager.cc
+ *
+ * @param chreLogLevel The log level.
+ * @param formatHash The hashLogFormat() of format.
+ * @param format The format string.
+ * @param ... The arguments to print into the final log.
+ */
+void chrePlatformDeferredLogToBuffer(enum chreLogLevel chreLogLevel,
+                                     uint32_t formatHash, const char *format,
+                                     ...);
+
 #ifdef __cplusplus
 }
 #endif
 
+#if defined(CHRE_USE_DEFERRED_LOG_FORMATTING) && defined(__cplusplus)
+#include "chre/platform/shared/log_format_common.h"
+
+// The hash is computed at compile time so that logging costs no more than
+// packing the arguments. The format string is stored in its own section so
+// that the build can extract it for the host.
+#define CHRE_BUFFER_LOG(level, fmt, ...)                                    \
+  do {                                                                      \
+    CHRE_LOG_PREAMBLE                                                       \
+    static const char kChreLogFormat[]                                      \
+        __attribute__((section(CHRE_LOG_FORMAT_SECTION))) = fmt;            \
+    constexpr uint32_t kChreLogFormatHash = ::chre::hashLogFormat(fmt);     \
+    chrePlatformDeferredLogToBuffer(level, kChreLogFormatHash,              \
+                                    kChreLogFormat, ##__VA_ARGS__);         \
+    CHRE_LOG_EPILOGUE                                                       \
+  } while (0)
+#else
 #define CHRE_BUFFER_LOG(level, fmt, ...)                \
   do {                                                  \
     CHRE_LOG_PREAMBLE                                   \
     chrePlatformLogToBuffer(level, fmt, ##__VA_ARGS__); \
     CHRE_LOG_EPILOGUE                                   \
   } while (0)
+#endif  // CHRE_USE_DEFERRED_LOG_FORMATTING
 #define LOGE(fmt, ...) CHRE_BUFFER_LOG(CHRE_LOG_ERROR, fmt, ##__VA_ARGS__)
 #define LOGW(fmt, ...) CHRE_BUFFER_LOG(CHRE_LOG_WARN, fmt, ##__VA_ARGS__)
 #define LOGI(fmt, ...) CHRE_BUFFER_LOG(CHRE_LOG_INFO, fmt, ##__VA_ARGS__)
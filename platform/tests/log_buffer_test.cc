@@ -15,10 +15,17 @@
  */
 
 #include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include "chre/platform/atomic.h"
 #include "chre/platform/condition_variable.h"
+#include "chre/platform/log.h"
 #include "chre/platform/mutex.h"
 #include "chre/platform/shared/log_buffer.h"
 
@@ -280,6 +287,286 @@ TEST(LogBuffer, TransferTest) {
   ASSERT_EQ(bytesCopied, 0);
 }
 
-// TODO(srok): Add multithreaded tests
+TEST(LogBuffer, ReserveCommitMatchesLockedWireFormat) {
+  alignas(uint32_t) char lockedBuffer[kDefaultBufferSize];
+  alignas(uint32_t) char reserveBuffer[kDefaultBufferSize];
+  constexpr size_t kOutBufferSize = 200;
+  char lockedOut[kOutBufferSize];
+  char reserveOut[kOutBufferSize];
+  const uint8_t encodedLog[] = {0x12, 0x34, 0x00, 0x56};
+  TestLogBufferCallback callback;
+
+  LogBuffer lockedLogBuffer(&callback, lockedBuffer, kDefaultBufferSize);
+  LogBuffer reserveLogBuffer(&callback, reserveBuffer, kDefaultBufferSize,
+                             LogBufferWriteMode::RESERVE_COMMIT);
+  for (LogBuffer *logBuffer : {&lockedLogBuffer, &reserveLogBuffer}) {
+    logBuffer->handleLog(LogBufferLogLevel::WARN, 1234, "test %d", 42);
+    logBuffer->handleEncodedLog(LogBufferLogLevel::ERROR, 5678, encodedLog,
+                                sizeof(encodedLog));
+    logBuffer->handleLog(LogBufferLogLevel::INFO, 9, "%s", "str");
+  }
+
+  size_t numLogsDropped;
+  size_t lockedBytes =
+      lockedLogBuffer.copyLogs(lockedOut, kOutBufferSize, &numLogsDropped);
+  EXPECT_EQ(reserveLogBuffer.getBufferSize(), lockedBytes);
+  size_t reserveBytes =
+      reserveLogBuffer.copyLogs(reserveOut, kOutBufferSize, &numLogsDropped);
+
+  ASSERT_EQ(reserveBytes, lockedBytes);
+  EXPECT_EQ(memcmp(lockedOut, reserveOut, lockedBytes), 0);
+  EXPECT_EQ(numLogsDropped, 0);
+  EXPECT_EQ(reserveLogBuffer.getBufferSize(), 0);
+}
+
+TEST(LogBuffer, ReserveCommitCopiesWholeLogsOnly) {
+  alignas(uint32_t) char buffer[kDefaultBufferSize];
+  constexpr size_t kOutBufferSize = 12;
+  char outBuffer[kOutBufferSize];
+  size_t numLogsDropped;
+  TestLogBufferCallback callback;
+  LogBuffer logBuffer(&callback, buffer, kDefaultBufferSize,
+                      LogBufferWriteMode::RESERVE_COMMIT);
+
+  logBuffer.handleLog(LogBufferLogLevel::INFO, 0, "str1");
+  logBuffer.handleLog(LogBufferLogLevel::INFO, 0, "str2");
+
+  // Only one 10 byte log fits in the output buffer at a time.
+  EXPECT_EQ(logBuffer.copyLogs(outBuffer, kOutBufferSize, &numLogsDropped),
+            10);
+  EXPECT_STREQ(outBuffer + LogBuffer::kLogDataOffset, "str1");
+  EXPECT_EQ(logBuffer.copyLogs(outBuffer, kOutBufferSize, &numLogsDropped),
+            10);
+  EXPECT_STREQ(outBuffer + LogBuffer::kLogDataOffset, "str2");
+  EXPECT_EQ(logBuffer.copyLogs(outBuffer, kOutBufferSize, &numLogsDropped), 0);
+}
+
+TEST(LogBuffer, ReserveCommitDropsNewestLogWhenFull) {
+  alignas(uint32_t) char buffer[kDefaultBufferSize];
+  constexpr size_t kOutBufferSize = 200;
+  char outBuffer[kOutBufferSize];
+  TestLogBufferCallback callback;
+  LogBuffer logBuffer(&callback, buffer, kDefaultBufferSize,
+                      LogBufferWriteMode::RESERVE_COMMIT);
+
+  // Each log takes 112 bytes of the ring including its header and alignment,
+  // so only the first 9 fit.
+  EXPECT_FALSE(logBuffer.logWouldCauseOverflow(100));
+  for (size_t i = 0; i < 10; i++) {
+    std::string testLogStrStr(100, 'a' + i);
+    logBuffer.handleLog(LogBufferLogLevel::INFO, 0, testLogStrStr.c_str());
+  }
+  EXPECT_TRUE(logBuffer.logWouldCauseOverflow(100));
+  EXPECT_EQ(logBuffer.getNumLogsDropped(), 1);
+
+  size_t numLogsDropped;
+  size_t bytesCopied =
+      logBuffer.copyLogs(outBuffer, kOutBufferSize, &numLogsDropped);
+  EXPECT_EQ(bytesCopied, LogBuffer::kLogDataOffset + 100 + 1);
+  EXPECT_STREQ(outBuffer + LogBuffer::kLogDataOffset,
+               std::string(100, 'a').c_str());
+  EXPECT_EQ(numLogsDropped, 1);
+
+  logBuffer.reset();
+  EXPECT_EQ(logBuffer.getBufferSize(), 0);
+  EXPECT_EQ(logBuffer.getNumLogsDropped(), 0);
+}
+
+TEST(LogBuffer, ReserveCommitWrapsAroundRing) {
+  // Deliberately misalign the buffer so that the ring has to be aligned.
+  alignas(uint32_t) char buffer[kDefaultBufferSize + 1];
+  constexpr size_t kOutBufferSize = 200;
+  char outBuffer[kOutBufferSize];
+  size_t numLogsDropped;
+  TestLogBufferCallback callback;
+  LogBuffer logBuffer(&callback, buffer + 1, kDefaultBufferSize,
+                      LogBufferWriteMode::RESERVE_COMMIT);
+
+  // Log sizes that are not multiples of the record alignment make padding
+  // records appear at different offsets on each lap of the ring.
+  for (size_t i = 0; i < 200; i++) {
+    std::string testLogStrStr(20 + i % 77, 'a' + i % 26);
+    logBuffer.handleLog(LogBufferLogLevel::INFO, 0, testLogStrStr.c_str());
+    ASSERT_EQ(logBuffer.copyLogs(outBuffer, kOutBufferSize, &numLogsDropped),
+              LogBuffer::kLogDataOffset + testLogStrStr.size() + 1);
+    ASSERT_STREQ(outBuffer + LogBuffer::kLogDataOffset, testLogStrStr.c_str());
+  }
+  EXPECT_EQ(numLogsDropped, 0);
+}
+
+TEST(LogBuffer, ReserveCommitTransferTest) {
+  alignas(uint32_t) char bufferFrom[kDefaultBufferSize];
+  char bufferTo[kDefaultBufferSize];
+  const size_t kOutBufferSize = 10;
+  char outBuffer[kOutBufferSize];
+  size_t numLogsDropped;
+  TestLogBufferCallback callback;
+  LogBuffer logBufferFrom(&callback, bufferFrom, kDefaultBufferSize,
+                          LogBufferWriteMode::RESERVE_COMMIT);
+  LogBuffer logBufferTo(&callback, bufferTo, kDefaultBufferSize);
+
+  logBufferFrom.handleLog(LogBufferLogLevel::INFO, 0, "str1");
+  logBufferFrom.handleLog(LogBufferLogLevel::INFO, 0, "str2");
+  logBufferFrom.transferTo(logBufferTo);
+  EXPECT_EQ(logBufferFrom.getBufferSize(), 0);
+  EXPECT_EQ(logBufferTo.getBufferSize(), 20);
+
+  logBufferTo.copyLogs(outBuffer, kOutBufferSize, &numLogsDropped);
+  EXPECT_STREQ(outBuffer + LogBuffer::kLogDataOffset, "str1");
+  logBufferTo.copyLogs(outBuffer, kOutBufferSize, &numLogsDropped);
+  EXPECT_STREQ(outBuffer + LogBuffer::kLogDataOffset, "str2");
+}
+
+namespace {
+
+class CountingLogBufferCallback : public LogBufferCallbackInterface {
+ public:
+  void onLogsReady() override {
+    mNumCalls++;
+  }
+
+  std::atomic<size_t> mNumCalls{0};
+};
+
+}  // namespace
+
+TEST(LogBuffer, ReserveCommitThresholdNotification) {
+  alignas(uint32_t) char buffer[kDefaultBufferSize];
+  CountingLogBufferCallback callback;
+  LogBuffer logBuffer(&callback, buffer, kDefaultBufferSize,
+                      LogBufferWriteMode::RESERVE_COMMIT);
+  logBuffer.updateNotificationSetting(LogBufferNotificationSetting::THRESHOLD,
+                                      15 /* thresholdBytes */);
+
+  logBuffer.handleLog(LogBufferLogLevel::INFO, 0, "str1");
+  EXPECT_EQ(callback.mNumCalls, 0);
+  logBuffer.handleLog(LogBufferLogLevel::INFO, 0, "str2");
+  EXPECT_EQ(callback.mNumCalls, 1);
+}
+
+namespace {
+
+/**
+ * Logs from the given number of writer threads while a reader thread drains
+ * the buffer, as the LogBufferManager flush loop does.
+ *
+ * @param logBuffer The buffer under test.
+ * @param numWriters The number of concurrent writer threads.
+ * @param numLogsPerWriter The number of logs each writer emits.
+ * @param logsOut If non-null, populated with the logs read out in order.
+ * @return The time taken by the writers, in nanoseconds.
+ */
+uint64_t runConcurrentWriters(LogBuffer &logBuffer, size_t numWriters,
+                              size_t numLogsPerWriter,
+                              std::vector<std::string> *logsOut) {
+  std::atomic<bool> writersDone{false};
+  std::thread reader([&]() {
+    char outBuffer[kDefaultBufferSize];
+    size_t numLogsDropped;
+    bool done = false;
+    while (!done) {
+      // Check the flag before draining, so that a final drain happens after
+      // all writers finished.
+      done = writersDone;
+      size_t bytesCopied;
+      while ((bytesCopied = logBuffer.copyLogs(outBuffer, sizeof(outBuffer),
+                                               &numLogsDropped)) > 0) {
+        size_t index = 0;
+        while (logsOut != nullptr && index < bytesCopied) {
+          const char *log = &outBuffer[index + LogBuffer::kLogDataOffset];
+          logsOut->emplace_back(log);
+          index += LogBuffer::kLogDataOffset + strlen(log) + 1;
+        }
+      }
+      std::this_thread::yield();
+    }
+  });
+
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> writers;
+  for (size_t w = 0; w < numWriters; w++) {
+    writers.emplace_back([&, w]() {
+      for (size_t i = 0; i < numLogsPerWriter; i++) {
+        logBuffer.handleLog(LogBufferLogLevel::INFO, 0,
+                            "writer %zu log %zu value %" PRIu32, w, i,
+                            static_cast<uint32_t>(i * 7));
+      }
+    });
+  }
+  for (std::thread &writer : writers) {
+    writer.join();
+  }
+  auto end = std::chrono::steady_clock::now();
+
+  writersDone = true;
+  reader.join();
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(end - start)
+      .count();
+}
+
+}  // namespace
+
+TEST(LogBuffer, ReserveCommitConcurrentWritersKeepPerWriterOrder) {
+  constexpr size_t kNumWriters = 4;
+  constexpr size_t kNumLogsPerWriter = 5000;
+  // Small enough that the ring wraps around several times, so that writers
+  // race with the reader and with each other on padding records.
+  alignas(uint32_t) char buffer[kDefaultBufferSize * 16];
+  LogBuffer logBuffer(nullptr /* callback */, buffer, sizeof(buffer),
+                      LogBufferWriteMode::RESERVE_COMMIT);
+
+  std::vector<std::string> logs;
+  runConcurrentWriters(logBuffer, kNumWriters, kNumLogsPerWriter, &logs);
+
+  size_t nextExpected[kNumWriters] = {};
+  for (const std::string &log : logs) {
+    size_t writer;
+    size_t index;
+    uint32_t value;
+    ASSERT_EQ(sscanf(log.c_str(), "writer %zu log %zu value %" SCNu32, &writer,
+                     &index, &value),
+              3)
+        << log;
+    ASSERT_LT(writer, kNumWriters);
+    // Logs from a writer may be dropped, but never reordered or corrupted.
+    ASSERT_GE(index, nextExpected[writer]);
+    ASSERT_EQ(value, index * 7);
+    nextExpected[writer] = index + 1;
+  }
+
+  size_t numLogsDropped;
+  char outBuffer[1];
+  logBuffer.copyLogs(outBuffer, 0, &numLogsDropped);
+  EXPECT_EQ(logs.size() + numLogsDropped, kNumWriters * kNumLogsPerWriter);
+  EXPECT_EQ(logBuffer.getBufferSize(), 0);
+}
+
+TEST(LogBuffer, WriterContentionBenchmark) {
+  constexpr size_t kNumLogsPerWriter = 20000;
+  constexpr size_t kWriterCounts[] = {1, 2, 4, 8};
+  // Large enough to hold every log, so that both modes store all of them
+  // even if the reader falls behind and only the cost of writing is compared.
+  std::vector<uint32_t> buffer(8 * kNumLogsPerWriter * 64 / sizeof(uint32_t));
+
+  for (size_t numWriters : kWriterCounts) {
+    uint64_t logsPerSec[2];
+    size_t numDropped[2];
+    const LogBufferWriteMode kModes[] = {LogBufferWriteMode::LOCKED,
+                                         LogBufferWriteMode::RESERVE_COMMIT};
+    for (size_t m = 0; m < 2; m++) {
+      LogBuffer logBuffer(nullptr /* callback */, buffer.data(),
+                          buffer.size() * sizeof(uint32_t), kModes[m]);
+      uint64_t elapsedNs = runConcurrentWriters(logBuffer, numWriters,
+                                                kNumLogsPerWriter, nullptr);
+      logsPerSec[m] =
+          (numWriters * kNumLogsPerWriter) * UINT64_C(1000000000) / elapsedNs;
+      numDropped[m] = logBuffer.getNumLogsDropped();
+    }
+    LOGI("%zu writers: LOCKED %" PRIu64 " logs/s (%zu dropped), "
+         "RESERVE_COMMIT %" PRIu64 " logs/s (%zu dropped)",
+         numWriters, logsPerSec[0], numDropped[0], logsPerSec[1],
+         numDropped[1]);
+  }
+}
 
 }  // namespace chre
@@ -0,0 +1,248 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <chrono>
+#include <cinttypes>
+#include <cstdarg>
+#include <cstdio>
+#include <vector>
+
+#include "chre/platform/log.h"
+#include "chre/platform/shared/log_buffer.h"
+#include "chre/platform/shared/log_format_common.h"
+
+namespace chre {
+
+namespace {
+
+bool encodeArgs(std::vector<uint8_t> *encoded, size_t bufferSize,
+                const char *format, ...) {
+  encoded->resize(bufferSize);
+  va_list args;
+  va_start(args, format);
+  size_t encodedSize;
+  bool success = encodeLogArgsVa(format, args, encoded->data(), bufferSize,
+                                 &encodedSize);
+  va_end(args);
+  encoded->resize(success ? encodedSize : 0);
+  return success;
+}
+
+}  // namespace
+
+TEST(LogFormatCommon, HashIsComputedAtCompileTime) {
+  constexpr uint32_t kHash = hashLogFormat("abc %d");
+  static_assert(hashLogFormat("") == UINT32_C(2166136261),
+                "FNV-1a offset basis");
+  EXPECT_EQ(kHash, hashLogFormat("abc %d"));
+  EXPECT_NE(kHash, hashLogFormat("abc %u"));
+}
+
+TEST(LogFormatCommon, VarintRoundTrip) {
+  const uint64_t kValues[] = {0, 1, 127, 128, 300, UINT32_MAX, UINT64_MAX};
+  for (uint64_t value : kValues) {
+    uint8_t buffer[10];
+    size_t size = encodeLogVarint(value, buffer, sizeof(buffer));
+    ASSERT_GT(size, 0);
+    uint64_t decoded;
+    EXPECT_EQ(decodeLogVarint(buffer, size, &decoded), size);
+    EXPECT_EQ(decoded, value);
+    EXPECT_EQ(decodeLogVarint(buffer, size - 1, &decoded), 0);
+  }
+
+  uint8_t buffer[1];
+  EXPECT_EQ(encodeLogVarint(128, buffer, sizeof(buffer)), 0);
+  EXPECT_EQ(zigzagDecode(zigzagEncode(-5)), -5);
+  EXPECT_EQ(zigzagEncode(-1), 1);
+}
+
+TEST(LogFormatCommon, ParseConversions) {
+  LogFormatConversion conversion;
+  ASSERT_TRUE(parseLogFormatConversion("%-08.3f", &conversion));
+  EXPECT_EQ(conversion.length, 7);
+  EXPECT_EQ(conversion.flagsLength, 5);
+  EXPECT_EQ(conversion.argType, LogArgType::DOUBLE);
+
+  ASSERT_TRUE(parseLogFormatConversion("%" PRIu64 " trailing", &conversion));
+  EXPECT_EQ(conversion.argType, LogArgType::UNSIGNED_INT);
+  EXPECT_NE(conversion.argLength, LogArgLength::DEFAULT);
+
+  ASSERT_TRUE(parseLogFormatConversion("%zu", &conversion));
+  EXPECT_EQ(conversion.argLength, LogArgLength::SIZE_T);
+
+  ASSERT_TRUE(parseLogFormatConversion("%hhd", &conversion));
+  EXPECT_EQ(conversion.argLength, LogArgLength::CHAR);
+  EXPECT_EQ(conversion.length, 4);
+
+  ASSERT_TRUE(parseLogFormatConversion("%*.*s", &conversion));
+  EXPECT_TRUE(conversion.widthFromArg);
+  EXPECT_TRUE(conversion.precisionFromArg);
+  EXPECT_EQ(conversion.argType, LogArgType::STRING);
+
+  ASSERT_TRUE(parseLogFormatConversion("%%", &conversion));
+  EXPECT_EQ(conversion.argType, LogArgType::NONE);
+
+  ASSERT_TRUE(parseLogFormatConversion("%n", &conversion));
+  EXPECT_EQ(conversion.argType, LogArgType::UNSUPPORTED);
+  ASSERT_TRUE(parseLogFormatConversion("%Lf", &conversion));
+  EXPECT_EQ(conversion.argType, LogArgType::UNSUPPORTED);
+
+  EXPECT_FALSE(parseLogFormatConversion("%", &conversion));
+  EXPECT_FALSE(parseLogFormatConversion("%08", &conversion));
+}
+
+TEST(LogFormatCommon, EncodeArgs) {
+  std::vector<uint8_t> encoded;
+  ASSERT_TRUE(encodeArgs(&encoded, 64, "%d %u%% %s %c %f", -2, 300u, "hi", 'x',
+                         1.5));
+
+  const uint8_t kExpected[] = {
+      0x03,                    // zigzag(-2)
+      0xac, 0x02,              // 300
+      0x02, 'h',  'i',         // "hi"
+      'x',                     // 'x'
+      0x00, 0x00, 0x00, 0x00,  // 1.5
+      0x00, 0x00, 0xf8, 0x3f,
+  };
+  ASSERT_EQ(encoded.size(), sizeof(kExpected));
+  EXPECT_EQ(memcmp(encoded.data(), kExpected, sizeof(kExpected)), 0);
+}
+
+TEST(LogFormatCommon, EncodeIntegerLengths) {
+  std::vector<uint8_t> encoded;
+  ASSERT_TRUE(encodeArgs(&encoded, 64, "%" PRId64 " %zu %hhd %ld %hu",
+                         static_cast<int64_t>(INT64_MIN), SIZE_MAX,
+                         static_cast<signed char>(-1), -1L, 70000));
+
+  size_t index = 0;
+  uint64_t value;
+  index += decodeLogVarint(&encoded[index], encoded.size() - index, &value);
+  EXPECT_EQ(zigzagDecode(value), INT64_MIN);
+  index += decodeLogVarint(&encoded[index], encoded.size() - index, &value);
+  EXPECT_EQ(value, SIZE_MAX);
+  index += decodeLogVarint(&encoded[index], encoded.size() - index, &value);
+  EXPECT_EQ(zigzagDecode(value), -1);
+  index += decodeLogVarint(&encoded[index], encoded.size() - index, &value);
+  EXPECT_EQ(zigzagDecode(value), -1);
+  // Converted to unsigned short, as printf() would do
+  index += decodeLogVarint(&encoded[index], encoded.size() - index, &value);
+  EXPECT_EQ(value, 70000 & UINT16_MAX);
+  EXPECT_EQ(index, encoded.size());
+}
+
+TEST(LogFormatCommon, EncodeTruncatesLongStrings) {
+  std::string longStr(200, 'a');
+  std::vector<uint8_t> encoded;
+  ASSERT_TRUE(encodeArgs(&encoded, 256, "%s", longStr.c_str()));
+  ASSERT_EQ(encoded.size(), kLogMaxStringArgLength + 1);
+  EXPECT_EQ(encoded[0], kLogMaxStringArgLength | kLogStringArgTruncated);
+}
+
+TEST(LogFormatCommon, EncodeFailsOnUnsupportedOrOverflow) {
+  std::vector<uint8_t> encoded;
+  int count;
+  EXPECT_FALSE(encodeArgs(&encoded, 64, "%d%n", 1, &count));
+  EXPECT_FALSE(encodeArgs(&encoded, 64, "%Lf", 1.0L));
+  EXPECT_FALSE(encodeArgs(&encoded, 2, "%u %u", 1000000u, 1u));
+  EXPECT_FALSE(encodeArgs(&encoded, 4, "%s", "longer than 4"));
+  EXPECT_TRUE(encodeArgs(&encoded, 0, "no args"));
+  EXPECT_TRUE(encoded.empty());
+}
+
+TEST(LogFormatCommon, LogBufferStoresDeferredEncoding) {
+  char buffer[1024];
+  constexpr size_t kOutBufferSize = 64;
+  uint8_t outBuffer[kOutBufferSize];
+  LogBuffer logBuffer(nullptr /* callback */, buffer, sizeof(buffer));
+
+  const uint8_t kEncodedLog[] = {0x01, 0x02, 0x03, 0x04, 0x05};
+  logBuffer.handleEncodedLog(LogBufferLogLevel::INFO, 0, kEncodedLog,
+                             sizeof(kEncodedLog),
+                             LogBufferEncoding::DEFERRED_FORMAT);
+  size_t numLogsDropped;
+  size_t bytesCopied =
+      logBuffer.copyLogs(outBuffer, kOutBufferSize, &numLogsDropped);
+
+  ASSERT_EQ(bytesCopied, LogBuffer::kLogDataOffset + 1 + sizeof(kEncodedLog));
+  EXPECT_EQ(outBuffer[0] >> 4, kLogEncodingDeferredFormat);
+  EXPECT_EQ(outBuffer[0] & 0xf, static_cast<uint8_t>(LogBufferLogLevel::INFO));
+  EXPECT_EQ(outBuffer[LogBuffer::kLogDataOffset], sizeof(kEncodedLog));
+}
+
+namespace {
+
+size_t formatWithVsnprintf(char *buffer, size_t size, const char *format,
+                           ...) {
+  va_list args;
+  va_start(args, format);
+  int length = vsnprintf(buffer, size, format, args);
+  va_end(args);
+  return (length > 0) ? static_cast<size_t>(length) + 1 : 0;
+}
+
+size_t formatDeferred(uint8_t *buffer, size_t size, const char *format, ...) {
+  va_list args;
+  va_start(args, format);
+  size_t encodedSize = 0;
+  encodeLogArgsVa(format, args, buffer, size, &encodedSize);
+  va_end(args);
+  return kLogFormatHashSize + encodedSize;
+}
+
+}  // namespace
+
+TEST(LogFormatCommon, DeferredFormattingBenchmark) {
+  constexpr size_t kIterations = 200000;
+  constexpr char kFormat[] =
+      "Sensor %s (handle %" PRIu32 ") sample at %" PRIu64 " ns: %f %f %f";
+  char textBuffer[LogBuffer::kLogMaxSize];
+  uint8_t encodedBuffer[LogBuffer::kLogMaxSize];
+  size_t textBytes = 0;
+  size_t encodedBytes = 0;
+
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < kIterations; i++) {
+    textBytes = formatWithVsnprintf(textBuffer, sizeof(textBuffer), kFormat,
+                                    "Accelerometer", static_cast<uint32_t>(i),
+                                    static_cast<uint64_t>(i) * 5000000,
+                                    0.125 * i, -9.81, 0.5);
+  }
+  auto middle = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < kIterations; i++) {
+    encodedBytes = formatDeferred(encodedBuffer, sizeof(encodedBuffer),
+                                  kFormat, "Accelerometer",
+                                  static_cast<uint32_t>(i),
+                                  static_cast<uint64_t>(i) * 5000000,
+                                  0.125 * i, -9.81, 0.5);
+  }
+  auto end = std::chrono::steady_clock::now();
+
+  uint64_t textNs =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(middle - start)
+          .count() /
+      kIterations;
+  uint64_t deferredNs =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(end - middle)
+          .count() /
+      kIterations;
+  LOGI("vsnprintf: %" PRIu64 " ns, %zu bytes; deferred: %" PRIu64
+       " ns, %zu bytes",
+       textNs, textBytes, deferredNs, encodedBytes);
+  EXPECT_LT(encodedBytes, textBytes);
+}
+
+}  // namespace chre
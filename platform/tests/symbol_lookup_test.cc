@@ -0,0 +1,319 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "chre/platform/log.h"
+#include "chre/platform/shared/symbol_lookup.h"
+#include "chre/util/macros.h"
+
+namespace chre {
+namespace {
+
+constexpr size_t kNumExportedSymbols = 256;
+constexpr size_t kNumImports = 300;
+constexpr size_t kNumDefinedSymbols = 200;
+
+//! Names of the symbols exported to the synthetic nanoapp.
+std::vector<std::string> makeExportedNames() {
+  std::vector<std::string> names;
+  for (size_t i = 0; i < kNumExportedSymbols; i++) {
+    names.push_back("chreExportedSymbol" + std::to_string(i));
+  }
+  return names;
+}
+
+/**
+ * The dynamic symbol table, string table and hash sections of a synthetic
+ * nanoapp, laid out as a linker would: undefined (imported) symbols come first
+ * and are not part of the DT_GNU_HASH section, and defined symbols are sorted
+ * by GNU hash bucket.
+ */
+class SyntheticNanoapp {
+ public:
+  SyntheticNanoapp(const std::vector<std::string> &imports,
+                   const std::vector<std::string> &definitions) {
+    mStrings.push_back('\0');
+    mSymbols.push_back(Elf32_Sym{});
+
+    for (const std::string &name : imports) {
+      addSymbol(name, SHN_UNDEF, 0);
+    }
+
+    std::vector<std::string> sorted = definitions;
+    mNumBuckets = std::max<uint32_t>(1, sorted.size() / 4);
+    std::stable_sort(sorted.begin(), sorted.end(),
+                     [this](const std::string &a, const std::string &b) {
+                       return elfGnuHash(a.c_str()) % mNumBuckets <
+                              elfGnuHash(b.c_str()) % mNumBuckets;
+                     });
+    mSymbolOffset = static_cast<uint32_t>(mSymbols.size());
+    for (size_t i = 0; i < sorted.size(); i++) {
+      addSymbol(sorted[i], /*shndx=*/1, static_cast<Elf32_Addr>(16 * (i + 1)));
+    }
+
+    buildGnuHash();
+    buildSysvHash();
+  }
+
+  const Elf32_Sym *symbols() const {
+    return mSymbols.data();
+  }
+
+  size_t numSymbols() const {
+    return mSymbols.size();
+  }
+
+  const char *strings() const {
+    return mStrings.data();
+  }
+
+  const uint32_t *gnuHash() const {
+    return mGnuHash.data();
+  }
+
+  const uint32_t *sysvHash() const {
+    return mSysvHash.data();
+  }
+
+ private:
+  static constexpr uint32_t kBloomShift = 6;
+
+  std::vector<Elf32_Sym> mSymbols;
+  std::vector<char> mStrings;
+  std::vector<uint32_t> mGnuHash;
+  std::vector<uint32_t> mSysvHash;
+  uint32_t mNumBuckets;
+  uint32_t mSymbolOffset;
+
+  void addSymbol(const std::string &name, uint16_t shndx, Elf32_Addr value) {
+    Elf32_Sym symbol = {};
+    symbol.st_name = static_cast<Elf32_Word>(mStrings.size());
+    symbol.st_value = value;
+    symbol.st_shndx = shndx;
+    mSymbols.push_back(symbol);
+    mStrings.insert(mStrings.end(), name.begin(), name.end());
+    mStrings.push_back('\0');
+  }
+
+  void buildGnuHash() {
+    uint32_t numHashed = static_cast<uint32_t>(mSymbols.size()) - mSymbolOffset;
+    uint32_t bloomSize = std::max<uint32_t>(1, numHashed / 32);
+    std::vector<uint32_t> bloom(bloomSize, 0);
+    std::vector<uint32_t> buckets(mNumBuckets, 0);
+    std::vector<uint32_t> chain(numHashed, 0);
+
+    for (uint32_t i = mSymbolOffset; i < mSymbols.size(); i++) {
+      uint32_t hash = elfGnuHash(&mStrings[mSymbols[i].st_name]);
+      bloom[(hash / 32) % bloomSize] |=
+          (1u << (hash % 32)) | (1u << ((hash >> kBloomShift) % 32));
+
+      uint32_t bucket = hash % mNumBuckets;
+      if (buckets[bucket] == 0) {
+        buckets[bucket] = i;
+      }
+      chain[i - mSymbolOffset] = hash & ~1u;
+
+      bool lastInBucket =
+          (i + 1 == mSymbols.size() ||
+           elfGnuHash(&mStrings[mSymbols[i + 1].st_name]) % mNumBuckets !=
+               bucket);
+      if (lastInBucket) {
+        chain[i - mSymbolOffset] |= 1;
+      }
+    }
+
+    mGnuHash = {mNumBuckets, mSymbolOffset, bloomSize, kBloomShift};
+    mGnuHash.insert(mGnuHash.end(), bloom.begin(), bloom.end());
+    mGnuHash.insert(mGnuHash.end(), buckets.begin(), buckets.end());
+    mGnuHash.insert(mGnuHash.end(), chain.begin(), chain.end());
+  }
+
+  void buildSysvHash() {
+    uint32_t numBuckets = 37;
+    uint32_t numChains = static_cast<uint32_t>(mSymbols.size());
+    std::vector<uint32_t> buckets(numBuckets, STN_UNDEF);
+    std::vector<uint32_t> chain(numChains, STN_UNDEF);
+
+    for (uint32_t i = 1; i < numChains; i++) {
+      uint32_t bucket =
+          elfSysvHash(&mStrings[mSymbols[i].st_name]) % numBuckets;
+      chain[i] = buckets[bucket];
+      buckets[bucket] = i;
+    }
+
+    mSysvHash = {numBuckets, numChains};
+    mSysvHash.insert(mSysvHash.end(), buckets.begin(), buckets.end());
+    mSysvHash.insert(mSysvHash.end(), chain.begin(), chain.end());
+  }
+};
+
+//! The lookup NanoappLoader::findExportedSymbol used to perform.
+void *linearExportedLookup(const ExportedData *symbols, size_t numSymbols,
+                           const char *name) {
+  size_t nameLen = strlen(name);
+  for (size_t i = 0; i < numSymbols; i++) {
+    if (nameLen == strlen(symbols[i].dataName) &&
+        strncmp(name, symbols[i].dataName, nameLen) == 0) {
+      return symbols[i].data;
+    }
+  }
+  return nullptr;
+}
+
+//! The lookup NanoappLoader::findSymbolByName performs without a hash section.
+const Elf32_Sym *linearSymbolLookup(const SyntheticNanoapp &nanoapp,
+                                    const char *name) {
+  for (size_t i = 0; i < nanoapp.numSymbols(); i++) {
+    const Elf32_Sym *symbol = &nanoapp.symbols()[i];
+    if (symbol->st_shndx != SHN_UNDEF &&
+        strcmp(&nanoapp.strings()[symbol->st_name], name) == 0) {
+      return symbol;
+    }
+  }
+  return nullptr;
+}
+
+std::vector<std::string> makeDefinedNames() {
+  std::vector<std::string> names;
+  for (size_t i = 0; i < kNumDefinedSymbols; i++) {
+    names.push_back("nanoappFunction" + std::to_string(i));
+  }
+  return names;
+}
+
+}  // namespace
+
+TEST(SymbolLookup, HashesMatchElfSpecification) {
+  EXPECT_EQ(elfGnuHash(""), 0x1505u);
+  EXPECT_EQ(elfGnuHash("printf"), 0x156b2bb8u);
+  EXPECT_EQ(elfGnuHash("nanoappHandleEvent"), 0xbe7bb9e0u);
+  EXPECT_EQ(elfSysvHash(""), 0u);
+  EXPECT_EQ(elfSysvHash("printf"), 0x077905a6u);
+  EXPECT_EQ(elfSysvHash("nanoappHandleEvent"), 0x029afb64u);
+}
+
+TEST(SymbolLookup, ExportedSymbolTableFindsExactNames) {
+  static int a, b, c;
+  static const ExportedData kSymbols[] = {
+      {&a, "chreSensorFind"},
+      {&b, "chreSensorFindDefault"},
+      {&c, "chreGetTime"},
+  };
+  ExportedSymbolTable<ARRAY_SIZE(kSymbols)> table(kSymbols);
+
+  EXPECT_EQ(table.find("chreSensorFind"), &a);
+  EXPECT_EQ(table.find("chreSensorFindDefault"), &b);
+  EXPECT_EQ(table.find("chreGetTime"), &c);
+  EXPECT_EQ(table.find("chreSensor"), nullptr);
+  EXPECT_EQ(table.find("chreGetTimeX"), nullptr);
+  EXPECT_EQ(table.find(""), nullptr);
+}
+
+TEST(SymbolLookup, HashSectionsFindDefinedSymbols) {
+  std::vector<std::string> exportedNames = makeExportedNames();
+  std::vector<std::string> definedNames = makeDefinedNames();
+  SyntheticNanoapp nanoapp(exportedNames, definedNames);
+
+  for (const std::string &name : definedNames) {
+    const Elf32_Sym *expected = linearSymbolLookup(nanoapp, name.c_str());
+    ASSERT_NE(expected, nullptr);
+    EXPECT_EQ(elfGnuHashLookup(nanoapp.gnuHash(), nanoapp.symbols(),
+                               nanoapp.strings(), name.c_str()),
+              expected);
+    EXPECT_EQ(elfSysvHashLookup(nanoapp.sysvHash(), nanoapp.symbols(),
+                                nanoapp.strings(), name.c_str()),
+              expected);
+  }
+
+  // Imports are undefined in the nanoapp, so they must not be found
+  for (const char *name : {exportedNames[0].c_str(), "nanoappFunction",
+                           "nanoappFunction2000", "missing"}) {
+    EXPECT_EQ(elfGnuHashLookup(nanoapp.gnuHash(), nanoapp.symbols(),
+                               nanoapp.strings(), name),
+              nullptr);
+    EXPECT_EQ(elfSysvHashLookup(nanoapp.sysvHash(), nanoapp.symbols(),
+                                nanoapp.strings(), name),
+              nullptr);
+  }
+}
+
+TEST(SymbolLookup, LoadTimeBenchmark) {
+  // Resolves the imports of a synthetic nanoapp against a synthetic exported
+  // symbol table, then looks up each symbol it defines (as dlsym would), with
+  // both the previous linear scans and the hashed lookups.
+  constexpr size_t kIterations = 20;
+  std::vector<std::string> exportedNames = makeExportedNames();
+  ExportedData exported[kNumExportedSymbols];
+  for (size_t i = 0; i < kNumExportedSymbols; i++) {
+    exported[i].data = &exported[i];
+    exported[i].dataName = exportedNames[i].c_str();
+  }
+  ExportedSymbolTable<kNumExportedSymbols> table(exported);
+
+  std::vector<std::string> imports;
+  for (size_t i = 0; i < kNumImports; i++) {
+    imports.push_back(exportedNames[(i * 7) % kNumExportedSymbols]);
+  }
+  std::vector<std::string> definedNames = makeDefinedNames();
+  SyntheticNanoapp nanoapp(imports, definedNames);
+
+  size_t numFound = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (size_t n = 0; n < kIterations; n++) {
+    for (const std::string &name : imports) {
+      numFound += (linearExportedLookup(exported, kNumExportedSymbols,
+                                        name.c_str()) != nullptr);
+    }
+    for (const std::string &name : definedNames) {
+      numFound += (linearSymbolLookup(nanoapp, name.c_str()) != nullptr);
+    }
+  }
+  auto linearNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                      std::chrono::steady_clock::now() - start)
+                      .count();
+
+  start = std::chrono::steady_clock::now();
+  for (size_t n = 0; n < kIterations; n++) {
+    for (const std::string &name : imports) {
+      numFound += (table.find(name.c_str()) != nullptr);
+    }
+    for (const std::string &name : definedNames) {
+      numFound += (elfGnuHashLookup(nanoapp.gnuHash(), nanoapp.symbols(),
+                                    nanoapp.strings(),
+                                    name.c_str()) != nullptr);
+    }
+  }
+  auto hashedNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                      std::chrono::steady_clock::now() - start)
+                      .count();
+
+  EXPECT_EQ(numFound, 2 * kIterations * (kNumImports + kNumDefinedSymbols));
+  LOGI("%zu imports, %zu definitions: linear %" PRIu64
+       " ns/load, hashed %" PRIu64 " ns/load",
+       kNumImports, kNumDefinedSymbols,
+       static_cast<uint64_t>(linearNs) / kIterations,
+       static_cast<uint64_t>(hashedNs) / kIterations);
+}
+
+}  // namespace chre
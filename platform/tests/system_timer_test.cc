@@ -0,0 +1,268 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <signal.h>
+#include <time.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cinttypes>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "chre/platform/linux/timerfd_dispatcher.h"
+#include "chre/platform/log.h"
+#include "chre/platform/system_timer.h"
+
+using std::chrono::steady_clock;
+
+namespace chre {
+namespace {
+
+constexpr auto kWaitTimeout = std::chrono::seconds(5);
+
+//! Counts timer callbacks and lets the test wait for them.
+class CallbackCounter {
+ public:
+  static void callback(void *data) {
+    auto *counter = static_cast<CallbackCounter *>(data);
+    std::lock_guard<std::mutex> lock(counter->mMutex);
+    counter->mCount++;
+    counter->mCondVar.notify_all();
+  }
+
+  bool waitForCount(size_t count) {
+    std::unique_lock<std::mutex> lock(mMutex);
+    return mCondVar.wait_for(lock, kWaitTimeout,
+                             [&]() { return mCount >= count; });
+  }
+
+  size_t getCount() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mCount;
+  }
+
+ private:
+  std::mutex mMutex;
+  std::condition_variable mCondVar;
+  size_t mCount = 0;
+};
+
+TEST(SystemTimer, FiresOnce) {
+  SystemTimer timer;
+  CallbackCounter counter;
+  ASSERT_TRUE(timer.init());
+  EXPECT_FALSE(timer.isActive());
+
+  ASSERT_TRUE(timer.set(CallbackCounter::callback, &counter,
+                        Milliseconds(1)));
+  EXPECT_TRUE(counter.waitForCount(1));
+  EXPECT_FALSE(timer.isActive());
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  EXPECT_EQ(counter.getCount(), 1);
+}
+
+TEST(SystemTimer, ZeroDelayFires) {
+  SystemTimer timer;
+  CallbackCounter counter;
+  ASSERT_TRUE(timer.init());
+  ASSERT_TRUE(timer.set(CallbackCounter::callback, &counter, Nanoseconds(0)));
+  EXPECT_TRUE(counter.waitForCount(1));
+}
+
+TEST(SystemTimer, CancelPreventsCallback) {
+  SystemTimer timer;
+  CallbackCounter counter;
+  ASSERT_TRUE(timer.init());
+  ASSERT_TRUE(timer.set(CallbackCounter::callback, &counter,
+                        Milliseconds(50)));
+  EXPECT_TRUE(timer.isActive());
+  EXPECT_TRUE(timer.cancel());
+  EXPECT_FALSE(timer.isActive());
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  EXPECT_EQ(counter.getCount(), 0);
+}
+
+TEST(SystemTimer, ManyTimers) {
+  constexpr size_t kNumTimers = 32;
+  SystemTimer timers[kNumTimers];
+  CallbackCounter counter;
+  for (size_t i = 0; i < kNumTimers; i++) {
+    ASSERT_TRUE(timers[i].init());
+    ASSERT_TRUE(timers[i].set(CallbackCounter::callback, &counter,
+                              Microseconds(100 * (i + 1))));
+  }
+  EXPECT_TRUE(counter.waitForCount(kNumTimers));
+}
+
+TEST(TimerFdDispatcher, RearmAndRemoveFromCallback) {
+  struct State {
+    TimerFdDispatcher dispatcher;
+    TimerFdDispatcher::Timer timer;
+    CallbackCounter counter;
+  } state;
+
+  auto callback = [](void *data) {
+    auto *callbackState = static_cast<State *>(data);
+    CallbackCounter::callback(&callbackState->counter);
+    if (callbackState->counter.getCount() < 3) {
+      TimerFdDispatcher::setTimer(callbackState->timer, 1000 /* delayNs */);
+    } else {
+      callbackState->dispatcher.removeTimer(&callbackState->timer);
+    }
+  };
+
+  ASSERT_TRUE(state.dispatcher.addTimer(&state.timer, callback, &state));
+  ASSERT_TRUE(TimerFdDispatcher::setTimer(state.timer, 1000 /* delayNs */));
+  EXPECT_TRUE(state.counter.waitForCount(3));
+  std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  EXPECT_EQ(state.counter.getCount(), 3);
+  EXPECT_EQ(state.timer.fd, -1);
+}
+
+/**
+ * Measures how late timers fire with the POSIX timer + SIGEV_THREAD
+ * implementation and with the TimerFdDispatcher, each timer being re-armed from
+ * the callback of the previous one.
+ */
+class TimerJitterBenchmark {
+ public:
+  static constexpr size_t kNumSamples = 300;
+  static constexpr uint64_t kDelayNs = 1000000;
+
+  //! @return The lateness of each expiration in nanoseconds, sorted.
+  std::vector<uint64_t> measurePosixTimer() {
+    struct sigevent sigevt = {};
+    sigevt.sigev_notify = SIGEV_THREAD;
+    sigevt.sigev_value.sival_ptr = this;
+    sigevt.sigev_notify_function = [](union sigval cookie) {
+      static_cast<TimerJitterBenchmark *>(cookie.sival_ptr)->onExpiration();
+    };
+    timer_t timerId;
+    EXPECT_EQ(timer_create(CLOCK_MONOTONIC, &sigevt, &timerId), 0);
+    mArm = [timerId]() {
+      struct itimerspec spec = {};
+      spec.it_value.tv_nsec = kDelayNs;
+      timer_settime(timerId, 0 /* flags */, &spec, nullptr);
+    };
+
+    std::vector<uint64_t> latenessNs = run();
+    timer_delete(timerId);
+    return latenessNs;
+  }
+
+  std::vector<uint64_t> measureTimerFd(int realtimePriority) {
+    TimerFdDispatcher dispatcher(realtimePriority);
+    TimerFdDispatcher::Timer timer;
+    auto callback = [](void *data) {
+      static_cast<TimerJitterBenchmark *>(data)->onExpiration();
+    };
+    EXPECT_TRUE(dispatcher.addTimer(&timer, callback, this));
+    mArm = [&timer]() { TimerFdDispatcher::setTimer(timer, kDelayNs); };
+
+    std::vector<uint64_t> latenessNs = run();
+    dispatcher.removeTimer(&timer);
+    return latenessNs;
+  }
+
+ private:
+  std::vector<uint64_t> run() {
+    mLatenessNs.clear();
+    mLatenessNs.reserve(kNumSamples);
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      mDeadline = steady_clock::now() + std::chrono::nanoseconds(kDelayNs);
+      mArm();
+    }
+
+    std::unique_lock<std::mutex> lock(mMutex);
+    EXPECT_TRUE(mCondVar.wait_for(lock, std::chrono::seconds(10), [&]() {
+      return mLatenessNs.size() == kNumSamples;
+    }));
+    std::vector<uint64_t> latenessNs = mLatenessNs;
+    std::sort(latenessNs.begin(), latenessNs.end());
+    return latenessNs;
+  }
+
+  void onExpiration() {
+    auto now = steady_clock::now();
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mLatenessNs.size() < kNumSamples) {
+      mLatenessNs.push_back(
+          std::chrono::duration_cast<std::chrono::nanoseconds>(now - mDeadline)
+              .count());
+      if (mLatenessNs.size() < kNumSamples) {
+        mDeadline = now + std::chrono::nanoseconds(kDelayNs);
+        mArm();
+      } else {
+        mCondVar.notify_all();
+      }
+    }
+  }
+
+  std::function<void()> mArm;
+  std::mutex mMutex;
+  std::condition_variable mCondVar;
+  steady_clock::time_point mDeadline;
+  std::vector<uint64_t> mLatenessNs;
+};
+
+void logJitter(const char *name, const std::vector<uint64_t> &latenessNs) {
+  ASSERT_EQ(latenessNs.size(), TimerJitterBenchmark::kNumSamples);
+  size_t size = latenessNs.size();
+  LOGI("%s: late by p50 %" PRIu64 " ns, p99 %" PRIu64 " ns, max %" PRIu64
+       " ns",
+       name, latenessNs[size / 2], latenessNs[size * 99 / 100],
+       latenessNs[size - 1]);
+}
+
+TEST(TimerFdDispatcher, JitterBenchmark) {
+  TimerJitterBenchmark benchmark;
+  logJitter("POSIX timer, idle", benchmark.measurePosixTimer());
+  logJitter("timerfd, idle", benchmark.measureTimerFd(0 /* priority */));
+
+  // Load every CPU with busy threads.
+  std::atomic<bool> stop(false);
+  std::vector<std::thread> loadThreads;
+  for (unsigned i = 0; i < std::max(2u, std::thread::hardware_concurrency());
+       i++) {
+    loadThreads.emplace_back([&stop]() {
+      volatile uint64_t sum = 0;
+      while (!stop.load(std::memory_order_relaxed)) {
+        sum = sum + 1;
+      }
+    });
+  }
+
+  logJitter("POSIX timer, loaded", benchmark.measurePosixTimer());
+  logJitter("timerfd, loaded", benchmark.measureTimerFd(0 /* priority */));
+  logJitter("timerfd SCHED_FIFO, loaded",
+            benchmark.measureTimerFd(1 /* priority */));
+
+  stop = true;
+  for (std::thread &thread : loadThreads) {
+    thread.join();
+  }
+}
+
+}  // namespace
+}  // namespace chre
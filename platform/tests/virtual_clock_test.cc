@@ -0,0 +1,165 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+#include "chre/platform/linux/pal_task.h"
+#include "chre/platform/linux/virtual_clock.h"
+#include "chre/platform/system_time.h"
+#include "chre/platform/system_timer.h"
+#include "chre/util/time.h"
+
+namespace chre {
+namespace {
+
+class VirtualClockTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    mClock.enable();
+    // Dispatch alarms from the test thread, as if the event loop was busy.
+    mClock.onEventLoopBusy();
+    mStartNs = mClock.getTimeNs();
+  }
+
+  void TearDown() override {
+    mClock.disable();
+  }
+
+  //! Records the alarm number passed as data and the time at which it fired.
+  static void recordCallback(void *data) {
+    sFired.push_back(reinterpret_cast<uintptr_t>(data));
+    sFiredTimesNs.push_back(VirtualClock::getInstance().getTimeNs());
+  }
+
+  void addAlarm(uint64_t offsetNs, uintptr_t alarmNumber) {
+    mClock.addAlarm(mStartNs + offsetNs, recordCallback,
+                    reinterpret_cast<void *>(alarmNumber));
+  }
+
+  VirtualClock &mClock = VirtualClock::getInstance();
+  uint64_t mStartNs = 0;
+
+  static std::vector<uintptr_t> sFired;
+  static std::vector<uint64_t> sFiredTimesNs;
+};
+
+std::vector<uintptr_t> VirtualClockTest::sFired;
+std::vector<uint64_t> VirtualClockTest::sFiredTimesNs;
+
+TEST_F(VirtualClockTest, AlarmsFireInDeadlineOrder) {
+  sFired.clear();
+  sFiredTimesNs.clear();
+  addAlarm(30, 1);
+  addAlarm(10, 2);
+  addAlarm(10, 3);
+  addAlarm(20, 4);
+
+  while (mClock.onEventLoopIdle()) {
+  }
+
+  EXPECT_EQ(sFired, (std::vector<uintptr_t>{2, 3, 4, 1}));
+  EXPECT_EQ(sFiredTimesNs, (std::vector<uint64_t>{mStartNs + 10, mStartNs + 10,
+                                                  mStartNs + 20,
+                                                  mStartNs + 30}));
+  EXPECT_EQ(mClock.getTimeNs(), mStartNs + 30);
+}
+
+TEST_F(VirtualClockTest, CancelledAlarmDoesNotFire) {
+  sFired.clear();
+  uint64_t alarmId =
+      mClock.addAlarm(mStartNs + 10, recordCallback, nullptr /* data */);
+  EXPECT_TRUE(mClock.isAlarmPending(alarmId));
+
+  uint64_t cancelledId = alarmId;
+  EXPECT_TRUE(mClock.cancelAlarm(&alarmId));
+  EXPECT_EQ(alarmId, 0);
+  EXPECT_FALSE(mClock.isAlarmPending(cancelledId));
+  EXPECT_FALSE(mClock.cancelAlarm(&cancelledId));
+
+  EXPECT_FALSE(mClock.onEventLoopIdle());
+  EXPECT_TRUE(sFired.empty());
+  EXPECT_EQ(mClock.getTimeNs(), mStartNs);
+}
+
+TEST_F(VirtualClockTest, SystemTimeAndTimerFollowVirtualTime) {
+  EXPECT_EQ(SystemTime::getMonotonicTime().toRawNanoseconds(), mStartNs);
+
+  SystemTimer timer;
+  ASSERT_TRUE(timer.init());
+  bool fired = false;
+  auto callback = [](void *data) { *static_cast<bool *>(data) = true; };
+  ASSERT_TRUE(timer.set(callback, &fired, Seconds(3600)));
+  EXPECT_TRUE(timer.isActive());
+
+  EXPECT_TRUE(mClock.onEventLoopIdle());
+  EXPECT_TRUE(fired);
+  EXPECT_FALSE(timer.isActive());
+  EXPECT_EQ(SystemTime::getMonotonicTime().toRawNanoseconds(),
+            mStartNs + 3600 * kOneSecondInNanoseconds);
+}
+
+TEST_F(VirtualClockTest, PeriodicPalTaskRunsAtFixedRate) {
+  sFiredTimesNs.clear();
+  PalTask task;
+  task.start(
+      []() {
+        sFiredTimesNs.push_back(VirtualClock::getInstance().getTimeNs());
+      },
+      5 /* delayNs */, 10 /* intervalNs */);
+
+  for (int i = 0; i < 3; i++) {
+    EXPECT_TRUE(mClock.onEventLoopIdle());
+  }
+  task.stop();
+  EXPECT_FALSE(mClock.onEventLoopIdle());
+
+  EXPECT_EQ(sFiredTimesNs, (std::vector<uint64_t>{mStartNs + 5, mStartNs + 15,
+                                                  mStartNs + 25}));
+}
+
+TEST_F(VirtualClockTest, AlarmAddedWhileIdleIsDispatched) {
+  struct State {
+    std::mutex mutex;
+    std::condition_variable condVar;
+    bool fired = false;
+  } state;
+
+  // Nothing to dispatch: the event loop is marked idle.
+  EXPECT_FALSE(mClock.onEventLoopIdle());
+
+  mClock.addAlarm(
+      mStartNs + kOneSecondInNanoseconds,
+      [](void *data) {
+        auto *alarmState = static_cast<State *>(data);
+        std::lock_guard<std::mutex> lock(alarmState->mutex);
+        alarmState->fired = true;
+        alarmState->condVar.notify_all();
+      },
+      &state);
+
+  std::unique_lock<std::mutex> lock(state.mutex);
+  EXPECT_TRUE(state.condVar.wait_for(lock, std::chrono::seconds(5),
+                                     [&]() { return state.fired; }));
+  EXPECT_EQ(mClock.getTimeNs(), mStartNs + kOneSecondInNanoseconds);
+}
+
+}  // namespace
+}  // namespace chre
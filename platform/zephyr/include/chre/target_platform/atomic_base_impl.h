@@ -79,6 +79,16 @@ inline uint32_t AtomicUint32::fetch_decrement() {
   return atomic_dec(&value);
 }
 
+inline bool AtomicUint32::compare_exchange(uint32_t &expected,
+                                           uint32_t desired) {
+  bool success = atomic_cas(&value, static_cast<atomic_val_t>(expected),
+                            static_cast<atomic_val_t>(desired));
+  if (!success) {
+    expected = load();
+  }
+  return success;
+}
+
 }  // namespace chre
 
 #endif  // CHRE_PLATFORM_ZEPHYR_ATOMIC_BASE_IMPL_H_
@@ -165,5 +165,121 @@ TEST_F(TestBase, AudioUnsubscribeToDataEventsOnUnload) {
   EXPECT_FALSE(chrePalAudioIsHandle0Enabled());
 }
 
+TEST_F(TestBase, AudioFeaturesAreComputedOnceForAllNanoapps) {
+  CREATE_CHRE_TEST_EVENT(CONFIGURE, 0);
+  CREATE_CHRE_TEST_EVENT(CONFIGURE_FEATURES, 1);
+
+  struct Features {
+    uint64_t timestamp;
+    uintptr_t features;
+    uint16_t featureCount;
+    uint16_t frameCount;
+  };
+
+  struct App : public AudioNanoapp {
+    void (*handleEvent)(uint32_t, uint16_t,
+                        const void *) = [](uint32_t, uint16_t eventType,
+                                           const void *eventData) {
+      switch (eventType) {
+        case CHRE_EVENT_AUDIO_FEATURES: {
+          auto event =
+              static_cast<const struct chreAudioFeatureEvent *>(eventData);
+          Features features = {
+              .timestamp = event->timestamp,
+              .features = reinterpret_cast<uintptr_t>(event->features),
+              .featureCount = event->featureCount,
+              .frameCount = event->frameCount,
+          };
+          TestEventQueueSingleton::get()->pushEvent(CHRE_EVENT_AUDIO_FEATURES,
+                                                    features);
+          break;
+        }
+
+        case CHRE_EVENT_TEST_EVENT: {
+          auto event = static_cast<const TestEvent *>(eventData);
+          switch (event->type) {
+            case CONFIGURE: {
+              auto enable = static_cast<const bool *>(event->data);
+              const bool success = chreAudioConfigureSource(
+                  0 /*handle*/, *enable, 16000000 /*bufferDuration*/,
+                  16000000 /*deliveryInterval*/);
+              TestEventQueueSingleton::get()->pushEvent(CONFIGURE, success);
+              break;
+            }
+
+            case CONFIGURE_FEATURES: {
+              auto config =
+                  static_cast<const struct chreAudioFeatureConfig *>(
+                      event->data);
+              const bool success = chreAudioConfigureFeatures(
+                  0 /*handle*/, true /*enable*/, config);
+              TestEventQueueSingleton::get()->pushEvent(CONFIGURE_FEATURES,
+                                                        success);
+              break;
+            }
+          }
+        }
+      }
+    };
+  };
+
+  struct OtherApp : public App {
+    uint64_t id = 0x0123456789000001;
+  };
+
+  auto app = loadNanoapp<App>();
+  auto otherApp = loadNanoapp<OtherApp>();
+
+  chreAudioFeatureConfig config = {
+      .fftSize = 128,
+      .featureType = CHRE_AUDIO_FEATURE_TYPE_LOG_MEL,
+      .numMelBands = 16,
+  };
+  bool success;
+  // Features require the audio source to be enabled.
+  sendEventToNanoapp(app, CONFIGURE_FEATURES, config);
+  waitForEvent(CONFIGURE_FEATURES, &success);
+  EXPECT_FALSE(success);
+
+  bool enable = true;
+  sendEventToNanoapp(app, CONFIGURE, enable);
+  waitForEvent(CONFIGURE, &success);
+  EXPECT_TRUE(success);
+  sendEventToNanoapp(app, CONFIGURE_FEATURES, config);
+  waitForEvent(CONFIGURE_FEATURES, &success);
+  EXPECT_TRUE(success);
+  sendEventToNanoapp(otherApp, CONFIGURE, enable);
+  waitForEvent(CONFIGURE, &success);
+  EXPECT_TRUE(success);
+  sendEventToNanoapp(otherApp, CONFIGURE_FEATURES, config);
+  waitForEvent(CONFIGURE_FEATURES, &success);
+  EXPECT_TRUE(success);
+
+  // Both nanoapps receive the same features for a buffer of 256 samples.
+  Features features;
+  Features otherFeatures;
+  waitForEvent(CHRE_EVENT_AUDIO_FEATURES, &features);
+  for (int i = 0; i < 10; i++) {
+    waitForEvent(CHRE_EVENT_AUDIO_FEATURES, &otherFeatures);
+    if (otherFeatures.timestamp == features.timestamp) {
+      break;
+    }
+    features = otherFeatures;
+  }
+  EXPECT_EQ(otherFeatures.timestamp, features.timestamp);
+  EXPECT_EQ(otherFeatures.features, features.features);
+  EXPECT_EQ(features.featureCount, 16);
+  EXPECT_EQ(features.frameCount, 2);
+
+  enable = false;
+  sendEventToNanoapp(app, CONFIGURE, enable);
+  waitForEvent(CONFIGURE, &success);
+  EXPECT_TRUE(success);
+  sendEventToNanoapp(otherApp, CONFIGURE, enable);
+  waitForEvent(CONFIGURE, &success);
+  EXPECT_TRUE(success);
+  EXPECT_FALSE(chrePalAudioIsHandle0Enabled());
+}
+
 }  // namespace
 }  // namespace chre
\ No newline at end of file
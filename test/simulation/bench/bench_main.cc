@@ -0,0 +1,66 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include "benchmark_report.h"
+
+/**
+ * Entry point of chre_bench.
+ *
+ * Runs the benchmark scenarios, which are gtest tests of the ChreBench and
+ * FftBench suites, then prints the JSON report to stdout, or writes it to the
+ * file given with --bench_json_out=<path>.
+ *
+ * The simulation framework tests linked into the binary are filtered out
+ * unless a --gtest_filter is given.
+ */
+int main(int argc, char **argv) {
+  constexpr char kJsonOutFlag[] = "--bench_json_out=";
+  const char *jsonOutPath = nullptr;
+  bool hasFilter = false;
+  for (int i = 1; i < argc; i++) {
+    if (strncmp(argv[i], kJsonOutFlag, strlen(kJsonOutFlag)) == 0) {
+      jsonOutPath = argv[i] + strlen(kJsonOutFlag);
+    } else if (strncmp(argv[i], "--gtest_filter", 14) == 0) {
+      hasFilter = true;
+    }
+  }
+
+  testing::InitGoogleTest(&argc, argv);
+  if (!hasFilter) {
+    testing::GTEST_FLAG(filter) = "ChreBench.*:FftBench.*";
+  }
+  int result = RUN_ALL_TESTS();
+
+  std::string json = chre::getBenchmarkReport().toJson();
+  if (jsonOutPath == nullptr) {
+    fputs(json.c_str(), stdout);
+  } else {
+    FILE *file = fopen(jsonOutPath, "w");
+    if (file == nullptr) {
+      fprintf(stderr, "Failed to open %s\n", jsonOutPath);
+      result = 1;
+    } else {
+      fputs(json.c_str(), file);
+      fclose(file);
+    }
+  }
+  return result;
+}
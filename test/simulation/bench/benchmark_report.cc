@@ -0,0 +1,101 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "benchmark_report.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+
+#include "chre/util/time.h"
+
+namespace chre {
+
+namespace {
+
+//! Nearest-rank percentile of sorted values.
+uint64_t percentile(const std::vector<uint64_t> &sortedValues,
+                    double fraction) {
+  if (sortedValues.empty()) {
+    return 0;
+  }
+  size_t rank = static_cast<size_t>(fraction * sortedValues.size());
+  return sortedValues[std::min(rank, sortedValues.size() - 1)];
+}
+
+}  // anonymous namespace
+
+const BenchmarkResult &BenchmarkReport::addScenario(const char *name,
+                                                    BenchmarkSamples &samples) {
+  std::vector<uint64_t> &latencies = samples.latenciesNs;
+  std::sort(latencies.begin(), latencies.end());
+
+  BenchmarkResult result;
+  result.name = name;
+  result.sampleCount = latencies.size();
+  result.p50Ns = percentile(latencies, 0.5);
+  result.p99Ns = percentile(latencies, 0.99);
+  result.p999Ns = percentile(latencies, 0.999);
+  result.maxNs = latencies.empty() ? 0 : latencies.back();
+
+  uint64_t durationNs =
+      (samples.endNs > samples.startNs) ? samples.endNs - samples.startNs : 0;
+  result.eventsPerSec =
+      (durationNs > 0) ? static_cast<double>(latencies.size()) *
+                             kOneSecondInNanoseconds / durationNs
+                       : 0.0;
+  result.maxEventQueueSize = samples.maxEventQueueSize;
+
+  mResults.push_back(result);
+  return mResults.back();
+}
+
+std::string BenchmarkReport::toJson() const {
+  std::string json = "{\n  \"benchmarks\": [";
+  char entry[512];
+  for (size_t i = 0; i < mResults.size(); i++) {
+    const BenchmarkResult &result = mResults[i];
+    snprintf(entry, sizeof(entry),
+             "%s\n    {\n"
+             "      \"name\": \"%s\",\n"
+             "      \"samples\": %zu,\n"
+             "      \"p50_ns\": %" PRIu64
+             ",\n"
+             "      \"p99_ns\": %" PRIu64
+             ",\n"
+             "      \"p999_ns\": %" PRIu64
+             ",\n"
+             "      \"max_ns\": %" PRIu64
+             ",\n"
+             "      \"events_per_sec\": %.1f,\n"
+             "      \"max_event_queue_size\": %" PRIu32
+             "\n"
+             "    }",
+             (i == 0) ? "" : ",", result.name.c_str(), result.sampleCount,
+             result.p50Ns, result.p99Ns, result.p999Ns, result.maxNs,
+             result.eventsPerSec, result.maxEventQueueSize);
+    json += entry;
+  }
+  json += mResults.empty() ? "]\n}\n" : "\n  ]\n}\n";
+  return json;
+}
+
+BenchmarkReport &getBenchmarkReport() {
+  static BenchmarkReport report;
+  return report;
+}
+
+}  // namespace chre
@@ -0,0 +1,577 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <atomic>
+#include <cinttypes>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+
+#include "chre/core/event_loop_manager.h"
+#include "chre/platform/log.h"
+#include "chre/platform/system_time.h"
+#include "chre/util/time.h"
+#include "chre_api/chre/event.h"
+#include "chre_api/chre/re.h"
+#include "chre_api/chre/sensor.h"
+
+#include "benchmark_report.h"
+#include "gtest/gtest.h"
+#include "test_base.h"
+#include "test_event.h"
+#include "test_event_queue.h"
+#include "test_util.h"
+
+namespace chre {
+
+/**
+ * Benchmarks of the event loop hot paths, run in the simulation framework.
+ *
+ * Each scenario records one latency per event, in nanoseconds of the CHRE
+ * monotonic clock, and adds its statistics to the report printed by
+ * chre_bench. Latencies are measured in the nanoapp context, so they include
+ * the event queueing, dispatch and any framework processing on the way.
+ */
+class ChreBench : public TestBase {
+ protected:
+  uint64_t getTimeoutNs() const override {
+    return 60 * kOneSecondInNanoseconds;
+  }
+
+  //! Adds the statistics of the scenario that just completed to the report.
+  void reportScenario(const char *name);
+};
+
+namespace {
+
+//! The measurements of the running scenario.
+BenchmarkSamples gSamples;
+
+constexpr uint64_t kPingAppId = 0x0123456789000001;
+constexpr uint64_t kPongAppId = 0x0123456789000002;
+constexpr uint16_t kHostEndpoint = 0x8001;
+
+//! The simulation runs on 64-bit hosts: timestamps are carried in the event
+//! data pointer itself to keep allocations out of the measured path.
+static_assert(sizeof(void *) >= sizeof(uint64_t),
+              "Timestamps must fit in a pointer");
+
+void *timestampToEventData(uint64_t timestampNs) {
+  return reinterpret_cast<void *>(static_cast<uintptr_t>(timestampNs));
+}
+
+uint64_t eventDataToTimestamp(const void *eventData) {
+  return static_cast<uint64_t>(reinterpret_cast<uintptr_t>(eventData));
+}
+
+}  // anonymous namespace
+
+void ChreBench::reportScenario(const char *name) {
+  gSamples.maxEventQueueSize =
+      EventLoopManagerSingleton::get()->getEventLoop().getMaxEventQueueSize();
+  const BenchmarkResult &result =
+      getBenchmarkReport().addScenario(name, gSamples);
+  LOGI("%s: p50 %" PRIu64 " ns, p99 %" PRIu64 " ns, p999 %" PRIu64
+       " ns, %.1f events/s, max queue size %" PRIu32,
+       name, result.p50Ns, result.p99Ns, result.p999Ns, result.eventsPerSec,
+       result.maxEventQueueSize);
+}
+
+namespace {
+
+constexpr size_t kNumSensorSamples = 2000;
+constexpr uint64_t kSensorIntervalNs = 500 * kOneMicrosecondInNanoseconds;
+
+/**
+ * Latency from the PAL timestamping a sensor sample to the nanoapp receiving
+ * it. Samples are requested with ASAP latency, so they are not batched.
+ */
+TEST_F(ChreBench, SensorSampleToNanoapp) {
+  CREATE_CHRE_TEST_EVENT(START, 0);
+  CREATE_CHRE_TEST_EVENT(DONE, 1);
+
+  struct App : public TestNanoapp {
+    void (*handleEvent)(uint32_t, uint16_t, const void *) =
+        [](uint32_t, uint16_t eventType, const void *eventData) {
+          static uint32_t sensorHandle;
+
+          switch (eventType) {
+            case CHRE_EVENT_SENSOR_UNCALIBRATED_ACCELEROMETER_DATA: {
+              uint64_t now = chreGetTime();
+              auto *data =
+                  static_cast<const chreSensorThreeAxisData *>(eventData);
+              uint64_t timestamp = data->header.baseTimestamp;
+              for (uint16_t i = 0; i < data->header.readingCount &&
+                                   gSamples.size() < kNumSensorSamples;
+                   i++) {
+                timestamp += data->readings[i].timestampDelta;
+                gSamples.record(now - timestamp);
+                if (gSamples.size() == kNumSensorSamples) {
+                  gSamples.endNs = now;
+                  chreSensorConfigureModeOnly(sensorHandle,
+                                              CHRE_SENSOR_CONFIGURE_MODE_DONE);
+                  TestEventQueueSingleton::get()->pushEvent(DONE);
+                }
+              }
+              break;
+            }
+
+            case CHRE_EVENT_TEST_EVENT: {
+              auto event = static_cast<const TestEvent *>(eventData);
+              if (event->type == START) {
+                bool success = chreSensorFindDefault(
+                                   CHRE_SENSOR_TYPE_UNCALIBRATED_ACCELEROMETER,
+                                   &sensorHandle) &&
+                               chreSensorConfigure(
+                                   sensorHandle,
+                                   CHRE_SENSOR_CONFIGURE_MODE_CONTINUOUS,
+                                   kSensorIntervalNs, CHRE_SENSOR_LATENCY_ASAP);
+                gSamples.startNs = chreGetTime();
+                TestEventQueueSingleton::get()->pushEvent(START, success);
+              }
+              break;
+            }
+          }
+        };
+  };
+
+  gSamples.reset(kNumSensorSamples);
+  auto app = loadNanoapp<App>();
+  bool success;
+  sendEventToNanoapp(app, START);
+  waitForEvent(START, &success);
+  ASSERT_TRUE(success);
+  waitForEvent(DONE);
+
+  reportScenario("sensor_sample_to_nanoapp");
+}
+
+constexpr size_t kNumRoundTrips = 20000;
+
+/**
+ * Round trip of an event sent with chreSendEvent() from one nanoapp to
+ * another, which sends it back.
+ */
+TEST_F(ChreBench, NanoappEventRoundTrip) {
+  CREATE_CHRE_TEST_EVENT(START, 0);
+  CREATE_CHRE_TEST_EVENT(DONE, 1);
+  CREATE_CHRE_TEST_EVENT(PING, 2);
+  CREATE_CHRE_TEST_EVENT(PONG, 3);
+
+  struct PongApp : public TestNanoapp {
+    uint64_t id = kPongAppId;
+
+    void (*handleEvent)(uint32_t, uint16_t, const void *) =
+        [](uint32_t senderInstanceId, uint16_t eventType,
+           const void *eventData) {
+          if (eventType == PING) {
+            chreSendEvent(PONG, const_cast<void *>(eventData),
+                          nullptr /* freeCallback */, senderInstanceId);
+          }
+        };
+  };
+
+  struct PingApp : public TestNanoapp {
+    uint64_t id = kPingAppId;
+
+    void (*handleEvent)(uint32_t, uint16_t, const void *) =
+        [](uint32_t, uint16_t eventType, const void *eventData) {
+          static uint32_t pongInstanceId;
+
+          switch (eventType) {
+            case PONG: {
+              uint64_t now = chreGetTime();
+              gSamples.record(now - eventDataToTimestamp(eventData));
+              if (gSamples.size() < kNumRoundTrips) {
+                chreSendEvent(PING, timestampToEventData(chreGetTime()),
+                              nullptr /* freeCallback */, pongInstanceId);
+              } else {
+                gSamples.endNs = now;
+                TestEventQueueSingleton::get()->pushEvent(DONE);
+              }
+              break;
+            }
+
+            case CHRE_EVENT_TEST_EVENT: {
+              auto event = static_cast<const TestEvent *>(eventData);
+              if (event->type == START) {
+                pongInstanceId = *static_cast<const uint16_t *>(event->data);
+                gSamples.startNs = chreGetTime();
+                chreSendEvent(PING, timestampToEventData(gSamples.startNs),
+                              nullptr /* freeCallback */, pongInstanceId);
+              }
+              break;
+            }
+          }
+        };
+  };
+
+  gSamples.reset(kNumRoundTrips);
+  auto pingApp = loadNanoapp<PingApp>();
+  loadNanoapp<PongApp>();
+  uint16_t pongInstanceId;
+  ASSERT_TRUE(EventLoopManagerSingleton::get()
+                  ->getEventLoop()
+                  .findNanoappInstanceIdByAppId(kPongAppId, &pongInstanceId));
+  sendEventToNanoapp(pingApp, START, pongInstanceId);
+  waitForEvent(DONE);
+
+  reportScenario("nanoapp_event_round_trip");
+}
+
+constexpr size_t kNumTimerEvents = 1000;
+constexpr uint64_t kTimerIntervalNs = kOneMillisecondInNanoseconds;
+
+/**
+ * Jitter of a periodic nanoapp timer: the absolute difference between the
+ * time elapsed since the previous timer event and the timer period.
+ */
+TEST_F(ChreBench, TimerJitter) {
+  CREATE_CHRE_TEST_EVENT(START, 0);
+  CREATE_CHRE_TEST_EVENT(DONE, 1);
+
+  struct App : public TestNanoapp {
+    void (*handleEvent)(uint32_t, uint16_t, const void *) =
+        [](uint32_t, uint16_t eventType, const void *eventData) {
+          static uint32_t timerHandle;
+          static uint64_t previousTime;
+
+          switch (eventType) {
+            case CHRE_EVENT_TIMER: {
+              uint64_t now = chreGetTime();
+              if (gSamples.size() < kNumTimerEvents) {
+                uint64_t period = now - previousTime;
+                gSamples.record((period > kTimerIntervalNs)
+                                    ? period - kTimerIntervalNs
+                                    : kTimerIntervalNs - period);
+                if (gSamples.size() == kNumTimerEvents) {
+                  gSamples.endNs = now;
+                  chreTimerCancel(timerHandle);
+                  TestEventQueueSingleton::get()->pushEvent(DONE);
+                }
+              }
+              previousTime = now;
+              break;
+            }
+
+            case CHRE_EVENT_TEST_EVENT: {
+              auto event = static_cast<const TestEvent *>(eventData);
+              if (event->type == START) {
+                previousTime = chreGetTime();
+                gSamples.startNs = previousTime;
+                timerHandle = chreTimerSet(kTimerIntervalNs,
+                                           nullptr /* cookie */,
+                                           false /* oneShot */);
+                TestEventQueueSingleton::get()->pushEvent(
+                    START, timerHandle != CHRE_TIMER_INVALID);
+              }
+              break;
+            }
+          }
+        };
+  };
+
+  gSamples.reset(kNumTimerEvents);
+  auto app = loadNanoapp<App>();
+  bool success;
+  sendEventToNanoapp(app, START);
+  waitForEvent(START, &success);
+  ASSERT_TRUE(success);
+  waitForEvent(DONE);
+
+  reportScenario("timer_jitter");
+}
+
+constexpr size_t kNumHostMessages = 20000;
+constexpr size_t kMaxHostMessagesInFlight = 8;
+
+//! Number of messages from the host received by the nanoapp.
+std::atomic<size_t> gNumHostMessagesReceived;
+
+/**
+ * Latency from the host link handing a message to HostCommsManager to the
+ * nanoapp receiving it. The host thread keeps a few messages in flight to
+ * stay within the message pool.
+ */
+TEST_F(ChreBench, HostMessageIngress) {
+  CREATE_CHRE_TEST_EVENT(DONE, 0);
+
+  struct App : public TestNanoapp {
+    void (*handleEvent)(uint32_t, uint16_t, const void *) =
+        [](uint32_t, uint16_t eventType, const void *eventData) {
+          if (eventType == CHRE_EVENT_MESSAGE_FROM_HOST) {
+            uint64_t now = chreGetTime();
+            auto *message =
+                static_cast<const chreMessageFromHostData *>(eventData);
+            uint64_t timestamp;
+            memcpy(&timestamp, message->message, sizeof(timestamp));
+            gSamples.record(now - timestamp);
+            if (gNumHostMessagesReceived.fetch_add(1) + 1 ==
+                kNumHostMessages) {
+              gSamples.endNs = now;
+              TestEventQueueSingleton::get()->pushEvent(DONE);
+            }
+          }
+        };
+  };
+
+  gSamples.reset(kNumHostMessages);
+  gNumHostMessagesReceived = 0;
+  auto app = loadNanoapp<App>();
+  HostCommsManager &hostCommsManager =
+      EventLoopManagerSingleton::get()->getHostCommsManager();
+
+  gSamples.startNs = SystemTime::getMonotonicTime().toRawNanoseconds();
+  for (size_t i = 0; i < kNumHostMessages; i++) {
+    while (i - gNumHostMessagesReceived.load() >= kMaxHostMessagesInFlight) {
+      std::this_thread::yield();
+    }
+    uint64_t timestamp = SystemTime::getMonotonicTime().toRawNanoseconds();
+    hostCommsManager.sendMessageToNanoappFromHost(
+        app.id, 0 /* messageType */, kHostEndpoint, &timestamp,
+        sizeof(timestamp));
+  }
+  waitForEvent(DONE);
+
+  reportScenario("host_message_ingress");
+}
+
+/**
+ * Latency from a nanoapp sending a message to the host to its free callback
+ * running, once the Linux host link reports the message as consumed.
+ */
+TEST_F(ChreBench, HostMessageEgress) {
+  CREATE_CHRE_TEST_EVENT(START, 0);
+  CREATE_CHRE_TEST_EVENT(DONE, 1);
+
+  struct App : public TestNanoapp {
+    void (*handleEvent)(uint32_t, uint16_t, const void *) =
+        [](uint32_t, uint16_t eventType, const void *eventData) {
+          static uint64_t sendTime;
+          static uint8_t message[sizeof(uint64_t)];
+
+          // Sends the next message when the previous one was consumed.
+          static chreMessageFreeFunction *freeCallback = [](void *, size_t) {
+            uint64_t now = chreGetTime();
+            gSamples.record(now - sendTime);
+            if (gSamples.size() < kNumHostMessages) {
+              sendTime = chreGetTime();
+              chreSendMessageToHostEndpoint(message, sizeof(message),
+                                            0 /* messageType */,
+                                            kHostEndpoint, freeCallback);
+            } else {
+              gSamples.endNs = now;
+              TestEventQueueSingleton::get()->pushEvent(DONE);
+            }
+          };
+
+          if (eventType == CHRE_EVENT_TEST_EVENT &&
+              static_cast<const TestEvent *>(eventData)->type == START) {
+            gSamples.startNs = chreGetTime();
+            sendTime = gSamples.startNs;
+            bool success = chreSendMessageToHostEndpoint(
+                message, sizeof(message), 0 /* messageType */, kHostEndpoint,
+                freeCallback);
+            TestEventQueueSingleton::get()->pushEvent(START, success);
+          }
+        };
+  };
+
+  gSamples.reset(kNumHostMessages);
+  auto app = loadNanoapp<App>();
+  bool success;
+  sendEventToNanoapp(app, START);
+  waitForEvent(START, &success);
+  ASSERT_TRUE(success);
+  waitForEvent(DONE);
+
+  reportScenario("host_message_egress");
+}
+
+constexpr size_t kNumSaturationRounds = 100;
+
+//! Number of events posted and received in the current saturation round.
+size_t gNumFloodEventsPosted;
+size_t gNumFloodEventsReceived;
+size_t gNumSaturationRounds;
+
+/**
+ * Queueing latency and throughput of low priority events when the event pool
+ * is saturated: the nanoapp posts events to itself until chreSendEvent()
+ * fails, and refills the pool once all of them were received.
+ */
+TEST_F(ChreBench, EventPoolSaturation) {
+  CREATE_CHRE_TEST_EVENT(START, 0);
+  CREATE_CHRE_TEST_EVENT(DONE, 1);
+  CREATE_CHRE_TEST_EVENT(FLOOD, 2);
+
+  struct App : public TestNanoapp {
+    void (*handleEvent)(uint32_t, uint16_t, const void *) =
+        [](uint32_t, uint16_t eventType, const void *eventData) {
+          auto fillEventPool = []() {
+            gNumFloodEventsPosted = 0;
+            gNumFloodEventsReceived = 0;
+            while (chreSendEvent(FLOOD, timestampToEventData(chreGetTime()),
+                                 nullptr /* freeCallback */,
+                                 chreGetInstanceId())) {
+              gNumFloodEventsPosted++;
+            }
+          };
+
+          switch (eventType) {
+            case FLOOD: {
+              uint64_t now = chreGetTime();
+              gSamples.record(now - eventDataToTimestamp(eventData));
+              if (++gNumFloodEventsReceived == gNumFloodEventsPosted) {
+                if (++gNumSaturationRounds < kNumSaturationRounds) {
+                  fillEventPool();
+                } else {
+                  gSamples.endNs = now;
+                  TestEventQueueSingleton::get()->pushEvent(DONE);
+                }
+              }
+              break;
+            }
+
+            case CHRE_EVENT_TEST_EVENT: {
+              if (static_cast<const TestEvent *>(eventData)->type == START) {
+                gNumSaturationRounds = 0;
+                gSamples.startNs = chreGetTime();
+                fillEventPool();
+                TestEventQueueSingleton::get()->pushEvent(
+                    START, gNumFloodEventsPosted);
+              }
+              break;
+            }
+          }
+        };
+  };
+
+  auto app = loadNanoapp<App>();
+  gSamples.reset(kNumSaturationRounds * CHRE_MAX_EVENT_COUNT);
+  size_t eventsPerRound;
+  sendEventToNanoapp(app, START);
+  waitForEvent(START, &eventsPerRound);
+  ASSERT_GT(eventsPerRound, 0);
+  waitForEvent(DONE);
+
+  reportScenario("event_pool_saturation");
+}
+
+constexpr size_t kNumPalEvents = 20000;
+constexpr size_t kPalEventBurstSize = 8;
+constexpr uint16_t kPalEventType = CHRE_EVENT_FIRST_USER_VALUE;
+CREATE_CHRE_TEST_EVENT(PAL_EVENTS_DONE, 0);
+
+//! Instance ID of the nanoapp receiving the PAL events.
+uint16_t gPalEventTargetInstanceId;
+
+//! Number of PAL events received by the nanoapp.
+std::atomic<size_t> gNumPalEventsReceived;
+
+/**
+ * Posts PAL data events from the test thread, which stands for a PAL thread,
+ * in bursts that the nanoapp must receive before the next one is posted.
+ *
+ * @param postEvent Function posting one event, whose data is the timestamp
+ *        of the post.
+ */
+void runPalEventScenario(void (*postEvent)(void *eventData)) {
+  gSamples.startNs = SystemTime::getMonotonicTime().toRawNanoseconds();
+  for (size_t i = 0; i < kNumPalEvents; i++) {
+    if (i % kPalEventBurstSize == 0) {
+      while (gNumPalEventsReceived.load() < i) {
+        std::this_thread::yield();
+      }
+    }
+    postEvent(timestampToEventData(
+        SystemTime::getMonotonicTime().toRawNanoseconds()));
+  }
+}
+
+//! Receives the events posted by runPalEventScenario().
+struct PalEventApp : public TestNanoapp {
+  void (*handleEvent)(uint32_t, uint16_t, const void *) =
+      [](uint32_t, uint16_t eventType, const void *eventData) {
+        if (eventType == kPalEventType) {
+          uint64_t now = chreGetTime();
+          gSamples.record(now - eventDataToTimestamp(eventData));
+          if (gNumPalEventsReceived.fetch_add(1) + 1 == kNumPalEvents) {
+            gSamples.endNs = now;
+            TestEventQueueSingleton::get()->pushEvent(PAL_EVENTS_DONE);
+          }
+        }
+      };
+};
+
+/**
+ * Latency from a PAL posting a data event to the nanoapp receiving it, when
+ * the event is posted from a deferred callback, as the system does to update
+ * its state from within the CHRE thread. Each event goes through the event
+ * queue twice.
+ */
+TEST_F(ChreBench, PalEventDeferredDelivery) {
+  gSamples.reset(kNumPalEvents);
+  gNumPalEventsReceived = 0;
+  auto app = loadNanoapp<PalEventApp>();
+  ASSERT_TRUE(EventLoopManagerSingleton::get()
+                  ->getEventLoop()
+                  .findNanoappInstanceIdByAppId(app.id,
+                                                &gPalEventTargetInstanceId));
+
+  runPalEventScenario([](void *eventData) {
+    auto callback = [](uint16_t /*type*/, void *data, void * /*extraData*/) {
+      EventLoopManagerSingleton::get()->getEventLoop().postEventOrDie(
+          kPalEventType, data, nullptr /* freeCallback */,
+          gPalEventTargetInstanceId);
+    };
+    EventLoopManagerSingleton::get()->deferCallback(
+        SystemCallbackType::WifiHandleScanEvent, eventData, callback);
+  });
+  waitForEvent(PAL_EVENTS_DONE);
+
+  reportScenario("pal_event_deferred_delivery");
+}
+
+/**
+ * Same as PalEventDeferredDelivery, with the system state updated by the
+ * pre-dispatch hook of the event, which goes through the event queue once.
+ */
+TEST_F(ChreBench, PalEventSingleHopDelivery) {
+  gSamples.reset(kNumPalEvents);
+  gNumPalEventsReceived = 0;
+  auto app = loadNanoapp<PalEventApp>();
+  ASSERT_TRUE(EventLoopManagerSingleton::get()
+                  ->getEventLoop()
+                  .findNanoappInstanceIdByAppId(app.id,
+                                                &gPalEventTargetInstanceId));
+
+  runPalEventScenario([](void *eventData) {
+    auto hook = [](uint16_t /*eventType*/, void * /*eventData*/) -> uint16_t {
+      return gPalEventTargetInstanceId;
+    };
+    EventLoopManagerSingleton::get()
+        ->getEventLoop()
+        .postEventWithPreDispatchHookOrDie(kPalEventType, eventData, hook,
+                                           nullptr /* freeCallback */);
+  });
+  waitForEvent(PAL_EVENTS_DONE);
+
+  reportScenario("pal_event_single_hop_delivery");
+}
+
+}  // namespace
+}  // namespace chre
@@ -0,0 +1,105 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cinttypes>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "chre/platform/log.h"
+#include "chre/platform/system_time.h"
+#include "kiss_fft_scalar.h"
+#include "kiss_fftr.h"
+
+#include "benchmark_report.h"
+#include "gtest/gtest.h"
+
+namespace chre {
+
+namespace {
+
+//! The 128 points of audio_world and the frame sizes accepted by
+//! chreAudioConfigureFeatures().
+constexpr int kFftSizes[] = {64, 128, 256, 512, 1024};
+
+constexpr size_t kNumIterations = 5000;
+
+//! A pseudo-random frame of audio samples.
+std::vector<kiss_fft_scalar> makeFrame(int nfft) {
+  std::vector<kiss_fft_scalar> frame(nfft);
+  uint32_t seed = static_cast<uint32_t>(nfft);
+  for (kiss_fft_scalar &sample : frame) {
+    seed = seed * 1664525 + 1013904223;
+    sample = static_cast<kiss_fft_scalar>(seed >> 16);
+  }
+  return frame;
+}
+
+template <typename FftFunction>
+void benchmarkFft(const char *name, kiss_fftr_cfg config, FftFunction fft,
+                  const std::vector<kiss_fft_scalar> &frame) {
+  std::vector<kiss_fft_cpx> spectrum(frame.size() / 2 + 1);
+  BenchmarkSamples samples;
+  samples.reset(kNumIterations);
+
+  // Warm up the caches.
+  fft(config, frame.data(), spectrum.data());
+
+  samples.startNs = SystemTime::getMonotonicTime().toRawNanoseconds();
+  for (size_t i = 0; i < kNumIterations; i++) {
+    uint64_t startNs = SystemTime::getMonotonicTime().toRawNanoseconds();
+    fft(config, frame.data(), spectrum.data());
+    samples.record(SystemTime::getMonotonicTime().toRawNanoseconds() -
+                   startNs);
+  }
+  samples.endNs = SystemTime::getMonotonicTime().toRawNanoseconds();
+
+  const BenchmarkResult &result =
+      getBenchmarkReport().addScenario(name, samples);
+  LOGI("%s: p50 %" PRIu64 " ns, p99 %" PRIu64 " ns, %.1f FFTs/s", name,
+       result.p50Ns, result.p99Ns, result.eventsPerSec);
+}
+
+}  // anonymous namespace
+
+/**
+ * Duration of the real FFT of one frame of audio, as computed by the audio
+ * nanoapps and by the audio feature extraction of the core.
+ *
+ * Each size is measured with kiss_fft as built for CHRE, which uses the SIMD
+ * variant when enabled, and with the scalar build as a baseline.
+ */
+TEST(FftBench, RealFft) {
+  for (int nfft : kFftSizes) {
+    std::vector<kiss_fft_scalar> frame = makeFrame(nfft);
+    kiss_fftr_cfg config = kiss_fftr_alloc(nfft, 0 /* inverse_fft */,
+                                           nullptr /* mem */, nullptr);
+    kiss_fftr_cfg scalarConfig =
+        scalar_kiss_fftr_alloc(nfft, 0 /* inverse_fft */, nullptr, nullptr);
+    ASSERT_NE(config, nullptr);
+    ASSERT_NE(scalarConfig, nullptr);
+
+    std::string name = "kiss_fftr_" + std::to_string(nfft);
+    benchmarkFft(name.c_str(), config, kiss_fftr, frame);
+    name = "kiss_fftr_scalar_" + std::to_string(nfft);
+    benchmarkFft(name.c_str(), scalarConfig, scalar_kiss_fftr, frame);
+
+    kiss_fftr_free(config);
+    kiss_fftr_free(scalarConfig);
+  }
+}
+
+}  // namespace chre
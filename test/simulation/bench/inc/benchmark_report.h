@@ -0,0 +1,129 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CHRE_SIMULATION_BENCH_BENCHMARK_REPORT_H_
+#define CHRE_SIMULATION_BENCH_BENCHMARK_REPORT_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace chre {
+
+/**
+ * The raw measurements of one benchmark scenario.
+ *
+ * Samples are typically recorded from a nanoapp running in the CHRE thread and
+ * read by the test thread once the nanoapp signaled completion through the
+ * TestEventQueue, which orders the accesses.
+ */
+struct BenchmarkSamples {
+  //! One latency measurement per event, in nanoseconds.
+  std::vector<uint64_t> latenciesNs;
+
+  //! Monotonic time at which the scenario started and ended, used to compute
+  //! the event throughput.
+  uint64_t startNs = 0;
+  uint64_t endNs = 0;
+
+  //! Peak number of events pending in the event queue during the scenario.
+  uint32_t maxEventQueueSize = 0;
+
+  /**
+   * Clears the samples and reserves room for the expected number of samples,
+   * so that recording a sample doesn't allocate.
+   */
+  void reset(size_t expectedSampleCount) {
+    latenciesNs.clear();
+    latenciesNs.reserve(expectedSampleCount);
+    startNs = 0;
+    endNs = 0;
+    maxEventQueueSize = 0;
+  }
+
+  void record(uint64_t latencyNs) {
+    latenciesNs.push_back(latencyNs);
+  }
+
+  size_t size() const {
+    return latenciesNs.size();
+  }
+};
+
+/**
+ * Summary statistics of one benchmark scenario.
+ */
+struct BenchmarkResult {
+  std::string name;
+  size_t sampleCount;
+  uint64_t p50Ns;
+  uint64_t p99Ns;
+  uint64_t p999Ns;
+  uint64_t maxNs;
+  double eventsPerSec;
+  uint32_t maxEventQueueSize;
+};
+
+/**
+ * Collects the results of the benchmark scenarios run by chre_bench and
+ * serializes them as JSON:
+ *
+ * {
+ *   "benchmarks": [
+ *     {
+ *       "name": "timer_jitter",
+ *       "samples": 1000,
+ *       "p50_ns": 1234,
+ *       "p99_ns": 5678,
+ *       "p999_ns": 9012,
+ *       "max_ns": 12345,
+ *       "events_per_sec": 999.5,
+ *       "max_event_queue_size": 3
+ *     }
+ *   ]
+ * }
+ */
+class BenchmarkReport {
+ public:
+  /**
+   * Computes the statistics of a scenario and adds them to the report.
+   *
+   * @param name The name of the scenario, in snake_case.
+   * @param samples The measurements. The latencies are sorted in place.
+   * @return The statistics added to the report.
+   */
+  const BenchmarkResult &addScenario(const char *name,
+                                     BenchmarkSamples &samples);
+
+  std::string toJson() const;
+
+  const std::vector<BenchmarkResult> &getResults() const {
+    return mResults;
+  }
+
+ private:
+  std::vector<BenchmarkResult> mResults;
+};
+
+/**
+ * @return The report shared by all the scenarios of the benchmark binary.
+ */
+BenchmarkReport &getBenchmarkReport();
+
+}  // namespace chre
+
+#endif  // CHRE_SIMULATION_BENCH_BENCHMARK_REPORT_H_
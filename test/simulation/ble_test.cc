@@ -574,5 +574,130 @@ TEST_F(TestBase, BleSettingDisabledStopScanTest) {
   waitForEvent(SCAN_STOPPED);
 }
 
+/**
+ * This test validates that a nanoapp only receives the advertising reports
+ * matching its scan filter, while other nanoapps scanning without filter keep
+ * receiving all of them.
+ */
+TEST_F(TestBase, BleScanFilterPerNanoappTest) {
+  CREATE_CHRE_TEST_EVENT(START_SCAN, 0);
+  CREATE_CHRE_TEST_EVENT(SCAN_STARTED, 1);
+  CREATE_CHRE_TEST_EVENT(GET_NUM_ADVERTISEMENTS, 2);
+
+  struct UnfilteredApp : public BleTestNanoapp {
+    uint64_t id = 0x0123456789000001;
+
+    void (*handleEvent)(uint32_t, uint16_t,
+                        const void *) = [](uint32_t, uint16_t eventType,
+                                           const void *eventData) {
+      switch (eventType) {
+        case CHRE_EVENT_BLE_ASYNC_RESULT: {
+          auto *event = static_cast<const struct chreAsyncResult *>(eventData);
+          if (event->requestType == CHRE_BLE_REQUEST_TYPE_START_SCAN &&
+              event->errorCode == CHRE_ERROR_NONE) {
+            TestEventQueueSingleton::get()->pushEvent(SCAN_STARTED);
+          }
+          break;
+        }
+
+        case CHRE_EVENT_BLE_ADVERTISEMENT: {
+          TestEventQueueSingleton::get()->pushEvent(
+              CHRE_EVENT_BLE_ADVERTISEMENT);
+          break;
+        }
+
+        case CHRE_EVENT_TEST_EVENT: {
+          auto event = static_cast<const TestEvent *>(eventData);
+          if (event->type == START_SCAN) {
+            const bool success = chreBleStartScanAsync(
+                CHRE_BLE_SCAN_MODE_AGGRESSIVE, 0, nullptr);
+            TestEventQueueSingleton::get()->pushEvent(START_SCAN, success);
+          }
+          break;
+        }
+      }
+    };
+  };
+
+  struct FilteredApp : public BleTestNanoapp {
+    uint64_t id = 0x0123456789000002;
+
+    void (*handleEvent)(uint32_t, uint16_t,
+                        const void *) = [](uint32_t, uint16_t eventType,
+                                           const void *eventData) {
+      static uint32_t numAdvertisements = 0;
+
+      switch (eventType) {
+        case CHRE_EVENT_BLE_ASYNC_RESULT: {
+          auto *event = static_cast<const struct chreAsyncResult *>(eventData);
+          if (event->requestType == CHRE_BLE_REQUEST_TYPE_START_SCAN &&
+              event->errorCode == CHRE_ERROR_NONE) {
+            TestEventQueueSingleton::get()->pushEvent(SCAN_STARTED);
+          }
+          break;
+        }
+
+        case CHRE_EVENT_BLE_ADVERTISEMENT: {
+          numAdvertisements++;
+          break;
+        }
+
+        case CHRE_EVENT_TEST_EVENT: {
+          auto event = static_cast<const TestEvent *>(eventData);
+          switch (event->type) {
+            case START_SCAN: {
+              // The service data advertised by the PAL has no payload, so it
+              // never matches this filter.
+              chreBleGenericFilter genericFilter{};
+              genericFilter.type = CHRE_BLE_AD_TYPE_SERVICE_DATA_WITH_UUID_16;
+              genericFilter.len = 2;
+              genericFilter.data[0] = 0x2C;
+              genericFilter.data[1] = 0xFE;
+              genericFilter.dataMask[0] = 0xFF;
+              genericFilter.dataMask[1] = 0xFF;
+              chreBleScanFilter filter{CHRE_BLE_RSSI_THRESHOLD_NONE, 1,
+                                       &genericFilter};
+              const bool success = chreBleStartScanAsync(
+                  CHRE_BLE_SCAN_MODE_BACKGROUND, 0, &filter);
+              TestEventQueueSingleton::get()->pushEvent(START_SCAN, success);
+              break;
+            }
+
+            case GET_NUM_ADVERTISEMENTS: {
+              TestEventQueueSingleton::get()->pushEvent(GET_NUM_ADVERTISEMENTS,
+                                                        numAdvertisements);
+              break;
+            }
+          }
+          break;
+        }
+      }
+    };
+  };
+
+  auto filteredApp = loadNanoapp<FilteredApp>();
+  auto unfilteredApp = loadNanoapp<UnfilteredApp>();
+
+  bool success;
+  sendEventToNanoapp(filteredApp, START_SCAN);
+  waitForEvent(START_SCAN, &success);
+  EXPECT_TRUE(success);
+  waitForEvent(SCAN_STARTED);
+  sendEventToNanoapp(unfilteredApp, START_SCAN);
+  waitForEvent(START_SCAN, &success);
+  EXPECT_TRUE(success);
+  waitForEvent(SCAN_STARTED);
+  ASSERT_TRUE(chrePalIsBleEnabled());
+
+  for (int i = 0; i < 3; i++) {
+    waitForEvent(CHRE_EVENT_BLE_ADVERTISEMENT);
+  }
+
+  uint32_t numAdvertisements;
+  sendEventToNanoapp(filteredApp, GET_NUM_ADVERTISEMENTS);
+  waitForEvent(GET_NUM_ADVERTISEMENTS, &numAdvertisements);
+  EXPECT_EQ(numAdvertisements, 0);
+}
+
 }  // namespace
 }  // namespace chre
@@ -44,7 +44,7 @@ bool waitForCondition(const std::function<bool()> &predicate,
                       std::chrono::milliseconds timeout) {
   constexpr std::chrono::milliseconds kSleepDuration(100);
   bool result;
-  std::chrono::milliseconds time;
+  std::chrono::milliseconds time(0);
   while (!(result = predicate()) && time < timeout) {
     std::this_thread::sleep_for(kSleepDuration);
     time += kSleepDuration;
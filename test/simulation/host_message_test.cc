@@ -0,0 +1,155 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "test_base.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <cstring>
+
+#include "chre/core/event_loop_manager.h"
+#include "chre/core/host_comms_manager.h"
+#include "chre_api/chre/event.h"
+#include "test_event_queue.h"
+#include "test_util.h"
+
+namespace chre {
+
+namespace {
+
+constexpr uint32_t kMessageType = 1234;
+constexpr uint16_t kHostEndpointId = 123;
+
+//! What the nanoapp saw of a message from the host.
+struct ReceivedMessage {
+  const void *message;
+  uint32_t messageSize;
+  uint32_t messageType;
+  uint16_t hostEndpoint;
+  uint32_t checksum;
+};
+
+struct App : public TestNanoapp {
+  void (*handleEvent)(uint32_t, uint16_t, const void *) =
+      [](uint32_t, uint16_t eventType, const void *eventData) {
+        if (eventType == CHRE_EVENT_MESSAGE_FROM_HOST) {
+          auto data = static_cast<const chreMessageFromHostData *>(eventData);
+          ReceivedMessage received = {
+              .message = data->message,
+              .messageSize = data->messageSize,
+              .messageType = data->messageType,
+              .hostEndpoint = data->hostEndpoint,
+              .checksum = 0,
+          };
+          auto bytes = static_cast<const uint8_t *>(data->message);
+          for (uint32_t i = 0; i < data->messageSize; i++) {
+            received.checksum += bytes[i];
+          }
+          TestEventQueueSingleton::get()->pushEvent(
+              CHRE_EVENT_MESSAGE_FROM_HOST, received);
+        }
+      };
+};
+
+uint32_t fillPayload(uint8_t *payload, size_t size) {
+  uint32_t checksum = 0;
+  for (size_t i = 0; i < size; i++) {
+    payload[i] = static_cast<uint8_t>(i * 7);
+    checksum += payload[i];
+  }
+  return checksum;
+}
+
+TEST_F(TestBase, MessageFromHostIsCopiedWithoutReceiveBuffer) {
+  auto app = loadNanoapp<App>();
+
+  uint8_t payload[100];
+  const uint32_t checksum = fillPayload(payload, sizeof(payload));
+  EventLoopManagerSingleton::get()
+      ->getHostCommsManager()
+      .sendMessageToNanoappFromHost(app.id, kMessageType, kHostEndpointId,
+                                    payload, sizeof(payload));
+
+  ReceivedMessage received;
+  waitForEvent(CHRE_EVENT_MESSAGE_FROM_HOST, &received);
+  EXPECT_NE(received.message, payload);
+  EXPECT_EQ(received.messageSize, sizeof(payload));
+  EXPECT_EQ(received.messageType, kMessageType);
+  EXPECT_EQ(received.hostEndpoint, kHostEndpointId);
+  EXPECT_EQ(received.checksum, checksum);
+}
+
+TEST_F(TestBase, MessageFromHostReferencesReceiveBuffer) {
+  auto app = loadNanoapp<App>();
+
+  // Place the payload behind a fake header, like a link layer protocol would.
+  constexpr size_t kHeaderSize = 16;
+  constexpr size_t kPayloadSize = 4000;
+  SharedPtr<HostReceiveBuffer> receiveBuffer =
+      HostReceiveBuffer::create(kHeaderSize + kPayloadSize);
+  ASSERT_FALSE(receiveBuffer.isNull());
+  const uint8_t *payload = receiveBuffer->data() + kHeaderSize;
+  const uint32_t checksum =
+      fillPayload(receiveBuffer->data() + kHeaderSize, kPayloadSize);
+
+  EventLoopManagerSingleton::get()
+      ->getHostCommsManager()
+      .sendMessageToNanoappFromHost(app.id, kMessageType, kHostEndpointId,
+                                    receiveBuffer, payload, kPayloadSize);
+  // The message keeps the buffer alive once the link layer is done with it.
+  receiveBuffer.reset();
+
+  ReceivedMessage received;
+  waitForEvent(CHRE_EVENT_MESSAGE_FROM_HOST, &received);
+  EXPECT_EQ(received.message, payload);
+  EXPECT_EQ(received.messageSize, kPayloadSize);
+  EXPECT_EQ(received.messageType, kMessageType);
+  EXPECT_EQ(received.hostEndpoint, kHostEndpointId);
+  EXPECT_EQ(received.checksum, checksum);
+}
+
+TEST_F(TestBase, MessagesFromHostShareReceiveBuffer) {
+  auto app = loadNanoapp<App>();
+
+  constexpr size_t kPayloadSize = 64;
+  SharedPtr<HostReceiveBuffer> receiveBuffer =
+      HostReceiveBuffer::create(2 * kPayloadSize);
+  ASSERT_FALSE(receiveBuffer.isNull());
+  const uint32_t checksum = fillPayload(receiveBuffer->data(), kPayloadSize);
+  memcpy(receiveBuffer->data() + kPayloadSize, receiveBuffer->data(),
+         kPayloadSize);
+
+  HostCommsManager &hostCommsManager =
+      EventLoopManagerSingleton::get()->getHostCommsManager();
+  for (size_t i = 0; i < 2; i++) {
+    hostCommsManager.sendMessageToNanoappFromHost(
+        app.id, kMessageType + i, kHostEndpointId, receiveBuffer,
+        receiveBuffer->data() + i * kPayloadSize, kPayloadSize);
+  }
+  receiveBuffer.reset();
+
+  for (size_t i = 0; i < 2; i++) {
+    ReceivedMessage received;
+    waitForEvent(CHRE_EVENT_MESSAGE_FROM_HOST, &received);
+    EXPECT_EQ(received.messageType, kMessageType + i);
+    EXPECT_EQ(received.checksum, checksum);
+  }
+}
+
+}  // namespace
+
+}  // namespace chre
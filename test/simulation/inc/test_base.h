@@ -44,6 +44,18 @@ class TestBase : public testing::Test {
     return 5 * kOneSecondInNanoseconds;
   }
 
+  /**
+   * This method can be overridden in a derived class to run the test in
+   * virtual time, where the clock jumps to the next timer or PAL deadline as
+   * soon as the event loop is idle (see VirtualClock). The test timeout is
+   * still measured in real time.
+   *
+   * @return Whether the test runs in virtual time.
+   */
+  virtual bool useVirtualTime() const {
+    return false;
+  }
+
   /**
    * A convenience method to invoke waitForEvent() for the TestEventQueue
    * singleton.
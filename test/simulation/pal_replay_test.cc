@@ -0,0 +1,409 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+#include "chre/core/event_loop_manager.h"
+#include "chre/platform/linux/pal_replay.h"
+#include "chre/util/time.h"
+#include "chre_api/chre/ble.h"
+#include "chre_api/chre/event.h"
+#include "chre_api/chre/gnss.h"
+#include "chre_api/chre/sensor.h"
+#include "chre_api/chre/wifi.h"
+
+#include "gtest/gtest.h"
+#include "inc/test_util.h"
+#include "test_base.h"
+#include "test_event.h"
+#include "test_event_queue.h"
+#include "test_util.h"
+
+namespace chre {
+namespace {
+
+constexpr float kSpeedUp = 10.0f;
+
+constexpr uint32_t kNumAccelSamples = 1000;
+constexpr uint64_t kAccelPeriodNs = kOneMillisecondInNanoseconds;
+constexpr uint32_t kNumPressureSamples = 100;
+constexpr uint64_t kPressurePeriodNs = 10 * kOneMillisecondInNanoseconds;
+
+constexpr uint32_t kNumLocations = 10;
+constexpr uint32_t kNumScans = 5;
+constexpr uint8_t kNumResultsPerScan = 2;
+constexpr uint32_t kNumAdvertisements = 20;
+constexpr uint8_t kAdvertisingData[] = {0x02, 0x01, 0x06};
+
+//! The recording starts at an arbitrary time, which the replay must not care
+//! about.
+constexpr uint64_t kTraceStartNs = 12345 * kOneSecondInNanoseconds;
+
+std::vector<uint8_t> createTrace() {
+  PalReplayTraceWriter writer;
+
+  struct chreSensorInfo accel = {};
+  accel.sensorName = "Replay Accelerometer";
+  accel.sensorType = CHRE_SENSOR_TYPE_UNCALIBRATED_ACCELEROMETER;
+  accel.minInterval = kAccelPeriodNs;
+  writer.addSensor(accel);
+
+  struct chreSensorInfo pressure = {};
+  pressure.sensorName = "Replay Barometer";
+  pressure.sensorType = CHRE_SENSOR_TYPE_PRESSURE;
+  pressure.minInterval = kPressurePeriodNs;
+  writer.addSensor(pressure);
+
+  for (uint32_t i = 0; i < kNumAccelSamples; i++) {
+    float values[3] = {static_cast<float>(i), 0.0f, 9.81f};
+    writer.addSensorSample(kTraceStartNs + i * kAccelPeriodNs,
+                           0 /* sensorIndex */, values, 3);
+  }
+  for (uint32_t i = 0; i < kNumPressureSamples; i++) {
+    float value = 1000.0f + i;
+    writer.addSensorSample(kTraceStartNs + i * kPressurePeriodNs,
+                           1 /* sensorIndex */, &value, 1);
+  }
+
+  for (uint32_t i = 0; i < kNumLocations; i++) {
+    struct chreGnssLocationEvent location = {};
+    location.latitude_deg_e7 = 374220000 + i;
+    location.longitude_deg_e7 = -1220840000;
+    location.flags = CHRE_GPS_LOCATION_HAS_LAT_LONG;
+    writer.addGnssLocation(kTraceStartNs + i * kOneSecondInNanoseconds,
+                           location);
+  }
+
+  for (uint32_t i = 0; i < kNumScans; i++) {
+    struct chreWifiScanResult results[kNumResultsPerScan] = {};
+    for (uint8_t j = 0; j < kNumResultsPerScan; j++) {
+      results[j].bssid[5] = j;
+      results[j].rssi = static_cast<int8_t>(-40 - i);
+      results[j].band = CHRE_WIFI_BAND_2_4_GHZ;
+      results[j].primaryChannel = 2412;
+    }
+    writer.addWifiScan(kTraceStartNs + i * 10 * kOneSecondInNanoseconds,
+                       results, kNumResultsPerScan);
+  }
+
+  for (uint32_t i = 0; i < kNumAdvertisements; i++) {
+    struct chreBleAdvertisingReport report = {};
+    report.address[0] = static_cast<uint8_t>(i);
+    report.rssi = -60;
+    report.data = kAdvertisingData;
+    report.dataLength = sizeof(kAdvertisingData);
+    writer.addBleAdvertisement(
+        kTraceStartNs + i * 100 * kOneMillisecondInNanoseconds, report);
+  }
+
+  return writer.getData();
+}
+
+//! Replays the trace above in virtual time.
+class PalReplayTest : public TestBase {
+ protected:
+  void SetUp() override {
+    std::vector<uint8_t> trace = createTrace();
+    ASSERT_TRUE(
+        PalReplay::getInstance().loadFromBuffer(trace.data(), trace.size()));
+    PalReplay::getInstance().setSpeedUp(kSpeedUp);
+    TestBase::SetUp();
+  }
+
+  void TearDown() override {
+    TestBase::TearDown();
+    PalReplay::getInstance().logLagStats();
+    PalReplay::getInstance().unload();
+    PalReplay::getInstance().setSpeedUp(1.0);
+  }
+
+  bool useVirtualTime() const override {
+    return true;
+  }
+};
+
+TEST_F(PalReplayTest, ConcurrentSensorsFollowTheTrace) {
+  CREATE_CHRE_TEST_EVENT(CONFIGURE, 0);
+  CREATE_CHRE_TEST_EVENT(ACCEL_DONE, 1);
+  CREATE_CHRE_TEST_EVENT(PRESSURE_DONE, 2);
+
+  struct SensorSummary {
+    uint32_t count;
+    uint64_t firstTimestampNs;
+    uint64_t lastTimestampNs;
+    float lastValue;
+  };
+
+  struct App : public TestNanoapp {
+    void (*handleEvent)(uint32_t, uint16_t, const void *) =
+        [](uint32_t, uint16_t eventType, const void *eventData) {
+          static SensorSummary accel;
+          static SensorSummary pressure;
+
+          auto update = [](SensorSummary *summary,
+                           const struct chreSensorDataHeader &header,
+                           float value) {
+            if (summary->count == 0) {
+              summary->firstTimestampNs = header.baseTimestamp;
+            }
+            summary->count += header.readingCount;
+            summary->lastTimestampNs = header.baseTimestamp;
+            summary->lastValue = value;
+          };
+
+          switch (eventType) {
+            case CHRE_EVENT_SENSOR_UNCALIBRATED_ACCELEROMETER_DATA: {
+              auto *event =
+                  static_cast<const struct chreSensorThreeAxisData *>(
+                      eventData);
+              update(&accel, event->header, event->readings[0].x);
+              if (accel.count == kNumAccelSamples) {
+                TestEventQueueSingleton::get()->pushEvent(ACCEL_DONE, accel);
+              }
+              break;
+            }
+
+            case CHRE_EVENT_SENSOR_PRESSURE_DATA: {
+              auto *event =
+                  static_cast<const struct chreSensorFloatData *>(eventData);
+              update(&pressure, event->header, event->readings[0].value);
+              if (pressure.count == kNumPressureSamples) {
+                TestEventQueueSingleton::get()->pushEvent(PRESSURE_DONE,
+                                                          pressure);
+              }
+              break;
+            }
+
+            case CHRE_EVENT_TEST_EVENT: {
+              auto event = static_cast<const TestEvent *>(eventData);
+              if (event->type == CONFIGURE) {
+                auto mode = *static_cast<const chreSensorConfigureMode *>(
+                    event->data);
+                accel = {};
+                pressure = {};
+                uint32_t accelHandle;
+                uint32_t pressureHandle;
+                bool success =
+                    chreSensorFindDefault(
+                        CHRE_SENSOR_TYPE_UNCALIBRATED_ACCELEROMETER,
+                        &accelHandle) &&
+                    chreSensorFindDefault(CHRE_SENSOR_TYPE_PRESSURE,
+                                          &pressureHandle) &&
+                    chreSensorConfigure(accelHandle, mode, kAccelPeriodNs,
+                                        0 /*latency*/) &&
+                    chreSensorConfigure(pressureHandle, mode,
+                                        kPressurePeriodNs, 0 /*latency*/);
+                TestEventQueueSingleton::get()->pushEvent(CONFIGURE, success);
+              }
+              break;
+            }
+          }
+        };
+  };
+
+  auto app = loadNanoapp<App>();
+
+  bool success;
+  sendEventToNanoapp(app, CONFIGURE, CHRE_SENSOR_CONFIGURE_MODE_CONTINUOUS);
+  waitForEvent(CONFIGURE, &success);
+  ASSERT_TRUE(success);
+
+  // The last pressure sample is replayed before the last accelerometer one.
+  SensorSummary accel;
+  SensorSummary pressure;
+  waitForEvent(PRESSURE_DONE, &pressure);
+  waitForEvent(ACCEL_DONE, &accel);
+
+  EXPECT_EQ(accel.lastTimestampNs - accel.firstTimestampNs,
+            static_cast<uint64_t>((kNumAccelSamples - 1) * kAccelPeriodNs /
+                                  kSpeedUp));
+  EXPECT_EQ(accel.lastValue, kNumAccelSamples - 1);
+  EXPECT_EQ(pressure.lastTimestampNs - pressure.firstTimestampNs,
+            static_cast<uint64_t>((kNumPressureSamples - 1) *
+                                  kPressurePeriodNs / kSpeedUp));
+  EXPECT_EQ(pressure.lastValue, 1000.0f + kNumPressureSamples - 1);
+
+  // All the samples have been released once the request is processed.
+  sendEventToNanoapp(app, CONFIGURE, CHRE_SENSOR_CONFIGURE_MODE_DONE);
+  waitForEvent(CONFIGURE, &success);
+  EXPECT_TRUE(success);
+
+  PalReplay::LagStats lagStats = PalReplay::getInstance().getLagStats(
+      PalReplay::RecordType::SensorSample);
+  EXPECT_EQ(lagStats.numEvents, kNumAccelSamples + kNumPressureSamples);
+}
+
+TEST_F(PalReplayTest, LocationsScansAndAdvertisementsFollowTheTrace) {
+  CREATE_CHRE_TEST_EVENT(START, 0);
+  CREATE_CHRE_TEST_EVENT(LOCATIONS_DONE, 1);
+  CREATE_CHRE_TEST_EVENT(SCANS_DONE, 2);
+  CREATE_CHRE_TEST_EVENT(ADVERTISEMENTS_DONE, 3);
+
+  struct App : public TestNanoapp {
+    uint32_t perms = NanoappPermissions::CHRE_PERMS_GNSS |
+                     NanoappPermissions::CHRE_PERMS_WIFI |
+                     NanoappPermissions::CHRE_PERMS_BLE;
+
+    void (*handleEvent)(uint32_t, uint16_t, const void *) =
+        [](uint32_t, uint16_t eventType, const void *eventData) {
+          static uint32_t numLocations;
+          static int32_t lastLatitude;
+          static uint32_t numScans;
+          static uint32_t numResults;
+          static uint32_t numAdvertisements;
+          static uint32_t numAdvertisingBytes;
+
+          switch (eventType) {
+            case CHRE_EVENT_GNSS_LOCATION: {
+              auto *event =
+                  static_cast<const struct chreGnssLocationEvent *>(eventData);
+              lastLatitude = event->latitude_deg_e7;
+              if (++numLocations == kNumLocations) {
+                TestEventQueueSingleton::get()->pushEvent(LOCATIONS_DONE,
+                                                          lastLatitude);
+              }
+              break;
+            }
+
+            case CHRE_EVENT_WIFI_SCAN_RESULT: {
+              auto *event =
+                  static_cast<const struct chreWifiScanEvent *>(eventData);
+              numResults += event->resultCount;
+              if (++numScans == kNumScans) {
+                TestEventQueueSingleton::get()->pushEvent(SCANS_DONE,
+                                                          numResults);
+              }
+              break;
+            }
+
+            case CHRE_EVENT_BLE_ADVERTISEMENT: {
+              auto *event =
+                  static_cast<const struct chreBleAdvertisementEvent *>(
+                      eventData);
+              for (uint16_t i = 0; i < event->numReports; i++) {
+                numAdvertisingBytes += event->reports[i].dataLength;
+              }
+              if (++numAdvertisements == kNumAdvertisements) {
+                TestEventQueueSingleton::get()->pushEvent(ADVERTISEMENTS_DONE,
+                                                          numAdvertisingBytes);
+              }
+              break;
+            }
+
+            case CHRE_EVENT_TEST_EVENT: {
+              auto event = static_cast<const TestEvent *>(eventData);
+              if (event->type == START) {
+                numLocations = 0;
+                numScans = 0;
+                numResults = 0;
+                numAdvertisements = 0;
+                numAdvertisingBytes = 0;
+                bool success =
+                    chreGnssLocationSessionStartAsync(
+                        1000 /* minIntervalMs */, 0 /* minTimeToNextFixMs */,
+                        nullptr /* cookie */) &&
+                    chreWifiConfigureScanMonitorAsync(true /* enable */,
+                                                      nullptr /* cookie */) &&
+                    chreBleStartScanAsync(CHRE_BLE_SCAN_MODE_FOREGROUND,
+                                          0 /* reportDelayMs */,
+                                          nullptr /* filter */);
+                TestEventQueueSingleton::get()->pushEvent(START, success);
+              }
+              break;
+            }
+          }
+        };
+  };
+
+  auto app = loadNanoapp<App>();
+
+  bool success;
+  sendEventToNanoapp(app, START);
+  waitForEvent(START, &success);
+  ASSERT_TRUE(success);
+
+  // The streams end in this order.
+  uint32_t numAdvertisingBytes;
+  waitForEvent(ADVERTISEMENTS_DONE, &numAdvertisingBytes);
+  EXPECT_EQ(numAdvertisingBytes,
+            kNumAdvertisements * sizeof(kAdvertisingData));
+
+  int32_t lastLatitude;
+  waitForEvent(LOCATIONS_DONE, &lastLatitude);
+  EXPECT_EQ(lastLatitude, 374220000 + kNumLocations - 1);
+
+  uint32_t numResults;
+  waitForEvent(SCANS_DONE, &numResults);
+  EXPECT_EQ(numResults, kNumScans * kNumResultsPerScan);
+}
+
+TEST(PalReplayTraceTest, TraceFileRoundTrip) {
+  PalReplayTraceWriter writer;
+  struct chreSensorInfo info = {};
+  info.sensorName = "Replay Light";
+  info.sensorType = CHRE_SENSOR_TYPE_LIGHT;
+  info.isOnChange = 1;
+  writer.addSensor(info);
+  float value = 12.5f;
+  writer.addSensorSample(0 /* timestampNs */, 0 /* sensorIndex */, &value, 1);
+
+  const std::string path = testing::TempDir() + "pal_replay_test.trace";
+  ASSERT_TRUE(writer.writeToFile(path.c_str()));
+  PalReplay &replay = PalReplay::getInstance();
+  ASSERT_TRUE(replay.load(path.c_str()));
+  std::remove(path.c_str());
+
+  ASSERT_EQ(replay.getSensors().size(), 1);
+  EXPECT_STREQ(replay.getSensors()[0].sensorName, "Replay Light");
+  EXPECT_EQ(replay.getSensors()[0].isOnChange, 1);
+  ASSERT_EQ(
+      replay.getRecords(PalReplay::RecordType::SensorSample, 0).size(), 1);
+  replay.unload();
+  EXPECT_FALSE(replay.isLoaded());
+}
+
+TEST(PalReplayTraceTest, InvalidTracesAreRejected) {
+  PalReplay &replay = PalReplay::getInstance();
+  float values[3] = {};
+
+  // Sample of an undeclared sensor.
+  PalReplayTraceWriter undeclaredSensor;
+  undeclaredSensor.addSensorSample(0, 0 /* sensorIndex */, values, 3);
+  EXPECT_FALSE(replay.loadFromBuffer(undeclaredSensor.getData().data(),
+                                     undeclaredSensor.getData().size()));
+
+  // Records out of order.
+  PalReplayTraceWriter outOfOrder;
+  struct chreGnssLocationEvent location = {};
+  outOfOrder.addGnssLocation(2, location);
+  outOfOrder.addGnssLocation(1, location);
+  EXPECT_FALSE(replay.loadFromBuffer(outOfOrder.getData().data(),
+                                     outOfOrder.getData().size()));
+
+  // Truncated trace.
+  std::vector<uint8_t> trace = createTrace();
+  EXPECT_FALSE(replay.loadFromBuffer(trace.data(), trace.size() - 1));
+
+  // Bad magic.
+  trace[0] ^= 0xff;
+  EXPECT_FALSE(replay.loadFromBuffer(trace.data(), trace.size()));
+  EXPECT_FALSE(replay.isLoaded());
+}
+
+}  // namespace
+}  // namespace chre
@@ -21,6 +21,7 @@
 #include "chre/core/event_loop_manager.h"
 #include "chre/core/init.h"
 #include "chre/platform/linux/platform_log.h"
+#include "chre/platform/linux/virtual_clock.h"
 #include "chre/util/time.h"
 #include "chre_api/chre/version.h"
 #include "inc/test_util.h"
@@ -45,11 +46,6 @@ namespace chre {
 void TestBase::SetUp() {
   TestEventQueueSingleton::init();
   chre::PlatformLogSingleton::init();
-  chre::init();
-  EventLoopManagerSingleton::get()->lateInit();
-
-  mChreThread = std::thread(
-      []() { EventLoopManagerSingleton::get()->getEventLoop().run(); });
 
   auto callback = [](void *) {
     LOGE("Test timed out ...");
@@ -57,9 +53,21 @@ void TestBase::SetUp() {
         CHRE_EVENT_SIMULATION_TEST_TIMEOUT);
   };
 
+  // The timeout is set before enabling the virtual clock so that it is always
+  // measured in real time.
   ASSERT_TRUE(mSystemTimer.init());
   ASSERT_TRUE(mSystemTimer.set(callback, nullptr /*data*/,
                                Nanoseconds(getTimeoutNs())));
+
+  if (useVirtualTime()) {
+    VirtualClock::getInstance().enable();
+  }
+
+  chre::init();
+  EventLoopManagerSingleton::get()->lateInit();
+
+  mChreThread = std::thread(
+      []() { EventLoopManagerSingleton::get()->getEventLoop().run(); });
 }
 
 void TestBase::TearDown() {
@@ -70,6 +78,7 @@ void TestBase::TearDown() {
   mChreThread.join();
 
   chre::deinit();
+  VirtualClock::getInstance().disable();
   chre::PlatformLogSingleton::deinit();
   TestEventQueueSingleton::deinit();
   deleteNanoappInfos();
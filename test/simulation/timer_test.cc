@@ -21,6 +21,8 @@
 #include "chre/core/event_loop_manager.h"
 #include "chre/core/settings.h"
 #include "chre/platform/log.h"
+#include "chre/util/lock_guard.h"
+#include "chre/util/macros.h"
 #include "chre/util/time.h"
 #include "chre_api/chre/event.h"
 
@@ -39,6 +41,21 @@ class TestTimer : public TestBase {
   bool hasNanoappTimers(TimerPool &pool, uint16_t instanceId) {
     return pool.hasNanoappTimers(instanceId);
   }
+
+  void setTimerSlack(TimerPool &pool, Nanoseconds slack) {
+    LockGuard<Mutex> lock(pool.mMutex);
+    pool.mTimerSlack = slack;
+  }
+
+  uint32_t getNumWakeups(TimerPool &pool) {
+    LockGuard<Mutex> lock(pool.mMutex);
+    return pool.mNumWakeups;
+  }
+
+  uint32_t getNumTimersCoalesced(TimerPool &pool) {
+    LockGuard<Mutex> lock(pool.mMutex);
+    return pool.mNumTimersCoalesced;
+  }
 };
 
 namespace {
@@ -177,5 +194,120 @@ TEST_F(TestTimer, CancelPeriodicTimerOnUnload) {
   EXPECT_FALSE(hasNanoappTimers(timerPool, instanceId));
 }
 
+TEST_F(TestTimer, CancelTimersOutOfOrder) {
+  CREATE_CHRE_TEST_EVENT(START_TIMERS, 0);
+
+  // Timers are set in this order, and those at kCancelledIndices are
+  // cancelled before expiring.
+  static constexpr uint32_t kDurationsMs[] = {5, 1, 4, 2, 6, 3};
+  static constexpr size_t kNumTimers = ARRAY_SIZE(kDurationsMs);
+  static constexpr size_t kCancelledIndices[] = {2, 3};
+
+  struct App : public TestNanoapp {
+    void (*handleEvent)(uint32_t, uint16_t,
+                        const void *) = [](uint32_t, uint16_t eventType,
+                                           const void *eventData) {
+      static uint32_t cookies[kNumTimers];
+
+      switch (eventType) {
+        case CHRE_EVENT_TIMER: {
+          auto data = static_cast<const uint32_t *>(eventData);
+          TestEventQueueSingleton::get()->pushEvent(CHRE_EVENT_TIMER, *data);
+          break;
+        }
+
+        case CHRE_EVENT_TEST_EVENT: {
+          auto event = static_cast<const TestEvent *>(eventData);
+          if (event->type == START_TIMERS) {
+            uint32_t handles[kNumTimers];
+            for (size_t i = 0; i < kNumTimers; i++) {
+              cookies[i] = static_cast<uint32_t>(i);
+              handles[i] = chreTimerSet(
+                  kDurationsMs[i] * kOneMillisecondInNanoseconds, &cookies[i],
+                  true /*oneShot*/);
+            }
+
+            bool success = true;
+            for (size_t index : kCancelledIndices) {
+              success &= (handles[index] != CHRE_TIMER_INVALID) &&
+                         chreTimerCancel(handles[index]);
+              // A cancelled handle must not be found again.
+              success &= !chreTimerCancel(handles[index]);
+            }
+            TestEventQueueSingleton::get()->pushEvent(START_TIMERS, success);
+          }
+          break;
+        }
+      }
+    };
+  };
+
+  auto app = loadNanoapp<App>();
+
+  bool success;
+  sendEventToNanoapp(app, START_TIMERS);
+  waitForEvent(START_TIMERS, &success);
+  EXPECT_TRUE(success);
+
+  constexpr uint32_t kExpectedOrder[] = {1, 5, 0, 4};
+  for (uint32_t expected : kExpectedOrder) {
+    uint32_t cookie;
+    waitForEvent(CHRE_EVENT_TIMER, &cookie);
+    EXPECT_EQ(cookie, expected);
+  }
+}
+
+TEST_F(TestTimer, TimersWithinSlackShareWakeup) {
+  CREATE_CHRE_TEST_EVENT(START_TIMERS, 0);
+
+  struct App : public TestNanoapp {
+    void (*handleEvent)(uint32_t, uint16_t,
+                        const void *) = [](uint32_t, uint16_t eventType,
+                                           const void *eventData) {
+      switch (eventType) {
+        case CHRE_EVENT_TIMER: {
+          TestEventQueueSingleton::get()->pushEvent(CHRE_EVENT_TIMER);
+          break;
+        }
+
+        case CHRE_EVENT_TEST_EVENT: {
+          auto event = static_cast<const TestEvent *>(eventData);
+          if (event->type == START_TIMERS) {
+            uint32_t handle =
+                chreTimerSet(10 * kOneMillisecondInNanoseconds,
+                             nullptr /*cookie*/, true /*oneShot*/);
+            uint32_t otherHandle =
+                chreTimerSet(20 * kOneMillisecondInNanoseconds,
+                             nullptr /*cookie*/, true /*oneShot*/);
+            TestEventQueueSingleton::get()->pushEvent(
+                START_TIMERS, handle != CHRE_TIMER_INVALID &&
+                                  otherHandle != CHRE_TIMER_INVALID);
+          }
+          break;
+        }
+      }
+    };
+  };
+
+  TimerPool &timerPool =
+      EventLoopManagerSingleton::get()->getEventLoop().getTimerPool();
+  setTimerSlack(timerPool, Milliseconds(100));
+
+  auto app = loadNanoapp<App>();
+  uint32_t numWakeups = getNumWakeups(timerPool);
+
+  // The second timer expires within the slack of the first one, so both are
+  // handled by the same wakeup.
+  bool success;
+  sendEventToNanoapp(app, START_TIMERS);
+  waitForEvent(START_TIMERS, &success);
+  EXPECT_TRUE(success);
+  waitForEvent(CHRE_EVENT_TIMER);
+  waitForEvent(CHRE_EVENT_TIMER);
+
+  EXPECT_EQ(getNumWakeups(timerPool), numWakeups + 1);
+  EXPECT_EQ(getNumTimersCoalesced(timerPool), 1);
+}
+
 }  // namespace
 }  // namespace chre
@@ -0,0 +1,171 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "chre_api/chre/re.h"
+#include "chre_api/chre/sensor.h"
+
+#include <cstdint>
+
+#include "chre/core/event_loop_manager.h"
+#include "chre/platform/linux/pal_sensor.h"
+#include "chre/util/time.h"
+#include "chre_api/chre/event.h"
+
+#include "gtest/gtest.h"
+#include "inc/test_util.h"
+#include "test_base.h"
+#include "test_event.h"
+#include "test_event_queue.h"
+#include "test_util.h"
+
+namespace chre {
+namespace {
+
+//! Runs the test in virtual time, with a real-time timeout shorter than the
+//! simulated durations.
+class VirtualTimeTest : public TestBase {
+ protected:
+  bool useVirtualTime() const override {
+    return true;
+  }
+};
+
+TEST_F(VirtualTimeTest, PeriodicTimerRunsForAnHour) {
+  CREATE_CHRE_TEST_EVENT(START_TIMER, 0);
+  CREATE_CHRE_TEST_EVENT(TIMER_DONE, 1);
+
+  constexpr uint64_t kPeriodNs = kOneMinuteInNanoseconds;
+  constexpr uint32_t kNumTicks = 60;
+
+  struct App : public TestNanoapp {
+    void (*handleEvent)(uint32_t, uint16_t, const void *) =
+        [](uint32_t, uint16_t eventType, const void *eventData) {
+          static uint64_t startTimeNs = 0;
+          static uint32_t count = 0;
+          static uint32_t handle = CHRE_TIMER_INVALID;
+
+          switch (eventType) {
+            case CHRE_EVENT_TIMER: {
+              count++;
+              if (count == kNumTicks) {
+                chreTimerCancel(handle);
+                uint64_t elapsedNs = chreGetTime() - startTimeNs;
+                TestEventQueueSingleton::get()->pushEvent(TIMER_DONE,
+                                                          elapsedNs);
+              }
+              break;
+            }
+
+            case CHRE_EVENT_TEST_EVENT: {
+              auto event = static_cast<const TestEvent *>(eventData);
+              if (event->type == START_TIMER) {
+                count = 0;
+                startTimeNs = chreGetTime();
+                handle = chreTimerSet(kPeriodNs, nullptr /*cookie*/,
+                                      false /*oneShot*/);
+                TestEventQueueSingleton::get()->pushEvent(START_TIMER);
+              }
+              break;
+            }
+          }
+        };
+  };
+
+  auto app = loadNanoapp<App>();
+
+  sendEventToNanoapp(app, START_TIMER);
+  waitForEvent(START_TIMER);
+
+  uint64_t elapsedNs;
+  waitForEvent(TIMER_DONE, &elapsedNs);
+  EXPECT_EQ(elapsedNs, kNumTicks * kPeriodNs);
+}
+
+TEST_F(VirtualTimeTest, SensorSamplesFollowVirtualTime) {
+  CREATE_CHRE_TEST_EVENT(CONFIGURE, 0);
+  CREATE_CHRE_TEST_EVENT(SAMPLES_DONE, 1);
+
+  constexpr uint64_t kIntervalNs = kOneSecondInNanoseconds;
+  constexpr uint32_t kNumSamples = 600;
+
+  struct Configuration {
+    uint64_t interval;
+    enum chreSensorConfigureMode mode;
+  };
+
+  struct App : public TestNanoapp {
+    void (*handleEvent)(uint32_t, uint16_t, const void *) =
+        [](uint32_t, uint16_t eventType, const void *eventData) {
+          static uint64_t firstTimestampNs = 0;
+          static uint32_t count = 0;
+
+          switch (eventType) {
+            case CHRE_EVENT_SENSOR_UNCALIBRATED_ACCELEROMETER_DATA: {
+              auto *event =
+                  static_cast<const struct chreSensorThreeAxisData *>(
+                      eventData);
+              if (count == 0) {
+                firstTimestampNs = event->header.baseTimestamp;
+              }
+              count += event->header.readingCount;
+              if (count == kNumSamples) {
+                uint64_t elapsedNs =
+                    event->header.baseTimestamp - firstTimestampNs;
+                TestEventQueueSingleton::get()->pushEvent(SAMPLES_DONE,
+                                                          elapsedNs);
+              }
+              break;
+            }
+
+            case CHRE_EVENT_TEST_EVENT: {
+              auto event = static_cast<const TestEvent *>(eventData);
+              if (event->type == CONFIGURE) {
+                auto config = static_cast<const Configuration *>(event->data);
+                count = 0;
+                const bool success = chreSensorConfigure(
+                    0 /*sensorHandle*/, config->mode, config->interval,
+                    0 /*latency*/);
+                TestEventQueueSingleton::get()->pushEvent(CONFIGURE, success);
+              }
+              break;
+            }
+          }
+        };
+  };
+
+  auto app = loadNanoapp<App>();
+
+  Configuration config{.interval = kIntervalNs,
+                       .mode = CHRE_SENSOR_CONFIGURE_MODE_CONTINUOUS};
+  sendEventToNanoapp(app, CONFIGURE, config);
+  bool success;
+  waitForEvent(CONFIGURE, &success);
+  EXPECT_TRUE(success);
+
+  // Ten minutes of samples.
+  uint64_t elapsedNs;
+  waitForEvent(SAMPLES_DONE, &elapsedNs);
+  EXPECT_EQ(elapsedNs, (kNumSamples - 1) * kIntervalNs);
+
+  config.mode = CHRE_SENSOR_CONFIGURE_MODE_DONE;
+  sendEventToNanoapp(app, CONFIGURE, config);
+  waitForEvent(CONFIGURE, &success);
+  EXPECT_TRUE(success);
+  EXPECT_FALSE(chrePalSensorIsSensor0Enabled());
+}
+
+}  // namespace
+}  // namespace chre
@@ -16,6 +16,7 @@
 
 #include "chre_api/chre/wifi.h"
 #include <cstdint>
+#include <vector>
 #include "chre/core/event_loop_manager.h"
 #include "chre/core/settings.h"
 #include "chre/platform/linux/pal_nan.h"
@@ -227,5 +228,214 @@ TEST_F(TestBase, WifiScanMonitoringDisabledOnUnloadAndCanBeReEnabled) {
   EXPECT_TRUE(chrePalWifiIsScanMonitoringActive());
 }
 
+TEST_F(TestBase, WifiScanAsyncResultIsDeliveredBeforeScanResult) {
+  CREATE_CHRE_TEST_EVENT(SCAN_REQUEST, 0);
+  CREATE_CHRE_TEST_EVENT(WIFI_EVENT, 1);
+
+  struct App : public TestNanoapp {
+    uint32_t perms = NanoappPermissions::CHRE_PERMS_WIFI;
+
+    void (*handleEvent)(uint32_t, uint16_t, const void *) =
+        [](uint32_t, uint16_t eventType, const void *eventData) {
+          switch (eventType) {
+            case CHRE_EVENT_WIFI_ASYNC_RESULT:
+            case CHRE_EVENT_WIFI_SCAN_RESULT: {
+              TestEventQueueSingleton::get()->pushEvent(WIFI_EVENT, eventType);
+              break;
+            }
+
+            case CHRE_EVENT_TEST_EVENT: {
+              auto event = static_cast<const TestEvent *>(eventData);
+              switch (event->type) {
+                case SCAN_REQUEST:
+                  bool success =
+                      chreWifiRequestScanAsyncDefault(nullptr /* cookie */);
+                  TestEventQueueSingleton::get()->pushEvent(SCAN_REQUEST,
+                                                            success);
+              }
+            }
+          }
+        };
+  };
+
+  auto app = loadNanoapp<App>();
+
+  // The PAL sends the scan response and the scan event back to back, the async
+  // result must still be delivered first.
+  bool success;
+  sendEventToNanoapp(app, SCAN_REQUEST);
+  waitForEvent(SCAN_REQUEST, &success);
+  EXPECT_TRUE(success);
+  uint16_t wifiEventType;
+  ASSERT_NO_FATAL_FAILURE(waitForEvent(WIFI_EVENT, &wifiEventType));
+  EXPECT_EQ(wifiEventType, CHRE_EVENT_WIFI_ASYNC_RESULT);
+  ASSERT_NO_FATAL_FAILURE(waitForEvent(WIFI_EVENT, &wifiEventType));
+  EXPECT_EQ(wifiEventType, CHRE_EVENT_WIFI_SCAN_RESULT);
+}
+
+TEST_F(TestBase, WifiScanRequestsAreCoalesced) {
+  CREATE_CHRE_TEST_EVENT(SCAN_REQUEST, 0);
+  CREATE_CHRE_TEST_EVENT(WIFI_EVENT, 1);
+
+  //! A WiFi event received by a nanoapp, in the order of reception.
+  struct WifiEvent {
+    uint64_t appId;
+    uint16_t eventType;
+    bool success;
+    uint64_t scanTime;
+  };
+
+  struct App : public TestNanoapp {
+    uint32_t perms = NanoappPermissions::CHRE_PERMS_WIFI;
+
+    void (*handleEvent)(uint32_t, uint16_t, const void *) =
+        [](uint32_t, uint16_t eventType, const void *eventData) {
+          switch (eventType) {
+            case CHRE_EVENT_WIFI_ASYNC_RESULT: {
+              auto *event = static_cast<const chreAsyncResult *>(eventData);
+              WifiEvent wifiEvent = {};
+              wifiEvent.appId = chreGetAppId();
+              wifiEvent.eventType = eventType;
+              wifiEvent.success = event->success;
+              TestEventQueueSingleton::get()->pushEvent(WIFI_EVENT, wifiEvent);
+              break;
+            }
+
+            case CHRE_EVENT_WIFI_SCAN_RESULT: {
+              auto *event = static_cast<const chreWifiScanEvent *>(eventData);
+              WifiEvent wifiEvent = {};
+              wifiEvent.appId = chreGetAppId();
+              wifiEvent.eventType = eventType;
+              wifiEvent.scanTime = event->referenceTime;
+              TestEventQueueSingleton::get()->pushEvent(WIFI_EVENT, wifiEvent);
+              break;
+            }
+
+            case CHRE_EVENT_TEST_EVENT: {
+              auto event = static_cast<const TestEvent *>(eventData);
+              switch (event->type) {
+                case SCAN_REQUEST:
+                  chreWifiScanParams params = {};
+                  params.scanType = CHRE_WIFI_SCAN_TYPE_NO_PREFERENCE;
+                  params.maxScanAgeMs =
+                      *static_cast<const uint32_t *>(event->data);
+                  bool success =
+                      chreWifiRequestScanAsync(&params, nullptr /* cookie */);
+                  TestEventQueueSingleton::get()->pushEvent(SCAN_REQUEST,
+                                                            success);
+              }
+            }
+          }
+        };
+  };
+
+  struct OtherApp : public App {
+    uint64_t id = 0x0123456789000001;
+  };
+
+  chrePalWifiDelayScanResponse(true);
+  auto app = loadNanoapp<App>();
+  auto otherApp = loadNanoapp<OtherApp>();
+
+  // The second request is added to the scan in flight instead of failing.
+  uint32_t maxScanAgeMs = 5000;
+  bool success;
+  sendEventToNanoapp(app, SCAN_REQUEST, maxScanAgeMs);
+  waitForEvent(SCAN_REQUEST, &success);
+  EXPECT_TRUE(success);
+  sendEventToNanoapp(otherApp, SCAN_REQUEST, maxScanAgeMs);
+  waitForEvent(SCAN_REQUEST, &success);
+  EXPECT_TRUE(success);
+
+  // Each nanoapp receives its async result followed by the shared scan.
+  chrePalWifiStartSendingScanResponse();
+  chrePalWifiDelayScanResponse(false);
+  constexpr size_t kNumEventsPerApp = 2;
+  std::vector<WifiEvent> appEvents;
+  std::vector<WifiEvent> otherAppEvents;
+  for (size_t i = 0; i < 2 * kNumEventsPerApp; i++) {
+    WifiEvent wifiEvent;
+    ASSERT_NO_FATAL_FAILURE(waitForEvent(WIFI_EVENT, &wifiEvent));
+    if (wifiEvent.appId == app.id) {
+      appEvents.push_back(wifiEvent);
+    } else {
+      ASSERT_EQ(wifiEvent.appId, otherApp.id);
+      otherAppEvents.push_back(wifiEvent);
+    }
+  }
+
+  for (const std::vector<WifiEvent> *events : {&appEvents, &otherAppEvents}) {
+    ASSERT_EQ(events->size(), kNumEventsPerApp);
+    EXPECT_EQ((*events)[0].eventType, CHRE_EVENT_WIFI_ASYNC_RESULT);
+    EXPECT_TRUE((*events)[0].success);
+    EXPECT_EQ((*events)[1].eventType, CHRE_EVENT_WIFI_SCAN_RESULT);
+  }
+  EXPECT_EQ(appEvents[1].scanTime, otherAppEvents[1].scanTime);
+}
+
+#ifdef CHRE_WIFI_SCAN_CACHE_ENABLED
+TEST_F(TestBase, WifiScanRequestServedFromCache) {
+  CREATE_CHRE_TEST_EVENT(SCAN_REQUEST, 0);
+
+  struct App : public TestNanoapp {
+    uint32_t perms = NanoappPermissions::CHRE_PERMS_WIFI;
+
+    void (*handleEvent)(uint32_t, uint16_t, const void *) =
+        [](uint32_t, uint16_t eventType, const void *eventData) {
+          switch (eventType) {
+            case CHRE_EVENT_WIFI_SCAN_RESULT: {
+              auto *event = static_cast<const chreWifiScanEvent *>(eventData);
+              TestEventQueueSingleton::get()->pushEvent(
+                  CHRE_EVENT_WIFI_SCAN_RESULT, event->referenceTime);
+              break;
+            }
+
+            case CHRE_EVENT_TEST_EVENT: {
+              auto event = static_cast<const TestEvent *>(eventData);
+              switch (event->type) {
+                case SCAN_REQUEST:
+                  chreWifiScanParams params = {};
+                  params.scanType = CHRE_WIFI_SCAN_TYPE_NO_PREFERENCE;
+                  params.maxScanAgeMs =
+                      *static_cast<const uint32_t *>(event->data);
+                  bool success =
+                      chreWifiRequestScanAsync(&params, nullptr /* cookie */);
+                  TestEventQueueSingleton::get()->pushEvent(SCAN_REQUEST,
+                                                            success);
+              }
+            }
+          }
+        };
+  };
+
+  auto app = loadNanoapp<App>();
+
+  uint32_t maxScanAgeMs = 60000;
+  bool success;
+  uint64_t scanTime;
+  sendEventToNanoapp(app, SCAN_REQUEST, maxScanAgeMs);
+  waitForEvent(SCAN_REQUEST, &success);
+  EXPECT_TRUE(success);
+  waitForEvent(CHRE_EVENT_WIFI_SCAN_RESULT, &scanTime);
+
+  // A recent enough scan is delivered again.
+  uint64_t cachedScanTime;
+  sendEventToNanoapp(app, SCAN_REQUEST, maxScanAgeMs);
+  waitForEvent(SCAN_REQUEST, &success);
+  EXPECT_TRUE(success);
+  waitForEvent(CHRE_EVENT_WIFI_SCAN_RESULT, &cachedScanTime);
+  EXPECT_EQ(cachedScanTime, scanTime);
+
+  // A maxScanAgeMs of 0 always requires a new scan.
+  maxScanAgeMs = 0;
+  uint64_t newScanTime;
+  sendEventToNanoapp(app, SCAN_REQUEST, maxScanAgeMs);
+  waitForEvent(SCAN_REQUEST, &success);
+  EXPECT_TRUE(success);
+  waitForEvent(CHRE_EVENT_WIFI_SCAN_RESULT, &newScanTime);
+  EXPECT_GT(newScanTime, scanTime);
+}
+#endif  // CHRE_WIFI_SCAN_CACHE_ENABLED
+
 }  // namespace
 }  // namespace chre
\ No newline at end of file
@@ -54,6 +54,22 @@ class FixedSizeBlockingQueue : public NonCopyable {
    */
   ElementType pop();
 
+  /**
+   * Pops up to maxCount elements from the queue under a single lock
+   * acquisition, preserving their order. If the queue is empty, the thread will
+   * block until an element has been pushed.
+   *
+   * @param elements Array of at least maxCount elements that the popped
+   *     elements are moved into, starting at index 0.
+   * @param maxCount The maximum number of elements to pop, must be > 0.
+   * @param remaining If not null, populated with the number of elements left
+   *     in the queue after popping.
+   *
+   * @return The number of elements popped, which is always at least 1.
+   */
+  size_t popBatch(ElementType *elements, size_t maxCount,
+                  size_t *remaining = nullptr);
+
   /**
    * Determines whether or not the BlockingQueue is empty.
    */
@@ -17,6 +17,7 @@
 #ifndef CHRE_UTIL_FIXED_SIZE_BLOCKING_QUEUE_IMPL_H_
 #define CHRE_UTIL_FIXED_SIZE_BLOCKING_QUEUE_IMPL_H_
 
+#include "chre/platform/assert.h"
 #include "chre/util/fixed_size_blocking_queue.h"
 #include "chre/util/lock_guard.h"
 
@@ -61,6 +62,27 @@ ElementType FixedSizeBlockingQueue<ElementType, kSize>::pop() {
   return element;
 }
 
+template <typename ElementType, size_t kSize>
+size_t FixedSizeBlockingQueue<ElementType, kSize>::popBatch(
+    ElementType *elements, size_t maxCount, size_t *remaining) {
+  CHRE_ASSERT(maxCount > 0);
+  LockGuard<Mutex> lock(mMutex);
+  while (mQueue.empty()) {
+    mConditionVariable.wait(mMutex);
+  }
+
+  size_t count = 0;
+  while (count < maxCount && !mQueue.empty()) {
+    elements[count++] = std::move(mQueue.front());
+    mQueue.pop();
+  }
+
+  if (remaining != nullptr) {
+    *remaining = mQueue.size();
+  }
+  return count;
+}
+
 template <typename ElementType, size_t kSize>
 bool FixedSizeBlockingQueue<ElementType, kSize>::empty() {
   LockGuard<Mutex> lock(mMutex);
@@ -0,0 +1,176 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CHRE_UTIL_ATOMIC_MEMORY_POOL_H_
+#define CHRE_UTIL_ATOMIC_MEMORY_POOL_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "chre/platform/assert.h"
+#include "chre/platform/atomic.h"
+#include "chre/util/non_copyable.h"
+
+/**
+ * @file
+ * AtomicMemoryPool is a thread-safe, lock-free variant of MemoryPool. It
+ * offers the same interface as SynchronizedMemoryPool, so it can be used as a
+ * drop-in replacement where several threads allocate and free blocks
+ * concurrently and contention on the pool's lock is a concern.
+ *
+ * The free list is a Treiber stack of block indices. To avoid the ABA problem,
+ * where a thread reads the head and its successor, is preempted while other
+ * threads pop and push the same head back, then installs a stale successor,
+ * the head is a tagged index: the low 16 bits hold the index of the first free
+ * block and the high 16 bits hold a counter that is incremented on every
+ * update. A compare-and-exchange on the head therefore fails if the stack was
+ * modified in between, even if the same block is back on top.
+ *
+ * The successor links are kept in a separate array of atomics rather than in
+ * the unused block storage as MemoryPool does, so that a thread reading a link
+ * never races with another thread constructing an element in the same block.
+ *
+ * The pool supports at most 65534 blocks, since one index value marks the end
+ * of the free list.
+ */
+
+namespace chre {
+
+template <typename ElementType, size_t kSize>
+class AtomicMemoryPool : public NonCopyable {
+ public:
+  static_assert(kSize > 0 && kSize < UINT16_MAX,
+                "AtomicMemoryPool supports between 1 and 65534 blocks");
+
+  /**
+   * Constructs an AtomicMemoryPool with all blocks on the free list.
+   */
+  AtomicMemoryPool() {
+    for (size_t i = 0; i < kSize; i++) {
+      mLinks[i].nextFreeBlockIndex =
+          static_cast<uint32_t>((i + 1 < kSize) ? i + 1 : kInvalidIndex);
+    }
+  }
+
+  /**
+   * Allocates space for an object, constructs it and returns the pointer to
+   * that object. This method is thread-safe and lock-free.
+   *
+   * @param  The arguments to be forwarded to the constructor of the object.
+   * @return A pointer to a constructed object or nullptr if the allocation
+   *         fails.
+   */
+  template <typename... Args>
+  ElementType *allocate(Args &&... args) {
+    uint32_t head = mHead.load();
+    uint32_t blockIndex;
+    do {
+      blockIndex = getIndex(head);
+      if (blockIndex == kInvalidIndex) {
+        return nullptr;
+      }
+    } while (!mHead.compare_exchange(
+        head, makeHead(mLinks[blockIndex].nextFreeBlockIndex.load(), head)));
+
+    mFreeBlockCount.fetch_decrement();
+    return new (&blocks()[blockIndex]) ElementType(std::forward<Args>(args)...);
+  }
+
+  /**
+   * Releases the memory of a previously allocated element. The pointer provided
+   * here must be one that was produced by a previous call to the allocate()
+   * function. The destructor is invoked on the object. This method is
+   * thread-safe and lock-free.
+   *
+   * @param A pointer to an element that was previously allocated by the
+   *        allocate() function.
+   */
+  void deallocate(ElementType *element) {
+    uintptr_t elementAddress = reinterpret_cast<uintptr_t>(element);
+    uintptr_t baseAddress = reinterpret_cast<uintptr_t>(&blocks()[0]);
+    uint32_t blockIndex = static_cast<uint32_t>((elementAddress - baseAddress) /
+                                                sizeof(ElementType));
+    CHRE_ASSERT(blockIndex < kSize);
+
+    element->~ElementType();
+
+    uint32_t head = mHead.load();
+    do {
+      mLinks[blockIndex].nextFreeBlockIndex = getIndex(head);
+    } while (!mHead.compare_exchange(head, makeHead(blockIndex, head)));
+    mFreeBlockCount.fetch_increment();
+  }
+
+  /**
+   * @return the number of unused blocks in this memory pool. The value may be
+   *     stale by the time it is returned if other threads are using the pool.
+   */
+  size_t getFreeBlockCount() const {
+    return mFreeBlockCount.load();
+  }
+
+ private:
+  //! Marks the end of the free list.
+  static constexpr uint32_t kInvalidIndex = UINT16_MAX;
+
+  static constexpr uint32_t kIndexMask = 0xffff;
+  static constexpr uint32_t kTagIncrement = 0x10000;
+
+  static uint32_t getIndex(uint32_t head) {
+    return head & kIndexMask;
+  }
+
+  /**
+   * @return A new head value pointing at blockIndex, with the tag of the
+   *     previous head advanced.
+   */
+  static uint32_t makeHead(uint32_t blockIndex, uint32_t previousHead) {
+    return ((previousHead & ~kIndexMask) + kTagIncrement) |
+           (blockIndex & kIndexMask);
+  }
+
+  ElementType *blocks() {
+    return reinterpret_cast<ElementType *>(mBlocks);
+  }
+
+  //! Storage for the elements. To avoid static initialization of members,
+  //! std::aligned_storage is used.
+  typename std::aligned_storage<sizeof(ElementType),
+                                alignof(ElementType)>::type mBlocks[kSize];
+
+  //! The free list link of a block.
+  struct FreeListLink {
+    //! The index of the next free block, or kInvalidIndex. Only meaningful
+    //! while the block is free.
+    AtomicUint32 nextFreeBlockIndex{kInvalidIndex};
+  };
+
+  //! Free list links, one per block.
+  FreeListLink mLinks[kSize];
+
+  //! The tagged index of the first free block.
+  AtomicUint32 mHead{0};
+
+  //! The number of free blocks available.
+  AtomicUint32 mFreeBlockCount{static_cast<uint32_t>(kSize)};
+};
+
+}  // namespace chre
+
+#endif  // CHRE_UTIL_ATOMIC_MEMORY_POOL_H_
@@ -0,0 +1,319 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CHRE_UTIL_ATOMIC_MPSC_QUEUE_H_
+#define CHRE_UTIL_ATOMIC_MPSC_QUEUE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+
+#include "chre/platform/assert.h"
+#include "chre/platform/atomic.h"
+#include "chre/platform/condition_variable.h"
+#include "chre/platform/mutex.h"
+#include "chre/util/lock_guard.h"
+#include "chre/util/non_copyable.h"
+
+/**
+ * @file
+ * AtomicMpscQueue is a templated fixed-size FIFO queue supporting lock-free
+ * multiple-producer, single-consumer (MPSC) usage. Any number of threads may
+ * push into the queue concurrently without taking a lock, while exactly one
+ * thread of execution pulls from it. It offers the same interface as
+ * FixedSizeBlockingQueue, so it can be used as a drop-in replacement where
+ * producer contention on the queue's lock is a concern.
+ *
+ * The implementation is a bounded array where each slot carries a sequence
+ * number indicating whether it is ready to be written by a producer or read by
+ * the consumer. Producers claim a slot by advancing the tail index with a
+ * compare-and-exchange, construct the element, then publish it by updating the
+ * slot's sequence number. The consumer only reads slots that have been
+ * published, so a producer that is preempted between claiming and publishing
+ * only delays the consumer, never corrupts the queue.
+ *
+ * The blocking pop methods only fall back to the platform Mutex and
+ * ConditionVariable when the queue is empty. Producers only take the lock to
+ * signal the consumer if it is waiting, so in the common case where the
+ * consumer is busy processing earlier elements, pushing is lock-free.
+ *
+ * Since the indices are free-running 32-bit counters, the number of slots must
+ * divide 2^32, so the capacity is rounded up to the next power of 2.
+ */
+
+namespace chre {
+
+template <typename ElementType, size_t kMinCapacity>
+class AtomicMpscQueue : public NonCopyable {
+ public:
+  typedef ElementType value_type;
+
+  AtomicMpscQueue() {
+    for (size_t i = 0; i < kCapacity; i++) {
+      mSlots[i].sequence = static_cast<uint32_t>(i);
+    }
+  }
+
+  /**
+   * Destroying the queue must only be done when it is guaranteed that all
+   * producer and consumer execution contexts are stopped.
+   */
+  ~AtomicMpscQueue() {
+    ElementType element;
+    while (tryPop(&element)) {
+    }
+  }
+
+  size_t capacity() const {
+    return kCapacity;
+  }
+
+  /**
+   * Pushes an element into the queue and notifies the consumer if it is
+   * waiting for an element to be available. Safe to call from any thread.
+   *
+   * @param element The element to be pushed.
+   *
+   * @return true if the element was pushed, false if the queue is full.
+   */
+  bool push(const ElementType &element) {
+    return emplace(element);
+  }
+
+  bool push(ElementType &&element) {
+    return emplace(std::move(element));
+  }
+
+  /**
+   * Constructs a new element at the end of the queue in-place. Safe to call
+   * from any thread.
+   *
+   * @return true if the element was pushed, false if the queue is full.
+   */
+  template <typename... Args>
+  bool emplace(Args &&...args) {
+    bool success = false;
+    uint32_t pos = mTail.load();
+    Slot *slot;
+
+    while (true) {
+      slot = &mSlots[pos % kCapacity];
+      int32_t diff = static_cast<int32_t>(slot->sequence.load() - pos);
+      if (diff == 0) {
+        // The slot is free for this position, try to claim it. On failure,
+        // pos is updated to the current tail and we retry.
+        if (mTail.compare_exchange(pos, pos + 1)) {
+          success = true;
+          break;
+        }
+      } else if (diff < 0) {
+        // The consumer has not released this slot yet, i.e. we are full
+        break;
+      } else {
+        // Another producer claimed this position, reload and retry
+        pos = mTail.load();
+      }
+    }
+
+    if (success) {
+      new (slot->data()) ElementType(std::forward<Args>(args)...);
+      slot->sequence = pos + 1;
+      notifyConsumer();
+    }
+
+    return success;
+  }
+
+  /**
+   * Pops the oldest element from the queue if one is available. Must only be
+   * called from the consumer context.
+   *
+   * @param element Populated with the popped element on success.
+   *
+   * @return true if an element was popped.
+   */
+  bool tryPop(ElementType *element) {
+    uint32_t pos = mHead.load();
+    Slot &slot = mSlots[pos % kCapacity];
+    bool available =
+        (static_cast<int32_t>(slot.sequence.load() - (pos + 1)) >= 0);
+
+    if (available) {
+      ElementType *data = slot.data();
+      *element = std::move(*data);
+      data->~ElementType();
+
+      // Release the slot for the producer that will use it on the next lap
+      slot.sequence = pos + static_cast<uint32_t>(kCapacity);
+      mHead = pos + 1;
+    }
+
+    return available;
+  }
+
+  /**
+   * Pops one element from the queue. If the queue is empty, the thread will
+   * block until an element has been pushed. Must only be called from the
+   * consumer context.
+   *
+   * @return The element that was popped.
+   */
+  ElementType pop() {
+    ElementType element;
+    while (!tryPop(&element)) {
+      waitForElement();
+    }
+    return element;
+  }
+
+  /**
+   * Pops up to maxCount elements from the queue, preserving their order. If
+   * the queue is empty, the thread will block until an element has been
+   * pushed. Must only be called from the consumer context.
+   *
+   * @param elements Array of at least maxCount elements that the popped
+   *     elements are moved into, starting at index 0.
+   * @param maxCount The maximum number of elements to pop, must be > 0.
+   * @param remaining If not null, populated with a snapshot of the number of
+   *     elements left in the queue after popping.
+   *
+   * @return The number of elements popped, which is always at least 1.
+   */
+  size_t popBatch(ElementType *elements, size_t maxCount,
+                  size_t *remaining = nullptr) {
+    CHRE_ASSERT(maxCount > 0);
+    while (!tryPop(&elements[0])) {
+      waitForElement();
+    }
+
+    size_t count = 1;
+    while (count < maxCount && tryPop(&elements[count])) {
+      count++;
+    }
+
+    if (remaining != nullptr) {
+      *remaining = size();
+    }
+    return count;
+  }
+
+  /**
+   * Gets a snapshot of whether the queue is empty. Elements that are in the
+   * process of being pushed are counted as present. Safe to call from any
+   * context.
+   */
+  bool empty() const {
+    return (size() == 0);
+  }
+
+  /**
+   * Gets a snapshot of the number of elements currently stored in the queue.
+   * Elements that are in the process of being pushed are counted as present.
+   * Safe to call from any context.
+   */
+  size_t size() const {
+    uint32_t head = mHead.load();
+    uint32_t tail = mTail.load();
+
+    // The head is read first, so it can only lag behind the tail; a negative
+    // difference is only possible if the consumer ran in between the loads
+    int32_t diff = static_cast<int32_t>(tail - head);
+    return (diff > 0) ? static_cast<size_t>(diff) : 0;
+  }
+
+ private:
+  //! Rounds up to the next power of 2 (minimum 2).
+  static constexpr size_t roundUpToPowerOfTwo(size_t value,
+                                              size_t result = 2) {
+    return (result >= value) ? result
+                             : roundUpToPowerOfTwo(value, result * 2);
+  }
+
+  //! The number of slots in the queue.
+  static constexpr size_t kCapacity = roundUpToPowerOfTwo(kMinCapacity);
+  static_assert(kCapacity <= UINT32_MAX / 2,
+                "Large capacity usage of AtomicMpscQueue is not advised");
+
+  struct Slot {
+    Slot() : sequence(0) {}
+
+    //! Equal to the position that may next be written to this slot when it
+    //! is free, and that position + 1 once the element has been published.
+    AtomicUint32 sequence;
+
+    typename std::aligned_storage<sizeof(ElementType),
+                                  alignof(ElementType)>::type storage;
+
+    ElementType *data() {
+      return reinterpret_cast<ElementType *>(&storage);
+    }
+  };
+
+  //! Position of the next element to pop. Only modified by the consumer.
+  AtomicUint32 mHead{0};
+
+  //! Position the next producer will claim.
+  AtomicUint32 mTail{0};
+
+  //! Set by the consumer while it is (about to be) blocked waiting for an
+  //! element, so producers know to signal it.
+  AtomicBool mConsumerWaiting{false};
+
+  //! Used with mConditionVariable to block the consumer when the queue is
+  //! empty.
+  Mutex mMutex;
+
+  ConditionVariable mConditionVariable;
+
+  Slot mSlots[kCapacity];
+
+  //! @return true if the element at the head of the queue has been published
+  bool headAvailable() const {
+    uint32_t pos = mHead.load();
+    const Slot &slot = mSlots[pos % kCapacity];
+    return (static_cast<int32_t>(slot.sequence.load() - (pos + 1)) >= 0);
+  }
+
+  /**
+   * Blocks the consumer until the element at the head of the queue has been
+   * published, or a spurious wakeup occurs.
+   */
+  void waitForElement() {
+    LockGuard<Mutex> lock(mMutex);
+    mConsumerWaiting = true;
+
+    // Re-check after advertising that we are waiting: a producer either sees
+    // the flag and signals us after we start waiting (as it must acquire the
+    // mutex to do so), or published its element before we checked here.
+    if (!headAvailable()) {
+      mConditionVariable.wait(mMutex);
+    }
+    mConsumerWaiting = false;
+  }
+
+  //! Wakes up the consumer if it is blocked in waitForElement().
+  void notifyConsumer() {
+    if (mConsumerWaiting.load()) {
+      LockGuard<Mutex> lock(mMutex);
+      mConditionVariable.notify_one();
+    }
+  }
+};
+
+}  // namespace chre
+
+#endif  // CHRE_UTIL_ATOMIC_MPSC_QUEUE_H_
@@ -0,0 +1,193 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "chre/util/system/atomic_memory_pool.h"
+#include "chre/platform/log.h"
+#include "chre/util/synchronized_memory_pool.h"
+#include "gtest/gtest.h"
+
+#include <atomic>
+#include <chrono>
+#include <cinttypes>
+#include <set>
+#include <thread>
+#include <vector>
+
+using chre::AtomicMemoryPool;
+using chre::SynchronizedMemoryPool;
+
+TEST(AtomicMemoryPool, ExhaustPool) {
+  AtomicMemoryPool<int, 3> memoryPool;
+  EXPECT_EQ(memoryPool.getFreeBlockCount(), 3);
+  EXPECT_NE(memoryPool.allocate(), nullptr);
+  EXPECT_EQ(memoryPool.getFreeBlockCount(), 2);
+  EXPECT_NE(memoryPool.allocate(), nullptr);
+  EXPECT_EQ(memoryPool.getFreeBlockCount(), 1);
+  EXPECT_NE(memoryPool.allocate(), nullptr);
+  EXPECT_EQ(memoryPool.getFreeBlockCount(), 0);
+  EXPECT_EQ(memoryPool.allocate(), nullptr);
+  EXPECT_EQ(memoryPool.getFreeBlockCount(), 0);
+}
+
+TEST(AtomicMemoryPool, ExhaustPoolThenDeallocateOneAndAllocateOne) {
+  AtomicMemoryPool<int, 3> memoryPool;
+
+  int *element1 = memoryPool.allocate(0xcafe);
+  int *element2 = memoryPool.allocate(0xbeef);
+  int *element3 = memoryPool.allocate(0xface);
+
+  memoryPool.deallocate(element1);
+  EXPECT_EQ(memoryPool.getFreeBlockCount(), 1);
+  element1 = memoryPool.allocate(0xfade);
+  EXPECT_NE(element1, nullptr);
+  EXPECT_EQ(memoryPool.allocate(), nullptr);
+
+  EXPECT_EQ(*element1, 0xfade);
+  EXPECT_EQ(*element2, 0xbeef);
+  EXPECT_EQ(*element3, 0xface);
+}
+
+namespace {
+
+class ConstructionCounter {
+ public:
+  explicit ConstructionCounter(int *counter) : mCounter(counter) {
+    (*mCounter)++;
+  }
+
+  ~ConstructionCounter() {
+    (*mCounter)--;
+  }
+
+ private:
+  int *mCounter;
+};
+
+}  // namespace
+
+TEST(AtomicMemoryPool, ConstructsAndDestructsElements) {
+  int liveCount = 0;
+  AtomicMemoryPool<ConstructionCounter, 4> memoryPool;
+  ConstructionCounter *a = memoryPool.allocate(&liveCount);
+  ConstructionCounter *b = memoryPool.allocate(&liveCount);
+  EXPECT_EQ(liveCount, 2);
+  memoryPool.deallocate(a);
+  EXPECT_EQ(liveCount, 1);
+  memoryPool.deallocate(b);
+  EXPECT_EQ(liveCount, 0);
+  EXPECT_EQ(memoryPool.getFreeBlockCount(), 4);
+}
+
+TEST(AtomicMemoryPool, ConcurrentAllocateDeallocateKeepsBlocksExclusive) {
+  constexpr size_t kPoolSize = 32;
+  constexpr size_t kNumThreads = 8;
+  constexpr size_t kIterations = 50000;
+  AtomicMemoryPool<std::atomic<size_t>, kPoolSize> memoryPool;
+  std::atomic<bool> corrupted{false};
+
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < kNumThreads; t++) {
+    threads.emplace_back([&, t]() {
+      std::atomic<size_t> *held[3] = {};
+      for (size_t i = 0; i < kIterations; i++) {
+        size_t slot = i % 3;
+        if (held[slot] != nullptr) {
+          // If two threads were handed the same block, one of them would see
+          // the other's tag here.
+          if (held[slot]->load() != t) {
+            corrupted = true;
+          }
+          memoryPool.deallocate(held[slot]);
+        }
+        held[slot] = memoryPool.allocate(t);
+      }
+      for (std::atomic<size_t> *element : held) {
+        if (element != nullptr) {
+          memoryPool.deallocate(element);
+        }
+      }
+    });
+  }
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+
+  EXPECT_FALSE(corrupted);
+  EXPECT_EQ(memoryPool.getFreeBlockCount(), kPoolSize);
+
+  // Every block must be reachable exactly once from the free list.
+  std::set<std::atomic<size_t> *> blocks;
+  for (size_t i = 0; i < kPoolSize; i++) {
+    std::atomic<size_t> *element = memoryPool.allocate(i);
+    ASSERT_NE(element, nullptr);
+    EXPECT_TRUE(blocks.insert(element).second);
+  }
+  EXPECT_EQ(memoryPool.allocate(0), nullptr);
+}
+
+namespace {
+
+/**
+ * Measures the mean time taken by an allocate() plus deallocate() pair when the
+ * given number of threads use the pool concurrently, as PAL threads and the
+ * event loop do with the Event pool.
+ *
+ * @return The mean latency of an allocate/deallocate pair in nanoseconds
+ */
+template <typename PoolType>
+uint64_t measureAllocFreeLatencyNs(size_t numThreads) {
+  constexpr size_t kNumIterationsPerThread = 100000;
+  PoolType pool;
+  std::atomic<uint64_t> totalNs{0};
+
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < numThreads; t++) {
+    threads.emplace_back([&]() {
+      auto start = std::chrono::steady_clock::now();
+      for (size_t i = 0; i < kNumIterationsPerThread; i++) {
+        uint64_t *element = pool.allocate(i);
+        if (element != nullptr) {
+          pool.deallocate(element);
+        }
+      }
+      auto end = std::chrono::steady_clock::now();
+      totalNs += std::chrono::duration_cast<std::chrono::nanoseconds>(end -
+                                                                       start)
+                     .count();
+    });
+  }
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+
+  return totalNs.load() / (numThreads * kNumIterationsPerThread);
+}
+
+}  // namespace
+
+TEST(AtomicMemoryPool, ContentionBenchmark) {
+  constexpr size_t kThreadCounts[] = {1, 2, 4, 8};
+  for (size_t numThreads : kThreadCounts) {
+    uint64_t lockedNs =
+        measureAllocFreeLatencyNs<SynchronizedMemoryPool<uint64_t, 96>>(
+            numThreads);
+    uint64_t lockFreeNs =
+        measureAllocFreeLatencyNs<AtomicMemoryPool<uint64_t, 96>>(numThreads);
+    LOGI("%zu threads: SynchronizedMemoryPool alloc+free %" PRIu64
+         " ns, AtomicMemoryPool alloc+free %" PRIu64 " ns",
+         numThreads, lockedNs, lockFreeNs);
+  }
+}
@@ -0,0 +1,220 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "chre/util/system/atomic_mpsc_queue.h"
+#include "chre/platform/log.h"
+#include "chre/util/fixed_size_blocking_queue.h"
+#include "chre/util/unique_ptr.h"
+#include "gtest/gtest.h"
+
+#include <atomic>
+#include <chrono>
+#include <cinttypes>
+#include <thread>
+#include <vector>
+
+using chre::AtomicMpscQueue;
+using chre::FixedSizeBlockingQueue;
+using chre::MakeUnique;
+using chre::UniquePtr;
+
+TEST(AtomicMpscQueue, IsEmptyByDefault) {
+  AtomicMpscQueue<int, 16> q;
+  EXPECT_TRUE(q.empty());
+  EXPECT_EQ(q.size(), 0u);
+  int element;
+  EXPECT_FALSE(q.tryPop(&element));
+}
+
+TEST(AtomicMpscQueue, CapacityRoundedUpToPowerOfTwo) {
+  AtomicMpscQueue<int, 16> q16;
+  EXPECT_EQ(q16.capacity(), 16u);
+  AtomicMpscQueue<int, 96> q96;
+  EXPECT_EQ(q96.capacity(), 128u);
+}
+
+TEST(AtomicMpscQueue, PushPopVerifyOrder) {
+  AtomicMpscQueue<int, 16> q;
+  ASSERT_TRUE(q.push(0x1337));
+  ASSERT_TRUE(q.push(0xcafe));
+  EXPECT_EQ(q.size(), 2u);
+
+  EXPECT_EQ(q.pop(), 0x1337);
+  EXPECT_EQ(q.pop(), 0xcafe);
+  EXPECT_TRUE(q.empty());
+}
+
+TEST(AtomicMpscQueue, PushFailsWhenFull) {
+  AtomicMpscQueue<int, 4> q;
+  for (int i = 0; i < 4; i++) {
+    ASSERT_TRUE(q.push(i));
+  }
+  EXPECT_FALSE(q.push(4));
+  EXPECT_EQ(q.pop(), 0);
+  EXPECT_TRUE(q.push(4));
+
+  // Wrap around the slots a few times
+  for (int i = 5; i < 20; i++) {
+    EXPECT_EQ(q.pop(), i - 4);
+    ASSERT_TRUE(q.push(i));
+  }
+  EXPECT_EQ(q.size(), 4u);
+}
+
+TEST(AtomicMpscQueue, PopBatchVerifyOrder) {
+  AtomicMpscQueue<int, 16> q;
+  for (int i = 0; i < 5; i++) {
+    ASSERT_TRUE(q.push(i));
+  }
+
+  int elements[3];
+  size_t remaining;
+  ASSERT_EQ(q.popBatch(elements, 3, &remaining), 3u);
+  EXPECT_EQ(remaining, 2u);
+  EXPECT_EQ(elements[0], 0);
+  EXPECT_EQ(elements[1], 1);
+  EXPECT_EQ(elements[2], 2);
+
+  ASSERT_EQ(q.popBatch(elements, 3, &remaining), 2u);
+  EXPECT_EQ(remaining, 0u);
+  EXPECT_EQ(elements[0], 3);
+  EXPECT_EQ(elements[1], 4);
+}
+
+TEST(AtomicMpscQueue, PushPopMove) {
+  static constexpr int kVal = 0xbeef;
+  UniquePtr<int> ptr = MakeUnique<int>();
+  *ptr = kVal;
+
+  AtomicMpscQueue<UniquePtr<int>, 16> q;
+  ASSERT_TRUE(q.push(std::move(ptr)));
+  ASSERT_TRUE(ptr.isNull());
+  EXPECT_EQ(*(q.pop()), kVal);
+}
+
+TEST(AtomicMpscQueue, PopBlocksUntilPush) {
+  AtomicMpscQueue<int, 16> q;
+  std::thread producer([&q]() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    q.push(42);
+  });
+
+  EXPECT_EQ(q.pop(), 42);
+  producer.join();
+}
+
+TEST(AtomicMpscQueue, MultipleProducersPreserveOrderPerProducer) {
+  constexpr int kNumProducers = 4;
+  constexpr int kNumElementsPerProducer = 10000;
+  AtomicMpscQueue<uint32_t, 64> q;
+
+  std::vector<std::thread> producers;
+  for (int p = 0; p < kNumProducers; p++) {
+    producers.emplace_back([&q, p]() {
+      for (int i = 0; i < kNumElementsPerProducer; i++) {
+        uint32_t element = (static_cast<uint32_t>(p) << 16) | i;
+        while (!q.push(element)) {
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+
+  int nextExpected[kNumProducers] = {};
+  for (int i = 0; i < kNumProducers * kNumElementsPerProducer; i++) {
+    uint32_t element = q.pop();
+    int p = static_cast<int>(element >> 16);
+    ASSERT_LT(p, kNumProducers);
+    ASSERT_EQ(static_cast<int>(element & 0xffff), nextExpected[p]);
+    nextExpected[p]++;
+  }
+
+  for (std::thread &producer : producers) {
+    producer.join();
+  }
+  EXPECT_TRUE(q.empty());
+}
+
+namespace {
+
+/**
+ * Measures the mean time taken by a successful push() when the given number of
+ * producer threads post into the queue concurrently while a consumer drains it
+ * in batches, as the EventLoop does.
+ *
+ * @return The mean push latency in nanoseconds
+ */
+template <typename QueueType>
+uint64_t measurePushLatencyNs(size_t numProducers) {
+  constexpr size_t kNumElementsPerProducer = 20000;
+  QueueType q;
+  std::atomic<uint64_t> totalPushNs{0};
+  std::atomic<size_t> numPushed{0};
+  const size_t numTotal = numProducers * kNumElementsPerProducer;
+
+  std::thread consumer([&]() {
+    int *elements[16];
+    size_t numPopped = 0;
+    while (numPopped < numTotal) {
+      numPopped += q.popBatch(elements, 16);
+    }
+  });
+
+  std::vector<std::thread> producers;
+  for (size_t p = 0; p < numProducers; p++) {
+    producers.emplace_back([&]() {
+      uint64_t localNs = 0;
+      for (size_t i = 0; i < kNumElementsPerProducer; i++) {
+        while (true) {
+          auto start = std::chrono::steady_clock::now();
+          bool success = q.push(nullptr);
+          auto end = std::chrono::steady_clock::now();
+          if (success) {
+            localNs += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                           end - start)
+                           .count();
+            break;
+          }
+          std::this_thread::yield();
+        }
+      }
+      totalPushNs += localNs;
+      numPushed += kNumElementsPerProducer;
+    });
+  }
+
+  for (std::thread &producer : producers) {
+    producer.join();
+  }
+  consumer.join();
+
+  return totalPushNs.load() / numPushed.load();
+}
+
+}  // namespace
+
+TEST(AtomicMpscQueue, ProducerContentionBenchmark) {
+  constexpr size_t kProducerCounts[] = {1, 4, 8};
+  for (size_t numProducers : kProducerCounts) {
+    uint64_t lockedNs =
+        measurePushLatencyNs<FixedSizeBlockingQueue<int *, 128>>(numProducers);
+    uint64_t lockFreeNs =
+        measurePushLatencyNs<AtomicMpscQueue<int *, 128>>(numProducers);
+    LOGI("%zu producers: FixedSizeBlockingQueue push %" PRIu64
+         " ns, AtomicMpscQueue push %" PRIu64 " ns",
+         numProducers, lockedNs, lockFreeNs);
+  }
+}
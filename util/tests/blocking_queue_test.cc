@@ -49,3 +49,38 @@ TEST(FixedSizeBlockingQueue, PushPopMove) {
   ASSERT_TRUE(ptr.isNull());
   ASSERT_EQ(*(blockingQueue.pop()), kVal);
 }
+
+TEST(FixedSizeBlockingQueue, PopBatchVerifyOrder) {
+  FixedSizeBlockingQueue<int, 16> blockingQueue;
+  for (int i = 0; i < 5; i++) {
+    ASSERT_TRUE(blockingQueue.push(i));
+  }
+
+  int elements[3];
+  size_t remaining;
+  ASSERT_EQ(blockingQueue.popBatch(elements, 3, &remaining), 3u);
+  EXPECT_EQ(remaining, 2u);
+  EXPECT_EQ(elements[0], 0);
+  EXPECT_EQ(elements[1], 1);
+  EXPECT_EQ(elements[2], 2);
+
+  ASSERT_EQ(blockingQueue.popBatch(elements, 3, &remaining), 2u);
+  EXPECT_EQ(remaining, 0u);
+  EXPECT_EQ(elements[0], 3);
+  EXPECT_EQ(elements[1], 4);
+  EXPECT_TRUE(blockingQueue.empty());
+}
+
+TEST(FixedSizeBlockingQueue, PopBatchMove) {
+  static constexpr int kVal = 0xbeef;
+  UniquePtr<int> ptr = MakeUnique<int>();
+  *ptr = kVal;
+
+  FixedSizeBlockingQueue<UniquePtr<int>, 16> blockingQueue;
+  ASSERT_TRUE(blockingQueue.push(std::move(ptr)));
+
+  UniquePtr<int> elements[2];
+  ASSERT_EQ(blockingQueue.popBatch(elements, 2), 1u);
+  EXPECT_EQ(*elements[0], kVal);
+  EXPECT_TRUE(elements[1].isNull());
+}
@@ -10,4 +10,6 @@ CHRE_GNSS_SUPPORT_ENABLED = true
 CHRE_SENSORS_SUPPORT_ENABLED = true
 CHRE_WIFI_SUPPORT_ENABLED = true
 CHRE_WIFI_NAN_SUPPORT_ENABLED = true
+CHRE_WIFI_SCAN_CACHE_ENABLED = true
 CHRE_WWAN_SUPPORT_ENABLED = true
+CHRE_NANOAPP_SLAB_ALLOCATOR_ENABLED = true